@@ -0,0 +1,240 @@
+//===------------------------------Bytecode.h-----------------------------===//
+//
+// This file defines the linear bytecode that the interpreter executes and the
+// BytecodeCompiler that lowers moses IR to it.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "FrameLayout.h"
+#include "GenericValue.h"
+#include "IR/ConstantAndGlobal.h"
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Execution {
+using namespace IR;
+using Opcode = Instruction::Opcode;
+
+/// The list of bytecode opcodes, the order determines the layout of the
+/// dispatch table. The opcodes are specialized on the type of their operands
+/// when the IR is lowered, so the dispatch loop never inspects a type.
+///
+/// The opcodes after PrintBool are superinstructions, they are only produced
+/// by BytecodeCompiler::fuseSuperinstructions.
+#define BYTECODE_OPCODES(X)                                                    \
+  X(AddI32)                                                                    \
+  X(SubI32)                                                                    \
+  X(MulI32)                                                                    \
+  X(DivI32)                                                                    \
+  X(RemI32)                                                                    \
+  X(ShlI32)                                                                    \
+  X(ShrI32)                                                                    \
+  X(XorI32)                                                                    \
+  X(AndBool)                                                                   \
+  X(OrBool)                                                                    \
+  X(XorBool)                                                                   \
+  X(CmpEqI32)                                                                  \
+  X(CmpEqBool)                                                                 \
+  X(CmpNeI32)                                                                  \
+  X(CmpNeBool)                                                                 \
+  X(CmpGtI32)                                                                  \
+  X(CmpGeI32)                                                                  \
+  X(CmpLtI32)                                                                  \
+  X(CmpLeI32)                                                                  \
+  X(Alloca)                                                                    \
+  X(LoadI32)                                                                   \
+  X(LoadBool)                                                                  \
+  X(LoadPtr)                                                                   \
+  X(StoreI32)                                                                  \
+  X(StoreBool)                                                                 \
+  X(StorePtr)                                                                  \
+  X(GEP)                                                                       \
+  X(Br)                                                                        \
+  X(CondBr)                                                                    \
+  X(BrBack)                                                                    \
+  X(Call)                                                                      \
+  X(Ret)                                                                       \
+  X(RetVoid)                                                                   \
+  X(Memcpy)                                                                    \
+  X(PrintI32)                                                                  \
+  X(PrintBool)                                                                 \
+  X(AddI32Imm)                                                                 \
+  X(SubI32Imm)                                                                 \
+  X(MulI32Imm)                                                                 \
+  X(DivI32Imm)                                                                 \
+  X(RemI32Imm)                                                                 \
+  X(CmpEqI32Br)                                                                \
+  X(CmpNeI32Br)                                                                \
+  X(CmpGtI32Br)                                                                \
+  X(CmpGeI32Br)                                                                \
+  X(CmpLtI32Br)                                                                \
+  X(CmpLeI32Br)                                                                \
+  X(LoadCmpEqI32Br)                                                            \
+  X(LoadCmpNeI32Br)                                                            \
+  X(LoadCmpGtI32Br)                                                            \
+  X(LoadCmpGeI32Br)                                                            \
+  X(LoadCmpLtI32Br)                                                            \
+  X(LoadCmpLeI32Br)                                                            \
+  X(LoadLoadI32)                                                               \
+  X(LoadAddImmStoreI32)                                                        \
+  X(Halt)
+
+enum class BCOpcode : unsigned char {
+#define BYTECODE_ENUM(Name) Name,
+  BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+  NumOpcodes
+};
+
+/// \brief Get the name of the opcode, e.g. "AddI32".
+const char *getOpcodeName(BCOpcode Op);
+
+/// \brief Get the opcode named Name, return false if there is none.
+bool getOpcodeByName(const std::string &Name, BCOpcode &Op);
+
+/// BCValueKind - The run-time representation of a value, which member of the
+/// GenericValue is used. Only used to select the specialized opcode.
+enum class BCValueKind : unsigned char { Int, Bool, Pointer, Other };
+
+/// BCInstr - One bytecode instruction. All the operands have been resolved to
+/// register slots of the current frame, immediates or code offsets.
+///
+///   BinaryOp/Cmp  Dst = A op B
+///   Alloca        Dst = alloca of A bytes aligned to B
+///   Load*         Dst = *A
+///   Store*        *B = A
+///   GEP           Dst = A + B * sizeof(int)
+///   Br            goto Dst
+///   CondBr        if A goto Dst else goto B
+///   BrBack        goto Dst, a back-edge to the loop header LoopHeaders[A]
+///   Call          Dst = Functions[A](CallArgs[B...]), Dst is NoSlot if void
+///   Ret           return A
+///   Memcpy        memcpy(A, B, Dst bytes)
+///   Print*        print A
+///   *Imm          Dst = A op B, B is the immediate value of an int constant
+///
+/// A superinstruction executes the instruction it replaces and the ones that
+/// follow it in a single dispatch, e.g. CmpLtI32Br executes a CmpLtI32 and the
+/// CondBr after it. Every instruction of the sequence keeps its operands, and
+/// only the opcode of the first one is rewritten, so a branch to the middle of
+/// a sequence still executes the remaining instructions one by one.
+struct BCInstr {
+  BCOpcode Op;
+  unsigned Dst;
+  unsigned A;
+  unsigned B;
+
+  BCInstr(BCOpcode Op = BCOpcode::Halt) : Op(Op), Dst(0), A(0), B(0) {}
+};
+
+/// BCFunction - The bytecode of a function or of the top-level code.
+/// The register file of a frame is laid out as
+///   [ FrameLayout slots | imported globals | constants ]
+struct BCFunction {
+  static constexpr unsigned NoSlot = ~0U;
+
+  /// BlockStart - The code offset of a basic block.
+  struct BlockStart {
+    unsigned Offset;
+    const BasicBlock *BB;
+  };
+  /// LoopHeader - The target of a back-edge.
+  using LoopHeader = BlockStart;
+
+  // The IR function, nullptr for the top-level code.
+  const Function *F;
+  // The index in BCModule::Functions, the number of functions for the
+  // top-level code.
+  unsigned Index;
+  std::vector<BCInstr> Code;
+  // Sources[i] is the IR instruction lowered to Code[i], nullptr for the
+  // instructions added by the lowering.
+  std::vector<const Instruction *> Sources;
+  // The basic blocks in the order of their code.
+  std::vector<BlockStart> Blocks;
+  unsigned NumArgs;
+  unsigned NumRegs;
+  // Imports[i] is the global slot copied into register ImportBase + i.
+  unsigned ImportBase;
+  std::vector<unsigned> Imports;
+  // ConstantPool[i] is copied into register ConstBase + i.
+  unsigned ConstBase;
+  std::vector<GenericValue> ConstantPool;
+  // The argument registers of all the calls in this function.
+  std::vector<unsigned> CallArgs;
+  // The loop headers, i.e. the targets of the BrBack instructions.
+  std::vector<LoopHeader> LoopHeaders;
+
+  BCFunction()
+      : F(nullptr), Index(0), NumArgs(0), NumRegs(0), ImportBase(0),
+        ConstBase(0) {}
+};
+
+/// BCModule - The bytecode of the whole program.
+struct BCModule {
+  BCFunction TopLevel;
+  std::vector<BCFunction> Functions;
+};
+
+/// BytecodeCompiler - Lower the moses IR to bytecode. The lowering fails if
+/// the IR contains instructions that have no bytecode counterpart, in which
+/// case the interpreter walks the IR directly.
+class BytecodeCompiler {
+  const std::list<std::shared_ptr<Value>> &Insts;
+  const FrameLayout &GlobalLayout;
+  // Whether the instruction sequences are fused into superinstructions.
+  bool Fuse;
+  std::map<const Function *, unsigned> FunctionIndex;
+
+  /// A branch whose target offset is patched once all blocks are placed.
+  struct BranchFixup {
+    unsigned Index;
+    bool isFalseTarget;
+    const BasicBlock *Target;
+  };
+
+  // The state of the function being lowered.
+  struct FunctionState {
+    BCFunction *BCF;
+    FrameLayout Layout;
+    const FrameLayout *CurLayout;
+    std::map<const Value *, unsigned> ConstantSlots;
+    std::map<const Value *, unsigned> ImportSlots;
+    std::map<const BasicBlock *, unsigned> BlockOffsets;
+    std::vector<BranchFixup> Fixups;
+  };
+
+  bool getOperandSlot(const Value *V, FunctionState &FS, unsigned &Slot);
+  bool collectImports(const std::shared_ptr<Instruction> &I,
+                      FunctionState &FS);
+  bool lowerInstruction(const std::shared_ptr<Instruction> &I,
+                        FunctionState &FS);
+  bool lowerBlocks(const std::vector<BasicBlock *> &BBs, FunctionState &FS);
+  void markBackEdges(FunctionState &FS);
+
+public:
+  BytecodeCompiler(const std::list<std::shared_ptr<Value>> &Insts,
+                   const FrameLayout &GlobalLayout, bool Fuse = true)
+      : Insts(Insts), GlobalLayout(GlobalLayout), Fuse(Fuse) {}
+
+  /// \brief Lower the program, return nullptr if it can't be lowered.
+  std::unique_ptr<BCModule> compile();
+
+  /// \brief Rewrite the frequent instruction sequences of BCF to
+  /// superinstructions. The set of sequences is tuned with the instruction
+  /// pair counts collected by PairProfile.
+  static void fuseSuperinstructions(BCFunction &BCF);
+
+  /// \brief Get the opcode of the first instruction of the sequence executed
+  /// by Op, Op itself if it isn't a superinstruction of several instructions.
+  static BCOpcode getUnfusedOpcode(BCOpcode Op);
+
+  static BCValueKind getValueKind(const TyPtr &Ty);
+  static bool selectByKind(BCValueKind Kind, BCOpcode IntOp, BCOpcode BoolOp,
+                           BCOpcode PtrOp, BCOpcode &Op);
+};
+} // namespace Execution
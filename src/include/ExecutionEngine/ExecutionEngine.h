@@ -5,7 +5,15 @@
 //===---------------------------------------------------------------------===//
 #pragma once
 
+#include "Bytecode.h"
+#include "FrameLayout.h"
+#include "FrameStack.h"
 #include "GenericValue.h"
+#include "JIT.h"
+#include "PairProfile.h"
+#include "Profiler.h"
+#include "StackArena.h"
+#include "Tiering.h"
 #include "IR/BasicBlock.h"
 #include "IR/Function.h"
 #include "IR/IRType.h"
@@ -21,16 +29,6 @@
 
 namespace Execution {
 using namespace IR;
-using Opcode = Instruction::Opcode;
-
-/// AllocaHolder - Object to track all of the blocks of memory allocated by
-/// alloca. When the function returns, this object is "popped off" the execution
-/// stack, which causes the dtor to be run, which free all the alloca'd memory.
-struct AllocaHolder {
-  std::vector<std::shared_ptr<char>> Allocations;
-
-  void add(std::shared_ptr<char> Memory) { Allocations.push_back(Memory); }
-};
 
 /// ExecutionContext struct - This struct represents one stack frame currently
 /// executing.
@@ -41,21 +39,89 @@ struct ExecutionContext {
   std::shared_ptr<BasicBlock> CurBB;
   // The next instruction to execute.
   std::list<std::shared_ptr<Instruction>>::iterator CurInst;
-  // Values used in this invocation.
-  // http://stackoverflow.com/questions/24239696/using-std-shared-ptr-as-stdmap-key
-  std::map<std::shared_ptr<Value>, GenericValue> Values;
-
-  // Holds the call that called subframes.
-  std::shared_ptr<CallInst> Caller;
-
-  // Track memory allocated by alloca.
-  AllocaHolder Allocas;
+  // The slot layout of the currently executing function.
+  const FrameLayout *Layout;
+  // The layout index of CurInst.
+  unsigned NextInst;
+  // The layout of the executing instruction, for a caller it is the pending
+  // call.
+  const InstLayout *Executing;
+  // Values used in this invocation, indexed by the slots of the Layout.
+  std::vector<GenericValue> Values;
+
+  // The top of the alloca arena when this frame was pushed, all the memory
+  // allocated by alloca in this frame is released back to it on return.
+  StackArena::Mark AllocaMark;
   std::shared_ptr<Instruction> IssueInstruction() {
-    if (CurInst != CurBB->end())
-      return *CurInst++;
-    return nullptr;
+    if (CurInst == CurBB->end())
+      return nullptr;
+    Executing = &Layout->getInst(NextInst++);
+    return *CurInst++;
   }
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), Layout(nullptr), NextInst(0),
+        Executing(nullptr), AllocaMark{0, nullptr} {}
+};
+
+/// BCFrame - One stack frame of the bytecode tier.
+struct BCFrame {
+  // The executing bytecode function.
+  const BCFunction *Fn;
+  // Where to resume this frame when the callee returns.
+  const BCInstr *PC;
+  // The register that receives the return value of the pending call.
+  unsigned ReturnDst;
+  // The register file, it points to the global slot table for the top-level
+  // frame.
+  GenericValue *Regs;
+  std::vector<GenericValue> RegStorage;
+
+  // The top of the alloca arena when this frame was pushed.
+  StackArena::Mark AllocaMark;
+  BCFrame()
+      : Fn(nullptr), PC(nullptr), ReturnDst(BCFunction::NoSlot),
+        Regs(nullptr), AllocaMark{0, nullptr} {}
+};
+
+/// ExecutionMode - The tier that executes the program.
+enum class ExecutionMode {
+  // Walk the IR directly.
+  IR,
+  // Lower the IR to bytecode and run it with the dispatch loop.
+  Bytecode,
+  // Translate the bytecode to native code, fall back to the bytecode tier if
+  // the host isn't supported.
+  JIT,
+  // Start in the bytecode tier, and promote the hot functions and top-level
+  // loops to native code.
+  Tiered
+};
+
+/// InterpreterOptions - The options that control how the program is executed.
+struct InterpreterOptions {
+  /// The default limit of the call depth.
+  static constexpr std::size_t DefaultMaxCallDepth = 100000;
+  /// The default number of calls or loop iterations before a promotion.
+  static constexpr std::uint64_t DefaultTierUpThreshold = 1000;
+
+  ExecutionMode Mode;
+  // The limit of the call depth.
+  std::size_t MaxCallDepth;
+  // Fuse the frequent instruction sequences into superinstructions.
+  bool Superinstructions;
+  // If not nullptr, count the instruction pairs executed by the bytecode tier.
+  PairProfile *Pairs;
+  // The tiered mode promotes a function or a loop when its counter reaches
+  // this value.
+  std::uint64_t TierUpThreshold;
+  // Profile the bytecode or the IR tier. The profiled program runs unfused
+  // and without the native tiers, so every IR instruction is counted.
+  bool Profile;
+
+  InterpreterOptions()
+      : Mode(ExecutionMode::Bytecode), MaxCallDepth(DefaultMaxCallDepth),
+        Superinstructions(true), Pairs(nullptr),
+        TierUpThreshold(DefaultTierUpThreshold), Profile(false) {}
 };
 
 class Interpreter {
@@ -64,10 +130,38 @@ class Interpreter {
 
   // The runtime stack of executing code. The top of the stack is the current
   // function record.
-  std::vector<ExecutionContext> ECStack;
-
-  // Base frame.
-  ExecutionContext TopLevelFrame;
+  FrameStack<ExecutionContext> ECStack;
+
+  // The memory allocated by alloca, shared by all the frames.
+  StackArena Allocas;
+
+  // The slot layout and the values of the top-level code. Top-level values
+  // are visible to all the functions.
+  FrameLayout GlobalLayout;
+  std::vector<GenericValue> Globals;
+
+  // The slot layout of each function, computed at the first call.
+  std::map<const Function *, FrameLayout> FunctionLayouts;
+
+  // The bytecode of the program, nullptr if the program can't be lowered and
+  // the IR is interpreted directly.
+  std::unique_ptr<BCModule> Module;
+  // The runtime stack of the bytecode tier.
+  FrameStack<BCFrame> BCStack;
+  // The native code of the program, only in the JIT and the tiered mode.
+  std::unique_ptr<JITModule> Native;
+  // The hotness counters of the tiered mode.
+  std::unique_ptr<TierProfile> Tiers;
+  // The context of the native code, with its own stack.
+  JITContext NativeCtx;
+  std::vector<GenericValue> NativeArgs;
+  // The execution profile, only if InterpreterOptions::Profile is set.
+  std::unique_ptr<Profiler> Prof;
+
+  // Set when the program is stopped by a run-time error.
+  bool RuntimeError;
+
+  InterpreterOptions Options;
 
   // AtExitHandlers - List of functions to call when the program exits,
   // registered with the atexit() library function.
@@ -86,10 +180,34 @@ private:
                            IR::TyPtr Ty);
   void StoreValueToMemory(GenericValue V, GenericValue DestAddr, IR::TyPtr Ty);
   void PopStackAndSetReturnValue(GenericValue ReturnValue, bool isVoid);
+  /// Get the slot layout of the function F, compute it if necessary.
+  const FrameLayout &getFrameLayout(Function *F);
+  /// Get the storage of the specified slot.
+  GenericValue &getSlotValue(SlotRef Slot, ExecutionContext &SF) {
+    return Slot.isGlobal ? Globals[Slot.Index] : SF.Values[Slot.Index];
+  }
+  /// Report the call depth overflow and stop the program. The native code
+  /// may exhaust its own stack instead, if a helper needs more than the room
+  /// left for it.
+  void stackOverflow(bool isNativeStack = false);
+  /// The loop of the IR tier, instantiated with and without the profiler.
+  template <bool Profiling> void runIR();
+  /// The dispatch loop of the bytecode tier, instantiated with and without
+  /// the instruction pair counting, the hotness counters and the profiler.
+  template <bool CountPairs, bool Tiered, bool Profiling>
+  void dispatchBytecode();
+  /// Compile the function Index, or the top-level code entered at the loop
+  /// header for the OSR, and record the promotion.
+  bool tierUp(TierEvent::EventKind Kind, unsigned Index, unsigned LoopHeader);
+  /// Call the native code of the function Index from the bytecode tier,
+  /// return false if the program is stopped.
+  bool callNative(unsigned Index, const unsigned *Args, GenericValue *Regs,
+                  unsigned Dst);
 
 public:
   Interpreter(const std::list<std::shared_ptr<Value>> &Insts,
-              const MosesIRContext &Ctx);
+              const MosesIRContext &Ctx,
+              const InterpreterOptions &Options = InterpreterOptions());
   ~Interpreter() {}
 
   /// runAtExitHandlers - Run any functions registered by the program's calls
@@ -99,7 +217,19 @@ public:
   /// create - Create an interpreter ExecutionEngine. This can never fail.
   static std::shared_ptr<Interpreter>
   create(const std::list<std::shared_ptr<Value>> &Insts,
-         const MosesIRContext &Ctx);
+         const MosesIRContext &Ctx,
+         const InterpreterOptions &Options = InterpreterOptions());
+
+  /// hadRuntimeError - Return true if the program was stopped by an error,
+  /// e.g. the call depth exceeded the limit.
+  bool hadRuntimeError() const { return RuntimeError; }
+
+  /// dumpTierStats - Write the promotions of the tiered mode.
+  void dumpTierStats(std::ostream &Out) const;
+
+  /// getProfiler - Return the execution profile, nullptr if the program
+  /// isn't profiled.
+  const Profiler *getProfiler() const { return Prof.get(); }
 
   /// StoreValueToMemory - Stores the data in Val of type Ty at address Ptr.
   /// Ptr is the address of the memory at which to store Val, cast to
@@ -115,6 +245,8 @@ public:
   void executeInstruction();
   /// Execute instructions until nothing left to do.
   void run();
+  /// Execute the bytecode of the program with the threaded dispatch loop.
+  void runBytecode();
 
   void visitReturnInst(std::shared_ptr<ReturnInst> I);
   void visitBranchInst(std::shared_ptr<BranchInst> I);
@@ -137,21 +269,19 @@ public:
 
   // SwitchToNewBasicBlock - Start execution in a new basic block and run any
   // PHI nodes in the top of the block. This is used for intraprocedural
-  // control flow.
-  void SwitchToNewBasicBlock(std::shared_ptr<BasicBlock> New,
+  // control flow. Start is the layout index of the first instruction of New.
+  void SwitchToNewBasicBlock(std::shared_ptr<BasicBlock> New, unsigned Start,
                              ExecutionContext &SF);
 
-  GenericValue getOperandValue(std::shared_ptr<Value> V, ExecutionContext &SF);
-
-  GenericValue getConstantValue(ConstantPtr C);
-
-  GenericValue getLocalAndGlobalGV(std::shared_ptr<Value> V);
+  /// getOperandValue - Get the value of the operand i of the instruction
+  /// executing on the SF.
+  GenericValue getOperandValue(unsigned i, ExecutionContext &SF);
 
   void *getPointerToFunction(Function *F) { return (void *)F; };
 
-  /// SetGenericValue - Update the GenericValue of specified V on the SF.
-  void SetGenericValue(std::shared_ptr<Value> V, GenericValue GV,
-                       ExecutionContext &SF);
+  /// SetGenericValue - Update the result of the instruction executing on the
+  /// SF.
+  void SetGenericValue(GenericValue GV, ExecutionContext &SF);
 
   /// callFunction - Switch the context info and create a new stack frame.
   void callFunction(std::shared_ptr<Function> Function,
@@ -0,0 +1,105 @@
+//===-----------------------------FrameLayout.h---------------------------===//
+//
+// This file defines the FrameLayout class, which assigns a dense register slot
+// to every value that an interpreter frame needs to keep track of.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "GenericValue.h"
+#include "IR/BasicBlock.h"
+#include "IR/Function.h"
+#include "IR/Instruction.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Execution {
+using namespace IR;
+
+/// SlotRef - The location of a value at run time. Global slots live in the
+/// interpreter's global table, local slots live in the current frame.
+struct SlotRef {
+  unsigned Index;
+  bool isGlobal;
+  SlotRef() : Index(0), isGlobal(false) {}
+  SlotRef(unsigned Index, bool isGlobal) : Index(Index), isGlobal(isGlobal) {}
+};
+
+/// OperandRef - An operand of an instruction, resolved when the layout is
+/// built. A constant is decoded once, a basic block is the layout index of its
+/// first instruction.
+struct OperandRef {
+  enum class RefKind : unsigned char { None, Slot, Constant, Block };
+  RefKind Kind;
+  SlotRef Slot;
+  unsigned Block;
+  GenericValue Constant;
+  OperandRef() : Kind(RefKind::None), Block(0) {}
+};
+
+/// InstLayout - The operands and the result slot of one instruction, the
+/// operands are stored in the order of Instruction::getOperand.
+struct InstLayout {
+  unsigned FirstOperand;
+  unsigned NumOperands;
+  SlotRef Result;
+  InstLayout() : FirstOperand(0), NumOperands(0) {}
+};
+
+/// FrameLayout - Computed once per function (and once for the top-level code),
+/// the layout gives every argument and instruction a dense slot index. Values
+/// defined at top level but used by a function are recorded as global slots.
+/// The instructions are numbered in the order of their blocks, and the
+/// operands of each one are resolved up front, so the interpreter indexes the
+/// frame directly.
+class FrameLayout {
+  std::unordered_map<const Value *, SlotRef> Slots;
+  unsigned NumSlots;
+  bool isGlobalLayout;
+
+  std::vector<InstLayout> Insts;
+  std::vector<OperandRef> Operands;
+
+  void addSlot(const Value *V);
+  void addOperands(const std::shared_ptr<Instruction> &I,
+                   const FrameLayout *Globals);
+  /// \brief Number the instructions of \p BBs and resolve their operands.
+  void resolveInstructions(const std::vector<BasicBlock *> &BBs);
+
+public:
+  FrameLayout() : NumSlots(0), isGlobalLayout(false) {}
+
+  /// \brief Build the layout of the top-level code, every slot is global.
+  static void
+  computeGlobalLayout(FrameLayout &Layout,
+                      const std::list<std::shared_ptr<Value>> &Insts);
+
+  /// \brief Build the layout of the function \p F, top-level values are
+  /// resolved through \p Globals.
+  static void computeFunctionLayout(FrameLayout &Layout, Function *F,
+                                    const FrameLayout &Globals);
+
+  unsigned getNumSlots() const { return NumSlots; }
+
+  /// \brief Get the slot of the specified value, the value must have been
+  /// assigned a slot.
+  SlotRef getSlot(const Value *V) const {
+    auto Iter = Slots.find(V);
+    assert(Iter != Slots.end() && "Value has no slot in this frame.");
+    return Iter->second;
+  }
+
+  bool hasSlot(const Value *V) const { return Slots.find(V) != Slots.end(); }
+
+  /// \brief Get the layout of the instruction numbered \p Index.
+  const InstLayout &getInst(unsigned Index) const { return Insts[Index]; }
+
+  /// \brief Get the operand \p i of the instruction \p IL.
+  const OperandRef &getOperand(const InstLayout &IL, unsigned i) const {
+    assert(i < IL.NumOperands && "Operand index out of range.");
+    return Operands[IL.FirstOperand + i];
+  }
+};
+} // namespace Execution
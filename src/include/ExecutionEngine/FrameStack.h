@@ -0,0 +1,60 @@
+//===-----------------------------FrameStack.h----------------------------===//
+//
+// This file defines the FrameStack class, the call stack of the interpreter.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Execution {
+/// FrameStack - A stack of frames stored in fixed-size slabs. Frames never
+/// move once they are pushed, so a reference to a frame stays valid until it
+/// is popped. Slabs are kept when the stack shrinks, so push and pop are O(1)
+/// and don't allocate once the stack has reached its deepest point.
+///
+/// Frames are recycled, push() doesn't reset the frame it returns. Whatever
+/// the previous occupant left behind (e.g. the capacity of its vectors) is
+/// reused, and the caller must initialize every field it relies on.
+template <typename FrameTy, std::size_t SlabSize = 256> class FrameStack {
+  std::vector<std::unique_ptr<FrameTy[]>> Slabs;
+  std::size_t Depth;
+  std::size_t MaxDepth;
+
+  FrameTy &at(std::size_t Index) {
+    return Slabs[Index / SlabSize][Index % SlabSize];
+  }
+
+public:
+  explicit FrameStack(std::size_t MaxDepth) : Depth(0), MaxDepth(MaxDepth) {}
+
+  /// \brief Push a new frame, return nullptr if the depth limit is reached.
+  FrameTy *push() {
+    if (Depth >= MaxDepth)
+      return nullptr;
+    if (Depth / SlabSize == Slabs.size())
+      Slabs.push_back(std::make_unique<FrameTy[]>(SlabSize));
+    return &at(Depth++);
+  }
+
+  void pop_back() {
+    assert(Depth > 0 && "Pop from an empty frame stack.");
+    --Depth;
+  }
+
+  FrameTy &back() {
+    assert(Depth > 0 && "Frame stack is empty.");
+    return at(Depth - 1);
+  }
+
+  void clear() { Depth = 0; }
+  bool empty() const { return Depth == 0; }
+  std::size_t size() const { return Depth; }
+
+  std::size_t getMaxDepth() const { return MaxDepth; }
+  void setMaxDepth(std::size_t Max) { MaxDepth = Max; }
+};
+} // namespace Execution
@@ -0,0 +1,174 @@
+//===---------------------------------JIT.h-------------------------------===//
+//
+// This file defines the baseline JIT, which translates the bytecode of the
+// program to x86-64 machine code.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "Bytecode.h"
+#include "GenericValue.h"
+#include "StackArena.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Execution {
+/// JITContext - The run-time state shared by the native code, the generated
+/// code addresses its fields with fixed offsets and keeps a pointer to it in
+/// a callee-saved register.
+struct JITContext {
+  // The global slot table, the register file of the top-level code.
+  GenericValue *Globals;
+  // The entry of every function, indexed like BCModule::Functions.
+  void **Functions;
+  StackArena *Allocas;
+  // The call depth, the top-level code counts as one.
+  std::size_t Depth;
+  std::size_t MaxDepth;
+  // The native code stops calling when the stack pointer goes below it.
+  char *StackLimit;
+  // Set when the program stops, the callers return as soon as they see it.
+  bool Stop;
+  // Set when the call depth is exhausted.
+  bool Overflow;
+  // Set when the native stack is exhausted before the call depth, only if a
+  // helper needs more than the room left for it.
+  bool StackExhausted;
+};
+
+/// ExecutableMemory - Pages mapped for the generated code, they are never
+/// writable and executable at the same time.
+class ExecutableMemory {
+  void *Memory;
+  std::size_t Size;
+
+public:
+  ExecutableMemory() : Memory(nullptr), Size(0) {}
+  ExecutableMemory(const ExecutableMemory &) = delete;
+  ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+  ~ExecutableMemory();
+
+  /// \brief Copy the code to fresh pages and make them executable, return
+  /// false if the pages can't be mapped.
+  bool load(const std::vector<std::uint8_t> &Code);
+  std::uint8_t *getBase() const { return static_cast<std::uint8_t *>(Memory); }
+};
+
+/// NativeStack - The stack the native code runs on, with a guard page below
+/// it. The pages are only committed when the native code reaches them.
+class NativeStack {
+  void *Memory;
+  std::size_t Size;
+
+public:
+  NativeStack() : Memory(nullptr), Size(0) {}
+  NativeStack(const NativeStack &) = delete;
+  NativeStack &operator=(const NativeStack &) = delete;
+  ~NativeStack();
+
+  /// \brief Map a stack of at least Size bytes, return false if the pages
+  /// can't be mapped.
+  bool map(std::size_t Size);
+  /// \brief The lowest usable address, above the guard page.
+  char *getBottom() const;
+  /// \brief The initial stack pointer, 16-byte aligned.
+  char *getTop() const { return static_cast<char *>(Memory) + Size; }
+};
+
+/// JITModule - The native code of the program. Functions are compiled on
+/// demand, a function is only called from native code once it and all the
+/// functions it may call are compiled.
+///
+/// The native code runs on a stack of its own, sized so that the call depth
+/// limit is reached before the stack is exhausted. The native tiers thus
+/// accept the same programs as the interpreter tiers, whatever the size of
+/// the C++ stack.
+class JITModule {
+  friend class JITCompiler;
+  // The pages of every compilation, they live as long as the module.
+  std::vector<std::unique_ptr<ExecutableMemory>> Chunks;
+  // The entry of every function, nullptr until it is compiled.
+  std::vector<void *> Entries;
+  void *TopLevelEntry;
+  // The entries at the loop headers, indexed by the BCFunction::Index and the
+  // loop header.
+  std::map<std::pair<unsigned, unsigned>, void *> OSREntries;
+  // The largest native frame of a function, and the frame of the top-level
+  // code, with the return address and the saved registers.
+  std::size_t MaxFrameSize;
+  std::size_t TopLevelFrameSize;
+  NativeStack Stack;
+  // Switches to the native stack and calls an entry with two arguments.
+  void *Enter;
+
+  std::uint64_t enter(void *Entry, void *Arg, JITContext &Ctx);
+
+public:
+  explicit JITModule(const BCModule &Module);
+
+  bool isCompiled(unsigned Index) const { return Entries[Index]; }
+  bool hasTopLevel() const { return TopLevelEntry; }
+
+  /// \brief Get the entry at the loop header of the function Index, nullptr
+  /// if it isn't compiled.
+  void *getOSREntry(unsigned Index, unsigned LoopHeader) const {
+    auto Iter = OSREntries.find({Index, LoopHeader});
+    return Iter == OSREntries.end() ? nullptr : Iter->second;
+  }
+
+  /// \brief Prepare Ctx for a run and map the native stack for MaxDepth
+  /// frames. Return false if the stack can't be mapped.
+  bool initContext(JITContext &Ctx, GenericValue *Globals, StackArena &Allocas,
+                   std::size_t MaxDepth);
+
+  /// \brief Call the compiled function Index, return false if the program
+  /// is stopped.
+  bool callFunction(JITContext &Ctx, unsigned Index, const GenericValue *Args,
+                    GenericValue &Result);
+
+  /// \brief Continue a bytecode frame from the OSR Entry, Regs is the
+  /// register file of the frame. Return false if the program is stopped.
+  bool callOSREntry(JITContext &Ctx, void *Entry, GenericValue *Regs,
+                    GenericValue &Result);
+
+  /// \brief Run the compiled top-level code on the global slot table.
+  void runTopLevel(JITContext &Ctx);
+};
+
+/// JITCompiler - Translate the bytecode to x86-64 code. Every bytecode
+/// instruction is expanded from the template of its opcode, the registers of
+/// the frame live in memory and are addressed relative to a base register.
+/// Print, memcpy and alloca are calls to C++ helpers. A superinstruction is
+/// translated as the sequence of instructions it fuses.
+class JITCompiler {
+  const BCModule &Module;
+
+  bool compileClosure(JITModule &Native, std::vector<unsigned> Worklist,
+                      const BCFunction *Root, unsigned Entry,
+                      void *&RootEntry);
+
+public:
+  explicit JITCompiler(const BCModule &Module) : Module(Module) {}
+
+  /// \brief Return true if the host can run the generated code.
+  static bool isSupported();
+
+  /// \brief Translate the whole module, return nullptr if the host isn't
+  /// supported or the module can't be translated.
+  std::unique_ptr<JITModule> compile();
+
+  /// \brief Compile the function Index and the functions it may call.
+  bool compileFunction(JITModule &Native, unsigned Index);
+
+  /// \brief Compile the top-level code and the functions it may call.
+  bool compileTopLevel(JITModule &Native);
+
+  /// \brief Compile an entry at the loop header of Fn, which continues a
+  /// running bytecode frame of Fn in native code (on-stack replacement).
+  bool compileOSREntry(JITModule &Native, const BCFunction &Fn,
+                       unsigned LoopHeader);
+};
+} // namespace Execution
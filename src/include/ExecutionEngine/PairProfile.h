@@ -0,0 +1,46 @@
+//===-----------------------------PairProfile.h---------------------------===//
+//
+// This file defines the PairProfile class, which counts the pairs of bytecode
+// instructions executed one after another.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "Bytecode.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace Execution {
+/// PairProfile - The execution counts of the instruction pairs (A, B), where
+/// B is dispatched right after A. The most frequent pairs are the candidates
+/// of new superinstructions. The counts can be merged across runs, so that
+/// the fused set is tuned against a whole workload rather than one program.
+class PairProfile {
+  static constexpr unsigned NumOpcodes =
+      static_cast<unsigned>(BCOpcode::NumOpcodes);
+  std::vector<std::uint64_t> Counts;
+
+public:
+  PairProfile() : Counts(NumOpcodes * NumOpcodes, 0) {}
+
+  void record(BCOpcode First, BCOpcode Second) {
+    ++Counts[static_cast<unsigned>(First) * NumOpcodes +
+             static_cast<unsigned>(Second)];
+  }
+
+  std::uint64_t getCount(BCOpcode First, BCOpcode Second) const {
+    return Counts[static_cast<unsigned>(First) * NumOpcodes +
+                  static_cast<unsigned>(Second)];
+  }
+
+  /// \brief Add the counts written by a previous run, return false if the
+  /// input is malformed.
+  bool merge(std::istream &In);
+
+  /// \brief Write the non-zero counts, one "count first second" line per pair,
+  /// the most frequent pair first.
+  void write(std::ostream &Out) const;
+};
+} // namespace Execution
@@ -0,0 +1,127 @@
+//===------------------------------Profiler.h-----------------------------===//
+//
+// This file defines the Profiler class, which records where the bytecode tier
+// or the IR tier spends its time.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "Bytecode.h"
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Execution {
+/// Profiler - The execution count of every instruction, and the inclusive and
+/// exclusive cycles of every function and every calling context. The counts
+/// of the basic blocks are the counts of their first instruction.
+///
+/// The dispatch loops only call the profiler in their profiling
+/// instantiations, a run without profiling doesn't pay for it.
+class Profiler {
+  static constexpr unsigned NoContext = ~0U;
+
+  // The functions by BCFunction::Index, the top-level code last.
+  std::vector<const BCFunction *> Functions;
+  // The IR tier has no bytecode. The functions it runs are laid out like
+  // bytecode without code, one position per IR instruction in the order of
+  // the blocks.
+  std::vector<BCFunction> IRFunctions;
+  std::map<const Function *, unsigned> IRFunctionIndex;
+  // The function and the position of every IR instruction.
+  std::unordered_map<const Instruction *, std::pair<unsigned, unsigned>>
+      IRPositions;
+  // Indexed by BCFunction::Index, then by the code offset.
+  std::vector<std::vector<std::uint64_t>> InstCounts;
+
+  struct FunctionTimes {
+    std::uint64_t Calls;
+    std::uint64_t Inclusive;
+    std::uint64_t Exclusive;
+    // The activations on the stack, only the outermost one of a recursion
+    // adds its inclusive cycles.
+    unsigned Active;
+  };
+  std::vector<FunctionTimes> Times;
+
+  /// ContextNode - A node of the calling context tree, the path from the
+  /// root is the call stack.
+  struct ContextNode {
+    unsigned Function;
+    unsigned Parent;
+    std::uint64_t Exclusive;
+    std::map<unsigned, unsigned> Children;
+  };
+  std::vector<ContextNode> Contexts;
+  // The roots of the calling context tree.
+  std::map<unsigned, unsigned> Roots;
+
+  struct ActiveFrame {
+    unsigned Function;
+    unsigned Context;
+    std::uint64_t Start;
+    // The cycles spent in the callees.
+    std::uint64_t Children;
+  };
+  std::vector<ActiveFrame> Frames;
+
+  const BCFunction &getFunction(unsigned Index) const {
+    return *Functions[Index];
+  }
+  std::string getFunctionName(unsigned Index) const;
+  /// \brief Size the counters once the functions are known.
+  void initCounters();
+  /// \brief Lay out the instructions of the block BB at the end of the IR
+  /// function Fn.
+  void addIRBlock(BCFunction &Fn, BasicBlock *BB);
+  void writeFoldedStacks(std::ostream &Out, unsigned Context,
+                         const std::string &Prefix) const;
+
+public:
+  /// \brief Profile the bytecode of Module.
+  explicit Profiler(const BCModule &Module);
+  /// \brief Profile the IR of the program Insts, for the IR tier.
+  explicit Profiler(const std::list<std::shared_ptr<Value>> &Insts);
+
+  /// \brief Read the time stamp counter, or a nanosecond clock on the hosts
+  /// without one.
+  static std::uint64_t readCycleCounter();
+
+  void countInstruction(const BCFunction &Fn, const BCInstr *PC) {
+    ++InstCounts[Fn.Index][PC - Fn.Code.data()];
+  }
+  void countInstruction(const Instruction *I) {
+    auto Iter = IRPositions.find(I);
+    assert(Iter != IRPositions.end() && "The instruction isn't profiled.");
+    ++InstCounts[Iter->second.first][Iter->second.second];
+  }
+
+  /// \brief Get the index of the IR function F, for the IR tier.
+  unsigned getFunctionIndex(const Function *F) const {
+    auto Iter = IRFunctionIndex.find(F);
+    assert(Iter != IRFunctionIndex.end() && "The function isn't profiled.");
+    return Iter->second;
+  }
+  unsigned getTopLevelIndex() const { return Functions.size() - 1; }
+
+  /// \brief Record the entry of a frame of the function Index.
+  void enterFunction(unsigned Index);
+  /// \brief Record the exit of the innermost frame.
+  void exitFunction();
+  /// \brief Exit all the frames when the program stops.
+  void finish();
+
+  /// \brief Write the functions, basic blocks and instructions, the hottest
+  /// first.
+  void writeReport(std::ostream &Out) const;
+  /// \brief Write one "caller;callee cycles" line per calling context, the
+  /// input format of the flame graph tools.
+  void writeFoldedStacks(std::ostream &Out) const;
+};
+} // namespace Execution
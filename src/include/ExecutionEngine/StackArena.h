@@ -0,0 +1,63 @@
+//===-----------------------------StackArena.h----------------------------===//
+//
+// This file defines the StackArena class, the bump-pointer stack that holds
+// the memory allocated by alloca.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Execution {
+/// StackArena - The alloca'd memory of all the frames lives in a list of
+/// chunks that is only grown, never freed while the interpreter is alive.
+/// A frame remembers the top of the arena when it is pushed, and all of its
+/// allocas are released in O(1) by resetting the top when it is popped. Once
+/// the arena has grown to the deepest recursion of the program, calls don't
+/// touch malloc any more.
+class StackArena {
+  struct Chunk {
+    std::unique_ptr<char[]> Memory;
+    std::size_t Size;
+  };
+  std::vector<Chunk> Chunks;
+  // The chunk we are bumping in, and its free range.
+  unsigned CurChunk;
+  char *Cur;
+  char *End;
+
+  static char *alignPtr(char *Ptr, std::size_t Align);
+  char *grow(std::size_t Size, std::size_t Align);
+
+public:
+  /// Mark - The top of the arena, saved by each frame.
+  struct Mark {
+    unsigned Chunk;
+    char *Cur;
+  };
+
+  explicit StackArena(std::size_t InitialSize = 64 * 1024);
+
+  /// \brief Allocate Size zeroed bytes aligned to Align (a power of two).
+  void *allocate(std::size_t Size, std::size_t Align) {
+    char *Ptr = alignPtr(Cur, Align);
+    if (Ptr + Size > End)
+      Ptr = grow(Size, Align);
+    Cur = Ptr + Size;
+    std::memset(Ptr, 0, Size);
+    return Ptr;
+  }
+
+  Mark getMark() const { return {CurChunk, Cur}; }
+
+  /// \brief Release everything allocated after M.
+  void release(Mark M) {
+    CurChunk = M.Chunk;
+    Cur = M.Cur;
+    End = Chunks[CurChunk].Memory.get() + Chunks[CurChunk].Size;
+  }
+};
+} // namespace Execution
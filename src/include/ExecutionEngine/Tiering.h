@@ -0,0 +1,76 @@
+//===-------------------------------Tiering.h-----------------------------===//
+//
+// This file defines the TierProfile class, the hotness counters that drive
+// the promotion from the bytecode tier to native code.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+#include "Bytecode.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Execution {
+class JITModule;
+
+/// TierEvent - One promotion to native code.
+struct TierEvent {
+  enum EventKind {
+    // The function was called Threshold times.
+    CallCount,
+    // A loop ran Threshold iterations, and the running frame continued in
+    // native code from the loop header.
+    OnStackReplacement
+  };
+  EventKind Kind;
+  // The index of the function, BCFunction::Index.
+  unsigned Function;
+  // The index of the loop header for the OSR.
+  unsigned LoopHeader;
+  // When the promotion was decided, and how long the compilation took.
+  double TimeMs;
+  double CompileMs;
+  bool Succeeded;
+};
+
+/// TierProfile - The call counts of the functions and the back-edge counts
+/// of the loop headers, counted by the bytecode tier. Each counter fires
+/// once, when it reaches the threshold.
+class TierProfile {
+  const BCModule &Module;
+  std::uint64_t Threshold;
+  std::vector<std::uint64_t> CallCounts;
+  // Indexed by BCFunction::Index, then by the loop header.
+  std::vector<std::vector<std::uint64_t>> BackEdgeCounts;
+  std::vector<TierEvent> Events;
+  std::chrono::steady_clock::time_point Start;
+
+  const BCFunction &getFunction(unsigned Index) const {
+    return Index < Module.Functions.size() ? Module.Functions[Index]
+                                           : Module.TopLevel;
+  }
+
+public:
+  TierProfile(const BCModule &Module, std::uint64_t Threshold);
+
+  /// \brief Count a call, return true when the threshold is reached.
+  bool countCall(unsigned Function) {
+    return ++CallCounts[Function] == Threshold;
+  }
+
+  /// \brief Count a back-edge, return true when the threshold is reached.
+  bool countBackEdge(unsigned Function, unsigned LoopHeader) {
+    return ++BackEdgeCounts[Function][LoopHeader] == Threshold;
+  }
+
+  /// \brief The milliseconds elapsed since the profile was created.
+  double getTimeMs() const;
+
+  void addEvent(const TierEvent &Event) { Events.push_back(Event); }
+
+  /// \brief Write the promotions and the counters of every function.
+  void dump(std::ostream &Out, const JITModule *Native) const;
+};
+} // namespace Execution
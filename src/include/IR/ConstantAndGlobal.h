@@ -88,56 +88,59 @@ private:
   bool Val;
 
 public:
+  /// Only MosesIRContext creates the two ConstantBools, use getTrue() and
+  /// getFalse().
   ConstantBool(MosesIRContext &Ctx, bool val);
-  static ConstantBool *True, *False;
 
-  /// getTrue() - static factory methods - Return objects of the specified
-  /// value.
-  static std::shared_ptr<ConstantBool> getTrue(MosesIRContext &Ctx) {
-    return std::make_shared<ConstantBool>(Ctx, true);
-  }
-  /// getFalse() - static factory methods - Return objects of the specified
-  /// value.
-  static std::shared_ptr<ConstantBool> getFalse(MosesIRContext &Ctx) {
-    return std::make_shared<ConstantBool>(Ctx, false);
-  }
-  /// inverted - Return the opposite value of the current value.
-  ConstantBool *inverted() const { return (this == True) ? False : True; }
+  /// getTrue() - static factory methods - Return the true of Ctx, there is
+  /// one per context.
+  static std::shared_ptr<ConstantBool> getTrue(MosesIRContext &Ctx);
+  /// getFalse() - static factory methods - Return the false of Ctx, there is
+  /// one per context.
+  static std::shared_ptr<ConstantBool> getFalse(MosesIRContext &Ctx);
   /// getVal - return the boolean value of this constant.
   bool getVal() const { return Val; }
 
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static bool classof(const ConstantBool *) { return true; }
   static bool classof(const Constant *CPV) {
-    return (CPV == True) | (CPV == False);
+    return CPV->getType()->getTypeID() == Type::TypeID::BoolTy;
   }
 
   /// \brief Print the ConstantBool.
   void Print(std::ostringstream &out) override;
 };
 
+/// ConstantInt - An integer constant. The constants are uniqued by their
+/// MosesIRContext, two ConstantInts of a context are equal only if they are
+/// the same object. They are shared by the whole module, so they have no
+/// name of their own, the name is their value and is made the first time it
+/// is asked for.
 class ConstantInt final : public ConstantIntegral {
   int Val;
   ConstantInt(const ConstantInt &) = delete;
 
 public:
+  /// Only MosesIRContext creates ConstantInts, use get().
   ConstantInt(MosesIRContext &Ctx, int val);
 
-  /// \brief Get a ConstantInt for a specific value.
-  static std::shared_ptr<ConstantInt> get(MosesIRContext &Ctx, int value) {
-    auto CI = std::make_shared<ConstantInt>(Ctx, value);
-    CI->setName(std::to_string(value));
-    return CI;
-  }
+  /// \brief Get the ConstantInt of Ctx for a specific value.
+  static std::shared_ptr<ConstantInt> get(MosesIRContext &Ctx, int value);
 
   bool equalsInt(int v) const { return Val == v; }
   int getVal() const { return Val; }
   // Shit code.
   static std::shared_ptr<ConstantInt>
   getZeroValueForNegative(MosesIRContext &Ctx) {
-    return std::make_shared<ConstantInt>(Ctx, 0);
+    return get(Ctx, 0);
   }
 
+  /// \brief Get the value spelled out, it is what the printer shows for the
+  /// constant.
+  const std::string &getName() const override;
+  /// A uniqued constant can't be renamed.
+  void setName(const std::string &name) override;
+
   static bool classof(std::shared_ptr<Value> V) {
     return V->getValueType() == Value::ValueTy::ConstantVal;
   }
@@ -79,6 +79,8 @@ public:
   static IRTyPtr getBoolType(MosesIRContext &Ctx);
 
   virtual unsigned getSize() const;
+  /// getAlignment - Return the alignment required by the memory of the type.
+  virtual unsigned getAlignment() const;
 
   /// \brief Print the type info.
   virtual void Print(std::ostringstream &out);
@@ -156,6 +158,7 @@ public:
   static IRStructTyPtr get(MosesIRContext &Ctx, std::shared_ptr<ASTType> type);
 
   virtual unsigned getSize() const override;
+  virtual unsigned getAlignment() const override;
 
   bool isLiteral() const { return Literal; }
 
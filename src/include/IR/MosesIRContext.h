@@ -83,6 +83,33 @@ struct AnonStructTypeKeyInfo {
   }
 };
 
+struct ConstantIntKeyInfo {
+  struct KeyTy {
+    std::shared_ptr<Type> Ty;
+    int Val;
+    KeyTy(std::shared_ptr<Type> Ty, int Val) : Ty(Ty), Val(Val) {}
+    KeyTy(std::shared_ptr<ConstantInt> CI)
+        : Ty(CI->getType()), Val(CI->getVal()) {}
+    bool operator==(const KeyTy &rhs) const {
+      return Ty.get() == rhs.Ty.get() && Val == rhs.Val;
+    }
+    bool operator!=(const KeyTy &rhs) const { return !this->operator==(rhs); }
+  };
+  static unsigned long long getHashValue(const KeyTy &Key) {
+    return hash_value(Key.Ty, Key.Val);
+  }
+  static unsigned long long getHashValue(std::shared_ptr<ConstantInt> RHS) {
+    return getHashValue(KeyTy(RHS));
+  }
+  static bool isEqual(const KeyTy &LHS, std::shared_ptr<ConstantInt> RHS) {
+    return LHS == KeyTy(RHS);
+  }
+  static bool isEqual(std::shared_ptr<ConstantInt> LHS,
+                      std::shared_ptr<ConstantInt> RHS) {
+    return LHS == RHS;
+  }
+};
+
 struct NamedStructTypeKeyInfo {
   struct KeyTy {
     std::vector<std::shared_ptr<Type>> ETypes;
@@ -90,9 +117,10 @@ struct NamedStructTypeKeyInfo {
     // bool ispacked;
     KeyTy(const std::vector<std::shared_ptr<Type>> &E, std::string Name)
         : ETypes(E), Name(Name) {}
-    KeyTy(std::shared_ptr<StructType> ST) : ETypes(ST->getContainedTys()) {}
+    KeyTy(std::shared_ptr<StructType> ST)
+        : ETypes(ST->getContainedTys()), Name(ST->getName()) {}
     bool operator==(const KeyTy &rhs) const {
-      if (Name == rhs.Name)
+      if (Name != rhs.Name)
         return false;
       if (ETypes == rhs.ETypes)
         return true;
@@ -127,6 +155,8 @@ class MosesIRContext {
   TypeSet<std::shared_ptr<StructType>, AnonStructTypeKeyInfo> StructTypeSet;
   TypeSet<std::shared_ptr<StructType>, NamedStructTypeKeyInfo>
       NamedStructTypeSet;
+  // The constant pool, every integer constant of the module.
+  TypeSet<std::shared_ptr<ConstantInt>, ConstantIntKeyInfo> IntConstants;
 
 public:
   MosesIRContext()
@@ -137,6 +167,8 @@ public:
     std::vector<std::string> Names = {"dst", "src"};
     Intrinsics.push_back(std::make_shared<Intrinsic>("mosesir.memcpy", Names));
     Intrinsics.push_back(std::make_shared<Intrinsic>("mosesir.print", Names));
+    TheTrueVal = std::make_shared<ConstantBool>(*this, true);
+    TheFalseVal = std::make_shared<ConstantBool>(*this, false);
   }
   /// \brief Add literal structure type(AnonymousType).
   void AddStructType(std::shared_ptr<StructType> Type) {
@@ -159,11 +191,16 @@ public:
   std::shared_ptr<Type> getBoolTy() const { return BoolTy; }
   std::shared_ptr<Type> getLabelTy() const { return LabelTy; }
 
-  std::vector<std::shared_ptr<StructType>> getAnonyTypes() const {
+  std::shared_ptr<ConstantBool> getTrue() const { return TheTrueVal; }
+  std::shared_ptr<ConstantBool> getFalse() const { return TheFalseVal; }
+  /// \brief Get the uniqued ConstantInt of Val, it is made the first time.
+  std::shared_ptr<ConstantInt> getConstantInt(int Val);
+
+  const std::vector<std::shared_ptr<StructType>> &getAnonyTypes() const {
     return StructTypeSet.getBuckets();
   }
 
-  std::vector<std::shared_ptr<StructType>> getNamedTypes() const {
+  const std::vector<std::shared_ptr<StructType>> &getNamedTypes() const {
     return NamedStructTypeSet.getBuckets();
   }
 };
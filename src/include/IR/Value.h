@@ -23,7 +23,7 @@
 /// not a subclass of Value.
 ///
 /// Every value has a "use list" that keeps track of which other Values are
-/// using this value.
+/// using this value, but the constants, they are shared by the whole module.
 /// -------------------------------------------------------------------------
 
 namespace IR {
@@ -103,7 +103,7 @@ public:
   // hasOneUse - Return true if there is exactly one user of this value.
   bool hasOneUse() const;
   bool hasName() const { return Name != ""; }
-  const std::string &getName() const { return Name; }
+  virtual const std::string &getName() const { return Name; }
   virtual void setName(const std::string &name) { Name = name; }
 
   /// getValueType - Return the immediate subclass of this Value.
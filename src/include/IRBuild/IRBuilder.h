@@ -124,9 +124,10 @@ public:
   static std::string LocalInstNamePrefix;
 
 private:
-  // Symbol table from sema.
+  // Symbol table from sema. The AST is bound to its symbols and scopes, the
+  // builder only follows those links.
   std::shared_ptr<Scope> SymbolTree;
-  std::shared_ptr<Scope> CurScope;
+  Scope *CurScope;
 
   std::vector<CGStmt::BreakContinue> BreakContinueStack;
 
@@ -176,7 +177,7 @@ public:
     return LocalInstNamePrefix + Name + std::to_string(TempCounter++);
   }
 
-  void VisitChildren(std::vector<std::shared_ptr<StatementAST>> AST);
+  void VisitChildren(std::vector<StatementAST *> AST);
 
   // Note: We only need to consider the type of AST leaf node.
   std::shared_ptr<Value> visit([[maybe_unused]] const StatementAST *stmt) { return nullptr; }
@@ -247,7 +248,7 @@ private:
                           std::vector<std::shared_ptr<Value>> &SubArgs);
 
   RValue EmitCall(const FunctionDecl *FD, std::shared_ptr<Value> FuncAddr,
-                  const std::vector<ExprASTPtr> &Args);
+                  std::span<const ExprASTPtr> Args);
 
   RValue EmitCall(const FunctionDecl *FD, CGFuncInfoConstPtr CGFunInfo,
                   std::shared_ptr<Value> FuncAddr, CallArgList CallArgs);
@@ -257,7 +258,7 @@ private:
 
   /// EmitCallArgs - Emit call arguments for a function.
   void EmitCallArgs(CallArgList &CallArgs,
-                    const std::vector<ExprASTPtr> &ArgExprs);
+                    std::span<const ExprASTPtr> ArgExprs);
 
   /// EmitBranchOnBoolExpr - Emit a branch on a boolean condition(e.g for an
   /// if statement) to the specified blocks. Based on the condition, this might
@@ -0,0 +1,44 @@
+//===----------------------------ParallelLexer.h--------------------------===//
+//
+// This file defines class ParallelLexer, which lexes a large source file in
+// chunks on several threads.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include "scanner.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace parse {
+/// ParallelLexer - Split a source file at line starts and lex every chunk on
+/// a worker thread. Only a string literal spans lines, so a chunk is lexed
+/// again from the quote when the chunk before it ends inside a literal. The
+/// identifiers are interned in the order of the source once all the chunks
+/// are lexed, so the token stream is the same as the one of the serial
+/// scanner.
+class ParallelLexer {
+  unsigned FileID;
+  unsigned NumThreads;
+
+  using ChunkList = std::vector<std::unique_ptr<LexedChunk>>;
+
+  void splitChunks(ChunkList &Chunks) const;
+  void lexChunk(LexedChunk &Chunk) const;
+  void fixOpenStrings(ChunkList &Chunks) const;
+
+public:
+  /// A chunk is never smaller than MinChunkSize bytes, smaller files are
+  /// lexed on the calling thread.
+  static constexpr std::size_t MinChunkSize = 1 << 20;
+
+  ParallelLexer(unsigned FileID, unsigned NumThreads)
+      : FileID(FileID), NumThreads(NumThreads ? NumThreads : 1) {}
+
+  /// \brief Lex the whole file into Tokens, which starts with an empty token
+  /// and ends with the FILE_EOF token. Nothing is reported, the lexing
+  /// errors are added to Diagnostics in the order of the source.
+  void lex(std::vector<Token> &Tokens,
+           std::vector<LexDiagnostic> &Diagnostics);
+};
+} // namespace parse
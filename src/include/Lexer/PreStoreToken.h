@@ -6,70 +6,142 @@
 //===--------------------------------------------------------------------===//
 #pragma once
 #include "Token.h"
-#include <algorithm>
-#include <cassert>
-#include <string>
-#include <utility>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 using namespace tok;
 
 namespace lex {
+/// TokenSpelling - The fixed spelling of a keyword or an operator.
+struct TokenSpelling {
+  std::string_view Spelling;
+  TokenValue Kind;
+};
+
+/// PerfectHashTable - A table of spellings that maps every spelling to its own
+/// slot. The slot is computed from the length and the first and the last
+/// character of the spelling with a multiplier searched at compile time, so a
+/// lookup is one hash, one load and one comparison.
+template <std::size_t NumSlots> class PerfectHashTable {
+  static_assert((NumSlots & (NumSlots - 1)) == 0,
+                "The number of slots must be a power of two.");
+  TokenSpelling Slots[NumSlots];
+  std::uint32_t Seed;
+
+  static constexpr std::size_t hash(std::string_view S, std::uint32_t Seed) {
+    std::uint32_t Key = static_cast<unsigned char>(S.front()) * 131u +
+                        static_cast<unsigned char>(S.back()) * 7u +
+                        static_cast<std::uint32_t>(S.size());
+    Key *= Seed;
+    return (Key ^ (Key >> 15)) & (NumSlots - 1);
+  }
+
+public:
+  template <std::size_t NumEntries>
+  constexpr PerfectHashTable(const TokenSpelling (&Entries)[NumEntries])
+      : Slots(), Seed(0) {
+    static_assert(NumEntries <= NumSlots, "Too many spellings.");
+    for (std::uint32_t Candidate = 1; Candidate < 100000; Candidate += 2) {
+      bool Used[NumSlots] = {};
+      bool Collision = false;
+      for (const auto &Entry : Entries) {
+        std::size_t Slot = hash(Entry.Spelling, Candidate);
+        if (Used[Slot]) {
+          Collision = true;
+          break;
+        }
+        Used[Slot] = true;
+      }
+      if (!Collision) {
+        Seed = Candidate;
+        break;
+      }
+    }
+    for (auto &Slot : Slots)
+      Slot = {std::string_view(), TokenValue::UNKNOWN};
+    for (const auto &Entry : Entries)
+      Slots[hash(Entry.Spelling, Seed)] = Entry;
+  }
+
+  constexpr bool isPerfect() const { return Seed != 0; }
+
+  /// \brief Get the kind of the spelling S, UNKNOWN if S isn't in the table.
+  constexpr TokenValue lookup(std::string_view S) const {
+    if (S.empty())
+      return TokenValue::UNKNOWN;
+    const TokenSpelling &Slot = Slots[hash(S, Seed)];
+    return Slot.Spelling == S ? Slot.Kind : TokenValue::UNKNOWN;
+  }
+};
+
 class PreStoreToken {
-  std::vector<Token> tokenTable{
-      {TokenValue::KEYWORD_var, "var"},
-      {TokenValue::KEYWORD_const, "const"},
-      {TokenValue::KEYWORD_if, "if"},
-      {TokenValue::KEYWORD_else, "else"},
-      {TokenValue::KEYWORD_break, "break"},
-      {TokenValue::KEYWORD_while, "while"},
-      {TokenValue::KEYWORD_continue, "continue"},
-      {TokenValue::KEYWORD_int, "int"},
-      {TokenValue::KEYWORD_bool, "bool"},
-      {TokenValue::KEYWORD_class, "class"},
-      {TokenValue::KEYWORD_return, "return"},
-      {TokenValue::KEYWORD_func, "func"},
-      {TokenValue::KEYWORD_void, "void"},
-      {TokenValue::BOOL_TRUE, "true"},
-      {TokenValue::BOOL_FALSE, "false"},
-      {TokenValue::BO_Mul, "*"},
-      {TokenValue::BO_Div, "/"},
-      {TokenValue::BO_Rem, "%"},
-      {TokenValue::BO_Add, "+"},
-      {TokenValue::BO_Sub, "-"},
-      {TokenValue::BO_LT, "<"},
-      {TokenValue::BO_GT, ">"},
-      {TokenValue::BO_LE, "<="},
-      {TokenValue::BO_GE, ">="},
-      {TokenValue::BO_EQ, "=="},
-      {TokenValue::BO_NE, "!="},
-      {TokenValue::BO_And, "&&"},
-      {TokenValue::BO_Or, "||"},
-      {TokenValue::BO_AndAssign, "&&=="},
-      {TokenValue::BO_OrAssign, "||="},
-      {TokenValue::BO_Assign, "="},
-      {TokenValue::BO_MulAssign, "*="},
-      {TokenValue::BO_DivAssign, "/="},
-      {TokenValue::BO_RemAssign, "%="},
-      {TokenValue::BO_AddAssign, "+="},
-      {TokenValue::BO_SubAssign, "-="},
-      {TokenValue::UO_Dec, "--"},
-      {TokenValue::UO_Inc, "++"},
-      {TokenValue::UO_Exclamatory, "!"},
-      {TokenValue::PUNCTUATOR_Left_Paren, "("},
-      {TokenValue::PUNCTUATOR_Right_Paren, ")"},
-      {TokenValue::PUNCTUATOR_Left_Brace, "{"},
-      {TokenValue::PUNCTUATOR_Right_Brace, "}"},
-      {TokenValue::PUNCTUATOR_Arrow, "->"},
-      {TokenValue::PUNCTUATOR_Colon, ":"},
-      {TokenValue::PUNCTUATOR_Semicolon, ";"},
-      {TokenValue::PUNCTUATOR_Member_Access, "."},
-      {TokenValue::PUNCTUATOR_Comma, ","}
-  };
+  static constexpr TokenSpelling Keywords[] = {
+      {"var", TokenValue::KEYWORD_var},
+      {"const", TokenValue::KEYWORD_const},
+      {"if", TokenValue::KEYWORD_if},
+      {"else", TokenValue::KEYWORD_else},
+      {"break", TokenValue::KEYWORD_break},
+      {"while", TokenValue::KEYWORD_while},
+      {"continue", TokenValue::KEYWORD_continue},
+      {"int", TokenValue::KEYWORD_int},
+      {"bool", TokenValue::KEYWORD_bool},
+      {"class", TokenValue::KEYWORD_class},
+      {"return", TokenValue::KEYWORD_return},
+      {"func", TokenValue::KEYWORD_func},
+      {"void", TokenValue::KEYWORD_void},
+      {"true", TokenValue::BOOL_TRUE},
+      {"false", TokenValue::BOOL_FALSE}};
+
+  static constexpr TokenSpelling Operators[] = {
+      {"*", TokenValue::BO_Mul},
+      {"/", TokenValue::BO_Div},
+      {"%", TokenValue::BO_Rem},
+      {"+", TokenValue::BO_Add},
+      {"-", TokenValue::BO_Sub},
+      {"<", TokenValue::BO_LT},
+      {">", TokenValue::BO_GT},
+      {"<=", TokenValue::BO_LE},
+      {">=", TokenValue::BO_GE},
+      {"==", TokenValue::BO_EQ},
+      {"!=", TokenValue::BO_NE},
+      {"&&", TokenValue::BO_And},
+      {"||", TokenValue::BO_Or},
+      {"&&==", TokenValue::BO_AndAssign},
+      {"||=", TokenValue::BO_OrAssign},
+      {"=", TokenValue::BO_Assign},
+      {"*=", TokenValue::BO_MulAssign},
+      {"/=", TokenValue::BO_DivAssign},
+      {"%=", TokenValue::BO_RemAssign},
+      {"+=", TokenValue::BO_AddAssign},
+      {"-=", TokenValue::BO_SubAssign},
+      {"--", TokenValue::UO_Dec},
+      {"++", TokenValue::UO_Inc},
+      {"!", TokenValue::UO_Exclamatory},
+      {"(", TokenValue::PUNCTUATOR_Left_Paren},
+      {")", TokenValue::PUNCTUATOR_Right_Paren},
+      {"{", TokenValue::PUNCTUATOR_Left_Brace},
+      {"}", TokenValue::PUNCTUATOR_Right_Brace},
+      {"->", TokenValue::PUNCTUATOR_Arrow},
+      {":", TokenValue::PUNCTUATOR_Colon},
+      {";", TokenValue::PUNCTUATOR_Semicolon},
+      {".", TokenValue::PUNCTUATOR_Member_Access},
+      {",", TokenValue::PUNCTUATOR_Comma}};
+
+  static constexpr PerfectHashTable<32> KeywordTable{Keywords};
+  static constexpr PerfectHashTable<128> OperatorTable{Operators};
+  static_assert(KeywordTable.isPerfect() && OperatorTable.isPerfect(),
+                "No collision-free seed for the spellings.");
 
 public:
-  [[nodiscard]] tok::TokenValue isKeyword(const std::string &lexem) const;
+  [[nodiscard]] static constexpr tok::TokenValue
+  isKeyword(std::string_view lexem) {
+    return KeywordTable.lookup(lexem);
+  }
 
-  [[nodiscard]] tok::TokenValue isOperator(const std::string &lexem) const;
+  [[nodiscard]] static constexpr tok::TokenValue
+  isOperator(std::string_view lexem) {
+    return OperatorTable.lookup(lexem);
+  }
 };
 } // namespace lex
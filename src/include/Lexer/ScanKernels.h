@@ -0,0 +1,42 @@
+//===-----------------------------ScanKernels.h---------------------------===//
+//
+// This file defines the kernels that the scanner uses to skip runs of
+// characters of one class, 16 or 32 bytes at a time.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+
+namespace lex {
+/// ScanKernels - The character class scans of the scanner. Every kernel
+/// returns the first character in [Ptr, End) that ends the run, End if
+/// there is none. The classes are ASCII only, like the "C" locale.
+///
+/// There is a scalar, an SSE2 and an AVX2 version of every kernel, get()
+/// returns the fastest version the host runs.
+struct ScanKernels {
+  enum class Level { Scalar, SSE2, AVX2 };
+  using KernelFn = const char *(*)(const char *Ptr, const char *End);
+
+  Level KernelLevel;
+  // Skip ' ', '\t', '\n', '\v', '\f' and '\r'.
+  KernelFn SkipWhitespace;
+  // Find the '\n' or '\r' that ends a line comment.
+  KernelFn FindLineEnd;
+  // Skip [A-Za-z0-9_].
+  KernelFn SkipIdentifier;
+  // Skip [0-9].
+  KernelFn SkipDigits;
+  // Skip [0-9A-Fa-f].
+  KernelFn SkipHexDigits;
+
+  /// \brief Get the kernels of the best level the host supports, it is
+  /// selected once from the CPU features.
+  static const ScanKernels &get();
+
+  /// \brief Get the kernels of Level, or of the best level below it if the
+  /// host doesn't support it.
+  static const ScanKernels &get(Level L);
+
+  static const char *getLevelName(Level L);
+};
+} // namespace lex
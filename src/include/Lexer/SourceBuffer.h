@@ -0,0 +1,41 @@
+//===----------------------------SourceBuffer.h---------------------------===//
+//
+// This file defines class SourceBuffer, which holds the whole text of a source
+// file in memory.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lex {
+/// SourceBuffer - The contents of a source file. The file is mapped read-only
+/// where the host supports it, and read in one call otherwise, so the scanner
+/// walks a plain character range and the lexemes can point into it.
+class SourceBuffer {
+  const char *BufferStart;
+  std::size_t Size;
+  // The mapping, nullptr if the file was read into Storage.
+  void *Mapping;
+  std::string Storage;
+
+public:
+  SourceBuffer() : BufferStart(""), Size(0), Mapping(nullptr) {}
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  ~SourceBuffer();
+
+  /// \brief Load the file FileName, return false if it can't be read.
+  bool load(const std::string &FileName);
+
+  /// \brief Replace the contents by Text, which the buffer then owns.
+  void setContents(std::string Text);
+
+  const char *getBufferStart() const { return BufferStart; }
+  const char *getBufferEnd() const { return BufferStart + Size; }
+  std::size_t getBufferSize() const { return Size; }
+  std::string_view getBuffer() const { return {BufferStart, Size}; }
+  bool isMapped() const { return Mapping; }
+};
+} // namespace lex
@@ -0,0 +1,77 @@
+//===----------------------------SourceManager.h--------------------------===//
+//
+// This file defines class SourceManager, which owns the source files and maps
+// the source offsets of the tokens back to files, lines and columns.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include "SourceBuffer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lex {
+/// SourceManager - All the loaded source files. Every file owns the range
+/// [Base, Base + Size] of one 32-bit offset space, the last offset is the
+/// end of file. Offset 0 is never used, it is the invalid location.
+///
+/// The line table of a file is only built when a line or a column is asked
+/// for, the lexer itself never needs it. The queries only read the manager
+/// once the line tables are built, see buildLineTables.
+class SourceManager {
+  struct FileEntry {
+    std::string Name;
+    std::unique_ptr<SourceBuffer> Buffer;
+    std::uint32_t Base;
+    // The offsets of the first character of every line, relative to Base.
+    mutable std::vector<std::uint32_t> LineStarts;
+  };
+  std::vector<FileEntry> Files;
+  std::uint32_t NextBase;
+
+  const FileEntry *getFileEntry(std::uint32_t Offset) const;
+  static void buildLineTable(const FileEntry &File);
+
+public:
+  SourceManager() : NextBase(1) {}
+  SourceManager(const SourceManager &) = delete;
+  SourceManager &operator=(const SourceManager &) = delete;
+
+  /// \brief Get the source manager of the compilation.
+  static SourceManager &get();
+
+  /// \brief Load the file Name and assign it an offset range. The file is
+  /// registered even if it can't be read, with an empty buffer, so that
+  /// the errors can still name it. Return false if it can't be read.
+  bool addFile(const std::string &Name, unsigned &FileID);
+
+  /// \brief Replace the contents of the file FileID by Text, the file keeps
+  /// its base. Only the last file may outgrow its offset range.
+  void replaceBuffer(unsigned FileID, std::string Text);
+
+  const SourceBuffer &getBuffer(unsigned FileID) const {
+    return *Files[FileID].Buffer;
+  }
+  std::uint32_t getFileBase(unsigned FileID) const {
+    return Files[FileID].Base;
+  }
+  /// \brief Get the base the next file added gets.
+  std::uint32_t getNextFileBase() const { return NextBase; }
+
+  /// \brief Get the character at Offset, nullptr if Offset is invalid.
+  const char *getCharacterData(std::uint32_t Offset) const;
+
+  /// \brief Build the line table of every file that has none, so that the
+  /// locations can be asked for on several threads at once.
+  void buildLineTables() const;
+
+  /// \brief Get the 1-based line and column of Offset and the name of its
+  /// file. Return false, with the line and column 0, if Offset is invalid.
+  /// It builds the line table of the file if it has none, which only one
+  /// thread may do.
+  bool getPresumedLoc(std::uint32_t Offset, unsigned long &Line,
+                      unsigned long &Column,
+                      const std::string *&FileName) const;
+};
+} // namespace lex
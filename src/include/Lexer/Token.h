@@ -1,84 +1,61 @@
 #pragma once
 #include "TokenKinds.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 
 namespace lex {
+/// TokenLocation - A source offset given out by the SourceManager. The line,
+/// the column and the file name are looked up when they are asked for.
 class TokenLocation {
-  std::size_t LineNumber;
-  std::size_t ColNumber;
-  std::string FileName;
+  std::uint32_t Offset;
 
 public:
-  TokenLocation() : LineNumber(0), ColNumber(0), FileName("") {}
-
-  TokenLocation(const TokenLocation &TL) {
-    LineNumber = TL.LineNumber;
-    ColNumber = TL.ColNumber;
-    FileName = TL.FileName;
-  }
-
-  TokenLocation& operator=(const TokenLocation &TL) {
-    LineNumber = TL.LineNumber;
-    ColNumber = TL.ColNumber;
-    FileName = TL.FileName;
-    return *this;
-  }
+  TokenLocation() : Offset(0) {}
+  explicit TokenLocation(std::uint32_t Offset) : Offset(Offset) {}
 
   bool operator==(const TokenLocation &tokenLoc) const {
-    if (LineNumber == tokenLoc.LineNumber && ColNumber == tokenLoc.ColNumber &&
-        FileName == tokenLoc.FileName)
-      return true;
-    return false;
+    return Offset == tokenLoc.Offset;
   }
 
   [[nodiscard]] bool operator!=(const TokenLocation &tokenLoc) const {
     return !operator==(tokenLoc);
   }
 
-  TokenLocation(std::size_t lineNumber, std::size_t colNumber, std::string fileName)
-      : LineNumber(lineNumber), ColNumber(colNumber), FileName(fileName) {}
-
-  void setTokenLineNumber(std::size_t lineNumber) { LineNumber = lineNumber; }
-  void setTokenColNumber(std::size_t colNumber) { ColNumber = colNumber; }
-  void setTokenFileName(std::size_t fileName) { FileName = fileName; }
-  [[nodiscard]] unsigned long getTokenLineNumber() const { return LineNumber; }
-  [[nodiscard]] unsigned long getTokenColNumber() const { return ColNumber; }
-  [[nodiscard]] const std::string& getTokenFileName() const { return FileName; }
-  std::string toString() {
-    std::string LineStr = std::to_string(LineNumber);
-    std::string ColStr = std::to_string(ColNumber);
-    return FileName + ": Line: " + LineStr + ", ColumnNumber: " + ColStr;
-  }
+  [[nodiscard]] bool isValid() const { return Offset != 0; }
+  [[nodiscard]] std::uint32_t getOffset() const { return Offset; }
+  [[nodiscard]] unsigned long getTokenLineNumber() const;
+  [[nodiscard]] unsigned long getTokenColNumber() const;
+  [[nodiscard]] const std::string &getTokenFileName() const;
+  std::string toString() const;
 };
 
+/// Token - A token is 16 bytes, cheap to copy. The lexeme is the range
+/// [offset, offset + length) of the SourceManager, the values of the
+/// literals are converted from it when they are asked for, and an identifier
+/// carries the ID of its name in the StringInterner.
 class Token {
   using TokenValue = tok::TokenValue;
 
   TokenValue value;
-  TokenLocation loc;
-
-  std::string lexem;
-
-  long intValue;
-  double realValue;
-  std::string strValue;
+  std::uint16_t flags;
+  std::uint32_t offset;
+  std::uint32_t length;
+  std::uint32_t identID;
 
 public:
   Token();
 
-  Token(TokenValue tv, const std::string &lexem);
-
-  Token(TokenValue tv, const TokenLocation &location, const std::string &lexem);
-
-  // Token(TokenValue tv, const TokenLocation& location, const std::string&
-  // strValue, std::string lexem);
-  Token(TokenValue tv, const TokenLocation &location, long intvalue,
-        const std::string &lexem);
-
-  Token(TokenValue tv, const TokenLocation &location, double realvalue,
-        const std::string &lexem);
+  Token(TokenValue tv, const TokenLocation &location, std::uint32_t length,
+        std::uint32_t identID = 0, std::uint16_t flags = 0);
   enum class TokenFlags { StatrtOfLine, LeadingSpace };
+  /// The integer literal is written in hexadecimal, the lexeme starts after
+  /// the '$' at the location of the token.
+  static constexpr std::uint16_t HexLiteral = 1;
+  /// The lexeme of the literal starts after the '"' at the location of the
+  /// token.
+  static constexpr std::uint16_t QuotedLiteral = 2;
 
   void setKind(tok::TokenValue K) { value = K; }
   [[nodiscard]] TokenValue getKind() const { return value; }
@@ -86,19 +63,24 @@ public:
   [[nodiscard]] bool is(TokenValue K) const { return K == value; }
   [[nodiscard]] bool isNot(TokenValue K) const { return K != value; }
 
-  [[nodiscard]] TokenLocation &getTokenLoc() { return loc; }
-  void setTokenLoc(const TokenLocation &loc) { this->loc = loc; }
+  [[nodiscard]] TokenLocation getTokenLoc() const {
+    return TokenLocation(offset);
+  }
+  void setTokenLoc(const TokenLocation &Loc) { offset = Loc.getOffset(); }
+  /// \brief Get the length of the lexeme, the quotes of a literal are not in
+  /// it.
+  [[nodiscard]] std::uint32_t getLength() const { return length; }
 
   // help method
-  [[nodiscard]] bool isIdentifier() { return value == TokenValue::IDENTIFIER; }
+  [[nodiscard]] bool isIdentifier() const { return value == TokenValue::IDENTIFIER; }
 
-  [[nodiscard]] bool isAssign() {
+  [[nodiscard]] bool isAssign() const {
     return (value >= TokenValue::BO_Assign) &&
            (value <= TokenValue::BO_OrAssign);
   }
 
   // LHS and RHS must be int type.
-  [[nodiscard]] bool isIntOperator() {
+  [[nodiscard]] bool isIntOperator() const {
     if (value == TokenValue::BO_Add || value == TokenValue::BO_AddAssign ||
         value == TokenValue::BO_Sub || value == TokenValue::BO_SubAssign ||
         value == TokenValue::BO_Mul || value == TokenValue::BO_MulAssign ||
@@ -108,7 +90,7 @@ public:
   }
 
   // Operands must be bool type.
-  [[nodiscard]] bool isBoolOperator() {
+  [[nodiscard]] bool isBoolOperator() const {
     if (value == TokenValue::BO_And || value == TokenValue::BO_Or ||
         value == TokenValue::UO_Exclamatory ||
         value == TokenValue::BO_AndAssign || value == TokenValue::BO_OrAssign)
@@ -116,7 +98,7 @@ public:
     return false;
   }
 
-  [[nodiscard]] bool isCmpOperator() {
+  [[nodiscard]] bool isCmpOperator() const {
     if (value == TokenValue::BO_EQ || value == TokenValue::BO_GE ||
         value == TokenValue::BO_GT || value == TokenValue::BO_LE ||
         value == TokenValue::BO_LT || value == TokenValue::BO_NE)
@@ -124,7 +106,7 @@ public:
     return false;
   }
 
-  [[nodiscard]] bool isArithmeticOperator() {
+  [[nodiscard]] bool isArithmeticOperator() const {
     if (value == TokenValue::BO_Add || value == TokenValue::BO_AddAssign ||
         value == TokenValue::BO_Sub || value == TokenValue::BO_SubAssign ||
         value == TokenValue::BO_Mul || value == TokenValue::BO_MulAssign ||
@@ -134,7 +116,7 @@ public:
     return false;
   }
 
-  [[nodiscard]] bool isLogicalOperator() {
+  [[nodiscard]] bool isLogicalOperator() const {
     if (value == TokenValue::BO_EQ || value == TokenValue::BO_GE ||
         value == TokenValue::BO_GT || value == TokenValue::BO_LE ||
         value == TokenValue::BO_LT || value == TokenValue::BO_NE ||
@@ -146,48 +128,57 @@ public:
     return false;
   }
 
-  [[nodiscard]] bool isKeyword() {
+  [[nodiscard]] bool isKeyword() const {
     return (value >= TokenValue::KEYWORD_var) &&
            (value <= TokenValue::KEYWORD_return);
   }
 
-  [[nodiscard]] bool isPunctuator() {
+  [[nodiscard]] bool isPunctuator() const {
     return (value >= TokenValue::PUNCTUATOR_Left_Paren) &&
            (value <= TokenValue::PUNCTUATOR_Comma);
   }
 
-  [[nodiscard]] bool isBinaryOp() {
+  [[nodiscard]] bool isBinaryOp() const {
     return (value >= TokenValue::BO_Mul) &&
            (value <= TokenValue::BO_OrAssign) &&
            value != TokenValue::UO_Inc && value != TokenValue::UO_Dec &&
             value != TokenValue::UO_Exclamatory;
   }
 
-  [[nodiscard]] bool isUnaryOp() {
+  [[nodiscard]] bool isUnaryOp() const {
     return (value == TokenValue::UO_Dec) || (value == TokenValue::UO_Inc) ||
            (value == TokenValue::UO_Exclamatory);
   }
 
-  [[nodiscard]] bool isCharConstant() { return value == TokenValue::CHAR_LITERAL; }
-  [[nodiscard]] bool isNumericConstant() {
+  [[nodiscard]] bool isCharConstant() const { return value == TokenValue::CHAR_LITERAL; }
+  [[nodiscard]] bool isNumericConstant() const {
     return value == TokenValue::REAL_LITERAL ||
            value == TokenValue::INTEGER_LITERAL;
   }
-  [[nodiscard]] bool isStringLiteral() { return value == TokenValue::STRING_LITERAL; }
+  [[nodiscard]] bool isStringLiteral() const { return value == TokenValue::STRING_LITERAL; }
 
   [[nodiscard]] tok::TokenValue getValue() const { return value; }
 
-  [[nodiscard]] long getIntValue() const { return intValue; }
-  [[nodiscard]] double getRealValue() const { return realValue; }
-  [[nodiscard]] const std::string& getStringValue() const { return strValue; }
-  [[nodiscard]] std::string getLexem() { return lexem; }
+  [[nodiscard]] long getIntValue() const;
+  [[nodiscard]] double getRealValue() const;
+  [[nodiscard]] std::string_view getStringValue() const {
+    return getLexemView();
+  }
+  [[nodiscard]] std::string getLexem() const {
+    return std::string(getLexemView());
+  }
+  [[nodiscard]] std::string_view getLexemView() const;
+  /// \brief Get the StringInterner ID of an identifier, 0 for other tokens.
+  [[nodiscard]] std::uint32_t getIdentifierID() const { return identID; }
+  void setIdentifierID(std::uint32_t ID) { identID = ID; }
 
   [[nodiscard]] bool operator==(const Token &token) const {
-    if (value == token.value && loc == token.loc) {
+    if (value == token.value && offset == token.offset) {
       return true;
     }
     return false;
   }
   [[nodiscard]] bool operator!=(const Token &token) const { return !operator==(token); }
 };
+static_assert(sizeof(Token) == 16, "Token should stay compact.");
 } // namespace lex
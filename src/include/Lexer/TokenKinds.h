@@ -5,6 +5,9 @@
 //
 //===---------------------------------------------------------------------===//
 #pragma once
+#include <cstdint>
+#include <initializer_list>
+
 namespace tok {
 enum class TokenValue : unsigned short {
   IDENTIFIER,
@@ -72,4 +75,29 @@ enum class TokenValue : unsigned short {
   FILE_EOF,
   UNKNOWN
 };
+
+/// NumTokenValues - The number of token kinds, UNKNOWN is the last one.
+constexpr unsigned NumTokenValues =
+    static_cast<unsigned>(TokenValue::UNKNOWN) + 1;
+
+/// TokenSet - A set of token kinds with a bit per kind. The sets are built
+/// at compile time, testing a token is a shift and a mask.
+class TokenSet {
+  static constexpr unsigned WordBits = 64;
+  std::uint64_t Words[(NumTokenValues + WordBits - 1) / WordBits] = {};
+
+public:
+  constexpr TokenSet() = default;
+  constexpr TokenSet(std::initializer_list<TokenValue> Kinds) {
+    for (TokenValue Kind : Kinds)
+      Words[static_cast<unsigned>(Kind) / WordBits] |=
+          std::uint64_t(1) << (static_cast<unsigned>(Kind) % WordBits);
+  }
+
+  constexpr bool contains(TokenValue Kind) const {
+    return Words[static_cast<unsigned>(Kind) / WordBits] >>
+               (static_cast<unsigned>(Kind) % WordBits) &
+           1;
+  }
+};
 } // namespace tok
@@ -1,6 +1,9 @@
 #pragma once
 #include "Support/error.h"
+#include "Support/StringInterner.h"
 #include "PreStoreToken.h"
+#include "ScanKernels.h"
+#include "SourceManager.h"
 #include "Token.h"
 #include "TokenKinds.h"
 #include <algorithm>
@@ -9,41 +12,118 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace parse {
 using namespace lex;
 
+/// LexDiagnostic - A lexing error found ahead of the parser, it is reported
+/// when the token TokenIndex is replayed.
+struct LexDiagnostic {
+  std::size_t TokenIndex;
+  TokenLocation Loc;
+  std::string Message;
+  // A character that starts no token, the compilation stops there.
+  bool BadToken;
+
+  LexDiagnostic(std::size_t TokenIndex, TokenLocation Loc,
+                const std::string &Message, bool BadToken = false)
+      : TokenIndex(TokenIndex), Loc(Loc), Message(Message),
+        BadToken(BadToken) {}
+};
+
+/// LexedChunk - The tokens of the range [Begin, End) of a source file, lexed
+/// on its own by a worker of the ParallelLexer. Nothing is reported, traced
+/// or interned in the global tables while a chunk is lexed.
+struct LexedChunk {
+  const char *Begin;
+  const char *End;
+  // Whether End is the end of the file.
+  bool EndsFile;
+  std::vector<Token> Tokens;
+  // The interner of the identifier IDs of Tokens, a local one unless the
+  // chunk is the whole file.
+  Support::StringInterner LocalIdentifiers;
+  Support::StringInterner *Identifiers;
+  // The token indexes are local to the chunk. A bad token stops the chunk.
+  std::vector<LexDiagnostic> Diagnostics;
+  // The quote of a string literal that is still open at End.
+  TokenLocation OpenString;
+
+  LexedChunk(const char *Begin, const char *End, bool EndsFile)
+      : Begin(Begin), End(End), EndsFile(EndsFile),
+        Identifiers(&LocalIdentifiers) {}
+};
+
+/// TokenEdit - How an edit of the source changed the token buffer. The tokens
+/// [First, OldEnd) were replaced by the tokens [First, NewEnd), the tokens
+/// after them moved Delta bytes.
+struct TokenEdit {
+  std::size_t First;
+  std::size_t OldEnd;
+  std::size_t NewEnd;
+  std::int64_t Delta;
+};
+
 class Scanner {
+  friend class ParallelLexer;
+
 private:
   enum class State { NONE, END_OF_FILE, IDENTIFIER, NUMBER, STRING, OPERATION };
 
   std::string FileName;
-  std::ifstream input;
-  unsigned long CurLine;
-  unsigned long CurCol;
+  // The whole source file is owned by the SourceManager, the scanner walks it
+  // with a raw pointer. The location of a character is FileBase plus its
+  // offset in the buffer.
+  unsigned FileID;
+  std::uint32_t FileBase;
+  const char *BufferStart;
+  const char *BufferPtr;
+  const char *BufferEnd;
+  // The position of CurrentChar, BufferEnd once the end of file is read.
+  const char *CurPtr;
+  bool AtEOF;
   TokenLocation CurLoc;
+  // The runs of whitespace, comments, identifiers and digits are skipped by
+  // the kernels of the host.
+  const ScanKernels &Kernels;
 
   char CurrentChar;
-  static bool errorFlag;
+  // Set once the scanner fails, every scanner has its own.
+  bool errorFlag;
 
   State state;
-  Token Tok;
-  Token LastTok;
 
-  PreStoreToken table;
-  std::string buffer;
+  // Set while the scanner lexes a chunk for the ParallelLexer.
+  LexedChunk *Chunk;
+
+  // The token buffer of the whole file, see getNextToken. Tokens[0] is the
+  // empty token before the first one, the FILE_EOF token of the file is
+  // followed by an empty token.
+  std::vector<Token> Tokens;
+  std::vector<LexDiagnostic> Diagnostics;
+  // The index of the current token.
+  std::size_t CurToken;
+  // The furthest token consumed so far, the tokens up to it are traced and
+  // their diagnostics reported.
+  std::size_t MaxToken;
+  std::size_t NextDiagnostic;
 
 private:
   void getNextChar();
   char peekChar();
-  void addToBuffer(char c);
-  void reduceBuffer();
-  void makeToken(tok::TokenValue tv, const TokenLocation &loc,
-                 std::string name);
-  void makeToken(tok::TokenValue tv, const TokenLocation &loc,
-                 long intValue, std::string name);
+  /// \brief Make Ptr the current character, Ptr is at most BufferEnd.
+  void advanceTo(const char *Ptr) {
+    BufferPtr = Ptr;
+    getNextChar();
+  }
+  /// \brief Get the characters from Start up to CurrentChar.
+  std::string_view getLexemeFrom(const char *Start) const {
+    return std::string_view(Start, CurPtr - Start);
+  }
   void makeToken(tok::TokenValue tv, const TokenLocation &loc,
-                 double realValue, std::string name);
+                 std::string_view name, std::uint16_t flags = 0);
   void handleEOFState();
   void handleIdentifierState();
   void handleNumberState();
@@ -54,7 +134,7 @@ private:
   // void handleBlockComment();
 
   TokenLocation getTokenLocation() const {
-    return TokenLocation(CurLine, CurCol, FileName);
+    return TokenLocation(FileBase + (CurPtr - BufferStart));
   }
 
   void handleDigit();
@@ -63,14 +143,65 @@ private:
   void handleExponent();
   bool isOperator();
 
+  Scanner(unsigned FileID, LexedChunk &Chunk);
+  void lexToken();
+  void lexChunk();
+  void reachToken(std::size_t Index);
+
 public:
-  explicit Scanner(const std::string &srcFileName);
-  Token getToken() const { return Tok; };
-  Token getLastToken() const { return LastTok; };
-  Token getNextToken();
+  /// \brief Load the file and lex all of it on NumThreads threads.
+  explicit Scanner(const std::string &srcFileName, unsigned NumThreads = 1);
+
+  /// \brief Make a scanner of the tokens [First, End) of File, to parse that
+  /// part of the file on its own, on another thread. The tokens are copied,
+  /// they were traced and reported by File already and aren't again. The
+  /// part ends with a FILE_EOF token at the location of the token End.
+  Scanner(const Scanner &File, std::size_t First, std::size_t End);
+
+  /// The parser walks the token buffer, looking ahead and backtracking costs
+  /// nothing. Once the FILE_EOF token is consumed, the current token is an
+  /// empty FILE_EOF token and the last token is the FILE_EOF token of the
+  /// file, so the errors at the end of file point there.
+  const Token &getToken() const { return Tokens[CurToken]; }
+  const Token &getLastToken() const {
+    return Tokens[CurToken ? CurToken - 1 : 0];
+  }
+  /// \brief Consume the current token and return the next one.
+  const Token &getNextToken();
+  /// \brief Get the N-th token after the current one, without consuming
+  /// anything. peekToken(0) is the current token.
+  const Token &peekToken(std::size_t N) const {
+    return Tokens[std::min(CurToken + N, Tokens.size() - 1)];
+  }
+  /// \brief Get the position in the token buffer, to backtrack to it later.
+  std::size_t getTokenIndex() const { return CurToken; }
+  void backtrackTo(std::size_t Index) {
+    assert(Index <= CurToken && "Can only backtrack to a consumed token");
+    CurToken = Index;
+  }
+  /// \brief Make the token Index the next one getNextToken returns, forward or
+  /// backward. The tokens from Index on are traced and their errors reported
+  /// again when they are consumed.
+  void seekTo(std::size_t Index);
+  const Token &getTokenAt(std::size_t Index) const { return Tokens[Index]; }
+
+  /// \brief Replace RemovedLength bytes at Offset of the file by Inserted.
+  /// Only the lines the edit touched are lexed again, from the start of the
+  /// line of Offset up to the first line start after the inserted text where
+  /// the old tokens line up again. The scanner is left before the first
+  /// token replaced.
+  TokenEdit applyEdit(std::uint32_t Offset, std::uint32_t RemovedLength,
+                      std::string_view Inserted);
+
+  const SourceBuffer &getSource() const {
+    return SourceManager::get().getBuffer(FileID);
+  }
+  std::uint32_t getFileBase() const { return FileBase; }
+  /// \brief Whether the scanner found anything to report in the file.
+  bool hasDiagnostics() const { return !Diagnostics.empty(); }
 
-  static bool getErrorFlag() { return errorFlag; };
+  bool getErrorFlag() const { return errorFlag; };
   void errorReport(const std::string &msg);
-  static void setErrorFlag(bool flag) { errorFlag = flag; }
+  void setErrorFlag(bool flag) { errorFlag = flag; }
 };
 } // namespace parse
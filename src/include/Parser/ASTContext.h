@@ -4,26 +4,61 @@
 //
 //===---------------------------------------------------------------------===//
 #pragma once
+#include "Support/BumpPtrAllocator.h"
 #include "Support/Hasing.h"
 #include "Support/TypeSet.h"
 #include "Type.h"
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
 
 using namespace SupportStructure;
 namespace ast {
 /// ASTContext - This class holds types that can be referred to thorought
 /// the semantic analysis of a file.
+///
+/// It owns the AST as well. The nodes and their child arrays are allocated
+/// in the arena of the context, and refer to each other by raw pointers.
+/// They live as long as the context and are released with it in one go.
+///
+/// A function body checked on a worker thread is parsed into a context of its
+/// own, made from the context of the file. It is merged into that one once
+/// all the bodies are checked.
 class ASTContext {
 private:
   using UDKeyInfo = TypeKeyInfo::UserDefinedTypeKeyInfo;
   using AnonTypeKeyInfo = TypeKeyInfo::AnonTypeKeyInfo;
 
+  Support::BumpPtrAllocator Arena;
+  // The context of the file, for the context of a function body.
+  ASTContext *Parent;
+  // Guards the types of the context of a file while its bodies are checked.
+  std::mutex TypesLock;
+
+  std::shared_ptr<AnonymousType>
+  internAnonymousType(const std::vector<std::shared_ptr<ASTType>> &Types) {
+    AnonTypeKeyInfo::KeyTy Key(Types);
+    if (auto Anony = AnonTypes.lookup(Key))
+      return Anony;
+    return AnonTypes.insert(std::make_shared<AnonymousType>(Types));
+  }
+
 public:
   ASTContext()
-      : Int(std::make_shared<BuiltinType>(TypeKind::INT)),
+      : Parent(nullptr), Int(std::make_shared<BuiltinType>(TypeKind::INT)),
         Bool(std::make_shared<BuiltinType>(TypeKind::BOOL)),
         Void(std::make_shared<BuiltinType>(TypeKind::VOID)),
         isParseOrSemaSuccess(true) {}
 
+  /// \brief Make the context of a function body of the file of Parent. It
+  /// shares the builtin types of Parent, and keeps its anonymous and user
+  /// defined types in Parent, so that equal anonymous types of different
+  /// bodies are one type whichever thread made them.
+  explicit ASTContext(ASTContext &Parent)
+      : Parent(&Parent), Int(Parent.Int), Bool(Parent.Bool),
+        Void(Parent.Void), isParseOrSemaSuccess(true) {}
+
   std::shared_ptr<BuiltinType> Int;
   std::shared_ptr<BuiltinType> Bool;
   std::shared_ptr<BuiltinType> Void;
@@ -32,5 +67,48 @@ public:
   TypeSet<std::shared_ptr<AnonymousType>, AnonTypeKeyInfo> AnonTypes;
 
   bool isParseOrSemaSuccess;
+
+  /// \brief Allocate an AST node in the arena.
+  template <typename T, typename... ArgTys> T *create(ArgTys &&...Args) {
+    return Arena.create<T>(std::forward<ArgTys>(Args)...);
+  }
+
+  /// \brief Copy the children of a node to an array in the arena.
+  template <typename T>
+  std::span<const T> copyArray(const std::vector<T> &Elements) {
+    return Arena.copyArray(Elements);
+  }
+
+  /// \brief Get the anonymous type of the element types Types, equal
+  /// anonymous types are one type.
+  std::shared_ptr<AnonymousType>
+  getAnonymousType(const std::vector<std::shared_ptr<ASTType>> &Types) {
+    if (!Parent)
+      return internAnonymousType(Types);
+    std::lock_guard<std::mutex> Lock(Parent->TypesLock);
+    return Parent->internAnonymousType(Types);
+  }
+
+  /// \brief Record the type of a class declaration. A class declared in a
+  /// function body is a type of its own, like it is when the bodies are
+  /// checked on the thread of the file.
+  void addUserDefinedType(const std::shared_ptr<UserDefinedType> &UDT) {
+    if (!Parent) {
+      UDTypes.insert(UDT);
+      return;
+    }
+    std::lock_guard<std::mutex> Lock(Parent->TypesLock);
+    Parent->UDTypes.insert(UDT);
+  }
+
+  /// \brief Take over the nodes and the errors of the context of a function
+  /// body of this file, its types are in this context already.
+  void takeFrom(ASTContext &Body) {
+    Arena.takeFrom(Body.Arena);
+    if (!Body.isParseOrSemaSuccess)
+      isParseOrSemaSuccess = false;
+  }
+
+  std::size_t getAllocatedBytes() const { return Arena.getBytesAllocated(); }
 };
 } // namespace ast
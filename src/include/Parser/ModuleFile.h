@@ -0,0 +1,173 @@
+//===------------------------------ModuleFile.h---------------------------===//
+//
+// This file defines the precompiled module, the checked AST of a source file
+// saved next to it so that a later run can skip the scanner, the parser and
+// Sema.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include "Parser/ASTContext.h"
+#include "Parser/ast.h"
+#include "Support/SymbolTable.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ast {
+/// ModuleFile - The layout of a precompiled module. The module starts with a
+/// fixed Header in the byte order of the host, it is a cache of this host and
+/// is never shipped. The tables follow it, every number in them is an
+/// unsigned LEB128:
+///
+///   strings   the names, every other table refers to them by index
+///   types     the types but the builtin int, bool and void of ASTContext
+///   scopes    the scope tree, a parent comes before its children
+///   nodes     the AST nodes, a node comes after the nodes it refers to
+///   symbols   the symbols, a function comes after its parameters
+///   bindings  the symbols of every scope, and the class it belongs to, then
+///             the symbol of every decl and call, in the order of the nodes
+///   program   the top-level statements, and the types of ASTContext
+///
+/// An entry refers to another one by index plus one, zero is nullptr. The
+/// types 1, 2 and 3 are int, bool and void, the type table starts at 4. A
+/// node refers to the nodes before it by their distance instead, and its
+/// source locations are saved relative to the node before it. The function
+/// of a call is the exception, it is saved by its index: a recursive call
+/// comes before its function.
+/// The module is only used if the source has the size and the hash the
+/// header records. The header also records the hash of the tables, any
+/// damage makes the reader fail and the file is parsed again.
+namespace ModuleFile {
+constexpr char Magic[8] = {'M', 'O', 'S', 'E', 'S', 'P', 'C', 'M'};
+/// Bumped whenever the layout or the AST changes.
+constexpr std::uint32_t Version = 4;
+constexpr std::uint32_t NumBuiltinTypes = 3;
+
+struct Header {
+  char Magic[8];
+  std::uint32_t Version;
+  /// The offset the SourceManager gave the file, the source locations are
+  /// saved as they are.
+  std::uint32_t FileBase;
+  std::uint64_t SourceSize;
+  std::uint64_t SourceHash;
+  /// The hash of the tables, everything after the header.
+  std::uint64_t PayloadHash;
+};
+static_assert(sizeof(Header) == 40, "The header is written without padding.");
+
+enum class TypeClass : unsigned char { Plain, Builtin, UserDefined, Anonymous };
+
+enum class NodeKind : unsigned char {
+  NumberExpr,
+  CharExpr,
+  StringLiteral,
+  BoolLiteral,
+  DeclRefExpr,
+  BinaryExpr,
+  UnaryExpr,
+  CallExpr,
+  MemberExpr,
+  AnonymousInitExpr,
+  CompoundStmt,
+  IfStatement,
+  WhileStatement,
+  BreakStatement,
+  ContinueStatement,
+  ReturnStatement,
+  ExprStatement,
+  VarDecl,
+  ParameterDecl,
+  UnpackDecl,
+  FunctionDecl,
+  ClassDecl
+};
+/// The bits of the value flags of an expression, above its NodeKind.
+constexpr unsigned LValueBit = 5;
+constexpr unsigned CanBeEvaluatedBit = 6;
+
+enum class SymbolClass : unsigned char {
+  Variable,
+  ParmDecl,
+  Function,
+  Class,
+  Scope
+};
+
+/// \brief Hash the contents of a source file.
+std::uint64_t hashSource(std::string_view Source);
+
+/// \brief Get the path of the module of the source SourcePath.
+std::string getModulePath(const std::string &SourcePath);
+} // namespace ModuleFile
+
+/// ModuleWriter - Save the AST, the types and the scope tree of a checked
+/// source file. Every object is numbered the first time it is reached, in an
+/// order the reader can build them in, and the tables are written once all of
+/// them are numbered.
+class ModuleWriter {
+  using Scope = Support::Scope;
+  using Symbol = Support::Symbol;
+
+  const ASTContext &Ctx;
+
+  std::unordered_map<std::string, std::uint32_t> StringIDs;
+  std::vector<const std::string *> Strings;
+  std::unordered_map<const ASTType *, std::uint32_t> TypeIDs;
+  std::vector<const ASTType *> Types;
+  std::unordered_map<const StatementAST *, std::uint32_t> NodeIDs;
+  std::vector<const StatementAST *> Nodes;
+  std::unordered_map<const Scope *, std::uint32_t> ScopeIDs;
+  std::vector<const Scope *> Scopes;
+  std::unordered_map<const Symbol *, std::uint32_t> SymbolIDs;
+  std::vector<const Symbol *> Symbols;
+  // Set if the program can't be saved, the module isn't written then.
+  bool Failed;
+  // The start of the last node written, the locations are saved relative to
+  // it.
+  std::uint32_t LastLoc;
+
+  std::uint32_t addString(const std::string &Str);
+  std::uint32_t addType(const std::shared_ptr<ASTType> &Type);
+  std::uint32_t addNode(const StatementAST *Node);
+  std::uint32_t addScope(const std::shared_ptr<Scope> &S);
+  std::uint32_t addSymbol(const std::shared_ptr<Symbol> &Sym);
+  /// \brief Get the ID of a scope or a symbol the AST is bound to, they are
+  /// all reached from the top-level scope.
+  std::uint32_t getScopeID(const Scope *S);
+  std::uint32_t getSymbolID(const Symbol *Sym);
+
+  void writeType(std::string &Out, const ASTType *Type);
+  void writeNode(std::string &Out, const StatementAST *Node);
+  void writeSymbol(std::string &Out, const Symbol *Sym);
+
+public:
+  ModuleWriter(const ASTContext &Ctx) : Ctx(Ctx), Failed(false), LastLoc(0) {}
+
+  /// \brief Save the program of Source to the module ModulePath. Return false
+  /// if it can't be written, a module that is only half written is never
+  /// left behind.
+  bool write(const std::string &ModulePath, std::string_view Source,
+             std::uint32_t FileBase, const ASTPtr &AST,
+             const std::shared_ptr<Support::Scope> &TopScope);
+};
+
+/// ModuleReader - Load the module of a source file to the ASTContext, if it
+/// is the module of the current contents of the file.
+class ModuleReader {
+  ASTContext &Ctx;
+
+public:
+  ModuleReader(ASTContext &Ctx) : Ctx(Ctx) {}
+
+  /// \brief Load the module ModulePath of Source. Return false, and leave
+  /// the AST and the scope alone, if there is no module, if it was written
+  /// for other contents or if it is damaged.
+  bool read(const std::string &ModulePath, std::string_view Source,
+            std::uint32_t FileBase, ASTPtr &AST,
+            std::shared_ptr<Support::Scope> &TopScope);
+};
+} // namespace ast
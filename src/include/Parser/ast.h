@@ -10,9 +10,15 @@
 #include "Type.h"
 #include <cassert>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
+namespace Support {
+class Scope;
+class Symbol;
+class FunctionSymbol;
+} // namespace Support
 
 namespace ast {
 using namespace lex;
@@ -40,27 +46,27 @@ class DeclRefExpr;
 class BreakStatement;
 class ContinueStatement;
 
-using ASTPtr = std::vector<std::shared_ptr<StatementAST>>;
-using StmtASTPtr = std::shared_ptr<StatementAST>;
-using NumberExprPtr = std::shared_ptr<NumberExpr>;
-using ExprASTPtr = std::shared_ptr<Expr>;
-using CallExprPtr = std::shared_ptr<CallExpr>;
-using DeclASTPtr = std::shared_ptr<DeclStatement>;
-using CompoundStmtPtr = std::shared_ptr<CompoundStmt>;
-using VarDeclPtr = std::shared_ptr<VarDecl>;
-using ParmDeclPtr = std::shared_ptr<ParameterDecl>;
-using UnpackDeclPtr = std::shared_ptr<UnpackDecl>;
-using FunctionDeclPtr = std::shared_ptr<FunctionDecl>;
-using BinaryPtr = std::shared_ptr<BinaryExpr>;
-using UnaryPtr = std::shared_ptr<UnaryExpr>;
-using DeclRefExprPtr = std::shared_ptr<DeclRefExpr>;
+using ASTPtr = std::vector<StatementAST *>;
+using StmtASTPtr = StatementAST *;
+using NumberExprPtr = NumberExpr *;
+using ExprASTPtr = Expr *;
+using CallExprPtr = CallExpr *;
+using DeclASTPtr = DeclStatement *;
+using CompoundStmtPtr = CompoundStmt *;
+using VarDeclPtr = VarDecl *;
+using ParmDeclPtr = ParameterDecl *;
+using UnpackDeclPtr = UnpackDecl *;
+using FunctionDeclPtr = FunctionDecl *;
+using BinaryPtr = BinaryExpr *;
+using UnaryPtr = UnaryExpr *;
+using DeclRefExprPtr = DeclRefExpr *;
 using AnonTyPtr = std::shared_ptr<AnonymousType>;
 using UDTyPtr = std::shared_ptr<UserDefinedType>;
-using ReturnStmtPtr = std::shared_ptr<ReturnStatement>;
-using MemberExprPtr = std::shared_ptr<MemberExpr>;
-using BoolLiteralPtr = std::shared_ptr<BoolLiteral>;
-using BreakStmtPtr = std::shared_ptr<BreakStatement>;
-using ContStmtPtr = std::shared_ptr<ContinueStatement>;
+using ReturnStmtPtr = ReturnStatement *;
+using MemberExprPtr = MemberExpr *;
+using BoolLiteralPtr = BoolLiteral *;
+using BreakStmtPtr = BreakStatement *;
+using ContStmtPtr = ContinueStatement *;
 
 using IRValue = std::shared_ptr<IR::Value>;
 
@@ -207,6 +213,8 @@ public:
 
   void setCharType(std::shared_ptr<ASTType> type) { Expr::setType(type); }
 
+  const std::string &getChar() const { return C; }
+
   virtual ~CharExpr() {}
 
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
@@ -221,6 +229,8 @@ public:
       : Expr(start, end, type, ExprValueKind::VK_RValue, true), str(str) {}
   virtual ~StringLiteral() {}
 
+  const std::string &getString() const { return str; }
+
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
 
@@ -313,23 +323,34 @@ class CallExpr final : public Expr {
   std::string CalleeName;
   // To Do: FunctionDecl*
   FunctionDeclPtr FuncDecl;
-  std::vector<std::shared_ptr<Expr>> Args;
+  std::span<const ExprASTPtr> Args;
+  // The symbol of the callee, Sema binds it. The FunctionDecl of a recursive
+  // call isn't built yet, its symbol is.
+  Support::FunctionSymbol *Callee;
 
 public:
   CallExpr(SourceLocation start, SourceLocation end,
            std::shared_ptr<ASTType> type, const std::string &Callee,
-           std::vector<std::shared_ptr<Expr>> Args, ExprValueKind vk,
+           std::span<const ExprASTPtr> Args, ExprValueKind vk,
            FunctionDeclPtr FD, bool canDoEvaluate)
       : Expr(start, end, type, vk, canDoEvaluate), CalleeName(Callee),
-        FuncDecl(FD), Args(Args) {}
+        FuncDecl(FD), Args(Args), Callee(nullptr) {}
+
+  const std::string &getCalleeName() const { return CalleeName; }
+
+  Support::FunctionSymbol *getCalleeSymbol() const { return Callee; }
+  void setCalleeSymbol(Support::FunctionSymbol *Sym) { Callee = Sym; }
 
   std::size_t getArgsNum() const { return Args.size(); }
 
   FunctionDeclPtr getFuncDecl() const { return FuncDecl; }
+  /// The module reader sets the callee once all the nodes are read, a
+  /// recursive call comes before its function.
+  void setFuncDecl(FunctionDeclPtr FD) { FuncDecl = FD; }
 
   ExprASTPtr getArg(unsigned index) const { return Args[index]; }
 
-  const std::vector<ExprASTPtr> &getArgs() const { return Args; }
+  std::span<const ExprASTPtr> getArgs() const { return Args; }
 
   virtual ~CallExpr() {}
 
@@ -351,7 +372,7 @@ class MemberExpr final : public Expr {
 
 public:
   MemberExpr(SourceLocation start, SourceLocation end,
-             std::shared_ptr<ASTType> type, std::shared_ptr<Expr> base,
+             std::shared_ptr<ASTType> type, Expr *base,
              SourceLocation operatorloc, const std::string &name,
              bool canDoEvaluate, std::size_t idx)
       : Expr(start, end, type, ExprValueKind::VK_LValue, canDoEvaluate),
@@ -360,6 +381,7 @@ public:
   void setBase(ExprASTPtr E) { Base = E; }
   const std::string &getMemberName() const { return MemberName; }
   ExprASTPtr getBase() const { return Base; }
+  SourceLocation getOperatorLoc() const { return OperatorLoc; }
   std::size_t getIdx() const { return idx; }
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
@@ -367,15 +389,17 @@ public:
 class AnonymousInitExpr final : public Expr {
   AnonymousInitExpr() = delete;
   AnonymousInitExpr(const AnonymousInitExpr &) = delete;
-  std::vector<ExprASTPtr> InitExprs;
+  std::span<const ExprASTPtr> InitExprs;
 
 public:
   AnonymousInitExpr(SourceLocation start, SourceLocation end,
-                    std::vector<ExprASTPtr> initExprs,
+                    std::span<const ExprASTPtr> initExprs,
                     std::shared_ptr<ASTType> type)
       : Expr(start, end, type, Expr::ExprValueKind::VK_RValue, true),
         InitExprs(initExprs) {}
 
+  std::span<const ExprASTPtr> getInitExprs() const { return InitExprs; }
+
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
 
@@ -386,16 +410,18 @@ public:
 /// ------------------------------------------
 class CompoundStmt final : public StatementAST {
   // The sub-statements of the compound statement.
-  std::vector<StmtASTPtr> SubStmts;
+  std::span<const StmtASTPtr> SubStmts;
+  // The scope Sema opened for the statement.
+  Support::Scope *BodyScope;
 
 public:
   CompoundStmt(SourceLocation start, SourceLocation end,
-               std::vector<StmtASTPtr> subStmts)
-      : StatementAST(start, end), SubStmts(subStmts) {}
+               std::span<const StmtASTPtr> subStmts, Support::Scope *scope)
+      : StatementAST(start, end), SubStmts(subStmts), BodyScope(scope) {}
 
   virtual ~CompoundStmt() {}
 
-  void addSubStmt(StmtASTPtr stmt);
+  Support::Scope *getScope() const { return BodyScope; }
 
   StmtASTPtr getSubStmt(std::size_t index) const;
 
@@ -412,9 +438,9 @@ public:
 /// if-statement -> "if" expression compound-statement "else" compound-statement
 /// ----------------------------------------------------------------------------
 class IfStatement final : public StatementAST {
-  std::shared_ptr<Expr> Condition;
-  std::shared_ptr<StatementAST> Then;
-  std::shared_ptr<StatementAST> Else;
+  Expr *Condition;
+  StatementAST *Then;
+  StatementAST *Else;
 
 public:
   IfStatement(SourceLocation start, SourceLocation end, ExprASTPtr Condition,
@@ -489,7 +515,7 @@ public:
 /// return-statement -> "return" anonymous-initial ";"
 /// ---------------------------------------------
 class ReturnStatement final : public StatementAST {
-  std::shared_ptr<Expr> ReturnExpr;
+  Expr *ReturnExpr;
 
 public:
   ReturnStatement(SourceLocation start, SourceLocation end,
@@ -509,7 +535,7 @@ public:
 /// expression-statement -> expression? ";"
 /// ----------------------------------------
 class ExprStatement : public StatementAST {
-  std::shared_ptr<Expr> expr;
+  Expr *expr;
 
 public:
   ExprStatement(SourceLocation start, SourceLocation end, ExprASTPtr expr)
@@ -517,6 +543,8 @@ public:
 
   virtual ~ExprStatement() {}
 
+  ExprASTPtr getExpr() const { return expr; }
+
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
 
@@ -558,14 +586,20 @@ class VarDecl : public DeclStatement {
   bool IsConst;
   std::string name;
   ExprASTPtr InitExpr;
+  // The symbol Sema defined for the decl, a VariableSymbol or a
+  // ParmDeclSymbol. A DeclRefExpr reaches it through its decl.
+  Support::Symbol *Sym;
 
 public:
   VarDecl(SourceLocation start, SourceLocation end, const std::string &name,
           std::shared_ptr<ASTType> type, bool isConst, ExprASTPtr init)
       : DeclStatement(start, end, type), IsConst(isConst), name(name),
-        InitExpr(init) {}
+        InitExpr(init), Sym(nullptr) {}
   const std::string &getName() const { return name; }
 
+  Support::Symbol *getSymbol() const { return Sym; }
+  void setSymbol(Support::Symbol *S) { Sym = S; }
+
   std::shared_ptr<ASTType> getDeclType() const { return declType; }
 
   void setInitExpr(ExprASTPtr B) { InitExpr = B; }
@@ -595,11 +629,11 @@ public:
 /// \brief UnpackDecl - This class represents a UnpackDecl.
 class UnpackDecl final : public DeclStatement {
 private:
-  std::vector<DeclASTPtr> decls;
+  std::span<const DeclASTPtr> decls;
 
 public:
   UnpackDecl(SourceLocation start, SourceLocation end,
-             std::vector<DeclASTPtr> decls)
+             std::span<const DeclASTPtr> decls)
       : DeclStatement(start, end, nullptr), decls(decls) {}
 
   bool TypeCheckingAndTypeSetting(AnonTyPtr type);
@@ -609,6 +643,8 @@ public:
 
   std::size_t getDeclNumber() const { return decls.size(); };
 
+  std::span<const DeclASTPtr> getSubDecls() const { return decls; }
+
   std::vector<VarDeclPtr> operator[](std::size_t index) const;
 
   void getDecls(std::vector<VarDeclPtr> &names) const;
@@ -622,27 +658,29 @@ public:
 /// Forward declarations are not supported.
 class FunctionDecl : public DeclStatement {
   std::string FDName;
-  std::vector<ParmDeclPtr> parameters;
+  std::span<const ParmDeclPtr> parameters;
   std::size_t paraNum;
   StmtASTPtr funcBody;
   std::shared_ptr<ASTType> returnType;
   // For now, we just have builtin function `print()`.
   bool IsBuiltin;
+  // The symbol Sema defined for the function.
+  Support::FunctionSymbol *Sym;
 
 public:
   FunctionDecl(SourceLocation start, SourceLocation end,
-               const std::string &name, std::vector<ParmDeclPtr> Args,
+               const std::string &name, std::span<const ParmDeclPtr> Args,
                StmtASTPtr body, std::shared_ptr<ASTType> returnType,
                bool IsBuiltin = false)
       : DeclStatement(start, end, nullptr), FDName(name), parameters(Args),
         paraNum(parameters.size()), funcBody(body), returnType(returnType),
-        IsBuiltin(IsBuiltin) {}
+        IsBuiltin(IsBuiltin), Sym(nullptr) {}
 
   virtual ~FunctionDecl() {}
   std::size_t getParaNum() const { return paraNum; }
-  std::vector<ParmDeclPtr> getParms() const { return parameters; }
+  std::span<const ParmDeclPtr> getParms() const { return parameters; }
   const std::string &getParmName(std::size_t index) const {
-    return parameters[index].get()->getParmName();
+    return parameters[index]->getParmName();
   }
   std::shared_ptr<ASTType> getReturnType() const { return returnType; }
   const std::string &getFDName() const { return FDName; }
@@ -659,8 +697,16 @@ public:
   bool endsWithReturn() const;
 
   StmtASTPtr getCompoundBody() const { return funcBody; }
+  /// The FunctionDecl is made before its body, so that the recursive calls
+  /// in the body refer to it. The body and the end are set once it is
+  /// parsed.
+  void setCompoundBody(StmtASTPtr body) { funcBody = body; }
+  void setLocEnd(SourceLocation end) { LocEnd = end; }
   bool isBuiltin() const { return IsBuiltin; }
 
+  Support::FunctionSymbol *getSymbol() const { return Sym; }
+  void setSymbol(Support::FunctionSymbol *S) { Sym = S; }
+
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
 
@@ -684,6 +730,9 @@ public:
             StmtASTPtr body)
       : DeclStatement(start, end, nullptr), ClassName(name), Body(body) {}
 
+  const std::string &getClassName() const { return ClassName; }
+  StmtASTPtr getBody() const { return Body; }
+
   virtual IRValue Accept(Visitor<IRValue> *v) const { return v->visit(this); }
 };
 } // namespace ast
@@ -8,7 +8,10 @@
 #include "ast.h"
 #include "Lexer/scanner.h"
 #include "sema.h"
+#include "Support/error.h"
 #include <algorithm>
+#include <optional>
+#include <vector>
 
 namespace parse {
 using namespace ast;
@@ -51,7 +54,9 @@ enum class context : unsigned short {
 };
 using namespace tok;
 
-static std::vector<TokenValue> StmtSafeSymbols = {
+// The safe symbols of every context, syntaxErrorRecovery skips the tokens up
+// to one of them.
+static constexpr TokenSet StmtSafeSymbols = {
     TokenValue::PUNCTUATOR_Left_Brace,
     TokenValue::KEYWORD_while,
     TokenValue::KEYWORD_continue,
@@ -74,7 +79,7 @@ static std::vector<TokenValue> StmtSafeSymbols = {
     TokenValue::KEYWORD_func,
     TokenValue::PUNCTUATOR_Right_Brace};
 
-static std::vector<TokenValue> CompoundStmtSafeSymbols = {
+static constexpr TokenSet CompoundStmtSafeSymbols = {
     TokenValue::KEYWORD_else,
     TokenValue::PUNCTUATOR_Left_Brace,
     TokenValue::KEYWORD_while,
@@ -97,12 +102,12 @@ static std::vector<TokenValue> CompoundStmtSafeSymbols = {
     TokenValue::KEYWORD_func,
     TokenValue::PUNCTUATOR_Right_Brace};
 
-static std::vector<TokenValue> ExprSafeSymbols = {
+static constexpr TokenSet ExprSafeSymbols = {
     TokenValue::PUNCTUATOR_Right_Paren, TokenValue::PUNCTUATOR_Semicolon,
     TokenValue::PUNCTUATOR_Left_Brace, TokenValue::PUNCTUATOR_Comma};
 
 // u-expression post-expression
-static std::vector<TokenValue> UnaryAndPostExprSafeSymbols = {
+static constexpr TokenSet UnaryAndPostExprSafeSymbols = {
     TokenValue::BO_Mul,
     TokenValue::BO_Div,
     TokenValue::BO_Assign,
@@ -128,7 +133,7 @@ static std::vector<TokenValue> UnaryAndPostExprSafeSymbols = {
     TokenValue::PUNCTUATOR_Comma};
 
 // primary-expression and arg-list
-static std::vector<TokenValue> PrimaryAndArgListExprSafeSymbols = {
+static constexpr TokenSet PrimaryAndArgListExprSafeSymbols = {
     TokenValue::BO_Mul,
     TokenValue::BO_Div,
     TokenValue::BO_Assign,
@@ -157,19 +162,19 @@ static std::vector<TokenValue> PrimaryAndArgListExprSafeSymbols = {
     TokenValue::UO_Dec};
 
 // para-list
-static std::vector<TokenValue> ParaListSafeSymbols = {
+static constexpr TokenSet ParaListSafeSymbols = {
     TokenValue::PUNCTUATOR_Left_Brace};
 
 // para-declaration
-static std::vector<TokenValue> ParaDeclSafeSymbols = {
+static constexpr TokenSet ParaDeclSafeSymbols = {
     TokenValue::PUNCTUATOR_Comma, TokenValue::PUNCTUATOR_Right_Paren};
 
 // arg
-static std::vector<TokenValue> ArgSafeSymbols = {
+static constexpr TokenSet ArgSafeSymbols = {
     TokenValue::PUNCTUATOR_Comma, TokenValue::PUNCTUATOR_Right_Paren};
 
 // FunctionDefinition
-static std::vector<TokenValue> FuncDefSafeSymbols = {
+static constexpr TokenSet FuncDefSafeSymbols = {
     TokenValue::PUNCTUATOR_Left_Brace,
     TokenValue::KEYWORD_while,
     TokenValue::KEYWORD_continue,
@@ -192,30 +197,30 @@ static std::vector<TokenValue> FuncDefSafeSymbols = {
     TokenValue::KEYWORD_func};
 
 // class-body
-static std::vector<TokenValue> ClassBodySafeSymbols = {
+static constexpr TokenSet ClassBodySafeSymbols = {
     TokenValue::PUNCTUATOR_Semicolon};
 
-static std::vector<TokenValue> ReturnType = {TokenValue::PUNCTUATOR_Right_Brace,
-                                             TokenValue::PUNCTUATOR_Left_Brace,
-                                             TokenValue::KEYWORD_while,
-                                             TokenValue::KEYWORD_continue,
-                                             TokenValue::KEYWORD_if,
-                                             TokenValue::KEYWORD_return,
-                                             TokenValue::KEYWORD_break,
-                                             TokenValue::KEYWORD_const,
-                                             TokenValue::KEYWORD_class,
-                                             TokenValue::KEYWORD_var,
-                                             TokenValue::PUNCTUATOR_Semicolon,
-                                             TokenValue::BO_Sub,
-                                             TokenValue::UO_Exclamatory,
-                                             TokenValue::UO_Inc,
-                                             TokenValue::UO_Dec,
-                                             TokenValue::IDENTIFIER,
-                                             TokenValue::PUNCTUATOR_Left_Paren,
-                                             TokenValue::INTEGER_LITERAL,
-                                             TokenValue::BOOL_FALSE,
-                                             TokenValue::BOOL_TRUE,
-                                             TokenValue::KEYWORD_func};
+static constexpr TokenSet ReturnType = {TokenValue::PUNCTUATOR_Right_Brace,
+                                        TokenValue::PUNCTUATOR_Left_Brace,
+                                        TokenValue::KEYWORD_while,
+                                        TokenValue::KEYWORD_continue,
+                                        TokenValue::KEYWORD_if,
+                                        TokenValue::KEYWORD_return,
+                                        TokenValue::KEYWORD_break,
+                                        TokenValue::KEYWORD_const,
+                                        TokenValue::KEYWORD_class,
+                                        TokenValue::KEYWORD_var,
+                                        TokenValue::PUNCTUATOR_Semicolon,
+                                        TokenValue::BO_Sub,
+                                        TokenValue::UO_Exclamatory,
+                                        TokenValue::UO_Inc,
+                                        TokenValue::UO_Dec,
+                                        TokenValue::IDENTIFIER,
+                                        TokenValue::PUNCTUATOR_Left_Paren,
+                                        TokenValue::INTEGER_LITERAL,
+                                        TokenValue::BOOL_FALSE,
+                                        TokenValue::BOOL_TRUE,
+                                        TokenValue::KEYWORD_func};
 } // namespace ParseContext
 
 /// \brief Parser - Implenment a LL(1) parser.
@@ -229,17 +234,93 @@ public:
   enum class ContextKind { TopLevel, Function, Class, While };
 
 private:
+  /// TopLevelItem - A statement or a declaration of the translation unit, the
+  /// unit that applyEdit parses again.
+  struct TopLevelItem {
+    // The tokens [FirstToken, EndToken) of the item.
+    std::size_t FirstToken;
+    std::size_t EndToken;
+    // The symbols [FirstDef, EndDef) the item defined in the top-level scope.
+    std::size_t FirstDef;
+    std::size_t EndDef;
+    // An empty statement has no AST.
+    bool HasNode;
+    StmtASTPtr Node;
+    bool HadErrors;
+    // The sorted interned IDs of the identifiers the item mentions.
+    std::vector<std::uint32_t> Identifiers;
+  };
+
+  /// DeferredBody - The body of a top-level function, skipped by the parser
+  /// and checked on a worker thread once the rest of the file is parsed.
+  struct DeferredBody {
+    // The tokens [FirstToken, EndToken) of the body, from '{' to '}'.
+    std::size_t FirstToken;
+    std::size_t EndToken;
+    FunctionDeclPtr FD;
+    std::shared_ptr<FunctionSymbol> Func;
+    std::shared_ptr<Scope> BodyScope;
+    // The top-level symbols defined before the body, the ones it may see.
+    std::size_t NumTopLevelDefs;
+    // The item of the function.
+    std::size_t Item;
+    // The errors of the body go before the error DiagnosticPos of the file.
+    std::size_t DiagnosticPos;
+  };
+
+  /// PendingBinOp - A binary operator whose right operand is being parsed.
+  struct PendingBinOp {
+    ExprASTPtr LHS;
+    const Token *Op;
+    OperatorPrec::Level Prec;
+  };
+
   Scanner &scan;
   ASTPtr AST;
+  std::vector<TopLevelItem> Items;
   ASTContext &Ctx;
   Sema &Actions;
   ContextKind CurrentContext;
+  // The operator stacks of the expressions being parsed, an expression nested
+  // in another one pushes above the operators of the outer one.
+  std::vector<PendingBinOp> PendingBinOps;
+  std::vector<const Token *> PendingPrefixOps;
+  // The number of expressions being parsed, one nested in the other.
+  unsigned ExprNesting = 0;
+  // Nothing is reported after the expression nesting limit was reached.
+  bool NestingLimitReached = false;
+  // The function bodies are checked on SemaThreads threads once the rest of
+  // the file is parsed, unless it is 1.
+  unsigned SemaThreads;
+  std::vector<DeferredBody> DeferredBodies;
+  // The errors of the file while the bodies are deferred, the errors of a
+  // body are put in at its place.
+  DiagnosticBuffer FileDiagnostics;
+  std::optional<DiagnosticBuffer::Capture> FileCapture;
 
 public:
-  Parser(Scanner &scan, Sema &Actions, ASTContext &Ctx);
+  /// The expressions nested in parentheses or in call arguments are parsed
+  /// recursively, at most MaxExprNesting deep. The operators of an
+  /// expression are parsed without recursion.
+  static constexpr unsigned MaxExprNesting = 256;
+
+  Parser(Scanner &scan, Sema &Actions, ASTContext &Ctx,
+         unsigned SemaThreads = 1);
   /// \brief parse - Parse the entire file specified.
   ASTPtr &parse();
 
+  /// \brief Replace RemovedLength bytes at Offset of the parsed file by
+  /// Inserted, and bring the AST and the top-level scope up to date.
+  ///
+  /// Only the lines of the edit are lexed again, and only the top-level items
+  /// from the one before the edit up to the first old item that starts at
+  /// the same token again are parsed again. An item after them is parsed
+  /// again only if it mentions a name that one of the items parsed again
+  /// defines. The other items keep their AST and their symbols, the AST
+  /// nodes of an item keep the locations they were parsed at.
+  ASTPtr &applyEdit(std::uint32_t Offset, std::uint32_t RemovedLength,
+                    std::string_view Inserted);
+
   // The most important one is that this routine eats all of the tokens
   // that correspond to the production and returns the lexer buffer with
   // the next token (which is not part of the grammar production) ready
@@ -284,7 +365,7 @@ public:
   ExprASTPtr ParsePostfixExpressionSuffix(ExprASTPtr);
   ExprASTPtr ParsePrimaryExpr();
   ExprASTPtr ParseBinOpRHS(OperatorPrec::Level MinPrec, ExprASTPtr lhs);
-  ExprASTPtr ParseCallExpr(Token tok);
+  ExprASTPtr ParseCallExpr();
 
   DeclASTPtr ParseVarDecl();
   StmtASTPtr ParseFunctionDefinition();
@@ -307,7 +388,20 @@ public:
   std::vector<StmtASTPtr> getAST() const { return AST; }
 
 private:
+  TopLevelItem ParseTopLevelItem();
+  /// \brief Whether the body of the top-level function being parsed, which
+  /// starts at the current token, can be checked after the rest of the file,
+  /// and the end of its tokens if so. A body is checked in place if it
+  /// mentions a top-level constant that isn't initialized yet, as it may be
+  /// the one to initialize it.
+  bool canDeferBody(std::size_t &EndToken) const;
+  /// \brief Parse and check the deferred bodies on the worker threads, and
+  /// report their errors in the order of the file.
+  void checkDeferredBodies();
   // Helper Functions.
+  /// \brief Rebuild the AST from the items, and the status of the file from
+  /// the errors of the items.
+  void rebuildAST();
   bool expectToken(tok::TokenValue value, const std::string &lexem,
                    bool advanceToNextToken) const;
   bool validateToken(tok::TokenValue value) const;
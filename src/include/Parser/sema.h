@@ -73,8 +73,14 @@ private:
   // }
   std::vector<std::shared_ptr<FunctionSymbol>> FunctionStack;
 
+  /// \brief The number of top-level symbols that are visible. A function body
+  /// checked after the rest of the file only sees the symbols defined before
+  /// it, all of them are visible otherwise.
+  std::size_t NumVisibleTopLevelDefs;
+
 public:
-  Sema(ASTContext &Ctx) : Ctx(Ctx) {}
+  Sema(ASTContext &Ctx)
+      : Ctx(Ctx), NumVisibleTopLevelDefs(std::size_t(-1)) {}
 
 public:
   // The functions for handling scope.
@@ -85,6 +91,9 @@ public:
   void PushScope(std::shared_ptr<Scope> scope);
 
   void PopScope();
+  /// \brief Pop every scope but the translation unit, before a top-level
+  /// statement or declaration is parsed again.
+  void PopToTopLevelScope();
   void PopFunctionStack();
   void PopClassStack();
 
@@ -98,6 +107,13 @@ public:
   /// \brief Add a new function scope and symbol.
   void ActOnTranslationUnitStart();
 
+  /// \brief Start checking the body of the top-level function Func on its
+  /// own, in the scope BodyScope that ActOnFunctionDecl made for it. Only the
+  /// first NumTopLevelDefs top-level symbols are visible to the body.
+  void ActOnFunctionBodyStart(std::shared_ptr<FunctionSymbol> Func,
+                              std::shared_ptr<Scope> BodyScope,
+                              std::size_t NumTopLevelDefs);
+
   void ActOnFunctionDeclStart(const std::string &name);
 
   void ActOnFunctionDecl(const std::string &name,
@@ -145,27 +161,27 @@ public:
   std::shared_ptr<ASTType>
   ActOnCallExpr(const std::string &calleeName,
                 std::vector<std::shared_ptr<ASTType>> Args,
-                FunctionDeclPtr &FD);
+                FunctionDeclPtr &FD, FunctionSymbol *&Callee);
 
   ExprASTPtr ActOnUnaryOperator();
 
   ExprASTPtr ActOnPostfixUnaryOperator();
 
-  ExprASTPtr ActOnBinaryOperator(ExprASTPtr lhs, Token tok, ExprASTPtr rhs);
+  ExprASTPtr ActOnBinaryOperator(ExprASTPtr lhs, const Token &tok, ExprASTPtr rhs);
 
   VarDeclPtr ActOnDeclRefExpr(const std::string &name);
 
   ExprASTPtr ActOnStringLiteral();
 
-  ExprASTPtr ActOnMemberAccessExpr(ExprASTPtr lhs, Token tok);
+  ExprASTPtr ActOnMemberAccessExpr(ExprASTPtr lhs, const Token &tok);
 
   ExprASTPtr ActOnExprStmt();
 
   bool ActOnConditionExpr(std::shared_ptr<ASTType> type) const;
 
-  std::shared_ptr<ASTType> ActOnParmDeclUserDefinedType(Token tok) const;
+  std::shared_ptr<ASTType> ActOnParmDeclUserDefinedType(const Token &tok) const;
 
-  std::shared_ptr<ASTType> ActOnVarDeclUserDefinedType(Token tok) const;
+  std::shared_ptr<ASTType> ActOnVarDeclUserDefinedType(const Token &tok) const;
 
   // (3) help method
   bool isInFunctionContext() const { return FunctionStack.size() != 0; }
@@ -186,6 +202,11 @@ public:
 private:
   std::shared_ptr<Scope> getScopeStackTop() const;
 
+  /// \brief Look name up from the current scope.
+  std::shared_ptr<Symbol> resolve(const std::string &name) const;
+  /// \brief Look name up in the translation unit.
+  std::shared_ptr<Symbol> resolveTopLevel(const std::string &name) const;
+
   void errorReport(const std::string &msg) const;
 
   UnpackDeclPtr unpackDeclTypeChecking(UnpackDeclPtr unpackDecl,
@@ -0,0 +1,90 @@
+//===---------------------------BumpPtrAllocator.h------------------------===//
+//
+// This file defines class BumpPtrAllocator, the arena that the objects of one
+// lifetime are allocated from.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Support {
+/// BumpPtrAllocator - Hand out memory by bumping a pointer through slabs that
+/// grow as the arena does. Nothing is freed on its own, all the slabs are
+/// released at once when the allocator is destroyed. The objects that own
+/// memory elsewhere, a std::string for example, get their destructor run
+/// before, in the reverse order of their creation.
+class BumpPtrAllocator {
+  struct Destructor {
+    void *Object;
+    void (*Destroy)(void *);
+  };
+
+  std::vector<std::unique_ptr<char[]>> Slabs;
+  // The free range of the last slab.
+  char *Cur;
+  char *End;
+  std::size_t BytesAllocated;
+  std::vector<Destructor> Destructors;
+
+  char *grow(std::size_t Size, std::size_t Align);
+
+public:
+  /// The first slab is SlabSize bytes, every slab after it is twice as big as
+  /// the one before, up to 1024 times SlabSize.
+  static constexpr std::size_t SlabSize = 64 * 1024;
+
+  BumpPtrAllocator() : Cur(nullptr), End(nullptr), BytesAllocated(0) {}
+  BumpPtrAllocator(const BumpPtrAllocator &) = delete;
+  BumpPtrAllocator &operator=(const BumpPtrAllocator &) = delete;
+  ~BumpPtrAllocator();
+
+  /// \brief Allocate Size bytes aligned to Align (a power of two).
+  void *allocate(std::size_t Size, std::size_t Align) {
+    std::size_t Adjust = -reinterpret_cast<std::uintptr_t>(Cur) & (Align - 1);
+    char *Ptr = Cur + Adjust;
+    if (std::size_t(End - Cur) < Adjust + Size)
+      Ptr = grow(Size, Align);
+    Cur = Ptr + Size;
+    BytesAllocated += Size;
+    return Ptr;
+  }
+
+  /// \brief Construct a T in the arena, it lives as long as the allocator.
+  template <typename T, typename... ArgTys> T *create(ArgTys &&...Args) {
+    T *Object = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<ArgTys>(Args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>)
+      Destructors.push_back(
+          {Object, [](void *Ptr) { static_cast<T *>(Ptr)->~T(); }});
+    return Object;
+  }
+
+  /// \brief Copy Elements to an array in the arena.
+  template <typename T>
+  std::span<const T> copyArray(const std::vector<T> &Elements) {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_destructible_v<T>,
+                  "The arrays are released without their destructors.");
+    if (Elements.empty())
+      return {};
+    T *Array = static_cast<T *>(
+        allocate(sizeof(T) * Elements.size(), alignof(T)));
+    std::uninitialized_copy(Elements.begin(), Elements.end(), Array);
+    return {Array, Elements.size()};
+  }
+
+  /// \brief Take over the slabs and the objects of Other, they live as long
+  /// as this allocator now. Other is left empty.
+  void takeFrom(BumpPtrAllocator &Other);
+
+  /// \brief Get the number of bytes handed out, without the padding.
+  std::size_t getBytesAllocated() const { return BytesAllocated; }
+};
+} // namespace Support
@@ -0,0 +1,32 @@
+//===-------------------------------Parallel.h----------------------------===//
+//
+// This file defines runOnWorkers, which runs independent tasks on a few
+// threads.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Support {
+/// runOnWorkers - Run Task(0) ... Task(NumTasks - 1) on at most NumThreads
+/// threads, the calling thread is one of them. The tasks are handed out in
+/// order, a thread takes the next one once it is done with its own.
+template <typename TaskFn>
+void runOnWorkers(std::size_t NumTasks, unsigned NumThreads, TaskFn Task) {
+  std::atomic<std::size_t> NextTask(0);
+  auto Work = [&]() {
+    for (std::size_t i = NextTask++; i < NumTasks; i = NextTask++)
+      Task(i);
+  };
+  std::vector<std::thread> Workers;
+  for (std::size_t i = 1; i < std::min<std::size_t>(NumTasks, NumThreads); ++i)
+    Workers.emplace_back(Work);
+  Work();
+  for (auto &Worker : Workers)
+    Worker.join();
+}
+} // namespace Support
@@ -6,30 +6,21 @@
 
 namespace lex {
 /// @brief SourceLocation - This class represents source location.
-/// SourceLocation is same as TokenLocation
+/// SourceLocation is same as TokenLocation, a source offset whose line,
+/// column and file are looked up in the SourceManager on demand.
 class SourceLocation {
-  std::string FileName;
-  std::size_t line;
-  std::size_t column;
+  TokenLocation Loc;
 
 public:
-  SourceLocation() : FileName(""), line(0), column(0) {}
-  SourceLocation(const TokenLocation &tokLoc)
-      : FileName(tokLoc.getTokenFileName()), line(tokLoc.getTokenLineNumber()),
-        column(tokLoc.getTokenColNumber()) {}
+  SourceLocation() {}
+  SourceLocation(const TokenLocation &tokLoc) : Loc(tokLoc) {}
 
-  std::size_t getLineNumber() const { return line; }
-  std::size_t getColumnNumber() const { return column; }
-  const std::string& getFileName() const { return FileName; }
+  std::size_t getLineNumber() const { return Loc.getTokenLineNumber(); }
+  std::size_t getColumnNumber() const { return Loc.getTokenColNumber(); }
+  const std::string& getFileName() const { return Loc.getTokenFileName(); }
+  std::uint32_t getOffset() const { return Loc.getOffset(); }
 
-  void setLineNumber(unsigned long line) { this->line = line; }
-  void setColumnNumber(unsigned long column) { this->column = column; }
-  void setFileName(std::string fileName) { this->FileName = fileName; }
-
-  bool operator==(const SourceLocation &loc) const {
-    return loc.getColumnNumber() == column && loc.getLineNumber() == line &&
-           loc.getFileName() == FileName;
-  }
+  bool operator==(const SourceLocation &loc) const { return Loc == loc.Loc; }
   bool operator!=(const SourceLocation &loc) const { return !operator==(loc); }
 };
 } // namespace lex
@@ -0,0 +1,55 @@
+//===---------------------------StringInterner.h--------------------------===//
+//
+// This file defines class StringInterner, which maps every distinct string to
+// a small integer ID.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Support {
+/// StringInterner - Store every distinct string once. Two strings are equal
+/// iff their IDs are equal. ID 0 is reserved for "no string", it maps to the
+/// empty string.
+class StringInterner {
+  // The interned strings never move, the keys of IDs point into them.
+  std::deque<std::string> Storage;
+  std::unordered_map<std::string_view, std::uint32_t> IDs;
+  std::vector<std::string_view> Strings;
+
+public:
+  /// ReadOnlyScope - Only look the strings up on the current thread, until
+  /// the scope is destroyed. The interner isn't locked, a thread that shares
+  /// it with others holds one, and interning a new string there asserts.
+  class ReadOnlyScope {
+    bool Prev;
+
+  public:
+    ReadOnlyScope();
+    ReadOnlyScope(const ReadOnlyScope &) = delete;
+    ReadOnlyScope &operator=(const ReadOnlyScope &) = delete;
+    ~ReadOnlyScope();
+  };
+
+  StringInterner() : Strings(1) {}
+  StringInterner(const StringInterner &) = delete;
+  StringInterner &operator=(const StringInterner &) = delete;
+
+  /// \brief Get the interner of the compilation.
+  static StringInterner &get();
+
+  /// \brief Get the ID of Str, interning it the first time it is seen.
+  std::uint32_t intern(std::string_view Str);
+
+  /// \brief Get the ID of Str, or 0 if it was never interned.
+  std::uint32_t lookup(std::string_view Str) const;
+
+  std::string_view getString(std::uint32_t ID) const { return Strings[ID]; }
+  std::size_t size() const { return Strings.size() - 1; }
+};
+} // namespace Support
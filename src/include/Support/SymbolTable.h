@@ -8,6 +8,8 @@
 #include "IRBuild/CGCall.h"
 #include "Parser/Type.h"
 #include "Parser/ast.h"
+#include "Support/StringInterner.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -41,6 +43,24 @@ private:
   // identifiers
   std::vector<std::shared_ptr<Symbol>> SymbolTable;
 
+  /// IndexSlot - A slot of Index, NameID 0 is an empty slot.
+  struct IndexSlot {
+    std::uint32_t NameID;
+    std::uint32_t Def;
+  };
+
+  /// Index - An open-addressing hash table from the interned name of a symbol
+  /// to its position in SymbolTable. Its size is a power of two and it is at
+  /// most half full. A name defined twice maps to its first symbol, as the
+  /// symbol table is searched in order.
+  std::vector<IndexSlot> Index;
+  std::size_t NumIndexed = 0;
+
+  void indexDef(std::uint32_t Def);
+  void rebuildIndex();
+  /// \brief Get the first symbol of this scope named NameID, or nullptr.
+  const std::shared_ptr<Symbol> *lookupDef(std::uint32_t NameID) const;
+
   // For function and class.
   std::string ScopeName;
 
@@ -69,7 +89,22 @@ public:
   ScopeKind getFlags() const { return Flags; }
 
   /// \brief Add symbol.
-  void addDef(std::shared_ptr<Symbol> sym) { SymbolTable.push_back(sym); };
+  void addDef(std::shared_ptr<Symbol> sym);
+
+  std::size_t getNumDefs() const { return SymbolTable.size(); }
+  const std::shared_ptr<Symbol> &getDef(std::size_t Index) const {
+    return SymbolTable[Index];
+  }
+
+  /// \brief Remove the symbols from Index on and return them in order, so
+  /// that a part of the scope can be defined again.
+  std::vector<std::shared_ptr<Symbol>> takeDefsFrom(std::size_t Index) {
+    std::vector<std::shared_ptr<Symbol>> Defs(SymbolTable.begin() + Index,
+                                              SymbolTable.end());
+    SymbolTable.resize(Index);
+    rebuildIndex();
+    return Defs;
+  }
 
   /// \brief  Perform name lookup on the given name, classifying it based on
   /// the results of name look up and following token.
@@ -77,10 +112,19 @@ public:
   /// parsing. When the identifier cannot be found, this routine will attempt
   /// to correct the typo and classify based on the resulting name.
   std::shared_ptr<Symbol> Resolve(const std::string &name) const;
-
-  /// \brief Perform name lookup in current scope.
+  /// Only the first NumTopLevelDefs symbols of the translation unit are
+  /// found, the ones a function body checked after the rest of the file
+  /// could see where it is.
+  std::shared_ptr<Symbol>
+  Resolve(std::uint32_t NameID,
+          std::size_t NumTopLevelDefs = std::size_t(-1)) const;
+
+  /// \brief Perform name lookup in current scope, among its first NumDefs
+  /// symbols.
   // std::shared_ptr<Symbol> LookupName(std::string name);
-  std::shared_ptr<Symbol> CheckWhetherInCurScope(const std::string &name);
+  std::shared_ptr<Symbol>
+  CheckWhetherInCurScope(const std::string &name,
+                         std::size_t NumDefs = std::size_t(-1));
 
   bool isAnonymous() const { return ScopeName == ""; }
 
@@ -108,6 +152,8 @@ class Symbol {
 protected:
   using ScopePtr = std::shared_ptr<Scope>;
   std::string Lexem;
+  /// The ID of Lexem in the StringInterner, 0 for an anonymous symbol.
+  std::uint32_t NameID;
   ScopePtr BelongTo;
 
   std::shared_ptr<ASTType> type;
@@ -115,11 +161,16 @@ protected:
 public:
   Symbol(const std::string &lexem, ScopePtr belongTo,
          std::shared_ptr<ASTType> type)
-      : Lexem(lexem), BelongTo(belongTo), type(type) {}
+      : Lexem(lexem),
+        NameID(lexem.empty() ? 0 : StringInterner::get().intern(lexem)),
+        BelongTo(belongTo), type(type) {}
 
   std::shared_ptr<ASTType> getType() const { return type; }
 
-  virtual const std::string &getLexem() { return Lexem; }
+  ScopePtr getBelongTo() const { return BelongTo; }
+
+  virtual const std::string &getLexem() const { return Lexem; }
+  std::uint32_t getNameID() const { return NameID; }
 
   virtual ~Symbol(){};
 };
@@ -173,7 +224,7 @@ private:
 public:
   FunctionSymbol(const std::string &name, std::shared_ptr<ASTType> type,
                  ScopePtr belongTo, ScopePtr scope)
-      : Symbol(name, belongTo, type), scope(scope) {}
+      : Symbol(name, belongTo, type), scope(scope), FD(nullptr) {}
   std::shared_ptr<ASTType> getReturnType() { return type; }
   void setReturnType(std::shared_ptr<ASTType> type) { this->type = type; }
 
@@ -194,7 +245,7 @@ public:
 
   std::shared_ptr<IR::Function> getFuncAddr() const { return FuncAddr; }
   ScopePtr getScope() const { return scope; }
-  std::size_t getParmNum() { return parms.size(); }
+  std::size_t getParmNum() const { return parms.size(); }
   FunctionDeclPtr getFuncDeclPointer() const { return FD; }
 };
 
@@ -215,6 +266,11 @@ public:
                std::make_shared<UserDefinedType>(TypeKind::USERDEFIED, name)),
         scope(scope) {}
 
+  /// \brief Make the symbol of a class whose type is built already.
+  ClassSymbol(const std::string &name, ScopePtr belongTo, ScopePtr scope,
+              std::shared_ptr<UserDefinedType> type)
+      : Symbol(name, belongTo, type), scope(scope) {}
+
   void addSubType(std::shared_ptr<ASTType> subType, std::string name) {
     if (std::shared_ptr<UserDefinedType> UDT =
             std::dynamic_pointer_cast<UserDefinedType>(type)) {
@@ -224,6 +280,7 @@ public:
 
   /// \brief get the class type
   std::shared_ptr<ASTType> getType() { return Symbol::getType(); }
+  ScopePtr getScope() const { return scope; }
 };
 
 ///		func add(lhs : int, rhs : int) -> int
@@ -0,0 +1,141 @@
+//===--------------------------------Trace.h------------------------------===//
+//
+// This file defines the trace subsystem, the diagnostic dumps of the compiler
+// (tokens, IR, dominator tree, executed instructions) are written to named
+// channels, each with its own level, and collected by a pluggable sink.
+//
+//===---------------------------------------------------------------------===//
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace Trace {
+/// Channel - The source of a message.
+enum class Channel : unsigned char { Tokens, IR, DomTree, Exec, NumChannels };
+
+/// Level - The verbosity of a message. A channel at level L shows the
+/// messages up to L.
+enum class Level : unsigned char { Off, Info, Debug };
+
+/// \brief Get the name of the channel, e.g. "domtree".
+const char *getChannelName(Channel C);
+
+/// Sink - The destination of the enabled messages.
+class Sink {
+public:
+  virtual ~Sink() {}
+  virtual void write(Channel C, Level L, const std::string &Msg) = 0;
+  /// \brief Called when the program exits.
+  virtual void flush() {}
+};
+
+/// StreamSink - Write the messages as is to a stream, e.g. std::cout.
+class StreamSink : public Sink {
+  std::ostream &Out;
+
+public:
+  explicit StreamSink(std::ostream &Out) : Out(Out) {}
+  void write(Channel, Level, const std::string &Msg) override { Out << Msg; }
+  void flush() override { Out.flush(); }
+};
+
+/// FileSink - Write the messages to a file.
+class FileSink : public Sink {
+  std::ofstream Out;
+
+public:
+  explicit FileSink(const std::string &Path) : Out(Path) {}
+  bool isOpen() const { return Out.is_open(); }
+  void write(Channel, Level, const std::string &Msg) override { Out << Msg; }
+  void flush() override { Out.flush(); }
+};
+
+/// RingSink - Keep the last Capacity messages in memory, they are written to
+/// Out tagged with their channel when the program exits.
+class RingSink : public Sink {
+  struct Record {
+    Channel C;
+    std::string Msg;
+  };
+  std::ostream &Out;
+  std::size_t Capacity;
+  std::deque<Record> Records;
+  // The number of messages pushed out of the ring.
+  std::size_t Dropped;
+
+public:
+  RingSink(std::ostream &Out, std::size_t Capacity)
+      : Out(Out), Capacity(Capacity), Dropped(0) {}
+  ~RingSink() override { flush(); }
+  void write(Channel C, Level L, const std::string &Msg) override;
+  void flush() override;
+};
+
+/// NullSink - Drop all the messages, the formatting is still paid for.
+class NullSink : public Sink {
+public:
+  void write(Channel, Level, const std::string &) override {}
+};
+
+// The level of every channel. Only read through isEnabled().
+extern Level ChannelLevels[static_cast<unsigned>(Channel::NumChannels)];
+
+/// \brief Return true if the messages of channel C at level L are shown.
+/// A disabled call site costs one load and one compare, building the message
+/// with -DMOSES_NO_TRACE removes the call sites.
+inline bool isEnabled(Channel C, Level L) {
+#ifdef MOSES_NO_TRACE
+  (void)C;
+  (void)L;
+  return false;
+#else
+  return ChannelLevels[static_cast<unsigned>(C)] >= L;
+#endif
+}
+
+void setLevel(Channel C, Level L);
+
+/// \brief Replace the sink, the default sink writes to std::cout.
+void setSink(std::unique_ptr<Sink> S);
+Sink &getSink();
+
+/// \brief Enable the channels of Spec, a comma separated list of
+/// "<channel>[=<level>]", "all" names every channel and the default level is
+/// debug. Return false if Spec is malformed.
+bool parseChannels(const std::string &Spec);
+
+/// \brief Install the sink described by Spec, one of "stdout", "stderr",
+/// "null", "file:<path>" or "ring:<n>". Return false if Spec is malformed or
+/// the file can't be opened.
+bool parseSink(const std::string &Spec);
+
+/// Message - Collect one message, it is written to the sink when the Message
+/// is destroyed.
+class Message {
+  Channel C;
+  Level L;
+  std::ostringstream Out;
+
+public:
+  Message(Channel C, Level L) : C(C), L(L) {}
+  Message(const Message &) = delete;
+  Message &operator=(const Message &) = delete;
+  ~Message() { getSink().write(C, L, Out.str()); }
+
+  std::ostringstream &stream() { return Out; }
+};
+} // namespace Trace
+
+/// MOSES_TRACE - Stream a message to a channel, e.g.
+///   MOSES_TRACE(Tokens, Info) << Name << "\n";
+/// The operands are not evaluated when the channel is off.
+#define MOSES_TRACE(CHANNEL, LEVEL)                                            \
+  if (!Trace::isEnabled(Trace::Channel::CHANNEL, Trace::Level::LEVEL))         \
+    ;                                                                          \
+  else                                                                         \
+    Trace::Message(Trace::Channel::CHANNEL, Trace::Level::LEVEL).stream()
@@ -4,21 +4,81 @@
 //
 //===---------------------------------------------------------------------===//
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 namespace SupportStructure {
+/// TypeSet - A set of uniqued types, at most one of every group of equal
+/// types is in it. ValueInfoT tells when two types are equal, it has
+///
+///   KeyTy                  what a type is looked up by, built from a type
+///   getHashValue(Key)      the hash of a KeyTy or of a type
+///   isEqual(Key, Value)    whether the type Value is the one of Key
+///
+/// The types are kept in the order they are inserted, an open-addressing
+/// table of their hashes indexes them.
 template <typename ValueT, typename ValueInfoT> class TypeSet {
-  std::vector<ValueT> Buckets;
-
 public:
   using key_type = ValueT;
   using value_type = ValueT;
+  using KeyTy = typename ValueInfoT::KeyTy;
+  using const_iterator = typename std::vector<ValueT>::const_iterator;
+
+private:
+  /// Slot - A slot of the table. Index is the position of the type in Values
+  /// plus one, 0 is an empty slot.
+  struct Slot {
+    std::size_t Hash;
+    std::uint32_t Index;
+  };
+
+  std::vector<ValueT> Values;
+  /// The size is a power of two, and at most half of the slots are used.
+  std::vector<Slot> Slots;
+
+  static std::size_t getStart(std::size_t Hash, std::size_t NumSlots) {
+    // The hashes of the KeyInfos combine pointers, their low bits are poor.
+    Hash ^= Hash >> 33;
+    Hash *= 0xff51afd7ed558ccdULL;
+    Hash ^= Hash >> 33;
+    return Hash & (NumSlots - 1);
+  }
 
+  /// \brief Get the slot of the type of Key, or the empty slot it takes.
+  std::size_t findSlot(const KeyTy &Key, std::size_t Hash) const {
+    std::size_t Mask = Slots.size() - 1;
+    for (std::size_t i = getStart(Hash, Slots.size());; i = (i + 1) & Mask) {
+      const Slot &S = Slots[i];
+      if (!S.Index ||
+          (S.Hash == Hash && ValueInfoT::isEqual(Key, Values[S.Index - 1])))
+        return i;
+    }
+  }
+
+  void grow() {
+    std::vector<Slot> Old(std::max<std::size_t>(Slots.size() * 2, 16));
+    Old.swap(Slots);
+    std::size_t Mask = Slots.size() - 1;
+    for (const Slot &S : Old) {
+      if (!S.Index)
+        continue;
+      std::size_t i = getStart(S.Hash, Slots.size());
+      while (Slots[i].Index)
+        i = (i + 1) & Mask;
+      Slots[i] = S;
+    }
+  }
+
+public:
   explicit TypeSet([[maybe_unused]] unsigned NumInit = 0) {}
 
-  bool empty() const { return Buckets.empty(); }
+  bool empty() const { return Values.empty(); }
+
+  std::size_t size() const { return Values.size(); }
 
-  std::size_t size() const { return Buckets.size(); }
+  const_iterator begin() const { return Values.begin(); }
+  const_iterator end() const { return Values.end(); }
 
   bool isIn(const ValueT &V) const {
     if (lookup(V))
@@ -26,22 +86,33 @@ public:
     return false;
   }
 
-  std::vector<ValueT> getBuckets() const { return Buckets; }
+  /// \brief Get the types in the order they were inserted.
+  const std::vector<ValueT> &getBuckets() const { return Values; }
 
-  ValueT lookup([[maybe_unused]] const ValueT &V) const {
-    for (auto item : Buckets) {
-      // auto item_hash = ValueInfoT::getHashValue(item);
-      // auto v_hash = ValueInfoT::getHashValue(item);
-      if (ValueInfoT::getHashValue(item) == ValueInfoT::getHashValue(item))
-        return item;
-    }
-    return nullptr;
+  /// \brief Get the type of Key, or nullptr.
+  ValueT lookup(const KeyTy &Key) const {
+    if (Slots.empty())
+      return nullptr;
+    const Slot &S = Slots[findSlot(Key, ValueInfoT::getHashValue(Key))];
+    return S.Index ? Values[S.Index - 1] : nullptr;
   }
 
-  void insert(ValueT V) {
-    if (lookup(V))
-      return;
-    Buckets.push_back(V);
+  /// \brief Get the type equal to V, or nullptr.
+  ValueT lookup(const ValueT &V) const { return lookup(KeyTy(V)); }
+
+  /// \brief Insert V unless a type equal to it is in the set already. Return
+  /// the type of the set.
+  const ValueT &insert(const ValueT &V) {
+    KeyTy Key(V);
+    std::size_t Hash = ValueInfoT::getHashValue(Key);
+    if ((Values.size() + 1) * 2 > Slots.size())
+      grow();
+    Slot &S = Slots[findSlot(Key, Hash)];
+    if (!S.Index) {
+      Values.push_back(V);
+      S = {Hash, std::uint32_t(Values.size())};
+    }
+    return Values[S.Index - 1];
   }
 };
 } // namespace SupportStructure
@@ -4,8 +4,45 @@
 //
 //===--------------------------------------------------------------------===//
 #pragma once
+#include <cstddef>
 #include <string>
+#include <vector>
 extern void errorOption(const std::string &msg);
 extern void errorToken(const std::string &msg);
 extern void errorParser(const std::string &msg);
 extern void errorSema(const std::string &sema);
+extern void errorExecution(const std::string &msg);
+
+/// DiagnosticBuffer - The errors of a part of a file that is checked on a
+/// thread of its own. While a Capture of the buffer is alive, the errors
+/// reported on its thread are added to the buffer instead of printed, so the
+/// errors of all the parts can be printed in the order of the file.
+class DiagnosticBuffer {
+  std::vector<std::string> Lines;
+
+public:
+  /// Capture - Send the errors of the current thread to a buffer, until the
+  /// Capture is destroyed.
+  class Capture {
+    DiagnosticBuffer *Prev;
+
+  public:
+    explicit Capture(DiagnosticBuffer &Buffer);
+    Capture(const Capture &) = delete;
+    Capture &operator=(const Capture &) = delete;
+    ~Capture();
+  };
+
+  /// \brief Get the number of errors in the buffer.
+  std::size_t size() const { return Lines.size(); }
+  void add(std::string Line) { Lines.push_back(std::move(Line)); }
+  /// \brief Move the errors of Other in before the error Pos of this buffer.
+  void splice(std::size_t Pos, DiagnosticBuffer &Other);
+  /// \brief Report the errors in order, to the buffer of the current thread
+  /// or to std::cerr, and empty the buffer. The buffer must not be captured
+  /// any more.
+  void flush();
+  /// \brief Print the errors the current thread holds back, before the
+  /// program exits on a fatal error. Nothing is captured afterwards.
+  static void flushCaptured();
+};
@@ -0,0 +1,538 @@
+//===------------------------------Bytecode.cpp---------------------------===//
+//
+// Implements the lowering from moses IR to bytecode.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/Bytecode.h"
+#include <algorithm>
+
+using namespace Execution;
+
+static const char *OpcodeNames[] = {
+#define BYTECODE_NAME(Name) #Name,
+    BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+};
+
+const char *Execution::getOpcodeName(BCOpcode Op) {
+  assert(Op < BCOpcode::NumOpcodes && "Invalid opcode.");
+  return OpcodeNames[static_cast<unsigned>(Op)];
+}
+
+bool Execution::getOpcodeByName(const std::string &Name, BCOpcode &Op) {
+  for (unsigned i = 0; i < static_cast<unsigned>(BCOpcode::NumOpcodes); i++) {
+    if (Name == OpcodeNames[i]) {
+      Op = static_cast<BCOpcode>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+BCValueKind BytecodeCompiler::getValueKind(const TyPtr &Ty) {
+  if (Ty->isIntegerTy())
+    return BCValueKind::Int;
+  if (Ty->isBoolTy())
+    return BCValueKind::Bool;
+  if (Ty->isPointerTy())
+    return BCValueKind::Pointer;
+  return BCValueKind::Other;
+}
+
+/// \brief Select the opcode specialized for the value kind, there is no
+/// opcode for aggregate values.
+bool BytecodeCompiler::selectByKind(BCValueKind Kind, BCOpcode IntOp,
+                                    BCOpcode BoolOp, BCOpcode PtrOp,
+                                    BCOpcode &Op) {
+  switch (Kind) {
+  case BCValueKind::Int:
+    Op = IntOp;
+    return true;
+  case BCValueKind::Bool:
+    Op = BoolOp;
+    return true;
+  case BCValueKind::Pointer:
+    Op = PtrOp;
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// \brief Resolve the operand V to a register of the current frame. Constants
+/// are placed in the constant pool, top-level values used by a function are
+/// imported.
+bool BytecodeCompiler::getOperandSlot(const Value *V, FunctionState &FS,
+                                      unsigned &Slot) {
+  if (!V)
+    return false;
+
+  if (V->getValueType() == Value::ValueTy::ConstantVal) {
+    auto Iter = FS.ConstantSlots.find(V);
+    if (Iter != FS.ConstantSlots.end()) {
+      Slot = Iter->second;
+      return true;
+    }
+    GenericValue GV;
+    GV.PointerVal = nullptr;
+    if (auto CB = dynamic_cast<const ConstantBool *>(V))
+      GV.BoolVal = CB->getVal();
+    else if (auto CI = dynamic_cast<const ConstantInt *>(V))
+      GV.IntVal = CI->getVal();
+    else
+      return false;
+    Slot = FS.BCF->ConstBase + FS.BCF->ConstantPool.size();
+    FS.BCF->ConstantPool.push_back(GV);
+    FS.ConstantSlots[V] = Slot;
+    return true;
+  }
+
+  if (V->getValueType() != Value::ValueTy::InstructionVal &&
+      V->getValueType() != Value::ValueTy::ArgumentVal)
+    return false;
+  if (!FS.CurLayout->hasSlot(V))
+    return false;
+
+  SlotRef Ref = FS.CurLayout->getSlot(V);
+  if (Ref.isGlobal && FS.CurLayout != &GlobalLayout) {
+    auto Iter = FS.ImportSlots.find(V);
+    assert(Iter != FS.ImportSlots.end() && "Global value isn't imported.");
+    Slot = Iter->second;
+    return true;
+  }
+  Slot = Ref.Index;
+  return true;
+}
+
+/// \brief Reserve an import register for every top-level value used by I.
+bool BytecodeCompiler::collectImports(const std::shared_ptr<Instruction> &I,
+                                      FunctionState &FS) {
+  for (unsigned i = 0, size = I->getNumOperands(); i < size; i++) {
+    const Value *Op = I->getOperand(i).get().get();
+    if (!Op || !FS.CurLayout->hasSlot(Op))
+      continue;
+    SlotRef Ref = FS.CurLayout->getSlot(Op);
+    if (!Ref.isGlobal || FS.ImportSlots.find(Op) != FS.ImportSlots.end())
+      continue;
+    FS.ImportSlots[Op] = FS.BCF->ImportBase + FS.BCF->Imports.size();
+    FS.BCF->Imports.push_back(Ref.Index);
+  }
+  return true;
+}
+
+bool BytecodeCompiler::lowerInstruction(const std::shared_ptr<Instruction> &I,
+                                        FunctionState &FS) {
+  BCInstr BI;
+  BI.Dst = BCFunction::NoSlot;
+
+  auto &Code = FS.BCF->Code;
+  auto operand = [&](unsigned i, unsigned &Slot) {
+    return i < I->getNumOperands() &&
+           getOperandSlot(I->getOperand(i).get().get(), FS, Slot);
+  };
+  auto result = [&]() { return FS.CurLayout->getSlot(I.get()).Index; };
+
+  switch (I->getOpcode()) {
+  case Opcode::Add:
+  case Opcode::Sub:
+  case Opcode::Mul:
+  case Opcode::Div:
+  case Opcode::Rem:
+  case Opcode::Shl:
+  case Opcode::Shr:
+  case Opcode::And:
+  case Opcode::Or:
+  case Opcode::Xor: {
+    // The logical operators work on bool, the arithmetic ones on int. Xor
+    // works on both, e.g. IRBuilder::CreateNot emits a bool xor.
+    static const std::map<Opcode, BCOpcode> BinOps = {
+        {Opcode::Add, BCOpcode::AddI32}, {Opcode::Sub, BCOpcode::SubI32},
+        {Opcode::Mul, BCOpcode::MulI32}, {Opcode::Div, BCOpcode::DivI32},
+        {Opcode::Rem, BCOpcode::RemI32}, {Opcode::Shl, BCOpcode::ShlI32},
+        {Opcode::Shr, BCOpcode::ShrI32}, {Opcode::And, BCOpcode::AndBool},
+        {Opcode::Or, BCOpcode::OrBool}};
+    if (I->getOpcode() == Opcode::Xor) {
+      BCValueKind Kind = getValueKind(I->getType());
+      if (Kind == BCValueKind::Int)
+        BI.Op = BCOpcode::XorI32;
+      else if (Kind == BCValueKind::Bool)
+        BI.Op = BCOpcode::XorBool;
+      else
+        return false;
+    } else {
+      BI.Op = BinOps.at(I->getOpcode());
+    }
+    if (!operand(0, BI.A) || !operand(1, BI.B))
+      return false;
+    BI.Dst = result();
+    break;
+  }
+  case Opcode::Cmp: {
+    auto CI = std::dynamic_pointer_cast<CmpInst>(I);
+    assert(CI && "Instruction's kind is wrong.");
+    // Equality compares int or bool, the relational operators only int.
+    BCValueKind Kind = getValueKind(I->getOperand(0).get()->getType());
+    if (Kind != BCValueKind::Int && Kind != BCValueKind::Bool)
+      return false;
+    bool isInt = Kind == BCValueKind::Int;
+    switch (CI->getPredicate()) {
+    case CmpInst::CMP_EQ:
+      BI.Op = isInt ? BCOpcode::CmpEqI32 : BCOpcode::CmpEqBool;
+      break;
+    case CmpInst::CMP_NE:
+      BI.Op = isInt ? BCOpcode::CmpNeI32 : BCOpcode::CmpNeBool;
+      break;
+    case CmpInst::CMP_GT:
+      BI.Op = BCOpcode::CmpGtI32;
+      break;
+    case CmpInst::CMP_GE:
+      BI.Op = BCOpcode::CmpGeI32;
+      break;
+    case CmpInst::CMP_LT:
+      BI.Op = BCOpcode::CmpLtI32;
+      break;
+    case CmpInst::CMP_LE:
+      BI.Op = BCOpcode::CmpLeI32;
+      break;
+    default:
+      return false;
+    }
+    if (!operand(0, BI.A) || !operand(1, BI.B))
+      return false;
+    BI.Dst = result();
+    break;
+  }
+  case Opcode::Alloca: {
+    auto PTy = std::dynamic_pointer_cast<PointerType>(I->getType());
+    assert(PTy && "PTy is null.");
+    BI.Op = BCOpcode::Alloca;
+    BI.A = PTy->getElementTy()->getSize();
+    BI.B = PTy->getElementTy()->getAlignment();
+    BI.Dst = result();
+    break;
+  }
+  case Opcode::Load:
+    if (!selectByKind(getValueKind(I->getType()), BCOpcode::LoadI32,
+                      BCOpcode::LoadBool, BCOpcode::LoadPtr, BI.Op))
+      return false;
+    if (!operand(0, BI.A))
+      return false;
+    BI.Dst = result();
+    break;
+  case Opcode::Store:
+    if (!selectByKind(getValueKind(I->getOperand(0).get()->getType()),
+                      BCOpcode::StoreI32, BCOpcode::StoreBool,
+                      BCOpcode::StorePtr, BI.Op))
+      return false;
+    if (!operand(0, BI.A) || !operand(1, BI.B))
+      return false;
+    break;
+  case Opcode::GetElementPtr:
+    BI.Op = BCOpcode::GEP;
+    if (!operand(0, BI.A) || !operand(2, BI.B))
+      return false;
+    BI.Dst = result();
+    break;
+  case Opcode::Br: {
+    auto Br = std::dynamic_pointer_cast<BranchInst>(I);
+    assert(Br && "Instruction's kind is wrong.");
+    if (Br->isUncoditional()) {
+      BI.Op = BCOpcode::Br;
+    } else {
+      BI.Op = BCOpcode::CondBr;
+      if (!getOperandSlot(Br->getCondition().get(), FS, BI.A))
+        return false;
+      FS.Fixups.push_back({(unsigned)Code.size(), true,
+                           Br->getSuccessor(1).get()});
+    }
+    FS.Fixups.push_back(
+        {(unsigned)Code.size(), false, Br->getSuccessor(0).get()});
+    break;
+  }
+  case Opcode::Ret: {
+    auto Ret = std::dynamic_pointer_cast<ReturnInst>(I);
+    assert(Ret && "Instruction's kind is wrong.");
+    if (I->getType()->isVoidType()) {
+      BI.Op = BCOpcode::RetVoid;
+    } else {
+      BI.Op = BCOpcode::Ret;
+      if (!getOperandSlot(Ret->getReturnValue().get(), FS, BI.A))
+        return false;
+    }
+    break;
+  }
+  case Opcode::Call: {
+    auto Call = std::dynamic_pointer_cast<CallInst>(I);
+    assert(Call && "Instruction's kind is wrong.");
+    auto Callee = I->getOperand(0).get();
+    if (Call->isIntrinsicCall()) {
+      if (Callee->getName() == "mosesir.memcpy") {
+        auto PTy = std::dynamic_pointer_cast<IR::PointerType>(
+            I->getOperand(2).get()->getType());
+        assert(PTy && "The operand of mosesir.memcpy must have pointer type.");
+        BI.Op = BCOpcode::Memcpy;
+        BI.Dst = PTy->getElementTy()->getSize();
+        if (!operand(1, BI.A) || !operand(2, BI.B))
+          return false;
+      } else if (Callee->getName() == "mosesir.print") {
+        BCValueKind Kind = getValueKind(I->getOperand(1).get()->getType());
+        if (Kind == BCValueKind::Int)
+          BI.Op = BCOpcode::PrintI32;
+        else if (Kind == BCValueKind::Bool)
+          BI.Op = BCOpcode::PrintBool;
+        else
+          return false;
+        if (!operand(1, BI.A))
+          return false;
+      } else {
+        return false;
+      }
+      break;
+    }
+
+    auto Iter = FunctionIndex.find(dynamic_cast<const Function *>(Callee.get()));
+    if (Iter == FunctionIndex.end())
+      return false;
+    BI.Op = BCOpcode::Call;
+    BI.A = Iter->second;
+    BI.B = FS.BCF->CallArgs.size();
+    for (std::size_t i = 0, size = Call->getNumArgOperands(); i < size; i++) {
+      unsigned Slot;
+      if (!getOperandSlot(Call->getArgOperand(i).get(), FS, Slot))
+        return false;
+      FS.BCF->CallArgs.push_back(Slot);
+    }
+    if (!I->getType()->isVoidType())
+      BI.Dst = result();
+    break;
+  }
+  case Opcode::PHI:
+    // The IR has no phi node now, just skip it like the interpreter does.
+    return true;
+  default:
+    return false;
+  }
+
+  Code.push_back(BI);
+  FS.BCF->Sources.push_back(I.get());
+  return true;
+}
+
+bool BytecodeCompiler::lowerBlocks(const std::vector<BasicBlock *> &BBs,
+                                   FunctionState &FS) {
+  auto &Code = FS.BCF->Code;
+  for (auto BB : BBs) {
+    FS.BlockOffsets[BB] = Code.size();
+    FS.BCF->Blocks.push_back({static_cast<unsigned>(Code.size()), BB});
+    for (auto &I : BB->getInstList())
+      if (!lowerInstruction(I, FS))
+        return false;
+    // Running off the end of a block stops the program.
+    if (!BB->getTerminator()) {
+      Code.push_back(BCInstr(BCOpcode::Halt));
+      FS.BCF->Sources.push_back(nullptr);
+    }
+  }
+
+  for (auto &Fixup : FS.Fixups) {
+    auto Iter = FS.BlockOffsets.find(Fixup.Target);
+    if (Iter == FS.BlockOffsets.end())
+      return false;
+    if (Fixup.isFalseTarget)
+      Code[Fixup.Index].B = Iter->second;
+    else
+      Code[Fixup.Index].Dst = Iter->second;
+  }
+  markBackEdges(FS);
+  return true;
+}
+
+/// \brief Rewrite the unconditional branches that jump backward, the loops
+/// built by ModuleBuilder jump back to their condition block with one.
+void BytecodeCompiler::markBackEdges(FunctionState &FS) {
+  auto &Code = FS.BCF->Code;
+  auto &Headers = FS.BCF->LoopHeaders;
+  for (auto &Fixup : FS.Fixups) {
+    BCInstr &BI = Code[Fixup.Index];
+    if (BI.Op != BCOpcode::Br || BI.Dst > Fixup.Index)
+      continue;
+    auto Iter = std::find_if(Headers.begin(), Headers.end(),
+                             [&BI](const BCFunction::LoopHeader &Header) {
+                               return Header.Offset == BI.Dst;
+                             });
+    BI.Op = BCOpcode::BrBack;
+    BI.A = Iter - Headers.begin();
+    if (Iter == Headers.end())
+      Headers.push_back({BI.Dst, Fixup.Target});
+  }
+}
+
+std::unique_ptr<BCModule> BytecodeCompiler::compile() {
+  auto Module = std::make_unique<BCModule>();
+
+  std::vector<Function *> Functions;
+  std::vector<BasicBlock *> TopLevelBBs;
+  for (auto &val : Insts) {
+    if (auto F = std::dynamic_pointer_cast<Function>(val)) {
+      FunctionIndex[F.get()] = Functions.size();
+      Functions.push_back(F.get());
+    } else if (auto BB = std::dynamic_pointer_cast<BasicBlock>(val)) {
+      TopLevelBBs.push_back(BB.get());
+    }
+  }
+  Module->Functions.resize(Functions.size());
+
+  for (unsigned i = 0, size = Functions.size(); i < size; i++) {
+    Function *F = Functions[i];
+    BCFunction &BCF = Module->Functions[i];
+    FunctionState FS;
+    FS.BCF = &BCF;
+    FS.CurLayout = &FS.Layout;
+    FrameLayout::computeFunctionLayout(FS.Layout, F, GlobalLayout);
+
+    BCF.F = F;
+    BCF.Index = i;
+    BCF.NumArgs = F->getArgumentList().size();
+    BCF.ImportBase = FS.Layout.getNumSlots();
+
+    std::vector<BasicBlock *> BBs;
+    for (auto &BB : F->getBasicBlockList()) {
+      BBs.push_back(BB.get());
+      for (auto &I : BB->getInstList())
+        collectImports(I, FS);
+    }
+    BCF.ConstBase = BCF.ImportBase + BCF.Imports.size();
+    if (!lowerBlocks(BBs, FS))
+      return nullptr;
+    BCF.NumRegs = BCF.ConstBase + BCF.ConstantPool.size();
+    if (Fuse)
+      fuseSuperinstructions(BCF);
+  }
+
+  // The top-level code runs on the global slot table directly.
+  BCFunction &Top = Module->TopLevel;
+  FunctionState FS;
+  FS.BCF = &Top;
+  FS.CurLayout = &GlobalLayout;
+  Top.Index = Functions.size();
+  Top.ImportBase = Top.ConstBase = GlobalLayout.getNumSlots();
+  if (!lowerBlocks(TopLevelBBs, FS))
+    return nullptr;
+  if (Top.Code.empty()) {
+    Top.Code.push_back(BCInstr(BCOpcode::Halt));
+    Top.Sources.push_back(nullptr);
+  }
+  Top.NumRegs = Top.ConstBase + Top.ConstantPool.size();
+  if (Fuse)
+    fuseSuperinstructions(Top);
+  return Module;
+}
+
+void BytecodeCompiler::fuseSuperinstructions(BCFunction &BCF) {
+  auto &Code = BCF.Code;
+  auto isConstant = [&BCF](unsigned Slot) {
+    return Slot >= BCF.ConstBase &&
+           Slot < BCF.ConstBase + BCF.ConstantPool.size();
+  };
+
+  // (1) Int binary operators whose right operand is a constant take it as an
+  // immediate, e.g. the i + 1 of the loops.
+  static const std::map<BCOpcode, BCOpcode> ImmOps = {
+      {BCOpcode::AddI32, BCOpcode::AddI32Imm},
+      {BCOpcode::SubI32, BCOpcode::SubI32Imm},
+      {BCOpcode::MulI32, BCOpcode::MulI32Imm},
+      {BCOpcode::DivI32, BCOpcode::DivI32Imm},
+      {BCOpcode::RemI32, BCOpcode::RemI32Imm}};
+  for (auto &BI : Code) {
+    auto Iter = ImmOps.find(BI.Op);
+    if (Iter == ImmOps.end() || !isConstant(BI.B))
+      continue;
+    BI.Op = Iter->second;
+    BI.B = BCF.ConstantPool[BI.B - BCF.ConstBase].IntVal;
+  }
+
+  // (2) Fuse the sequences, the longest sequence that matches wins. Since the
+  // instructions keep their operands, any sequence can be fused no matter
+  // whether it crosses a branch target.
+  static const std::map<BCOpcode, BCOpcode> CmpBrOps = {
+      {BCOpcode::CmpEqI32, BCOpcode::CmpEqI32Br},
+      {BCOpcode::CmpNeI32, BCOpcode::CmpNeI32Br},
+      {BCOpcode::CmpGtI32, BCOpcode::CmpGtI32Br},
+      {BCOpcode::CmpGeI32, BCOpcode::CmpGeI32Br},
+      {BCOpcode::CmpLtI32, BCOpcode::CmpLtI32Br},
+      {BCOpcode::CmpLeI32, BCOpcode::CmpLeI32Br}};
+  static const std::map<BCOpcode, BCOpcode> LoadCmpBrOps = {
+      {BCOpcode::CmpEqI32, BCOpcode::LoadCmpEqI32Br},
+      {BCOpcode::CmpNeI32, BCOpcode::LoadCmpNeI32Br},
+      {BCOpcode::CmpGtI32, BCOpcode::LoadCmpGtI32Br},
+      {BCOpcode::CmpGeI32, BCOpcode::LoadCmpGeI32Br},
+      {BCOpcode::CmpLtI32, BCOpcode::LoadCmpLtI32Br},
+      {BCOpcode::CmpLeI32, BCOpcode::LoadCmpLeI32Br}};
+  auto opAt = [&Code](std::size_t Index) {
+    return Index < Code.size() ? Code[Index].Op : BCOpcode::NumOpcodes;
+  };
+
+  for (std::size_t i = 0, size = Code.size(); i < size;) {
+    BCOpcode Op = Code[i].Op;
+    // load + cmp + condbr, the condition of the loops.
+    if (Op == BCOpcode::LoadI32 && opAt(i + 2) == BCOpcode::CondBr) {
+      auto Iter = LoadCmpBrOps.find(opAt(i + 1));
+      if (Iter != LoadCmpBrOps.end()) {
+        Code[i].Op = Iter->second;
+        i += 3;
+        continue;
+      }
+    }
+    // load + add + store, the increment and decrement of a variable.
+    if (Op == BCOpcode::LoadI32 && opAt(i + 1) == BCOpcode::AddI32Imm &&
+        opAt(i + 2) == BCOpcode::StoreI32) {
+      Code[i].Op = BCOpcode::LoadAddImmStoreI32;
+      i += 3;
+      continue;
+    }
+    // cmp + condbr.
+    if (opAt(i + 1) == BCOpcode::CondBr) {
+      auto Iter = CmpBrOps.find(Op);
+      if (Iter != CmpBrOps.end()) {
+        Code[i].Op = Iter->second;
+        i += 2;
+        continue;
+      }
+    }
+    // load + load, the operands of a binary operator.
+    if (Op == BCOpcode::LoadI32 && opAt(i + 1) == BCOpcode::LoadI32) {
+      Code[i].Op = BCOpcode::LoadLoadI32;
+      i += 2;
+      continue;
+    }
+    ++i;
+  }
+}
+
+BCOpcode BytecodeCompiler::getUnfusedOpcode(BCOpcode Op) {
+  switch (Op) {
+  case BCOpcode::CmpEqI32Br:
+    return BCOpcode::CmpEqI32;
+  case BCOpcode::CmpNeI32Br:
+    return BCOpcode::CmpNeI32;
+  case BCOpcode::CmpGtI32Br:
+    return BCOpcode::CmpGtI32;
+  case BCOpcode::CmpGeI32Br:
+    return BCOpcode::CmpGeI32;
+  case BCOpcode::CmpLtI32Br:
+    return BCOpcode::CmpLtI32;
+  case BCOpcode::CmpLeI32Br:
+    return BCOpcode::CmpLeI32;
+  case BCOpcode::LoadCmpEqI32Br:
+  case BCOpcode::LoadCmpNeI32Br:
+  case BCOpcode::LoadCmpGtI32Br:
+  case BCOpcode::LoadCmpGeI32Br:
+  case BCOpcode::LoadCmpLtI32Br:
+  case BCOpcode::LoadCmpLeI32Br:
+  case BCOpcode::LoadLoadI32:
+  case BCOpcode::LoadAddImmStoreI32:
+    return BCOpcode::LoadI32;
+  default:
+    return Op;
+  }
+}
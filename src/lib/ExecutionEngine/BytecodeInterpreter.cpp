@@ -0,0 +1,412 @@
+//===------------------------BytecodeInterpreter.cpp----------------------===//
+//
+// Implements the dispatch loop of the bytecode tier. With GCC and clang the
+// loop is threaded through a table of label addresses (computed goto), other
+// compilers fall back to a switch. The loop is instantiated again to count
+// the executed instruction pairs, the hotness of the tiered mode and the
+// profile, so the normal loop pays nothing for them.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/ExecutionEngine.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace Execution;
+
+#if defined(__GNUC__)
+#define MOSES_THREADED_DISPATCH 1
+#endif
+
+void Interpreter::runBytecode() {
+  if (Prof) {
+    // The profiler runs without the tiers, every instruction is counted.
+    Prof->enterFunction(Module->TopLevel.Index);
+    if (Options.Pairs)
+      dispatchBytecode<true, false, true>();
+    else
+      dispatchBytecode<false, false, true>();
+    Prof->finish();
+  } else if (Options.Pairs && Tiers) {
+    dispatchBytecode<true, true, false>();
+  } else if (Options.Pairs) {
+    dispatchBytecode<true, false, false>();
+  } else if (Tiers) {
+    dispatchBytecode<false, true, false>();
+  } else {
+    dispatchBytecode<false, false, false>();
+  }
+}
+
+bool Interpreter::tierUp(TierEvent::EventKind Kind, unsigned Index,
+                         unsigned LoopHeader) {
+  TierEvent Event;
+  Event.Kind = Kind;
+  Event.Function = Index;
+  Event.LoopHeader = LoopHeader;
+  Event.TimeMs = Tiers->getTimeMs();
+
+  JITCompiler Compiler(*Module);
+  if (Kind == TierEvent::OnStackReplacement) {
+    const BCFunction &Fn = Index < Module->Functions.size()
+                               ? Module->Functions[Index]
+                               : Module->TopLevel;
+    Event.Succeeded = Compiler.compileOSREntry(*Native, Fn, LoopHeader);
+  } else {
+    Event.Succeeded = Compiler.compileFunction(*Native, Index);
+  }
+  Event.CompileMs = Tiers->getTimeMs() - Event.TimeMs;
+  Tiers->addEvent(Event);
+  return Event.Succeeded;
+}
+
+bool Interpreter::callNative(unsigned Index, const unsigned *Args,
+                             GenericValue *Regs, unsigned Dst) {
+  unsigned NumArgs = Module->Functions[Index].NumArgs;
+  NativeArgs.resize(NumArgs);
+  for (unsigned i = 0; i < NumArgs; i++)
+    NativeArgs[i] = Regs[Args[i]];
+
+  GenericValue Result;
+  NativeCtx.Depth = BCStack.size();
+  if (!Native->callFunction(NativeCtx, Index, NativeArgs.data(), Result)) {
+    // The native code ran into a stack overflow or the end of the program.
+    if (NativeCtx.Overflow || NativeCtx.StackExhausted)
+      stackOverflow(NativeCtx.StackExhausted);
+    BCStack.clear();
+    return false;
+  }
+  if (Dst != BCFunction::NoSlot)
+    Regs[Dst] = Result;
+  return true;
+}
+
+template <bool CountPairs, bool Tiered, bool Profiling>
+void Interpreter::dispatchBytecode() {
+  if (BCStack.empty())
+    return;
+
+  BCFrame *Frame = &BCStack.back();
+  const BCFunction *Fn = Frame->Fn;
+  const BCInstr *Code = Fn->Code.data();
+  const BCInstr *PC = Frame->PC;
+  GenericValue *Regs = Frame->Regs;
+  GenericValue RetVal;
+  bool HasRetVal = false;
+  // The previously dispatched opcode, NumOpcodes before the first dispatch.
+  BCOpcode PrevOp = BCOpcode::NumOpcodes;
+
+#define COUNT_PAIR()                                                           \
+  if constexpr (CountPairs) {                                                  \
+    if (PrevOp != BCOpcode::NumOpcodes)                                        \
+      Options.Pairs->record(PrevOp, PC->Op);                                   \
+    PrevOp = PC->Op;                                                           \
+  }                                                                            \
+  if constexpr (Profiling)                                                     \
+    Prof->countInstruction(*Fn, PC);
+
+#ifdef MOSES_THREADED_DISPATCH
+  static const void *DispatchTable[] = {
+#define BYTECODE_LABEL(Name) &&Op_##Name,
+      BYTECODE_OPCODES(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+  };
+#define DISPATCH()                                                             \
+  do {                                                                         \
+    COUNT_PAIR()                                                               \
+    goto *DispatchTable[static_cast<unsigned>(PC->Op)];                        \
+  } while (0)
+#define CASE(Name) Op_##Name:
+  DISPATCH();
+#else
+#define DISPATCH()                                                             \
+  do {                                                                         \
+    COUNT_PAIR()                                                               \
+    goto Dispatch;                                                             \
+  } while (0)
+#define CASE(Name) case BCOpcode::Name:
+  COUNT_PAIR()
+Dispatch:
+  switch (PC->Op) {
+#endif
+
+#define BINARY_OP(Name, Member, Operator)                                     \
+  CASE(Name) {                                                                 \
+    Regs[PC->Dst].Member = Regs[PC->A].Member Operator Regs[PC->B].Member;    \
+    ++PC;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+  BINARY_OP(AddI32, IntVal, +)
+  BINARY_OP(SubI32, IntVal, -)
+  BINARY_OP(MulI32, IntVal, *)
+  BINARY_OP(DivI32, IntVal, /)
+  BINARY_OP(RemI32, IntVal, %)
+  BINARY_OP(ShlI32, IntVal, <<)
+  BINARY_OP(ShrI32, IntVal, >>)
+  BINARY_OP(XorI32, IntVal, ^)
+  BINARY_OP(AndBool, BoolVal, &&)
+  BINARY_OP(OrBool, BoolVal, ||)
+  BINARY_OP(XorBool, BoolVal, !=)
+#undef BINARY_OP
+
+#define COMPARE_OP(Name, Member, Operator)                                    \
+  CASE(Name) {                                                                 \
+    Regs[PC->Dst].BoolVal = Regs[PC->A].Member Operator Regs[PC->B].Member;   \
+    ++PC;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+  COMPARE_OP(CmpEqI32, IntVal, ==)
+  COMPARE_OP(CmpEqBool, BoolVal, ==)
+  COMPARE_OP(CmpNeI32, IntVal, !=)
+  COMPARE_OP(CmpNeBool, BoolVal, !=)
+  COMPARE_OP(CmpGtI32, IntVal, >)
+  COMPARE_OP(CmpGeI32, IntVal, >=)
+  COMPARE_OP(CmpLtI32, IntVal, <)
+  COMPARE_OP(CmpLeI32, IntVal, <=)
+#undef COMPARE_OP
+
+  CASE(Alloca) {
+    Regs[PC->Dst] = PTOGV(Allocas.allocate(PC->A, PC->B));
+    ++PC;
+    DISPATCH();
+  }
+  // Both int and bool occupy an int in memory.
+  CASE(LoadI32) {
+    Regs[PC->Dst].IntVal = *(int *)GVTOP(Regs[PC->A]);
+    ++PC;
+    DISPATCH();
+  }
+  CASE(LoadBool) {
+    Regs[PC->Dst].BoolVal = *(int *)GVTOP(Regs[PC->A]);
+    ++PC;
+    DISPATCH();
+  }
+  CASE(LoadPtr) {
+    Regs[PC->Dst].PointerVal = *(void **)GVTOP(Regs[PC->A]);
+    ++PC;
+    DISPATCH();
+  }
+  CASE(StoreI32) {
+    *(int *)GVTOP(Regs[PC->B]) = Regs[PC->A].IntVal;
+    ++PC;
+    DISPATCH();
+  }
+  CASE(StoreBool) {
+    *(int *)GVTOP(Regs[PC->B]) = Regs[PC->A].BoolVal;
+    ++PC;
+    DISPATCH();
+  }
+  CASE(StorePtr) {
+    *(void **)GVTOP(Regs[PC->B]) = Regs[PC->A].PointerVal;
+    ++PC;
+    DISPATCH();
+  }
+  CASE(GEP) {
+    Regs[PC->Dst].PointerVal =
+        (char *)GVTOP(Regs[PC->A]) + Regs[PC->B].IntVal * sizeof(int);
+    ++PC;
+    DISPATCH();
+  }
+  CASE(Br) {
+    PC = Code + PC->Dst;
+    DISPATCH();
+  }
+  CASE(CondBr) {
+    PC = Code + (Regs[PC->A].BoolVal ? PC->Dst : PC->B);
+    DISPATCH();
+  }
+  CASE(BrBack) {
+    if constexpr (Tiered) {
+      if (Tiers->countBackEdge(Fn->Index, PC->A) &&
+          tierUp(TierEvent::OnStackReplacement, Fn->Index, PC->A)) {
+        // Continue the frame in native code from the loop header. The
+        // top-level code runs on the global slot table in both tiers, a
+        // function frame hands its register file over.
+        bool isTopLevel = Fn == &Module->TopLevel;
+        NativeCtx.Depth = BCStack.size() - (isTopLevel ? 0 : 1);
+        if (!Native->callOSREntry(NativeCtx,
+                                  Native->getOSREntry(Fn->Index, PC->A),
+                                  Regs, RetVal) ||
+            isTopLevel) {
+          if (NativeCtx.Overflow || NativeCtx.StackExhausted)
+            stackOverflow(NativeCtx.StackExhausted);
+          BCStack.clear();
+          return;
+        }
+        HasRetVal = true;
+        goto Return;
+      }
+    }
+    PC = Code + PC->Dst;
+    DISPATCH();
+  }
+  CASE(Call) {
+    if constexpr (Tiered) {
+      if (Tiers->countCall(PC->A) && !Native->isCompiled(PC->A))
+        tierUp(TierEvent::CallCount, PC->A, 0);
+      if (Native->isCompiled(PC->A)) {
+        if (!callNative(PC->A, Fn->CallArgs.data() + PC->B, Regs, PC->Dst))
+          return;
+        ++PC;
+        DISPATCH();
+      }
+    }
+    const BCFunction &Callee = Module->Functions[PC->A];
+    const unsigned *Args = Fn->CallArgs.data() + PC->B;
+    GenericValue *CallerRegs = Regs;
+    Frame->PC = PC + 1;
+    Frame->ReturnDst = PC->Dst;
+
+    // Create a new stack frame. Frames never move, and a recycled frame
+    // reuses the register file of its previous occupant.
+    Frame = BCStack.push();
+    if (!Frame) {
+      stackOverflow();
+      return;
+    }
+    if constexpr (Profiling)
+      Prof->enterFunction(PC->A);
+    Frame->Fn = &Callee;
+    Frame->RegStorage.resize(Callee.NumRegs);
+    Frame->Regs = Frame->RegStorage.data();
+    Frame->AllocaMark = Allocas.getMark();
+    Regs = Frame->Regs;
+
+    // Handle the argument passing, then materialize the imported globals and
+    // the constants.
+    for (unsigned i = 0; i < Callee.NumArgs; i++)
+      Regs[i] = CallerRegs[Args[i]];
+    for (unsigned i = 0, size = Callee.Imports.size(); i < size; i++)
+      Regs[Callee.ImportBase + i] = Globals[Callee.Imports[i]];
+    std::copy(Callee.ConstantPool.begin(), Callee.ConstantPool.end(),
+              Regs + Callee.ConstBase);
+
+    Fn = &Callee;
+    Code = Fn->Code.data();
+    PC = Code;
+    DISPATCH();
+  }
+  CASE(Ret) {
+    RetVal = Regs[PC->A];
+    HasRetVal = true;
+    goto Return;
+  }
+  CASE(RetVoid) {
+    HasRetVal = false;
+    goto Return;
+  }
+  CASE(Memcpy) {
+    std::memcpy((char *)GVTOP(Regs[PC->A]), (char *)GVTOP(Regs[PC->B]),
+                PC->Dst);
+    ++PC;
+    DISPATCH();
+  }
+  CASE(PrintI32) {
+    std::cout << Regs[PC->A].IntVal << std::endl;
+    ++PC;
+    DISPATCH();
+  }
+  CASE(PrintBool) {
+    std::cout << Regs[PC->A].BoolVal << std::endl;
+    ++PC;
+    DISPATCH();
+  }
+  // Superinstructions. Each one executes a sequence of instructions with their
+  // own operands, see BytecodeCompiler::fuseSuperinstructions.
+#define IMM_OP(Name, Operator)                                                 \
+  CASE(Name) {                                                                 \
+    Regs[PC->Dst].IntVal =                                                     \
+        Regs[PC->A].IntVal Operator static_cast<int>(PC->B);                   \
+    ++PC;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+  IMM_OP(AddI32Imm, +)
+  IMM_OP(SubI32Imm, -)
+  IMM_OP(MulI32Imm, *)
+  IMM_OP(DivI32Imm, /)
+  IMM_OP(RemI32Imm, %)
+#undef IMM_OP
+
+  // cmp + condbr.
+#define CMP_BR_OP(Name, Operator)                                              \
+  CASE(Name) {                                                                 \
+    Regs[PC[0].Dst].BoolVal =                                                  \
+        Regs[PC[0].A].IntVal Operator Regs[PC[0].B].IntVal;                    \
+    PC = Code + (Regs[PC[1].A].BoolVal ? PC[1].Dst : PC[1].B);                 \
+    DISPATCH();                                                                \
+  }
+
+  CMP_BR_OP(CmpEqI32Br, ==)
+  CMP_BR_OP(CmpNeI32Br, !=)
+  CMP_BR_OP(CmpGtI32Br, >)
+  CMP_BR_OP(CmpGeI32Br, >=)
+  CMP_BR_OP(CmpLtI32Br, <)
+  CMP_BR_OP(CmpLeI32Br, <=)
+#undef CMP_BR_OP
+
+  // load + cmp + condbr.
+#define LOAD_CMP_BR_OP(Name, Operator)                                         \
+  CASE(Name) {                                                                 \
+    Regs[PC[0].Dst].IntVal = *(int *)GVTOP(Regs[PC[0].A]);                     \
+    Regs[PC[1].Dst].BoolVal =                                                  \
+        Regs[PC[1].A].IntVal Operator Regs[PC[1].B].IntVal;                    \
+    PC = Code + (Regs[PC[2].A].BoolVal ? PC[2].Dst : PC[2].B);                 \
+    DISPATCH();                                                                \
+  }
+
+  LOAD_CMP_BR_OP(LoadCmpEqI32Br, ==)
+  LOAD_CMP_BR_OP(LoadCmpNeI32Br, !=)
+  LOAD_CMP_BR_OP(LoadCmpGtI32Br, >)
+  LOAD_CMP_BR_OP(LoadCmpGeI32Br, >=)
+  LOAD_CMP_BR_OP(LoadCmpLtI32Br, <)
+  LOAD_CMP_BR_OP(LoadCmpLeI32Br, <=)
+#undef LOAD_CMP_BR_OP
+
+  CASE(LoadLoadI32) {
+    Regs[PC[0].Dst].IntVal = *(int *)GVTOP(Regs[PC[0].A]);
+    Regs[PC[1].Dst].IntVal = *(int *)GVTOP(Regs[PC[1].A]);
+    PC += 2;
+    DISPATCH();
+  }
+  CASE(LoadAddImmStoreI32) {
+    Regs[PC[0].Dst].IntVal = *(int *)GVTOP(Regs[PC[0].A]);
+    Regs[PC[1].Dst].IntVal = Regs[PC[1].A].IntVal + static_cast<int>(PC[1].B);
+    *(int *)GVTOP(Regs[PC[2].B]) = Regs[PC[2].A].IntVal;
+    PC += 3;
+    DISPATCH();
+  }
+  CASE(Halt) {
+    // Nothing left to do, release all the frames.
+    BCStack.clear();
+    return;
+  }
+
+#ifndef MOSES_THREADED_DISPATCH
+  default:
+    assert(0 && "Unreachable code.");
+    return;
+  }
+#endif
+
+Return:
+  // Restore previous stack and set the return value of the previous stack.
+  assert(BCStack.size() > 1 && "Return from the top-level frame.");
+  if constexpr (Profiling)
+    Prof->exitFunction();
+  Allocas.release(Frame->AllocaMark);
+  BCStack.pop_back();
+  Frame = &BCStack.back();
+  Fn = Frame->Fn;
+  Code = Fn->Code.data();
+  PC = Frame->PC;
+  Regs = Frame->Regs;
+  if (HasRetVal && Frame->ReturnDst != BCFunction::NoSlot)
+    Regs[Frame->ReturnDst] = RetVal;
+  DISPATCH();
+
+#undef CASE
+#undef DISPATCH
+#undef COUNT_PAIR
+}
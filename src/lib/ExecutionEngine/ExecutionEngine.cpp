@@ -4,20 +4,70 @@
 //
 //===---------------------------------------------------------------------===//
 #include "ExecutionEngine/ExecutionEngine.h"
+#include "Support/Trace.h"
+#include "Support/error.h"
 #include <cstring>
 
 using namespace Execution;
-extern void print(std::shared_ptr<IR::Value> V);
 Interpreter::Interpreter(const std::list<std::shared_ptr<Value>> &Insts,
-                         const MosesIRContext &Ctx)
-    : Insts(Insts), Ctx(Ctx) {
-  // Initialize the top-level-frame.
-  ECStack.emplace_back(ExecutionContext());
+                         const MosesIRContext &Ctx,
+                         const InterpreterOptions &Options)
+    : ECStack(Options.MaxCallDepth), BCStack(Options.MaxCallDepth),
+      RuntimeError(false), Options(Options), Insts(Insts), Ctx(Ctx) {
+  assert(Options.MaxCallDepth > 0 && "The top-level frame needs a slot.");
+  // Assign the global slots before anything runs.
+  FrameLayout::computeGlobalLayout(GlobalLayout, Insts);
+
+  // Lower the program to bytecode, the IR is interpreted directly only if the
+  // lowering fails. The JIT translates the bytecode. A profiled program stays
+  // in the bytecode or the IR tier.
+  if (Options.Mode != ExecutionMode::IR)
+    Module = BytecodeCompiler(Insts, GlobalLayout,
+                              Options.Superinstructions && !Options.Profile)
+                 .compile();
+  if (Module && Options.Profile)
+    Prof = std::make_unique<Profiler>(*Module);
+  else if (Options.Profile)
+    Prof = std::make_unique<Profiler>(Insts);
+  if (Module && !Prof && Options.Mode == ExecutionMode::JIT)
+    Native = JITCompiler(*Module).compile();
+  if (Module && !Prof && Options.Mode == ExecutionMode::Tiered &&
+      JITCompiler::isSupported()) {
+    Native = std::make_unique<JITModule>(*Module);
+    Tiers = std::make_unique<TierProfile>(*Module, Options.TierUpThreshold);
+  }
+  if (Module) {
+    const BCFunction &Top = Module->TopLevel;
+    Globals.resize(Top.NumRegs);
+    std::copy(Top.ConstantPool.begin(), Top.ConstantPool.end(),
+              Globals.begin() + Top.ConstBase);
+
+    // The native code runs on a stack of its own, the program stays in the
+    // bytecode tier if it can't be mapped.
+    if (Native && !Native->initContext(NativeCtx, Globals.data(), Allocas,
+                                       Options.MaxCallDepth)) {
+      MOSES_TRACE(Exec, Info) << "run: the native stack can't be mapped\n";
+      Native.reset();
+      Tiers.reset();
+    }
 
-  ExecutionContext &SF = ECStack.back();
+    BCFrame &Frame = *BCStack.push();
+    Frame.Fn = &Top;
+    Frame.PC = Top.Code.data();
+    Frame.Regs = Globals.data();
+    Frame.AllocaMark = Allocas.getMark();
+    return;
+  }
+  Globals.resize(GlobalLayout.getNumSlots());
+
+  // Initialize the top-level-frame.
+  ExecutionContext &SF = *ECStack.push();
   // nullptr means top-level-frame.
   SF.CurFunction = nullptr;
-  // Get the first BasicBlock to execute.
+  SF.Layout = &GlobalLayout;
+  SF.NextInst = 0;
+  SF.AllocaMark = Allocas.getMark();
+  // Get the first BasicBlock to execute, it is numbered first in the layout.
   for (auto &val : Insts) {
     if (std::shared_ptr<BasicBlock> BB =
             std::dynamic_pointer_cast<BasicBlock>(val)) {
@@ -26,16 +76,32 @@ Interpreter::Interpreter(const std::list<std::shared_ptr<Value>> &Insts,
     }
   }
   SF.CurInst = SF.CurBB->begin();
-
-  // Start executing the function call.
-  run();
 }
 
 /// create - Create an interpreter ExecutionEngine. This can never fail.
 std::shared_ptr<Interpreter>
 Interpreter::create(const std::list<std::shared_ptr<Value>> &Insts,
-                    const MosesIRContext &Ctx) {
-  return std::make_shared<Interpreter>(Insts, Ctx);
+                    const MosesIRContext &Ctx,
+                    const InterpreterOptions &Options) {
+  return std::make_shared<Interpreter>(Insts, Ctx, Options);
+}
+
+void Interpreter::dumpTierStats(std::ostream &Out) const {
+  if (Tiers)
+    Tiers->dump(Out, Native.get());
+  else
+    Out << "tiered execution is disabled.\n";
+}
+
+void Interpreter::stackOverflow(bool isNativeStack) {
+  if (isNativeStack)
+    errorExecution("Stack overflow, the native stack is exhausted.");
+  else
+    errorExecution("Stack overflow, the call depth exceeds " +
+                   std::to_string(ECStack.getMaxDepth()) + ".");
+  RuntimeError = true;
+  ECStack.clear();
+  BCStack.clear();
 }
 
 void Interpreter::LoadValueFromMemory(GenericValue &Dest, GenericValue SrcAddr,
@@ -56,30 +122,71 @@ void Interpreter::StoreValueToMemory(GenericValue V, GenericValue DestAddr,
 
 void Interpreter::PopStackAndSetReturnValue(GenericValue ReturnValue,
                                             bool isVoid) {
+  // Release the allocas of the frame in one step.
+  Allocas.release(ECStack.back().AllocaMark);
   ECStack.pop_back();
   ExecutionContext &SF = ECStack.back();
 
-  if (!isVoid) {
-    auto CallSite = SF.Caller;
-    SetGenericValue(CallSite, ReturnValue, SF);
-  }
+  // The caller is still executing the call.
+  if (!isVoid)
+    SetGenericValue(ReturnValue, SF);
 }
 
 void Interpreter::run() {
+  if (Native && Native->hasTopLevel()) {
+    MOSES_TRACE(Exec, Info) << "run: native code\n";
+    Native->runTopLevel(NativeCtx);
+    if (NativeCtx.Overflow || NativeCtx.StackExhausted)
+      stackOverflow(NativeCtx.StackExhausted);
+    return;
+  }
+  if (Module) {
+    MOSES_TRACE(Exec, Info) << "run: bytecode" << (Tiers ? ", tiered" : "")
+                            << (Prof ? ", profiled" : "") << "\n";
+    runBytecode();
+    return;
+  }
+
+  MOSES_TRACE(Exec, Info) << "run: IR" << (Prof ? ", profiled" : "") << "\n";
+  if (Prof) {
+    Prof->enterFunction(Prof->getTopLevelIndex());
+    runIR<true>();
+    Prof->finish();
+  } else {
+    runIR<false>();
+  }
+}
+
+template <bool Profiling> void Interpreter::runIR() {
   while (!ECStack.empty()) {
     // Interprete a single instruction & increment the "PC"
     // Current stack frame.
     ExecutionContext &SF = ECStack.back();
     std::shared_ptr<Instruction> I = SF.IssueInstruction();
-    if (I)
-      visit(I);
-    else
+    if (!I)
       break;
+    if constexpr (Profiling) {
+      // A call pushes the frame of the callee, a return pops its own. A stack
+      // overflow empties the stack, finish() exits the frames left.
+      std::size_t Depth = ECStack.size();
+      Prof->countInstruction(I.get());
+      visit(I);
+      if (ECStack.size() > Depth)
+        Prof->enterFunction(
+            Prof->getFunctionIndex(ECStack.back().CurFunction.get()));
+      else if (ECStack.size() < Depth && !ECStack.empty())
+        Prof->exitFunction();
+    } else {
+      visit(I);
+    }
   }
 }
 
 void Interpreter::visit(std::shared_ptr<Instruction> I) {
-  print(I);
+  if (Trace::isEnabled(Trace::Channel::Exec, Trace::Level::Debug)) {
+    Trace::Message Exec(Trace::Channel::Exec, Trace::Level::Debug);
+    I->Print(Exec.stream());
+  }
   switch (I->getOpcode()) {
   case Opcode::Add:
   case Opcode::Sub:
@@ -154,8 +261,8 @@ void Interpreter::visit(std::shared_ptr<Instruction> I) {
 void Interpreter::visitBinaryOperator(std::shared_ptr<BinaryOperator> I) {
   ExecutionContext &SF = ECStack.back();
   auto Ty = I->getType();
-  GenericValue Src1 = getOperandValue(I->getOperand(0).get(), SF);
-  GenericValue Src2 = getOperandValue(I->getOperand(1).get(), SF);
+  GenericValue Src1 = getOperandValue(0, SF);
+  GenericValue Src2 = getOperandValue(1, SF);
   GenericValue R;
 
   switch (I->getOpcode()) {
@@ -187,13 +294,16 @@ void Interpreter::visitBinaryOperator(std::shared_ptr<BinaryOperator> I) {
     R.IntVal = Src1.IntVal << Src2.IntVal;
     break;
   case Opcode::Xor:
-    R.IntVal = Src1.IntVal ^ Src2.IntVal;
+    if (Ty->isBoolTy())
+      R.BoolVal = Src1.BoolVal != Src2.BoolVal;
+    else
+      R.IntVal = Src1.IntVal ^ Src2.IntVal;
     break;
   default:
     assert(0 && "Unreachable code.");
   }
 
-  SetGenericValue(I, R, SF);
+  SetGenericValue(R, SF);
 }
 
 /// visitAllocaInst - Alloca the memory and update the information.
@@ -203,24 +313,20 @@ void Interpreter::visitAllocaInst(std::shared_ptr<AllocaInst> I) {
   assert(PTy && "PTy is null.");
   auto ty = PTy->getElementTy();
 
-  unsigned TypeSize = ty->getSize();
-
   // Alloca enough memory to hold the type...
-  auto Memory = std::make_shared<char>(TypeSize);
-  GenericValue Result = PTOGV(Memory.get());
-  SetGenericValue(I, Result, SF);
-  ECStack.back().Allocas.add(Memory);
+  void *Memory = Allocas.allocate(ty->getSize(), ty->getAlignment());
+  GenericValue Result = PTOGV(Memory);
+  SetGenericValue(Result, SF);
 }
 
 void Interpreter::visitBranchInst(std::shared_ptr<BranchInst> I) {
   ExecutionContext &SF = ECStack.back();
-  auto Dest = I->getSuccessor(0);
-  if (!I->isUncoditional()) {
-    GenericValue CondV = getOperandValue(I->getCondition(), SF);
-    if (!CondV.BoolVal)
-      Dest = I->getSuccessor(1);
-  }
-  SwitchToNewBasicBlock(Dest, SF);
+  unsigned Succ = 0;
+  // The condition is the last operand of a conditional branch.
+  if (!I->isUncoditional() && !getOperandValue(2, SF).BoolVal)
+    Succ = 1;
+  const OperandRef &Dest = SF.Layout->getOperand(*SF.Executing, Succ);
+  SwitchToNewBasicBlock(I->getSuccessor(Succ), Dest.Block, SF);
 }
 
 void Interpreter::visitCallInst(std::shared_ptr<CallInst> I) {
@@ -231,11 +337,10 @@ void Interpreter::visitCallInst(std::shared_ptr<CallInst> I) {
     return;
   }
 
-  SF.Caller = I;
-  // prepare the arg values.
+  // prepare the arg values, they follow the called function.
   std::vector<GenericValue> ArgVals;
   for (std::size_t i = 0, size = I->getNumArgOperands(); i < size; i++)
-    ArgVals.push_back(getOperandValue(I->getArgOperand(i), SF));
+    ArgVals.push_back(getOperandValue(i + 1, SF));
 
   auto Func = std::dynamic_pointer_cast<Function>(I->getOperand(0).get());
   assert(I && "Call instruciton's function can't be null.");
@@ -247,8 +352,8 @@ void Interpreter::visitCmpInst(std::shared_ptr<CmpInst> I) {
   auto Ty = I->getOperand(0).get()->getType();
 
   CmpInst::Predicate PreD = I->getPredicate();
-  GenericValue LHS = getOperandValue(I->getOperand(0).get(), SF);
-  GenericValue RHS = getOperandValue(I->getOperand(1).get(), SF);
+  GenericValue LHS = getOperandValue(0, SF);
+  GenericValue RHS = getOperandValue(1, SF);
   GenericValue Result;
 
   switch (PreD) {
@@ -281,33 +386,34 @@ void Interpreter::visitCmpInst(std::shared_ptr<CmpInst> I) {
     assert(0 && "Unreachable code.");
     break;
   }
-  SetGenericValue(I, Result, SF);
+  SetGenericValue(Result, SF);
 }
 
-void Interpreter::visitGEPInst(std::shared_ptr<GetElementPtrInst> I) {
+void Interpreter::visitGEPInst(
+    [[maybe_unused]] std::shared_ptr<GetElementPtrInst> I) {
   ExecutionContext &SF = ECStack.back();
-  void *BaseAddr = GVTOP(getOperandValue(I->getOperand(0).get(), SF));
+  void *BaseAddr = GVTOP(getOperandValue(0, SF));
   GenericValue Result;
   // GEP instruction just have two operand. Shit.
-  GenericValue index = getOperandValue(I->getOperand(2).get(), SF);
+  GenericValue index = getOperandValue(2, SF);
 
   Result.PointerVal = (char *)BaseAddr + index.IntVal * sizeof(int);
-  SetGenericValue(I, Result, SF);
+  SetGenericValue(Result, SF);
 }
 
 void Interpreter::visitLoadInst(std::shared_ptr<LoadInst> I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue SrcAddr = getOperandValue(I->getOperand(0).get(), SF);
+  GenericValue SrcAddr = getOperandValue(0, SF);
   GenericValue Result;
   LoadValueFromMemory(Result, SrcAddr, I->getType());
 
-  SetGenericValue(I, Result, SF);
+  SetGenericValue(Result, SF);
 }
 
 void Interpreter::visitStoreInst(std::shared_ptr<StoreInst> I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue V = getOperandValue(I->getOperand(0).get(), SF);
-  GenericValue DestAddr = getOperandValue(I->getOperand(1).get(), SF);
+  GenericValue V = getOperandValue(0, SF);
+  GenericValue DestAddr = getOperandValue(1, SF);
 
   StoreValueToMemory(V, DestAddr, I->getOperand(0).get()->getType());
 }
@@ -317,7 +423,7 @@ void Interpreter::visitReturnInst(std::shared_ptr<ReturnInst> I) {
   GenericValue ReturnV;
   bool isVoid = true;
   if (!I->getType()->isVoidType()) {
-    ReturnV = getOperandValue(I->getReturnValue(), SF);
+    ReturnV = getOperandValue(0, SF);
     isVoid = false;
   }
 
@@ -326,66 +432,65 @@ void Interpreter::visitReturnInst(std::shared_ptr<ReturnInst> I) {
 }
 
 void Interpreter::SwitchToNewBasicBlock(std::shared_ptr<BasicBlock> New,
-                                        ExecutionContext &SF) {
+                                        unsigned Start, ExecutionContext &SF) {
   SF.CurBB = New;
   SF.CurInst = New->begin();
+  SF.NextInst = Start;
   // Now have no phi node, so return.
 }
 
-GenericValue Interpreter::getConstantValue(ConstantPtr C) {
-  GenericValue Result;
-  if (std::shared_ptr<ConstantBool> CB =
-          std::dynamic_pointer_cast<ConstantBool>(C))
-    Result.BoolVal = CB->getVal();
-
-  if (std::shared_ptr<ConstantInt> CI =
-          std::dynamic_pointer_cast<ConstantInt>(C))
-    Result.IntVal = CI->getVal();
-  return Result;
-}
-
-GenericValue
-Interpreter::getOperandValue(std::shared_ptr<Value> V,
-                             [[maybe_unused]] ExecutionContext &SF) {
-  if (ConstantPtr CPV = std::dynamic_pointer_cast<Constant>(V))
-    return getConstantValue(CPV);
-  return getLocalAndGlobalGV(V);
+GenericValue Interpreter::getOperandValue(unsigned i, ExecutionContext &SF) {
+  const OperandRef &Op = SF.Layout->getOperand(*SF.Executing, i);
+  if (Op.Kind == OperandRef::RefKind::Constant)
+    return Op.Constant;
+  assert(Op.Kind == OperandRef::RefKind::Slot && "Operand isn't a value.");
+  return getSlotValue(Op.Slot, SF);
 }
 
-GenericValue Interpreter::getLocalAndGlobalGV(std::shared_ptr<Value> V) {
-  ExecutionContext &SF = ECStack.back();
-  if (SF.Values.find(V) != SF.Values.end())
-    return SF.Values[V];
-  return TopLevelFrame.Values[V];
+void Interpreter::SetGenericValue(GenericValue GV, ExecutionContext &SF) {
+  getSlotValue(SF.Executing->Result, SF) = GV;
 }
 
-void Interpreter::SetGenericValue(std::shared_ptr<Value> V, GenericValue GV,
-                                  ExecutionContext &SF) {
-  SF.Values[V] = GV;
+const FrameLayout &Interpreter::getFrameLayout(Function *F) {
+  auto Iter = FunctionLayouts.find(F);
+  if (Iter != FunctionLayouts.end())
+    return Iter->second;
+  FrameLayout &Layout = FunctionLayouts[F];
+  FrameLayout::computeFunctionLayout(Layout, F, GlobalLayout);
+  return Layout;
 }
 
 void Interpreter::callFunction(std::shared_ptr<Function> Function,
                                std::vector<GenericValue> ArgVals) {
-  // Create a new stack frame.
-  ECStack.push_back(ExecutionContext());
+  // Create a new stack frame, the frame may be recycled from a previous call.
+  ExecutionContext *NewFrame = ECStack.push();
+  if (!NewFrame) {
+    stackOverflow();
+    return;
+  }
 
-  ExecutionContext &SF = ECStack.back();
+  ExecutionContext &SF = *NewFrame;
   SF.CurFunction = Function;
   SF.CurBB = Function->getEntryBlock();
   SF.CurInst = SF.CurBB->begin();
+  SF.Layout = &getFrameLayout(Function.get());
+  SF.NextInst = 0;
+  SF.Executing = nullptr;
+  SF.Values.assign(SF.Layout->getNumSlots(), GenericValue());
+  SF.AllocaMark = Allocas.getMark();
 
   // This is the most interesting part.
-  // Handle the argument passing.
-  for (std::size_t i = 0, size = Function->getArgumentList().size(); i < size;
-       i++)
-    SetGenericValue(Function->getArg(i), ArgVals[i], SF);
+  // Handle the argument passing, the arguments take the first slots.
+  std::copy(ArgVals.begin(),
+            ArgVals.begin() + Function->getArgumentList().size(),
+            SF.Values.begin());
 }
 
 void Interpreter::callIntrinsic(std::shared_ptr<CallInst> I) {
   ExecutionContext &SF = ECStack.back();
   if (I->getOperand(0).get()->getName() == "mosesir.memcpy") {
-    GenericValue SrcAddr = getOperandValue(I->getOperand(2).get(), SF);
-    GenericValue DestAddr = getOperandValue(I->getOperand(1).get(), SF);
+    GenericValue SrcAddr = getOperandValue(2, SF);
+    GenericValue DestAddr = getOperandValue(1, SF);
 
     auto Ty = I->getOperand(2).get()->getType();
     auto PTy = std::dynamic_pointer_cast<IR::PointerType>(Ty);
@@ -395,7 +500,7 @@ void Interpreter::callIntrinsic(std::shared_ptr<CallInst> I) {
 
     std::memcpy((char *)GVTOP(DestAddr), (char *)GVTOP(SrcAddr), size);
   } else if (I->getOperand(0).get()->getName() == "mosesir.print") {
-    GenericValue Val = getOperandValue(I->getOperand(1).get(), SF);
+    GenericValue Val = getOperandValue(1, SF);
     auto Ty = I->getOperand(1).get()->getType();
     if (Ty->isIntegerTy()) {
       std::cout << Val.IntVal << std::endl;
@@ -0,0 +1,112 @@
+//===----------------------------FrameLayout.cpp--------------------------===//
+//
+// Implements the class FrameLayout.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/FrameLayout.h"
+#include "IR/ConstantAndGlobal.h"
+
+using namespace Execution;
+
+void FrameLayout::addSlot(const Value *V) {
+  if (Slots.find(V) != Slots.end())
+    return;
+  Slots[V] = SlotRef(NumSlots++, isGlobalLayout);
+}
+
+/// \brief Record the top-level values used by \p I, so that the function
+/// frame can resolve them without a second lookup.
+void FrameLayout::addOperands(const std::shared_ptr<Instruction> &I,
+                              const FrameLayout *Globals) {
+  for (unsigned i = 0, size = I->getNumOperands(); i < size; i++) {
+    const Value *Op = I->getOperand(i).get().get();
+    if (!Op || Slots.find(Op) != Slots.end())
+      continue;
+    auto VTy = Op->getValueType();
+    if (VTy != Value::ValueTy::InstructionVal &&
+        VTy != Value::ValueTy::ArgumentVal)
+      continue;
+    // Only values defined in this function or at top level can reach here.
+    if (Globals && Globals->hasSlot(Op))
+      Slots[Op] = Globals->getSlot(Op);
+  }
+}
+
+void FrameLayout::resolveInstructions(
+    const std::vector<BasicBlock *> &BBs) {
+  std::unordered_map<const Value *, unsigned> BlockStart;
+  unsigned NumInsts = 0;
+  for (BasicBlock *BB : BBs) {
+    BlockStart[BB] = NumInsts;
+    NumInsts += BB->getInstList().size();
+  }
+
+  Insts.resize(NumInsts);
+  unsigned Index = 0;
+  for (BasicBlock *BB : BBs) {
+    for (auto &I : BB->getInstList()) {
+      InstLayout &IL = Insts[Index++];
+      IL.FirstOperand = Operands.size();
+      IL.NumOperands = I->getNumOperands();
+      IL.Result = getSlot(I.get());
+      for (unsigned i = 0; i < IL.NumOperands; i++) {
+        const Value *Op = I->getOperand(i).get().get();
+        OperandRef Ref;
+        if (auto CB = dynamic_cast<const ConstantBool *>(Op)) {
+          Ref.Kind = OperandRef::RefKind::Constant;
+          Ref.Constant.BoolVal = CB->getVal();
+        } else if (auto CI = dynamic_cast<const ConstantInt *>(Op)) {
+          Ref.Kind = OperandRef::RefKind::Constant;
+          Ref.Constant.IntVal = CI->getVal();
+        } else if (dynamic_cast<const Constant *>(Op)) {
+          Ref.Kind = OperandRef::RefKind::Constant;
+        } else if (Op && BlockStart.find(Op) != BlockStart.end()) {
+          Ref.Kind = OperandRef::RefKind::Block;
+          Ref.Block = BlockStart[Op];
+        } else if (Op && hasSlot(Op)) {
+          Ref.Kind = OperandRef::RefKind::Slot;
+          Ref.Slot = getSlot(Op);
+        }
+        // Anything else, e.g. the called function, isn't read as a value.
+        Operands.push_back(Ref);
+      }
+    }
+  }
+}
+
+void FrameLayout::computeGlobalLayout(
+    FrameLayout &Layout, const std::list<std::shared_ptr<Value>> &Insts) {
+  Layout.isGlobalLayout = true;
+  std::vector<BasicBlock *> BBs;
+  for (auto &val : Insts) {
+    if (std::shared_ptr<BasicBlock> BB =
+            std::dynamic_pointer_cast<BasicBlock>(val)) {
+      for (auto &I : BB->getInstList())
+        Layout.addSlot(I.get());
+      BBs.push_back(BB.get());
+    }
+  }
+  Layout.resolveInstructions(BBs);
+}
+
+void FrameLayout::computeFunctionLayout(FrameLayout &Layout, Function *F,
+                                        const FrameLayout &Globals) {
+  Layout.isGlobalLayout = false;
+  for (auto &Arg : F->getArgumentList())
+    Layout.addSlot(Arg.get());
+
+  auto &BBs = F->getBasicBlockList();
+  for (auto &BB : BBs)
+    for (auto &I : BB->getInstList())
+      Layout.addSlot(I.get());
+
+  // Forward references to top-level values, e.g. global variables.
+  for (auto &BB : BBs)
+    for (auto &I : BB->getInstList())
+      Layout.addOperands(I, &Globals);
+
+  std::vector<BasicBlock *> Blocks;
+  for (auto &BB : BBs)
+    Blocks.push_back(BB.get());
+  Layout.resolveInstructions(Blocks);
+}
@@ -0,0 +1,865 @@
+//===--------------------------------JIT.cpp------------------------------===//
+//
+// Implements the baseline x86-64 JIT. The generated code follows the System V
+// calling convention, so it only runs on x86-64 Linux, other hosts keep using
+// the bytecode interpreter.
+//
+// The native frame of a function is laid out as
+//
+//   rbp + 8    return address
+//   rbp        saved rbp
+//   rbp - 8    saved rbx
+//   rbp - 16   saved r12
+//              register file        <- rbx
+//              the return value
+//              the alloca mark
+//   rsp        outgoing arguments
+//
+// rbx points to the register file and r12 to the JITContext for the whole
+// function. The top-level code runs on the global slot table instead. The
+// frames live on the NativeStack of the module, the C++ code enters it
+// through a trampoline.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/JIT.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MOSES_JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Execution;
+
+ExecutableMemory::~ExecutableMemory() {
+#ifdef MOSES_JIT_X86_64
+  if (Memory)
+    munmap(Memory, Size);
+#endif
+}
+
+bool ExecutableMemory::load(const std::vector<std::uint8_t> &Code) {
+#ifdef MOSES_JIT_X86_64
+  std::size_t PageSize = sysconf(_SC_PAGESIZE);
+  std::size_t NewSize = (Code.size() + PageSize - 1) / PageSize * PageSize;
+  if (NewSize == 0)
+    NewSize = PageSize;
+  void *NewMemory = mmap(nullptr, NewSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (NewMemory == MAP_FAILED)
+    return false;
+  std::memcpy(NewMemory, Code.data(), Code.size());
+  if (mprotect(NewMemory, NewSize, PROT_READ | PROT_EXEC) != 0) {
+    munmap(NewMemory, NewSize);
+    return false;
+  }
+  if (Memory)
+    munmap(Memory, Size);
+  Memory = NewMemory;
+  Size = NewSize;
+  return true;
+#else
+  (void)Code;
+  return false;
+#endif
+}
+
+NativeStack::~NativeStack() {
+#ifdef MOSES_JIT_X86_64
+  if (Memory)
+    munmap(static_cast<char *>(Memory) - sysconf(_SC_PAGESIZE),
+           Size + sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool NativeStack::map(std::size_t NewSize) {
+#ifdef MOSES_JIT_X86_64
+  std::size_t PageSize = sysconf(_SC_PAGESIZE);
+  if (NewSize > SIZE_MAX / 2)
+    return false;
+  NewSize = (NewSize + PageSize - 1) / PageSize * PageSize;
+  if (Memory && NewSize <= Size)
+    return true;
+  // The lowest page stays inaccessible, a stray access below the stack
+  // faults instead of corrupting the heap.
+  void *NewMemory =
+      mmap(nullptr, NewSize + PageSize, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (NewMemory == MAP_FAILED)
+    return false;
+  if (mprotect(NewMemory, PageSize, PROT_NONE) != 0) {
+    munmap(NewMemory, NewSize + PageSize);
+    return false;
+  }
+  if (Memory)
+    munmap(static_cast<char *>(Memory) - PageSize, Size + PageSize);
+  Memory = static_cast<char *>(NewMemory) + PageSize;
+  Size = NewSize;
+  return true;
+#else
+  (void)NewSize;
+  return false;
+#endif
+}
+
+char *NativeStack::getBottom() const { return static_cast<char *>(Memory); }
+
+namespace {
+/// \brief The largest number of arguments passed by a call in Fn.
+unsigned getMaxCallArgs(const BCModule &Module, const BCFunction &Fn) {
+  unsigned MaxArgs = 0;
+  for (auto &BI : Fn.Code)
+    if (BI.Op == BCOpcode::Call && Module.Functions[BI.A].NumArgs > MaxArgs)
+      MaxArgs = Module.Functions[BI.A].NumArgs;
+  return MaxArgs;
+}
+
+/// \brief The size of the native frame of Fn below the saved registers, see
+/// the layout at the top of the file.
+std::int32_t getFrameSize(const BCModule &Module, const BCFunction &Fn) {
+  const bool isTopLevel = &Fn == &Module.TopLevel;
+  std::int32_t FrameSize = getMaxCallArgs(Module, Fn) * 8 + 16 + 8 +
+                           (isTopLevel ? 0 : Fn.NumRegs * sizeof(GenericValue));
+  return (FrameSize + 15) & ~15;
+}
+
+// The return address and the saved rbp, rbx and r12 of a native frame.
+const std::size_t SavedSize = 32;
+// The room left below the deepest frame for the C++ helpers.
+const std::size_t HelperMargin = 256 * 1024;
+} // namespace
+
+JITModule::JITModule(const BCModule &Module)
+    : Entries(Module.Functions.size(), nullptr), TopLevelEntry(nullptr),
+      MaxFrameSize(0), Enter(nullptr) {
+  for (auto &Fn : Module.Functions)
+    MaxFrameSize = std::max<std::size_t>(MaxFrameSize,
+                                         getFrameSize(Module, Fn) + SavedSize);
+  TopLevelFrameSize = getFrameSize(Module, Module.TopLevel) + SavedSize;
+}
+
+bool JITCompiler::isSupported() {
+#ifdef MOSES_JIT_X86_64
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef MOSES_JIT_X86_64
+namespace {
+// The helpers called by the generated code.
+void *jitAlloca(JITContext *Ctx, unsigned Size, unsigned Align) {
+  return Ctx->Allocas->allocate(Size, Align);
+}
+void jitGetMark(JITContext *Ctx, StackArena::Mark *M) {
+  *M = Ctx->Allocas->getMark();
+}
+void jitRelease(JITContext *Ctx, const StackArena::Mark *M) {
+  Ctx->Allocas->release(*M);
+}
+void jitMemcpy(void *Dest, const void *Src, unsigned Size) {
+  std::memcpy(Dest, Src, Size);
+}
+void jitPrintI32(int V) { std::cout << V << std::endl; }
+void jitPrintBool(bool V) { std::cout << V << std::endl; }
+
+enum Reg : unsigned {
+  RAX = 0,
+  RCX = 1,
+  RDX = 2,
+  RBX = 3,
+  RSP = 4,
+  RBP = 5,
+  RSI = 6,
+  RDI = 7,
+  R12 = 12
+};
+
+enum CondCode : std::uint8_t {
+  CC_B = 0x2,
+  CC_AE = 0x3,
+  CC_E = 0x4,
+  CC_NE = 0x5,
+  CC_L = 0xC,
+  CC_GE = 0xD,
+  CC_LE = 0xE,
+  CC_G = 0xF
+};
+
+/// X86Emitter - Encode the few x86-64 instructions used by the templates.
+/// Memory operands are always [Base + disp32].
+class X86Emitter {
+  std::vector<std::uint8_t> &Code;
+
+  void rex(bool W, unsigned R, unsigned B) {
+    std::uint8_t Rex =
+        0x40 | (W << 3) | (((R >> 3) & 1) << 2) | ((B >> 3) & 1);
+    if (Rex != 0x40)
+      byte(Rex);
+  }
+
+public:
+  explicit X86Emitter(std::vector<std::uint8_t> &Code) : Code(Code) {}
+
+  std::size_t size() const { return Code.size(); }
+  void byte(std::uint8_t B) { Code.push_back(B); }
+  void bytes(std::initializer_list<std::uint8_t> Bytes) {
+    Code.insert(Code.end(), Bytes.begin(), Bytes.end());
+  }
+  void imm32(std::int32_t V) {
+    for (unsigned i = 0; i < 4; i++)
+      byte(static_cast<std::uint32_t>(V) >> (8 * i));
+  }
+  void imm64(std::uint64_t V) {
+    for (unsigned i = 0; i < 8; i++)
+      byte(V >> (8 * i));
+  }
+
+  /// \brief Emit Opcode with the operands R (or an opcode extension) and
+  /// [Base + Disp].
+  void mem(bool W, std::initializer_list<std::uint8_t> Opcode, unsigned R,
+           unsigned Base, std::int32_t Disp) {
+    rex(W, R, Base);
+    bytes(Opcode);
+    byte(0x80 | ((R & 7) << 3) | (Base & 7));
+    if ((Base & 7) == RSP)
+      byte(0x24);
+    imm32(Disp);
+  }
+  /// \brief Emit Opcode with the register operands R and RM.
+  void reg(bool W, std::initializer_list<std::uint8_t> Opcode, unsigned R,
+           unsigned RM) {
+    rex(W, R, RM);
+    bytes(Opcode);
+    byte(0xC0 | ((R & 7) << 3) | (RM & 7));
+  }
+
+  void load32(unsigned R, unsigned Base, std::int32_t Disp) {
+    mem(false, {0x8B}, R, Base, Disp);
+  }
+  void load64(unsigned R, unsigned Base, std::int32_t Disp) {
+    mem(true, {0x8B}, R, Base, Disp);
+  }
+  void store8(unsigned Base, std::int32_t Disp, unsigned R) {
+    mem(false, {0x88}, R, Base, Disp);
+  }
+  void store32(unsigned Base, std::int32_t Disp, unsigned R) {
+    mem(false, {0x89}, R, Base, Disp);
+  }
+  void store64(unsigned Base, std::int32_t Disp, unsigned R) {
+    mem(true, {0x89}, R, Base, Disp);
+  }
+  void lea(unsigned R, unsigned Base, std::int32_t Disp) {
+    mem(true, {0x8D}, R, Base, Disp);
+  }
+  void mov64(unsigned Dst, unsigned Src) { reg(true, {0x89}, Src, Dst); }
+  void movImm32(unsigned R, std::uint32_t V) {
+    byte(0xB8 + R);
+    imm32(V);
+  }
+  void movImm64(unsigned R, std::uint64_t V) {
+    byte(0x48);
+    byte(0xB8 + R);
+    imm64(V);
+  }
+  void setcc(CondCode CC, unsigned R) {
+    reg(false, {0x0F, static_cast<std::uint8_t>(0x90 | CC)}, 0, R);
+  }
+  /// cmp byte [Base + Disp], Imm
+  void cmpByte(unsigned Base, std::int32_t Disp, std::uint8_t Imm) {
+    mem(false, {0x80}, 7, Base, Disp);
+    byte(Imm);
+  }
+  /// mov byte [Base + Disp], Imm
+  void storeImm8(unsigned Base, std::int32_t Disp, std::uint8_t Imm) {
+    mem(false, {0xC6}, 0, Base, Disp);
+    byte(Imm);
+  }
+  template <typename T> void call(T *Helper) {
+    movImm64(RAX, reinterpret_cast<std::uint64_t>(Helper));
+    reg(false, {0xFF}, 2, RAX);
+  }
+
+  /// \brief Emit a jump and return the position of its rel32 for patch().
+  std::size_t jmp() {
+    byte(0xE9);
+    imm32(0);
+    return size() - 4;
+  }
+  std::size_t jcc(CondCode CC) {
+    byte(0x0F);
+    byte(0x80 | CC);
+    imm32(0);
+    return size() - 4;
+  }
+  void patch(std::size_t Pos, std::size_t Target) {
+    std::int32_t Rel = Target - (Pos + 4);
+    std::memcpy(&Code[Pos], &Rel, sizeof(Rel));
+  }
+
+  void push(unsigned R) {
+    rex(false, 0, R);
+    byte(0x50 + (R & 7));
+  }
+  void pop(unsigned R) {
+    rex(false, 0, R);
+    byte(0x58 + (R & 7));
+  }
+  void ret() { byte(0xC3); }
+};
+
+const std::int32_t CtxGlobals = offsetof(JITContext, Globals);
+const std::int32_t CtxFunctions = offsetof(JITContext, Functions);
+const std::int32_t CtxDepth = offsetof(JITContext, Depth);
+const std::int32_t CtxMaxDepth = offsetof(JITContext, MaxDepth);
+const std::int32_t CtxStackLimit = offsetof(JITContext, StackLimit);
+const std::int32_t CtxStop = offsetof(JITContext, Stop);
+const std::int32_t CtxOverflow = offsetof(JITContext, Overflow);
+const std::int32_t CtxStackExhausted = offsetof(JITContext, StackExhausted);
+
+static_assert(sizeof(StackArena::Mark) <= 16,
+              "The alloca mark slot is 16 bytes.");
+static_assert(sizeof(GenericValue) == 8, "A register is 8 bytes.");
+
+/// \brief The displacement of the register Slot from rbx.
+std::int32_t slot(unsigned Slot) { return Slot * sizeof(GenericValue); }
+
+/// \brief Translate one function, or the top-level code. The code is entered
+/// at the code offset Entry. The OSR entry of a function replaces a running
+/// bytecode frame, so the register file is copied from the frame instead of
+/// being built from the arguments.
+bool emitFunction(const BCModule &Module, const BCFunction &Fn,
+                  unsigned Entry, bool isOSR, X86Emitter &E) {
+  const bool isTopLevel = &Fn == &Module.TopLevel;
+  // The outgoing argument area holds the arguments of the largest call.
+  const std::int32_t MarkOffset = getMaxCallArgs(Module, Fn) * 8;
+  const std::int32_t RetOffset = MarkOffset + 16;
+  const std::int32_t RegsOffset = RetOffset + 8;
+  const std::int32_t FrameSize = getFrameSize(Module, Fn);
+
+  std::vector<std::size_t> OverflowJumps;
+  std::vector<std::size_t> ExhaustedJumps;
+  std::vector<std::size_t> EpilogueJumps;
+  // The branches to patch, with the bytecode index of their target.
+  std::vector<std::pair<std::size_t, unsigned>> BranchJumps;
+  std::vector<std::size_t> NativeOffsets(Fn.Code.size());
+
+  // (1) Prologue.
+  E.push(RBP);
+  E.mov64(RBP, RSP);
+  E.push(RBX);
+  E.push(R12);
+  E.mov64(R12, RSI);
+  if (!isTopLevel) {
+    // Check the call depth and the native stack.
+    E.load64(RAX, R12, CtxDepth);
+    E.mem(true, {0x3B}, RAX, R12, CtxMaxDepth);
+    OverflowJumps.push_back(E.jcc(CC_AE));
+    E.mov64(RAX, RSP);
+    E.bytes({0x48, 0x2D});
+    E.imm32(FrameSize);
+    E.mem(true, {0x3B}, RAX, R12, CtxStackLimit);
+    ExhaustedJumps.push_back(E.jcc(CC_B));
+    E.mem(true, {0xFF}, 0, R12, CtxDepth);
+  }
+  E.reg(true, {0x81}, 5, RSP);
+  E.imm32(FrameSize);
+  if (isTopLevel) {
+    // The constants of the top-level code are already in the global table.
+    E.mov64(RBX, RDI);
+  } else if (isOSR) {
+    E.lea(RBX, RSP, RegsOffset);
+    E.mov64(RSI, RDI);
+    E.mov64(RDI, RBX);
+    E.movImm32(RCX, Fn.NumRegs);
+    E.bytes({0xF3, 0x48, 0xA5}); // rep movsq
+  } else {
+    E.lea(RBX, RSP, RegsOffset);
+    for (unsigned i = 0; i < Fn.NumArgs; i++) {
+      E.load64(RAX, RDI, slot(i));
+      E.store64(RBX, slot(i), RAX);
+    }
+    if (!Fn.Imports.empty()) {
+      E.load64(RCX, R12, CtxGlobals);
+      for (unsigned i = 0, size = Fn.Imports.size(); i < size; i++) {
+        E.load64(RAX, RCX, slot(Fn.Imports[i]));
+        E.store64(RBX, slot(Fn.ImportBase + i), RAX);
+      }
+    }
+    for (unsigned i = 0, size = Fn.ConstantPool.size(); i < size; i++) {
+      std::uint64_t Bits;
+      std::memcpy(&Bits, &Fn.ConstantPool[i], sizeof(Bits));
+      E.movImm64(RAX, Bits);
+      E.store64(RBX, slot(Fn.ConstBase + i), RAX);
+    }
+  }
+  if (!isTopLevel) {
+    E.lea(RSI, RSP, MarkOffset);
+    E.mov64(RDI, R12);
+    E.call(jitGetMark);
+  }
+  if (Entry != 0)
+    BranchJumps.push_back({E.jmp(), Entry});
+
+  // (2) Body, one template per instruction.
+  for (unsigned i = 0, size = Fn.Code.size(); i < size; i++) {
+    const BCInstr &BI = Fn.Code[i];
+    NativeOffsets[i] = E.size();
+
+    auto binary = [&](std::initializer_list<std::uint8_t> Opcode) {
+      E.load32(RAX, RBX, slot(BI.A));
+      E.mem(false, Opcode, RAX, RBX, slot(BI.B));
+      E.store32(RBX, slot(BI.Dst), RAX);
+    };
+    auto divide = [&](unsigned Result) {
+      E.load32(RAX, RBX, slot(BI.A));
+      E.byte(0x99); // cdq
+      E.mem(false, {0xF7}, 7, RBX, slot(BI.B));
+      E.store32(RBX, slot(BI.Dst), Result);
+    };
+    auto shift = [&](unsigned Ext) {
+      E.load32(RCX, RBX, slot(BI.B));
+      E.load32(RAX, RBX, slot(BI.A));
+      E.reg(false, {0xD3}, Ext, RAX);
+      E.store32(RBX, slot(BI.Dst), RAX);
+    };
+    auto logical = [&](std::uint8_t Opcode) {
+      E.mem(false, {0x8A}, RAX, RBX, slot(BI.A));
+      E.mem(false, {Opcode}, RAX, RBX, slot(BI.B));
+      E.store8(RBX, slot(BI.Dst), RAX);
+    };
+    auto compare = [&](CondCode CC, bool isBool) {
+      if (isBool) {
+        E.mem(false, {0x8A}, RAX, RBX, slot(BI.A));
+        E.mem(false, {0x3A}, RAX, RBX, slot(BI.B));
+      } else {
+        E.load32(RAX, RBX, slot(BI.A));
+        E.mem(false, {0x3B}, RAX, RBX, slot(BI.B));
+      }
+      E.setcc(CC, RAX);
+      E.store8(RBX, slot(BI.Dst), RAX);
+    };
+
+    auto immediate = [&](std::uint8_t Opcode) {
+      E.load32(RAX, RBX, slot(BI.A));
+      E.byte(Opcode);
+      E.imm32(BI.B);
+      E.store32(RBX, slot(BI.Dst), RAX);
+    };
+    auto divideImm = [&](unsigned Result) {
+      E.movImm32(RCX, BI.B);
+      E.load32(RAX, RBX, slot(BI.A));
+      E.byte(0x99); // cdq
+      E.reg(false, {0xF7}, 7, RCX);
+      E.store32(RBX, slot(BI.Dst), Result);
+    };
+
+    // The first instruction of a superinstruction is translated on its own,
+    // the rest of the sequence kept its opcodes.
+    switch (BytecodeCompiler::getUnfusedOpcode(BI.Op)) {
+    case BCOpcode::AddI32Imm:
+      immediate(0x05);
+      break;
+    case BCOpcode::SubI32Imm:
+      immediate(0x2D);
+      break;
+    case BCOpcode::MulI32Imm:
+      E.load32(RAX, RBX, slot(BI.A));
+      E.reg(false, {0x69}, RAX, RAX);
+      E.imm32(BI.B);
+      E.store32(RBX, slot(BI.Dst), RAX);
+      break;
+    case BCOpcode::DivI32Imm:
+      divideImm(RAX);
+      break;
+    case BCOpcode::RemI32Imm:
+      divideImm(RDX);
+      break;
+    case BCOpcode::AddI32:
+      binary({0x03});
+      break;
+    case BCOpcode::SubI32:
+      binary({0x2B});
+      break;
+    case BCOpcode::MulI32:
+      binary({0x0F, 0xAF});
+      break;
+    case BCOpcode::XorI32:
+      binary({0x33});
+      break;
+    case BCOpcode::DivI32:
+      divide(RAX);
+      break;
+    case BCOpcode::RemI32:
+      divide(RDX);
+      break;
+    case BCOpcode::ShlI32:
+      shift(4);
+      break;
+    case BCOpcode::ShrI32:
+      shift(7);
+      break;
+    case BCOpcode::AndBool:
+      logical(0x22);
+      break;
+    case BCOpcode::OrBool:
+      logical(0x0A);
+      break;
+    case BCOpcode::XorBool:
+      logical(0x32);
+      break;
+    case BCOpcode::CmpEqI32:
+      compare(CC_E, false);
+      break;
+    case BCOpcode::CmpEqBool:
+      compare(CC_E, true);
+      break;
+    case BCOpcode::CmpNeI32:
+      compare(CC_NE, false);
+      break;
+    case BCOpcode::CmpNeBool:
+      compare(CC_NE, true);
+      break;
+    case BCOpcode::CmpGtI32:
+      compare(CC_G, false);
+      break;
+    case BCOpcode::CmpGeI32:
+      compare(CC_GE, false);
+      break;
+    case BCOpcode::CmpLtI32:
+      compare(CC_L, false);
+      break;
+    case BCOpcode::CmpLeI32:
+      compare(CC_LE, false);
+      break;
+    case BCOpcode::Alloca:
+      E.mov64(RDI, R12);
+      E.movImm32(RSI, BI.A);
+      E.movImm32(RDX, BI.B);
+      E.call(jitAlloca);
+      E.store64(RBX, slot(BI.Dst), RAX);
+      break;
+    // Both int and bool occupy an int in memory.
+    case BCOpcode::LoadI32:
+      E.load64(RAX, RBX, slot(BI.A));
+      E.load32(RAX, RAX, 0);
+      E.store32(RBX, slot(BI.Dst), RAX);
+      break;
+    case BCOpcode::LoadBool:
+      E.load64(RAX, RBX, slot(BI.A));
+      E.mem(false, {0x83}, 7, RAX, 0);
+      E.byte(0);
+      E.setcc(CC_NE, RAX);
+      E.store8(RBX, slot(BI.Dst), RAX);
+      break;
+    case BCOpcode::LoadPtr:
+      E.load64(RAX, RBX, slot(BI.A));
+      E.load64(RAX, RAX, 0);
+      E.store64(RBX, slot(BI.Dst), RAX);
+      break;
+    case BCOpcode::StoreI32:
+      E.load64(RAX, RBX, slot(BI.B));
+      E.load32(RCX, RBX, slot(BI.A));
+      E.store32(RAX, 0, RCX);
+      break;
+    case BCOpcode::StoreBool:
+      E.load64(RAX, RBX, slot(BI.B));
+      E.mem(false, {0x0F, 0xB6}, RCX, RBX, slot(BI.A));
+      E.store32(RAX, 0, RCX);
+      break;
+    case BCOpcode::StorePtr:
+      E.load64(RAX, RBX, slot(BI.B));
+      E.load64(RCX, RBX, slot(BI.A));
+      E.store64(RAX, 0, RCX);
+      break;
+    case BCOpcode::GEP:
+      E.load64(RAX, RBX, slot(BI.A));
+      E.mem(true, {0x63}, RCX, RBX, slot(BI.B));
+      E.bytes({0x48, 0x8D, 0x04, 0x88}); // lea rax, [rax + rcx * 4]
+      E.store64(RBX, slot(BI.Dst), RAX);
+      break;
+    case BCOpcode::Br:
+    case BCOpcode::BrBack:
+      BranchJumps.push_back({E.jmp(), BI.Dst});
+      break;
+    case BCOpcode::CondBr:
+      E.cmpByte(RBX, slot(BI.A), 0);
+      BranchJumps.push_back({E.jcc(CC_NE), BI.Dst});
+      BranchJumps.push_back({E.jmp(), BI.B});
+      break;
+    case BCOpcode::Call: {
+      const unsigned *Args = Fn.CallArgs.data() + BI.B;
+      for (unsigned j = 0, NumArgs = Module.Functions[BI.A].NumArgs;
+           j < NumArgs; j++) {
+        E.load64(RAX, RBX, slot(Args[j]));
+        E.store64(RSP, slot(j), RAX);
+      }
+      E.mov64(RDI, RSP);
+      E.mov64(RSI, R12);
+      E.load64(RAX, R12, CtxFunctions);
+      E.mem(false, {0xFF}, 2, RAX, BI.A * sizeof(void *));
+      // Unwind if the callee stopped the program.
+      E.cmpByte(R12, CtxStop, 0);
+      EpilogueJumps.push_back(E.jcc(CC_NE));
+      if (BI.Dst != BCFunction::NoSlot)
+        E.store64(RBX, slot(BI.Dst), RAX);
+      break;
+    }
+    case BCOpcode::Ret:
+      E.load64(RAX, RBX, slot(BI.A));
+      EpilogueJumps.push_back(E.jmp());
+      break;
+    case BCOpcode::RetVoid:
+      EpilogueJumps.push_back(E.jmp());
+      break;
+    case BCOpcode::Memcpy:
+      E.load64(RDI, RBX, slot(BI.A));
+      E.load64(RSI, RBX, slot(BI.B));
+      E.movImm32(RDX, BI.Dst);
+      E.call(jitMemcpy);
+      break;
+    case BCOpcode::PrintI32:
+      E.load32(RDI, RBX, slot(BI.A));
+      E.call(jitPrintI32);
+      break;
+    case BCOpcode::PrintBool:
+      E.mem(false, {0x0F, 0xB6}, RDI, RBX, slot(BI.A));
+      E.call(jitPrintBool);
+      break;
+    case BCOpcode::Halt:
+      if (!isTopLevel)
+        E.storeImm8(R12, CtxStop, 1);
+      EpilogueJumps.push_back(E.jmp());
+      break;
+    default:
+      return false;
+    }
+  }
+
+  // (3) Epilogue.
+  std::size_t Epilogue = E.size();
+  if (!isTopLevel) {
+    E.store64(RSP, RetOffset, RAX);
+    E.lea(RSI, RSP, MarkOffset);
+    E.mov64(RDI, R12);
+    E.call(jitRelease);
+    E.mem(true, {0xFF}, 1, R12, CtxDepth);
+    E.load64(RAX, RSP, RetOffset);
+  }
+  E.lea(RSP, RBP, -16);
+  E.pop(R12);
+  E.pop(RBX);
+  E.pop(RBP);
+  E.ret();
+
+  // Nothing has been pushed but the callee-saved registers when the overflow
+  // is detected.
+  auto emitOverflow = [&](std::int32_t Flag) {
+    std::size_t Pos = E.size();
+    E.storeImm8(R12, Flag, 1);
+    E.storeImm8(R12, CtxStop, 1);
+    E.bytes({0x31, 0xC0}); // xor eax, eax
+    E.pop(R12);
+    E.pop(RBX);
+    E.pop(RBP);
+    E.ret();
+    return Pos;
+  };
+  if (!isTopLevel) {
+    std::size_t Overflow = emitOverflow(CtxOverflow);
+    for (auto Pos : OverflowJumps)
+      E.patch(Pos, Overflow);
+    std::size_t Exhausted = emitOverflow(CtxStackExhausted);
+    for (auto Pos : ExhaustedJumps)
+      E.patch(Pos, Exhausted);
+  }
+  for (auto Pos : EpilogueJumps)
+    E.patch(Pos, Epilogue);
+  for (auto &Jump : BranchJumps) {
+    if (Jump.second >= NativeOffsets.size())
+      return false;
+    E.patch(Jump.first, NativeOffsets[Jump.second]);
+  }
+  return true;
+}
+
+/// \brief Emit the switch to the native stack. It is called as
+/// Enter(Arg, Ctx, StackTop, Entry) and calls Entry(Arg, Ctx) with the stack
+/// pointer at StackTop.
+void emitEnter(X86Emitter &E) {
+  E.push(RBP);
+  E.mov64(RBP, RSP);
+  E.mov64(RSP, RDX);
+  E.reg(false, {0xFF}, 2, RCX); // call rcx
+  E.mov64(RSP, RBP);
+  E.pop(RBP);
+  E.ret();
+}
+} // namespace
+#endif
+
+bool JITModule::initContext(JITContext &Ctx, GenericValue *Globals,
+                            StackArena &Allocas, std::size_t MaxDepth) {
+#ifdef MOSES_JIT_X86_64
+  if (!Enter) {
+    std::vector<std::uint8_t> Code;
+    X86Emitter E(Code);
+    emitEnter(E);
+    auto Memory = std::make_unique<ExecutableMemory>();
+    if (!Memory->load(Code))
+      return false;
+    Enter = Memory->getBase();
+    Chunks.push_back(std::move(Memory));
+  }
+
+  // The top-level frame and a function frame for every other level of the
+  // call depth, the room for the helpers goes below the deepest frame.
+  if (MaxFrameSize && MaxDepth - 1 > (SIZE_MAX / 4) / MaxFrameSize)
+    return false;
+  std::size_t Size = HelperMargin + 2 * SavedSize + TopLevelFrameSize +
+                     (MaxDepth - 1) * MaxFrameSize;
+  if (!Stack.map(Size))
+    return false;
+
+  Ctx.Globals = Globals;
+  Ctx.Functions = Entries.data();
+  Ctx.Allocas = &Allocas;
+  Ctx.Depth = 1;
+  Ctx.MaxDepth = MaxDepth;
+  Ctx.StackLimit = Stack.getBottom() + HelperMargin;
+  Ctx.Stop = false;
+  Ctx.Overflow = false;
+  Ctx.StackExhausted = false;
+  return true;
+#else
+  (void)Ctx;
+  (void)Globals;
+  (void)Allocas;
+  (void)MaxDepth;
+  return false;
+#endif
+}
+
+std::uint64_t JITModule::enter(void *Entry, void *Arg, JITContext &Ctx) {
+  using EnterTy = std::uint64_t (*)(void *, JITContext *, char *, void *);
+  return reinterpret_cast<EnterTy>(Enter)(Arg, &Ctx, Stack.getTop(), Entry);
+}
+
+bool JITModule::callFunction(JITContext &Ctx, unsigned Index,
+                             const GenericValue *Args, GenericValue &Result) {
+  assert(Entries[Index] && "The function isn't compiled.");
+  std::uint64_t Bits =
+      enter(Entries[Index], const_cast<GenericValue *>(Args), Ctx);
+  std::memcpy(static_cast<void *>(&Result), &Bits, sizeof(Bits));
+  return !Ctx.Stop;
+}
+
+bool JITModule::callOSREntry(JITContext &Ctx, void *Entry, GenericValue *Regs,
+                             GenericValue &Result) {
+  std::uint64_t Bits = enter(Entry, Regs, Ctx);
+  std::memcpy(static_cast<void *>(&Result), &Bits, sizeof(Bits));
+  return !Ctx.Stop;
+}
+
+void JITModule::runTopLevel(JITContext &Ctx) {
+  assert(TopLevelEntry && "The top-level code isn't compiled.");
+  enter(TopLevelEntry, Ctx.Globals, Ctx);
+}
+
+bool JITCompiler::compileClosure(JITModule &Native,
+                                 std::vector<unsigned> Worklist,
+                                 const BCFunction *Root, unsigned Entry,
+                                 void *&RootEntry) {
+#ifdef MOSES_JIT_X86_64
+  // Collect the functions that may be called and aren't compiled yet.
+  std::vector<bool> Visited(Module.Functions.size(), false);
+  std::vector<unsigned> Pending;
+  if (Root)
+    for (auto &BI : Root->Code)
+      if (BI.Op == BCOpcode::Call)
+        Worklist.push_back(BI.A);
+  while (!Worklist.empty()) {
+    unsigned Index = Worklist.back();
+    Worklist.pop_back();
+    if (Visited[Index] || Native.isCompiled(Index))
+      continue;
+    Visited[Index] = true;
+    Pending.push_back(Index);
+    for (auto &BI : Module.Functions[Index].Code)
+      if (BI.Op == BCOpcode::Call)
+        Worklist.push_back(BI.A);
+  }
+
+  std::vector<std::uint8_t> Code;
+  X86Emitter E(Code);
+  std::vector<std::size_t> Offsets;
+  for (auto Index : Pending) {
+    Offsets.push_back(E.size());
+    if (!emitFunction(Module, Module.Functions[Index], 0, false, E))
+      return false;
+  }
+  std::size_t RootOffset = E.size();
+  // A function is only the root of its OSR entry.
+  if (Root &&
+      !emitFunction(Module, *Root, Entry, Root != &Module.TopLevel, E))
+    return false;
+
+  auto Memory = std::make_unique<ExecutableMemory>();
+  if (!Memory->load(Code))
+    return false;
+  for (unsigned i = 0, size = Pending.size(); i < size; i++)
+    Native.Entries[Pending[i]] = Memory->getBase() + Offsets[i];
+  if (Root)
+    RootEntry = Memory->getBase() + RootOffset;
+  Native.Chunks.push_back(std::move(Memory));
+  return true;
+#else
+  (void)Native;
+  (void)Worklist;
+  (void)Root;
+  (void)Entry;
+  (void)RootEntry;
+  return false;
+#endif
+}
+
+bool JITCompiler::compileFunction(JITModule &Native, unsigned Index) {
+  void *RootEntry = nullptr;
+  return compileClosure(Native, {Index}, nullptr, 0, RootEntry);
+}
+
+bool JITCompiler::compileTopLevel(JITModule &Native) {
+  return compileClosure(Native, {}, &Module.TopLevel, 0,
+                        Native.TopLevelEntry);
+}
+
+bool JITCompiler::compileOSREntry(JITModule &Native, const BCFunction &Fn,
+                                  unsigned LoopHeader) {
+  // The function is compiled too, the later calls enter it normally.
+  std::vector<unsigned> Worklist;
+  if (&Fn != &Module.TopLevel)
+    Worklist.push_back(Fn.Index);
+  void *RootEntry = nullptr;
+  if (!compileClosure(Native, Worklist, &Fn, Fn.LoopHeaders[LoopHeader].Offset,
+                      RootEntry))
+    return false;
+  Native.OSREntries[{Fn.Index, LoopHeader}] = RootEntry;
+  return true;
+}
+
+std::unique_ptr<JITModule> JITCompiler::compile() {
+  if (!isSupported())
+    return nullptr;
+  auto Native = std::make_unique<JITModule>(Module);
+  if (!compileTopLevel(*Native))
+    return nullptr;
+  return Native;
+}
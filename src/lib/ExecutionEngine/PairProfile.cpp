@@ -0,0 +1,40 @@
+//===----------------------------PairProfile.cpp--------------------------===//
+//
+// Implements the PairProfile class.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/PairProfile.h"
+#include <algorithm>
+#include <string>
+#include <tuple>
+
+using namespace Execution;
+
+bool PairProfile::merge(std::istream &In) {
+  std::uint64_t Count;
+  std::string First, Second;
+  while (In >> Count >> First >> Second) {
+    BCOpcode FirstOp, SecondOp;
+    if (!getOpcodeByName(First, FirstOp) || !getOpcodeByName(Second, SecondOp))
+      return false;
+    Counts[static_cast<unsigned>(FirstOp) * NumOpcodes +
+           static_cast<unsigned>(SecondOp)] += Count;
+  }
+  return In.eof();
+}
+
+void PairProfile::write(std::ostream &Out) const {
+  std::vector<std::tuple<std::uint64_t, unsigned, unsigned>> Pairs;
+  for (unsigned i = 0; i < NumOpcodes; i++)
+    for (unsigned j = 0; j < NumOpcodes; j++)
+      if (std::uint64_t Count = Counts[i * NumOpcodes + j])
+        Pairs.emplace_back(Count, i, j);
+
+  std::stable_sort(Pairs.begin(), Pairs.end(), [](const auto &LHS, const auto &RHS) {
+    return std::get<0>(LHS) > std::get<0>(RHS);
+  });
+  for (auto &Pair : Pairs)
+    Out << std::get<0>(Pair) << " "
+        << getOpcodeName(static_cast<BCOpcode>(std::get<1>(Pair))) << " "
+        << getOpcodeName(static_cast<BCOpcode>(std::get<2>(Pair))) << "\n";
+}
@@ -0,0 +1,213 @@
+//===-----------------------------Profiler.cpp----------------------------===//
+//
+// Implements the Profiler class.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <tuple>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace Execution;
+
+Profiler::Profiler(const BCModule &Module) {
+  for (auto &Fn : Module.Functions)
+    Functions.push_back(&Fn);
+  Functions.push_back(&Module.TopLevel);
+  initCounters();
+}
+
+Profiler::Profiler(const std::list<std::shared_ptr<Value>> &Insts) {
+  std::vector<Function *> IRFuncs;
+  std::vector<BasicBlock *> TopLevelBBs;
+  for (auto &val : Insts) {
+    if (auto F = std::dynamic_pointer_cast<Function>(val))
+      IRFuncs.push_back(F.get());
+    else if (auto BB = std::dynamic_pointer_cast<BasicBlock>(val))
+      TopLevelBBs.push_back(BB.get());
+  }
+
+  // The top-level code comes last, as in the bytecode.
+  IRFunctions.resize(IRFuncs.size() + 1);
+  for (unsigned i = 0, size = IRFunctions.size(); i < size; i++) {
+    BCFunction &Fn = IRFunctions[i];
+    Fn.Index = i;
+    if (i < IRFuncs.size()) {
+      Fn.F = IRFuncs[i];
+      IRFunctionIndex[Fn.F] = i;
+      for (auto &BB : IRFuncs[i]->getBasicBlockList())
+        addIRBlock(Fn, BB.get());
+    } else {
+      for (auto BB : TopLevelBBs)
+        addIRBlock(Fn, BB);
+    }
+    Functions.push_back(&Fn);
+  }
+  initCounters();
+}
+
+void Profiler::initCounters() {
+  Times.assign(Functions.size(), {0, 0, 0, 0});
+  for (auto Fn : Functions)
+    InstCounts.emplace_back(Fn->Sources.size(), 0);
+}
+
+void Profiler::addIRBlock(BCFunction &Fn, BasicBlock *BB) {
+  Fn.Blocks.push_back({static_cast<unsigned>(Fn.Sources.size()), BB});
+  for (auto &I : BB->getInstList()) {
+    IRPositions[I.get()] = {Fn.Index, static_cast<unsigned>(Fn.Sources.size())};
+    Fn.Sources.push_back(I.get());
+  }
+}
+
+std::uint64_t Profiler::readCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+std::string Profiler::getFunctionName(unsigned Index) const {
+  const BCFunction &Fn = getFunction(Index);
+  return Fn.F ? Fn.F->getName() : "<top-level>";
+}
+
+void Profiler::enterFunction(unsigned Index) {
+  auto &Children =
+      Frames.empty() ? Roots : Contexts[Frames.back().Context].Children;
+  auto Iter = Children.find(Index);
+  unsigned Context;
+  if (Iter != Children.end()) {
+    Context = Iter->second;
+  } else {
+    Context = Contexts.size();
+    Children[Index] = Context;
+    Contexts.push_back(
+        {Index, Frames.empty() ? NoContext : Frames.back().Context, 0, {}});
+  }
+
+  ++Times[Index].Calls;
+  ++Times[Index].Active;
+  Frames.push_back({Index, Context, readCycleCounter(), 0});
+}
+
+void Profiler::exitFunction() {
+  assert(!Frames.empty() && "Exit from an empty profile stack.");
+  ActiveFrame Frame = Frames.back();
+  Frames.pop_back();
+
+  std::uint64_t Elapsed = readCycleCounter() - Frame.Start;
+  std::uint64_t Exclusive =
+      Elapsed > Frame.Children ? Elapsed - Frame.Children : 0;
+  FunctionTimes &FT = Times[Frame.Function];
+  FT.Exclusive += Exclusive;
+  if (--FT.Active == 0)
+    FT.Inclusive += Elapsed;
+  Contexts[Frame.Context].Exclusive += Exclusive;
+  if (!Frames.empty())
+    Frames.back().Children += Elapsed;
+}
+
+void Profiler::finish() {
+  while (!Frames.empty())
+    exitFunction();
+}
+
+void Profiler::writeReport(std::ostream &Out) const {
+  // (1) Functions, by exclusive cycles.
+  std::vector<unsigned> Functions(Times.size());
+  for (unsigned i = 0, size = Times.size(); i < size; i++)
+    Functions[i] = i;
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [this](unsigned LHS, unsigned RHS) {
+                     return Times[LHS].Exclusive > Times[RHS].Exclusive;
+                   });
+  Out << "functions:\n";
+  Out << std::setw(12) << "calls" << std::setw(16) << "inclusive"
+      << std::setw(16) << "exclusive"
+      << "  name\n";
+  for (auto Index : Functions) {
+    const FunctionTimes &FT = Times[Index];
+    if (FT.Calls == 0)
+      continue;
+    Out << std::setw(12) << FT.Calls << std::setw(16) << FT.Inclusive
+        << std::setw(16) << FT.Exclusive << "  " << getFunctionName(Index)
+        << "\n";
+  }
+
+  // (2) Basic blocks, by execution count.
+  std::vector<std::tuple<std::uint64_t, unsigned, const BasicBlock *>> Blocks;
+  for (unsigned i = 0, size = InstCounts.size(); i < size; i++)
+    for (auto &Block : getFunction(i).Blocks)
+      if (Block.Offset < InstCounts[i].size() && InstCounts[i][Block.Offset])
+        Blocks.emplace_back(InstCounts[i][Block.Offset], i, Block.BB);
+  std::stable_sort(Blocks.begin(), Blocks.end(),
+                   [](const auto &LHS, const auto &RHS) {
+                     return std::get<0>(LHS) > std::get<0>(RHS);
+                   });
+  Out << "\nbasic blocks:\n";
+  Out << std::setw(12) << "count"
+      << "  function: block\n";
+  for (auto &Block : Blocks)
+    Out << std::setw(12) << std::get<0>(Block) << "  "
+        << getFunctionName(std::get<1>(Block)) << ": "
+        << std::get<2>(Block)->getName() << "\n";
+
+  // (3) Instructions, by execution count.
+  std::vector<std::tuple<std::uint64_t, unsigned, unsigned>> Insts;
+  for (unsigned i = 0, size = InstCounts.size(); i < size; i++)
+    for (unsigned j = 0, e = InstCounts[i].size(); j < e; j++)
+      if (InstCounts[i][j])
+        Insts.emplace_back(InstCounts[i][j], i, j);
+  std::stable_sort(Insts.begin(), Insts.end(),
+                   [](const auto &LHS, const auto &RHS) {
+                     return std::get<0>(LHS) > std::get<0>(RHS);
+                   });
+  Out << "\ninstructions:\n";
+  Out << std::setw(12) << "count"
+      << "  function: instruction\n";
+  for (auto &Inst : Insts) {
+    const BCFunction &Fn = getFunction(std::get<1>(Inst));
+    const Instruction *I = Fn.Sources[std::get<2>(Inst)];
+    // Only the bytecode tier has instructions without an IR instruction.
+    std::string Text;
+    if (I) {
+      std::ostringstream IROut;
+      const_cast<Instruction *>(I)->Print(IROut);
+      Text = IROut.str();
+      while (!Text.empty() && (Text.back() == '\n' || Text.back() == ' '))
+        Text.pop_back();
+    } else {
+      Text = getOpcodeName(Fn.Code[std::get<2>(Inst)].Op);
+    }
+    Out << std::setw(12) << std::get<0>(Inst) << "  "
+        << getFunctionName(std::get<1>(Inst)) << ": " << Text << "\n";
+  }
+}
+
+void Profiler::writeFoldedStacks(std::ostream &Out, unsigned Context,
+                                 const std::string &Prefix) const {
+  const ContextNode &Node = Contexts[Context];
+  std::string Path = Prefix.empty()
+                         ? getFunctionName(Node.Function)
+                         : Prefix + ";" + getFunctionName(Node.Function);
+  if (Node.Exclusive)
+    Out << Path << " " << Node.Exclusive << "\n";
+  for (auto &Child : Node.Children)
+    writeFoldedStacks(Out, Child.second, Path);
+}
+
+void Profiler::writeFoldedStacks(std::ostream &Out) const {
+  for (auto &Root : Roots)
+    writeFoldedStacks(Out, Root.second, "");
+}
@@ -0,0 +1,39 @@
+//===----------------------------StackArena.cpp---------------------------===//
+//
+// Implements the class StackArena.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/StackArena.h"
+#include <cstdint>
+
+using namespace Execution;
+
+StackArena::StackArena(std::size_t InitialSize) : CurChunk(0) {
+  Chunks.push_back({std::make_unique<char[]>(InitialSize), InitialSize});
+  Cur = Chunks[0].Memory.get();
+  End = Cur + InitialSize;
+}
+
+char *StackArena::alignPtr(char *Ptr, std::size_t Align) {
+  auto Addr = reinterpret_cast<std::uintptr_t>(Ptr);
+  return Ptr + ((Align - (Addr & (Align - 1))) & (Align - 1));
+}
+
+/// \brief Move to the next chunk that is large enough, chunks released by
+/// popped frames are reused before a new one is allocated.
+char *StackArena::grow(std::size_t Size, std::size_t Align) {
+  std::size_t Needed = Size + Align;
+  unsigned Next = CurChunk + 1;
+  while (Next < Chunks.size() && Chunks[Next].Size < Needed)
+    Next++;
+  if (Next == Chunks.size()) {
+    std::size_t NewSize = Chunks.back().Size * 2;
+    if (NewSize < Needed)
+      NewSize = Needed;
+    Chunks.push_back({std::make_unique<char[]>(NewSize), NewSize});
+  }
+  CurChunk = Next;
+  Cur = Chunks[Next].Memory.get();
+  End = Cur + Chunks[Next].Size;
+  return alignPtr(Cur, Align);
+}
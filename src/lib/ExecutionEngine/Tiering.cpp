@@ -0,0 +1,79 @@
+//===------------------------------Tiering.cpp----------------------------===//
+//
+// Implements the TierProfile class.
+//
+//===---------------------------------------------------------------------===//
+#include "ExecutionEngine/Tiering.h"
+#include "ExecutionEngine/JIT.h"
+#include <iomanip>
+
+using namespace Execution;
+
+TierProfile::TierProfile(const BCModule &Module, std::uint64_t Threshold)
+    : Module(Module), Threshold(Threshold),
+      CallCounts(Module.Functions.size(), 0),
+      Start(std::chrono::steady_clock::now()) {
+  for (auto &Fn : Module.Functions)
+    BackEdgeCounts.emplace_back(Fn.LoopHeaders.size(), 0);
+  BackEdgeCounts.emplace_back(Module.TopLevel.LoopHeaders.size(), 0);
+}
+
+double TierProfile::getTimeMs() const {
+  std::chrono::duration<double, std::milli> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  return Elapsed.count();
+}
+
+static std::string getFunctionName(const BCFunction &Fn) {
+  return Fn.F ? Fn.F->getName() : "<top-level>";
+}
+
+static std::string getHeaderName(const BCFunction &Fn, unsigned Header) {
+  const BasicBlock *BB = Fn.LoopHeaders[Header].BB;
+  return BB ? BB->getName() : "<unnamed>";
+}
+
+void TierProfile::dump(std::ostream &Out, const JITModule *Native) const {
+  Out << "tier-up threshold: " << Threshold << "\n";
+  Out << std::fixed << std::setprecision(3);
+
+  Out << "promotions:\n";
+  if (Events.empty())
+    Out << "  none\n";
+  for (auto &Event : Events) {
+    const BCFunction &Fn = getFunction(Event.Function);
+    Out << "  " << std::setw(10) << Event.TimeMs << " ms  "
+        << getFunctionName(Fn) << ": ";
+    switch (Event.Kind) {
+    case TierEvent::CallCount:
+      Out << Threshold << " calls";
+      break;
+    case TierEvent::OnStackReplacement:
+      Out << Threshold << " back-edges to "
+          << getHeaderName(Fn, Event.LoopHeader) << ", OSR";
+      break;
+    }
+    if (Event.Succeeded)
+      Out << ", compiled in " << Event.CompileMs << " ms\n";
+    else
+      Out << ", compilation failed\n";
+  }
+
+  Out << "functions:\n";
+  for (unsigned i = 0, size = BackEdgeCounts.size(); i < size; i++) {
+    const BCFunction &Fn = getFunction(i);
+    bool isNative = Native && i < Module.Functions.size() &&
+                    Native->isCompiled(i);
+    Out << "  " << getFunctionName(Fn) << ": ";
+    if (i < Module.Functions.size())
+      Out << CallCounts[i] << " interpreted calls, ";
+    Out << (isNative ? "native" : "bytecode") << "\n";
+    for (unsigned j = 0, e = BackEdgeCounts[i].size(); j < e; j++) {
+      Out << "    loop " << getHeaderName(Fn, j) << ": "
+          << BackEdgeCounts[i][j] << " interpreted back-edges";
+      if (Native && Native->getOSREntry(i, j))
+        Out << ", OSR entry";
+      Out << "\n";
+    }
+  }
+}
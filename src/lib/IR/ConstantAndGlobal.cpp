@@ -17,6 +17,14 @@ GlobalValue::GlobalValue(TyPtr Ty, ValueTy vty, const std::string &name)
 ConstantBool::ConstantBool(MosesIRContext &Ctx, bool val)
     : ConstantIntegral(Ctx.getBoolTy()), Val(val) {}
 
+std::shared_ptr<ConstantBool> ConstantBool::getTrue(MosesIRContext &Ctx) {
+  return Ctx.getTrue();
+}
+
+std::shared_ptr<ConstantBool> ConstantBool::getFalse(MosesIRContext &Ctx) {
+  return Ctx.getFalse();
+}
+
 void ConstantBool::Print(std::ostringstream &out) {
   if (Val)
     out << " true";
@@ -29,6 +37,22 @@ void ConstantBool::Print(std::ostringstream &out) {
 ConstantInt::ConstantInt(MosesIRContext &Ctx, int val)
     : ConstantIntegral(Ctx.getIntTy()), Val(val) {}
 
+std::shared_ptr<ConstantInt> ConstantInt::get(MosesIRContext &Ctx, int value) {
+  return Ctx.getConstantInt(value);
+}
+
+const std::string &ConstantInt::getName() const {
+  // Most constants are never printed, the name is only spelled out for the
+  // ones that are.
+  if (Name.empty())
+    const_cast<ConstantInt *>(this)->Name = std::to_string(Val);
+  return Name;
+}
+
+void ConstantInt::setName([[maybe_unused]] const std::string &name) {
+  assert(name == getName() && "A ConstantInt is named by its value!");
+}
+
 void ConstantInt::Print(std::ostringstream &out) {
   out << " " << std::to_string(Val);
 }
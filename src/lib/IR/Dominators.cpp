@@ -9,6 +9,7 @@
 //
 //===---------------------------------------------------------------------===//
 #include "IR/Dominators.h"
+#include "Support/Trace.h"
 using namespace IR;
 using color = DomTreeNode::color;
 
@@ -38,8 +39,8 @@ void DominatorTree::printDomFrontier(std::ostream &out) const {
     out << std::endl;
   }
 
-  std::cout << "---------------------------------------------------------------"
-               "-----------------\n";
+  out << "---------------------------------------------------------------"
+         "-----------------\n";
 }
 
 void DominatorTree::runOnCFG(std::vector<std::shared_ptr<BasicBlock>> &BBs) {
@@ -72,7 +73,10 @@ void DominatorTree::computeDomTree(std::shared_ptr<BasicBlock> EntryBlock) {
   Calcuate();
 
   // (4) print
-  printIDoms(std::cout);
+  if (Trace::isEnabled(Trace::Channel::DomTree, Trace::Level::Info)) {
+    Trace::Message IDoms(Trace::Channel::DomTree, Trace::Level::Info);
+    printIDoms(IDoms.stream());
+  }
 }
 
 // DFS() - We will get post-order and reverse post-order of CFG through
@@ -251,12 +255,18 @@ void DominatorTree::ComputeDomFrontierOnCFG(std::vector<std::shared_ptr<BasicBlo
     runOnCFG(BBs);
   ComputeDomFrontier();
 
-  printDomFrontier(std::cout);
+  if (Trace::isEnabled(Trace::Channel::DomTree, Trace::Level::Info)) {
+    Trace::Message DF(Trace::Channel::DomTree, Trace::Level::Info);
+    printDomFrontier(DF.stream());
+  }
 }
 void DominatorTree::ComputeDomFrontierOnFunction(std::shared_ptr<Function> F) {
   if (RootNode->getIDom() == nullptr)
     runOnFunction(F);
   ComputeDomFrontier();
 
-  printDomFrontier(std::cout);
+  if (Trace::isEnabled(Trace::Channel::DomTree, Trace::Level::Info)) {
+    Trace::Message DF(Trace::Channel::DomTree, Trace::Level::Info);
+    printDomFrontier(DF.stream());
+  }
 }
@@ -31,6 +31,19 @@ unsigned Type::getSize() const {
   return 0;
 }
 
+unsigned Type::getAlignment() const {
+  switch (ID) {
+  case Type::TypeID::IntegerTy:
+  case Type::TypeID::BoolTy:
+    return alignof(int);
+  case Type::TypeID::PointerTy:
+    return alignof(void *);
+  default:
+    break;
+  }
+  return 1;
+}
+
 /// \brief Print the Type info, i32 bool void and so on.
 void Type::Print(std::ostringstream &out) {
   switch (ID) {
@@ -240,6 +253,8 @@ void StructType::PrintCompleteInfo(std::ostringstream &out) {
 
 void StructType::Print(std::ostringstream &out) { out << " " << Name; }
 
+std::string StructType::getName() const { return Name; }
+
 void StructType::setName(std::string Name) { this->Name = Name; }
 
 unsigned StructType::getSize() const {
@@ -250,6 +265,15 @@ unsigned StructType::getSize() const {
   return sum;
 }
 
+unsigned StructType::getAlignment() const {
+  unsigned Align = 1;
+  for (auto item : ContainedTys) {
+    if (item->getAlignment() > Align)
+      Align = item->getAlignment();
+  }
+  return Align;
+}
+
 //===---------------------------------------------------------------------===//
 // Implements the PointerType.
 PointerType::PointerType(IRTyPtr Ty) : Type(TypeID::PointerTy) {
@@ -12,4 +12,10 @@ IRTyPtr Type::getLabelType(MosesIRContext &Ctx) { return Ctx.getLabelTy(); }
 
 IRTyPtr Type::getIntType(MosesIRContext &Ctx) { return Ctx.getIntTy(); }
 
-IRTyPtr Type::getBoolType(MosesIRContext &Ctx) { return Ctx.getBoolTy(); }
\ No newline at end of file
+IRTyPtr Type::getBoolType(MosesIRContext &Ctx) { return Ctx.getBoolTy(); }
+
+std::shared_ptr<ConstantInt> MosesIRContext::getConstantInt(int Val) {
+  if (auto CI = IntConstants.lookup(ConstantIntKeyInfo::KeyTy(IntTy, Val)))
+    return CI;
+  return IntConstants.insert(std::make_shared<ConstantInt>(*this, Val));
+}
\ No newline at end of file
@@ -36,9 +36,17 @@ void Value::replaceAllUsesWith(std::shared_ptr<Value> NewV) {
   Uses.clear();
 }
 
-void Value::addUse(Use &U) { Uses.push_back(&U); }
+// The constants are uniqued and used all over the module, nothing walks their
+// uses, and a use list that long would make every killUse a long search.
+void Value::addUse(Use &U) {
+  if (VTy != ValueTy::ConstantVal)
+    Uses.push_back(&U);
+}
 
-void Value::killUse(Use &U) { Uses.remove(&U); }
+void Value::killUse(Use &U) {
+  if (VTy != ValueTy::ConstantVal)
+    Uses.remove(&U);
+}
 
 Value::~Value() {
   // Tell the Users, this value is gone,
@@ -124,7 +124,7 @@ void ModuleBuilder::EmitFunctionPrologue(CGFuncInfoConstPtr FunInfo,
   ASTToIRMapping IRFunctionArgs(*FunInfo);
   for (unsigned i = 0; i < FunInfo->getArgNums(); i++) {
     auto ArgInfo = FunInfo->getArgABIInfo(i);
-    auto Arg = CurFunc->CurFuncDecl->getParmDecl(i).get();
+    auto Arg = CurFunc->CurFuncDecl->getParmDecl(i);
     unsigned FirstIRArg, NumIRArgs;
     std::tie(FirstIRArg, NumIRArgs) =
         IRFunctionArgs.getIRArgs(isSRet ? i + 1 : i);
@@ -246,7 +246,7 @@ void ModuleBuilder::CreateCoercedStore(std::shared_ptr<Value> Src,
 /// \brief EmitCall - Emit code for CallExpr.
 RValue ModuleBuilder::EmitCall(const FunctionDecl *FD,
                                std::shared_ptr<Value> FuncAddr,
-                               const std::vector<ExprASTPtr> &ArgExprs) {
+                               std::span<const ExprASTPtr> ArgExprs) {
   CallArgList Args;
   // (1) EmitCallArgs().
   EmitCallArgs(Args, ArgExprs);
@@ -338,16 +338,16 @@ RValue ModuleBuilder::EmitCall(const FunctionDecl *FD,
 
 // EmitCallArgs - Emit call arguments for a function.
 void ModuleBuilder::EmitCallArgs(CallArgList &CallArgs,
-                                 const std::vector<ExprASTPtr> &ArgExprs) {
+                                 std::span<const ExprASTPtr> ArgExprs) {
   std::shared_ptr<Value> V = nullptr;
   for (auto item : ArgExprs) {
     auto ty = Types.ConvertType(item->getType());
     if (ty->isAggregateType()) {
       auto AggTemp = CreateAlloca(ty, getCurLocalName("agg.tmp"));
-      EmitAggExpr(item.get(), AggTemp);
+      EmitAggExpr(item, AggTemp);
       V = AggTemp;
     } else {
-      V = EmitScalarExpr(item.get());
+      V = EmitScalarExpr(item);
     }
     CallArgs.push_back({RValue::get(V), item->getType()});
   }
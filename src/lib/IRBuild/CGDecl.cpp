@@ -24,9 +24,9 @@ void ModuleBuilder::EmitLocalVarDecl(const VarDecl *var) {
   if (auto init = var->getInitExpr()) {
     auto ty = Types.ConvertType(init->getType());
     if (ty->isAggregateType()) {
-      EmitAggExpr(init.get(), DeclPtr);
+      EmitAggExpr(init, DeclPtr);
     } else {
-      std::shared_ptr<Value> V = EmitScalarExpr(init.get());
+      std::shared_ptr<Value> V = EmitScalarExpr(init);
       EmitStoreOfScalar(V, DeclPtr);
     }
   }
@@ -40,9 +40,7 @@ std::shared_ptr<AllocaInst>  ModuleBuilder::EmitLocalVarAlloca(const VarDecl *va
   std::shared_ptr<AllocaInst>  allocInst =
       CreateAlloca(IRTy, LocalInstNamePrefix + var->getName() + ".addr");
 
-  if (std::shared_ptr<VariableSymbol> varSym =
-          std::dynamic_pointer_cast<VariableSymbol>(
-              CurScope->Resolve(var->getName()))) {
+  if (auto varSym = dynamic_cast<VariableSymbol *>(var->getSymbol())) {
     assert(!varSym->getAllocaInst() && "Decl's alloca inst already exists.");
     varSym->setAllocaInst(allocInst);
   }
@@ -77,10 +75,9 @@ void ModuleBuilder::EmitParmDecl(const VarDecl *VD, std::shared_ptr<Value> Arg)
   Arg->setName(Name);
 
   // (1) Get the ParmDecl's SymbolTable Entry.
-  auto SymEntry = CurScope->Resolve(VD->getName());
+  Symbol *SymEntry = VD->getSymbol();
   assert(SymEntry != nullptr && "Parameter declaration doesn't exists.");
-  if (std::shared_ptr<ParmDeclSymbol> sym =
-          std::dynamic_pointer_cast<ParmDeclSymbol>(SymEntry)) {
+  if (auto sym = dynamic_cast<ParmDeclSymbol *>(SymEntry)) {
     assert((sym->getAllocaInst() == nullptr) &&
            "Symbol's alloca instruciton already exists.");
     sym->setAllocaInst(DeclPtr);
@@ -114,13 +111,11 @@ void ModuleBuilder::EmitFunctionDecl(const FunctionDecl *FD) {
   //            {
   //              ...
   //            }
-  auto Sym = CurScope->Resolve(FD->getFDName());
-  assert(Sym != nullptr && "Funciton symbol can't be null.");
-  std::shared_ptr<FunctionSymbol> FuncSym =
-      std::dynamic_pointer_cast<FunctionSymbol>(Sym);
+  FunctionSymbol *FuncSym = FD->getSymbol();
   assert(FuncSym != nullptr && "Funciton symbol can't be null.");
   FuncSym->setFuncAddr(func);
-  CurScope = FuncSym->getScope();
+  Scope *OldScope = CurScope;
+  CurScope = FuncSym->getScope().get();
 
   StartFunction(FI, func);
 
@@ -132,7 +127,7 @@ void ModuleBuilder::EmitFunctionDecl(const FunctionDecl *FD) {
   CurFunc->CurFn = nullptr;
 
   // (4) Switch the scope back.
-  CurScope = CurScope->getParent();
+  CurScope = OldScope;
 }
 
 /// \brief Handle the start of function.
@@ -175,8 +170,7 @@ std::shared_ptr<Value> ModuleBuilder::visit(const FunctionDecl *FD) {
   //            {
   //              ...
   //            }
-  auto FunSym = CurScope->Resolve(FD->getFDName());
-  assert(FunSym != nullptr && "Function doesn't exists.");
+  assert(FD->getSymbol() != nullptr && "Function doesn't exists.");
   SaveTopLevelCtxInfo();
 
   // (2) Emit code for function.
@@ -11,7 +11,7 @@ extern void print(std::shared_ptr<IR::Value> V);
 void ModuleBuilder::EmitBranchOnBoolExpr(
     ExprASTPtr Cond, std::shared_ptr<BasicBlock> TrueBlock,
     std::shared_ptr<BasicBlock> FalseBlock) {
-  if (BinaryPtr CondBOp = std::dynamic_pointer_cast<BinaryExpr>(Cond)) {
+  if (BinaryPtr CondBOp = dynamic_cast<BinaryExpr *>(Cond)) {
     // Handle X && Y in a conditon.
     if (CondBOp->getOpcode() == "&&") {
       // If we have "true && X", simplify the code. "0 && X" would have constant
@@ -74,7 +74,7 @@ void ModuleBuilder::EmitBranchOnBoolExpr(
   }
 
   // Deal with the situation of br(!X).
-  if (UnaryPtr CondUOp = std::dynamic_pointer_cast<UnaryExpr>(Cond)) {
+  if (UnaryPtr CondUOp = dynamic_cast<UnaryExpr *>(Cond)) {
     if (CondUOp->getOpcode() == "!")
       return EmitBranchOnBoolExpr(CondUOp->getSubExpr(), FalseBlock, TrueBlock);
   }
@@ -141,12 +141,12 @@ ModuleBuilder::EmitAlgAndBooleanOp(const CGExpr::BinOpInfo &BInfo) {
 ///i32* %num | | store i32 %tmp, i32* %mem	|
 ///									-----------------------------
 std::shared_ptr<Value> ModuleBuilder::EmitBinAssignOp(const BinaryExpr *B) {
-  LValue LHSAddr = EmitLValue(B->getLHS().get());
+  LValue LHSAddr = EmitLValue(B->getLHS());
 
   // Aggregate
   auto ty = Types.ConvertType(B->getType());
   if (ty->isAggregateType()) {
-    EmitAggExpr(B->getRHS().get(), LHSAddr.getAddress());
+    EmitAggExpr(B->getRHS(), LHSAddr.getAddress());
     return LHSAddr.getAddress();
   } else {
     std::shared_ptr<Value> RHSV = B->getRHS()->Accept(this);
@@ -177,7 +177,7 @@ ModuleBuilder::EmitCompoundAssignOp(const BinaryExpr *BE) {
   std::shared_ptr<Value> RHSV = BE->getRHS()->Accept(this);
 
   // (2) Load the LHS.
-  LValue LHSLV = EmitLValue(BE->getLHS().get());
+  LValue LHSLV = EmitLValue(BE->getLHS());
   std::shared_ptr<Value> LHSV = EmitLoadOfLValue(LHSLV).getScalarVal();
 
   // (3) Perform the operation.
@@ -245,17 +245,14 @@ LValue ModuleBuilder::EmitLValue(const Expr *E) {
 /// \brief Get the decl address(Alloca Inst).
 LValue ModuleBuilder::EmitDeclRefLValue(const DeclRefExpr *DRE) {
   // DeclRefExpr is still very simple. --- 2016-7-5
-  std::string DeclName = DRE->getDeclName();
-  auto Sym = CurScope->Resolve(DeclName);
+  Symbol *Sym = DRE->getDecl()->getSymbol();
   assert(Sym && "No alloca instruciton created for the decl?");
-  if (std::shared_ptr<VariableSymbol> VarSym =
-          std::dynamic_pointer_cast<VariableSymbol>(Sym)) {
+  if (auto VarSym = dynamic_cast<VariableSymbol *>(Sym)) {
     auto Alloca = VarSym->getAllocaInst();
     assert(Alloca && "No alloca instruciton created for the VarDecl?");
     return LValue::MakeAddr(Alloca);
   }
-  if (std::shared_ptr<ParmDeclSymbol> ParmSym =
-          std::dynamic_pointer_cast<ParmDeclSymbol>(Sym)) {
+  if (auto ParmSym = dynamic_cast<ParmDeclSymbol *>(Sym)) {
     auto Alloca = ParmSym->getAllocaInst();
     assert(Alloca && "No alloca instruciton created for the ParmDecl?");
     return LValue::MakeAddr(Alloca);
@@ -265,9 +262,8 @@ LValue ModuleBuilder::EmitDeclRefLValue(const DeclRefExpr *DRE) {
 }
 
 LValue ModuleBuilder::EmitMemberExprLValue(const MemberExpr *ME) {
-  auto base = ME->getBase();
   // (1) Get the base address.
-  LValue BaseLValue = EmitLValue(ME->getBase().get());
+  LValue BaseLValue = EmitLValue(ME->getBase());
 
   // (2) According to specified member to get the offset.
   // e.g.	class B { var num : int; var mem : int; };
@@ -357,7 +353,7 @@ ModuleBuilder::EmitPrePostIncDec(const UnaryExpr *UE, bool isInc, bool isPre) {
   int AmoutVal = isInc ? 1 : -1;
   std::shared_ptr<Value> NextVal;
   // (1) Get the sub expression's address.
-  LValue LV = EmitLValue(UE->getSubExpr().get());
+  LValue LV = EmitLValue(UE->getSubExpr());
   std::shared_ptr<ASTType> ValTy = UE->getSubExpr()->getType();
 
   // (2) Get the sub expression's value.
@@ -365,7 +361,6 @@ ModuleBuilder::EmitPrePostIncDec(const UnaryExpr *UE, bool isInc, bool isPre) {
 
   // (3) Perform the operationn.
   NextVal = ConstantInt::get(Context, AmoutVal);
-  NextVal->setName(std::to_string(AmoutVal));
   NextVal = CreateAdd(InVal, NextVal, getCurLocalName(isInc ? "inc" : "dec"));
 
   // (4) Save the ResultValue.
@@ -394,10 +389,7 @@ RValue ModuleBuilder::EmitCallExpr(const CallExpr *CE) {
   // Get the funciton decl's address.
   auto FD = CE->getFuncDecl();
 
-  auto Sym = SymbolTree->Resolve(FD->getFDName());
-  assert(Sym && "function decl symbol doesn't exists.");
-  std::shared_ptr<FunctionSymbol> FuncSym =
-      std::dynamic_pointer_cast<FunctionSymbol>(Sym);
+  FunctionSymbol *FuncSym = CE->getCalleeSymbol();
   assert(FuncSym && "function decl symbol doesn't exists.");
 
   auto CalleeAddr = FuncSym->getFuncAddr();
@@ -410,12 +402,12 @@ RValue ModuleBuilder::EmitCallExpr(const CallExpr *CE) {
 
     // generate function info.
     std::shared_ptr<CGFunctionInfo const> FI =
-        Types.arrangeFunctionInfo(FD.get());
+        Types.arrangeFunctionInfo(FD);
 
-    auto TypeAndName = Types.getFunctionType(FD.get(), FI);
+    auto TypeAndName = Types.getFunctionType(FD, FI);
 
     CurFunc->CGFnInfo = FI;
-    CurFunc->CurFuncDecl = const_cast<FunctionDecl *>(FD.get());
+    CurFunc->CurFuncDecl = const_cast<FunctionDecl *>(FD);
     CurFunc->FnRetTy = Types.ConvertType(FD->getReturnType());
     CalleeAddr = Function::create(TypeAndName.first, FD->getFDName(),
                                   TypeAndName.second);
@@ -423,7 +415,7 @@ RValue ModuleBuilder::EmitCallExpr(const CallExpr *CE) {
     FuncSym->setFuncAddr(CalleeAddr);
   }
 
-  return EmitCall(FD.get(), CalleeAddr, CE->getArgs());
+  return EmitCall(FD, CalleeAddr, CE->getArgs());
 }
 
 /// \brief visit(const BinaryExpr*) - Generate code for BinaryExpr.
@@ -447,9 +439,7 @@ std::shared_ptr<Value> ModuleBuilder::visit(const BoolLiteral *BL) {
 }
 
 std::shared_ptr<Value> ModuleBuilder::visit(const NumberExpr *NE) {
-  auto CInt = ConstantInt::get(Context, NE->getVal());
-  CInt->setName(std::to_string(NE->getVal()));
-  return CInt;
+  return ConstantInt::get(Context, NE->getVal());
 }
 
 /// \brief Generate the code for UnaryExpr, include ''
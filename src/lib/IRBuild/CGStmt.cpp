@@ -192,18 +192,8 @@ std::shared_ptr<Value> ModuleBuilder::visit(const WhileStatement *WS) {
 /// \brief Dispatched the task to the children.
 std::shared_ptr<Value> ModuleBuilder::visit(const CompoundStmt *comstmt) {
   // (1) Switch the scope.
-  auto symTab = CurScope->getSymbolTable();
-  auto num = symTab.size();
-  for (unsigned i = 0; i < num; i++) {
-    if (std::shared_ptr<ScopeSymbol> scope =
-            std::dynamic_pointer_cast<ScopeSymbol>(symTab[i])) {
-      if (scope->isVisitedForIRGen())
-        continue;
-      CurScope = scope->getScope();
-      break;
-    }
-    continue;
-  }
+  Scope *OldScope = CurScope;
+  CurScope = comstmt->getScope();
 
   // (2) Generated the code for children.
   std::size_t size = comstmt->getSize();
@@ -212,8 +202,7 @@ std::shared_ptr<Value> ModuleBuilder::visit(const CompoundStmt *comstmt) {
   }
 
   // (3) Switch the scope back.
-  if (num != 0)
-    CurScope = CurScope->getParent();
+  CurScope = OldScope;
 
   return nullptr;
 }
@@ -270,14 +259,14 @@ void ModuleBuilder::EmitIfStmt(const IfStatement *ifstmt) {
 
   // Emit the 'then' code.
   EmitBlock(ThenBlock);
-  ifstmt->getThen().get()->Accept(this);
+  ifstmt->getThen()->Accept(this);
 
   EmitBrach(ContBlock);
   // Emit the 'else' code if present.
   if (auto Else = ifstmt->getElse()) {
     EmitBlock(ElseBlock);
 
-    Else.get()->Accept(this);
+    Else->Accept(this);
 
     EmitBrach(ContBlock);
   }
@@ -301,7 +290,7 @@ void ModuleBuilder::EmitIfStmt(const IfStatement *ifstmt) {
 std::shared_ptr<Value>
 ModuleBuilder::EmitReturnStmt(const ReturnStatement *RS) {
   // Emit the sub-expression, even if unused, to evaluate the side effects.
-  const Expr *SubE = RS->getSubExpr().get();
+  const Expr *SubE = RS->getSubExpr();
 
   if (!CurFunc->ReturnValue) {
     // Make sure not to return anything, but evaluate the expression for
@@ -322,7 +311,7 @@ ModuleBuilder::EmitReturnStmt(const ReturnStatement *RS) {
 }
 
 void ModuleBuilder::EmitFunctionBody(StmtASTPtr body) {
-  EmitCompoundStmt(body.get());
+  EmitCompoundStmt(body);
 }
 
 std::shared_ptr<Value>
@@ -1,5 +1,6 @@
 //===--------------------------CodeGenMo
 #include "IRBuild/IRBuilder.h"
+#include "Support/Trace.h"
 using namespace IRBuild;
 using namespace IR;
 
@@ -9,7 +10,7 @@ std::string ModuleBuilder::LocalInstNamePrefix = "%";
 
 ModuleBuilder::ModuleBuilder(std::shared_ptr<Scope> SymbolInfo,
                              MosesIRContext &context)
-    : SymbolTree(SymbolInfo), CurScope(SymbolInfo), Context(context),
+    : SymbolTree(SymbolInfo), CurScope(SymbolInfo.get()), Context(context),
       Types(CodeGenTypes(context)), CurBB(CreateBasicBlock("entry", nullptr)),
       CurFunc(std::make_shared<FunctionBuilderStatus>()),
       isAllocaInsertPointSetByNormalInsert(false), TempCounter(0) {
@@ -21,10 +22,10 @@ ModuleBuilder::ModuleBuilder(std::shared_ptr<Scope> SymbolInfo,
 }
 
 void ModuleBuilder::VisitChildren(
-    std::vector<std::shared_ptr<StatementAST>> AST) {
+    std::vector<StatementAST *> AST) {
   std::size_t ASTSize = AST.size();
   for (unsigned i = 0; i < ASTSize; i++)
-    AST[i].get()->Accept(this);
+    AST[i]->Accept(this);
 }
 
 //===---------------------------------------------------------------------===//
@@ -321,7 +322,9 @@ void ModuleBuilder::RestoreTopLevelCtxInfo() {
       CurFunc->TopLevelIsAllocaInsertPointSetByNormalInsert;
   TempCounter = CurFunc->TopLevelTempCounter;
 }
-void print([[maybe_unused]] std::shared_ptr<Value> V) {
-  std::ostringstream out;
-  cout << out.str();
+void print(std::shared_ptr<Value> V) {
+  if (Trace::isEnabled(Trace::Channel::IR, Trace::Level::Debug)) {
+    Trace::Message IR(Trace::Channel::IR, Trace::Level::Debug);
+    V->Print(IR.stream());
+  }
 }
@@ -0,0 +1,112 @@
+//===---------------------------ParallelLexer.cpp-------------------------===//
+//
+// This file is used to implement class ParallelLexer.
+//
+//===---------------------------------------------------------------------===//
+#include "Lexer/ParallelLexer.h"
+#include "Support/Parallel.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace parse;
+using namespace lex;
+using Support::runOnWorkers;
+
+void ParallelLexer::splitChunks(ChunkList &Chunks) const {
+  const SourceBuffer &Buffer = SourceManager::get().getBuffer(FileID);
+  const char *Begin = Buffer.getBufferStart();
+  const char *End = Buffer.getBufferEnd();
+  std::size_t Size = End - Begin;
+  std::size_t NumChunks =
+      std::clamp<std::size_t>(Size / MinChunkSize, 1, NumThreads);
+
+  // Every chunk but the first starts after a newline, so no token but a
+  // string literal crosses a chunk boundary.
+  const char *ChunkBegin = Begin;
+  for (std::size_t i = 1; ChunkBegin != End || Chunks.empty(); ++i) {
+    const char *ChunkEnd = End;
+    if (i < NumChunks) {
+      const char *Split = std::max(ChunkBegin, Begin + Size * i / NumChunks);
+      if (const void *NewLine = std::memchr(Split, '\n', End - Split))
+        ChunkEnd = static_cast<const char *>(NewLine) + 1;
+    }
+    Chunks.push_back(
+        std::make_unique<LexedChunk>(ChunkBegin, ChunkEnd, ChunkEnd == End));
+    ChunkBegin = ChunkEnd;
+  }
+}
+
+void ParallelLexer::lexChunk(LexedChunk &Chunk) const {
+  // The source has about one token every three bytes, the pages that aren't
+  // used are never touched.
+  Chunk.Tokens.reserve((Chunk.End - Chunk.Begin) / 2);
+  Scanner(FileID, Chunk).lexChunk();
+}
+
+void ParallelLexer::fixOpenStrings(ChunkList &Chunks) const {
+  // A chunk after an open string literal was lexed from the middle of the
+  // literal, lex it again from the quote. The literal may span several
+  // chunks, the chunk lexed again may end inside it as well.
+  for (std::size_t i = 1; i < Chunks.size(); ++i) {
+    const LexedChunk &Prev = *Chunks[i - 1];
+    if (!Prev.OpenString.isValid())
+      continue;
+    const char *Quote =
+        SourceManager::get().getCharacterData(Prev.OpenString.getOffset());
+    auto Relexed = std::make_unique<LexedChunk>(Quote, Chunks[i]->End,
+                                                Chunks[i]->EndsFile);
+    lexChunk(*Relexed);
+    Chunks[i] = std::move(Relexed);
+  }
+}
+
+void ParallelLexer::lex(std::vector<Token> &Tokens,
+                        std::vector<LexDiagnostic> &Diagnostics) {
+  ChunkList Chunks;
+  splitChunks(Chunks);
+  // The empty token before the first one.
+  Chunks.front()->Tokens.emplace_back();
+  Support::StringInterner &Interner = Support::StringInterner::get();
+  if (Chunks.size() == 1)
+    Chunks.front()->Identifiers = &Interner;
+  runOnWorkers(Chunks.size(), NumThreads,
+               [&](std::size_t i) { lexChunk(*Chunks[i]); });
+  fixOpenStrings(Chunks);
+
+  // Intern the identifiers in the order of the source, IDMaps[i] maps the
+  // local identifier IDs of chunk i.
+  std::vector<std::vector<std::uint32_t>> IDMaps(Chunks.size());
+  std::vector<std::size_t> Starts(Chunks.size());
+  std::size_t NumTokens = 0;
+  for (std::size_t i = 0; i < Chunks.size(); ++i) {
+    const LexedChunk &Chunk = *Chunks[i];
+    for (const LexDiagnostic &Diag : Chunk.Diagnostics) {
+      Diagnostics.push_back(Diag);
+      Diagnostics.back().TokenIndex += NumTokens;
+    }
+    IDMaps[i].resize(Chunk.LocalIdentifiers.size() + 1);
+    for (std::uint32_t ID = 1; ID < IDMaps[i].size(); ++ID)
+      IDMaps[i][ID] = Interner.intern(Chunk.LocalIdentifiers.getString(ID));
+    Starts[i] = NumTokens;
+    NumTokens += Chunk.Tokens.size();
+  }
+
+  if (Chunks.size() == 1) {
+    // The whole file is interned in place.
+    Tokens = std::move(Chunks.front()->Tokens);
+  } else {
+    Tokens.resize(NumTokens);
+    runOnWorkers(Chunks.size(), NumThreads, [&](std::size_t i) {
+      Token *Out = Tokens.data() + Starts[i];
+      for (Token Tok : Chunks[i]->Tokens) {
+        Tok.setIdentifierID(IDMaps[i][Tok.getIdentifierID()]);
+        *Out++ = Tok;
+      }
+    });
+  }
+  const SourceBuffer &Buffer = SourceManager::get().getBuffer(FileID);
+  Tokens.emplace_back(tok::TokenValue::FILE_EOF,
+                      TokenLocation(SourceManager::get().getFileBase(FileID) +
+                                    Buffer.getBufferSize()),
+                      0);
+}
@@ -0,0 +1,171 @@
+//===----------------------------ScanKernels.cpp--------------------------===//
+//
+// This file is used to implement the scanning kernels.
+//
+//===---------------------------------------------------------------------===//
+#include "Lexer/ScanKernels.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define MOSES_SCAN_X86 1
+#endif
+
+using namespace lex;
+
+namespace {
+enum class CharClass { Whitespace, LineEnd, Identifier, Digit, HexDigit };
+
+template <CharClass C> bool isInClass(char Ch) {
+  unsigned char U = Ch;
+  unsigned char Lower = U | 0x20;
+  switch (C) {
+  case CharClass::Whitespace:
+    return U == ' ' || (U >= '\t' && U <= '\r');
+  case CharClass::LineEnd:
+    return U == '\n' || U == '\r';
+  case CharClass::Identifier:
+    return (Lower >= 'a' && Lower <= 'z') || (U >= '0' && U <= '9') ||
+           U == '_';
+  case CharClass::Digit:
+    return U >= '0' && U <= '9';
+  case CharClass::HexDigit:
+    return (U >= '0' && U <= '9') || (Lower >= 'a' && Lower <= 'f');
+  }
+  return false;
+}
+
+/// scanScalar - Advance while the class of the character is InClass.
+template <CharClass C, bool InClass>
+const char *scanScalar(const char *Ptr, const char *End) {
+  while (Ptr != End && isInClass<C>(*Ptr) == InClass)
+    ++Ptr;
+  return Ptr;
+}
+
+#ifdef MOSES_SCAN_X86
+// The bytes are compared as signed, so the non-ASCII bytes are below every
+// range and never in a class.
+
+/// inRange16 - The mask of the bytes of V in [Lo, Hi].
+inline __m128i inRange16(__m128i V, char Lo, char Hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8(Lo - 1)),
+                       _mm_cmplt_epi8(V, _mm_set1_epi8(Hi + 1)));
+}
+
+template <CharClass C> __m128i classify16(__m128i V) {
+  __m128i Lower = _mm_or_si128(V, _mm_set1_epi8(0x20));
+  switch (C) {
+  case CharClass::Whitespace:
+    return _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8(' ')),
+                        inRange16(V, '\t', '\r'));
+  case CharClass::LineEnd:
+    return _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8('\n')),
+                        _mm_cmpeq_epi8(V, _mm_set1_epi8('\r')));
+  case CharClass::Identifier:
+    return _mm_or_si128(
+        _mm_or_si128(inRange16(Lower, 'a', 'z'), inRange16(V, '0', '9')),
+        _mm_cmpeq_epi8(V, _mm_set1_epi8('_')));
+  case CharClass::Digit:
+    return inRange16(V, '0', '9');
+  case CharClass::HexDigit:
+    return _mm_or_si128(inRange16(V, '0', '9'), inRange16(Lower, 'a', 'f'));
+  }
+  return _mm_setzero_si128();
+}
+
+template <CharClass C, bool InClass>
+const char *scanSSE2(const char *Ptr, const char *End) {
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+    unsigned Mask = _mm_movemask_epi8(classify16<C>(V));
+    unsigned Stop = InClass ? ~Mask & 0xFFFF : Mask;
+    if (Stop)
+      return Ptr + __builtin_ctz(Stop);
+  }
+  return scanScalar<C, InClass>(Ptr, End);
+}
+
+__attribute__((target("avx2"))) inline __m256i inRange32(__m256i V, char Lo,
+                                                          char Hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(V, _mm256_set1_epi8(Lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(Hi + 1), V));
+}
+
+template <CharClass C>
+__attribute__((target("avx2"))) __m256i classify32(__m256i V) {
+  __m256i Lower = _mm256_or_si256(V, _mm256_set1_epi8(0x20));
+  switch (C) {
+  case CharClass::Whitespace:
+    return _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8(' ')),
+                           inRange32(V, '\t', '\r'));
+  case CharClass::LineEnd:
+    return _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8('\n')),
+                           _mm256_cmpeq_epi8(V, _mm256_set1_epi8('\r')));
+  case CharClass::Identifier:
+    return _mm256_or_si256(
+        _mm256_or_si256(inRange32(Lower, 'a', 'z'), inRange32(V, '0', '9')),
+        _mm256_cmpeq_epi8(V, _mm256_set1_epi8('_')));
+  case CharClass::Digit:
+    return inRange32(V, '0', '9');
+  case CharClass::HexDigit:
+    return _mm256_or_si256(inRange32(V, '0', '9'),
+                           inRange32(Lower, 'a', 'f'));
+  }
+  return _mm256_setzero_si256();
+}
+
+template <CharClass C, bool InClass>
+__attribute__((target("avx2"))) const char *scanAVX2(const char *Ptr,
+                                                     const char *End) {
+  for (; End - Ptr >= 32; Ptr += 32) {
+    __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+    unsigned Mask = _mm256_movemask_epi8(classify32<C>(V));
+    unsigned Stop = InClass ? ~Mask : Mask;
+    if (Stop)
+      return Ptr + __builtin_ctz(Stop);
+  }
+  return scanSSE2<C, InClass>(Ptr, End);
+}
+#endif
+
+#define MOSES_SCAN_KERNELS(LEVEL, SCAN)                                        \
+  {                                                                            \
+    ScanKernels::Level::LEVEL, SCAN<CharClass::Whitespace, true>,              \
+        SCAN<CharClass::LineEnd, false>, SCAN<CharClass::Identifier, true>,    \
+        SCAN<CharClass::Digit, true>, SCAN<CharClass::HexDigit, true>          \
+  }
+
+const ScanKernels ScalarKernels = MOSES_SCAN_KERNELS(Scalar, scanScalar);
+#ifdef MOSES_SCAN_X86
+const ScanKernels SSE2Kernels = MOSES_SCAN_KERNELS(SSE2, scanSSE2);
+const ScanKernels AVX2Kernels = MOSES_SCAN_KERNELS(AVX2, scanAVX2);
+#endif
+#undef MOSES_SCAN_KERNELS
+} // namespace
+
+const ScanKernels &ScanKernels::get(Level L) {
+#ifdef MOSES_SCAN_X86
+  if (L == Level::AVX2 && __builtin_cpu_supports("avx2"))
+    return AVX2Kernels;
+  if (L != Level::Scalar && __builtin_cpu_supports("sse2"))
+    return SSE2Kernels;
+#endif
+  (void)L;
+  return ScalarKernels;
+}
+
+const ScanKernels &ScanKernels::get() {
+  static const ScanKernels &HostKernels = get(Level::AVX2);
+  return HostKernels;
+}
+
+const char *ScanKernels::getLevelName(Level L) {
+  switch (L) {
+  case Level::Scalar:
+    return "scalar";
+  case Level::SSE2:
+    return "sse2";
+  case Level::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
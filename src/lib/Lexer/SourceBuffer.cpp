@@ -0,0 +1,71 @@
+//===---------------------------SourceBuffer.cpp--------------------------===//
+//
+// This file is used to implement class SourceBuffer.
+//
+//===---------------------------------------------------------------------===//
+#include "Lexer/SourceBuffer.h"
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MOSES_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace lex;
+
+SourceBuffer::~SourceBuffer() {
+#ifdef MOSES_HAVE_MMAP
+  if (Mapping)
+    munmap(Mapping, Size);
+#endif
+}
+
+void SourceBuffer::setContents(std::string Text) {
+#ifdef MOSES_HAVE_MMAP
+  if (Mapping)
+    munmap(Mapping, Size);
+#endif
+  Mapping = nullptr;
+  Storage = std::move(Text);
+  BufferStart = Storage.data();
+  Size = Storage.size();
+}
+
+bool SourceBuffer::load(const std::string &FileName) {
+#ifdef MOSES_HAVE_MMAP
+  int FD = open(FileName.c_str(), O_RDONLY);
+  if (FD < 0)
+    return false;
+  struct stat Status;
+  if (fstat(FD, &Status) == 0 && S_ISREG(Status.st_mode)) {
+    // An empty file can't be mapped, and needs no storage either.
+    if (Status.st_size == 0) {
+      close(FD);
+      return true;
+    }
+    void *Addr =
+        mmap(nullptr, Status.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+    if (Addr != MAP_FAILED) {
+      close(FD);
+      Mapping = Addr;
+      BufferStart = static_cast<const char *>(Addr);
+      Size = Status.st_size;
+      return true;
+    }
+  }
+  close(FD);
+#endif
+  // Not a regular file, or the host can't map it. Read it in one go.
+  std::ifstream Input(FileName, std::ios::binary);
+  if (!Input)
+    return false;
+  Storage.assign(std::istreambuf_iterator<char>(Input),
+                 std::istreambuf_iterator<char>());
+  BufferStart = Storage.data();
+  Size = Storage.size();
+  return true;
+}
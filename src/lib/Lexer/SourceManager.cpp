@@ -0,0 +1,114 @@
+//===---------------------------SourceManager.cpp-------------------------===//
+//
+// This file is used to implement class SourceManager.
+//
+//===---------------------------------------------------------------------===//
+#include "Lexer/SourceManager.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace lex;
+
+SourceManager &SourceManager::get() {
+  static SourceManager TheManager;
+  return TheManager;
+}
+
+bool SourceManager::addFile(const std::string &Name, unsigned &FileID) {
+  auto Buffer = std::make_unique<SourceBuffer>();
+  bool Loaded = Buffer->load(Name);
+  if (!Loaded)
+    Buffer = std::make_unique<SourceBuffer>();
+
+  std::uint64_t End = std::uint64_t(NextBase) + Buffer->getBufferSize() + 1;
+  assert(End <= std::numeric_limits<std::uint32_t>::max() &&
+         "The sources exceed the 32-bit offset space.");
+  FileID = Files.size();
+  Files.push_back({Name, std::move(Buffer), NextBase, {}});
+  NextBase = static_cast<std::uint32_t>(End);
+  return Loaded;
+}
+
+void SourceManager::replaceBuffer(unsigned FileID, std::string Text) {
+  FileEntry &File = Files[FileID];
+  std::uint64_t End = std::uint64_t(File.Base) + Text.size() + 1;
+  if (FileID + 1 == Files.size()) {
+    assert(End <= std::numeric_limits<std::uint32_t>::max() &&
+           "The sources exceed the 32-bit offset space.");
+    NextBase = static_cast<std::uint32_t>(End);
+  } else {
+    assert(End <= Files[FileID + 1].Base &&
+           "The file outgrows its offset range.");
+  }
+  File.Buffer->setContents(std::move(Text));
+  File.LineStarts.clear();
+}
+
+const SourceManager::FileEntry *
+SourceManager::getFileEntry(std::uint32_t Offset) const {
+  // The file of the last query on this thread, most queries hit the same
+  // file.
+  static thread_local unsigned LastFile = 0;
+  auto Contains = [Offset](const FileEntry &File) {
+    return Offset >= File.Base &&
+           Offset - File.Base <= File.Buffer->getBufferSize();
+  };
+  if (LastFile < Files.size() && Contains(Files[LastFile]))
+    return &Files[LastFile];
+
+  // The files are sorted by their base.
+  auto Iter = std::upper_bound(
+      Files.begin(), Files.end(), Offset,
+      [](std::uint32_t Offset, const FileEntry &File) {
+        return Offset < File.Base;
+      });
+  if (Iter == Files.begin() || !Contains(*(Iter - 1)))
+    return nullptr;
+  LastFile = Iter - 1 - Files.begin();
+  return &*(Iter - 1);
+}
+
+const char *SourceManager::getCharacterData(std::uint32_t Offset) const {
+  const FileEntry *File = getFileEntry(Offset);
+  if (!File)
+    return nullptr;
+  return File->Buffer->getBufferStart() + (Offset - File->Base);
+}
+
+void SourceManager::buildLineTable(const FileEntry &File) {
+  const char *Start = File.Buffer->getBufferStart();
+  std::size_t Size = File.Buffer->getBufferSize();
+  File.LineStarts.push_back(0);
+  for (std::size_t i = 0; i < Size; i++)
+    if (Start[i] == '\n')
+      File.LineStarts.push_back(i + 1);
+}
+
+void SourceManager::buildLineTables() const {
+  for (const FileEntry &File : Files)
+    if (File.LineStarts.empty())
+      buildLineTable(File);
+}
+
+bool SourceManager::getPresumedLoc(std::uint32_t Offset, unsigned long &Line,
+                                   unsigned long &Column,
+                                   const std::string *&FileName) const {
+  const FileEntry *File = getFileEntry(Offset);
+  if (!File) {
+    Line = Column = 0;
+    FileName = nullptr;
+    return false;
+  }
+
+  if (File->LineStarts.empty())
+    buildLineTable(*File);
+
+  std::uint32_t FileOffset = Offset - File->Base;
+  auto Iter = std::upper_bound(File->LineStarts.begin(),
+                               File->LineStarts.end(), FileOffset);
+  Line = Iter - File->LineStarts.begin();
+  Column = FileOffset - *(Iter - 1) + 1;
+  FileName = &File->Name;
+  return true;
+}
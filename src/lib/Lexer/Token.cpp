@@ -4,33 +4,79 @@
 //
 //===---------------------------------------------------------------------===//
 #include "Lexer/Token.h"
+#include "Lexer/SourceManager.h"
+#include <charconv>
 using namespace lex;
 
-Token::Token(TokenValue tv, const std::string &tokenName)
-    : value(tv), lexem(tokenName) {}
+//===---------------------------------------------------------------------===//
+// Implements class TokenLocation.
+unsigned long TokenLocation::getTokenLineNumber() const {
+  unsigned long Line, Column;
+  const std::string *FileName;
+  SourceManager::get().getPresumedLoc(Offset, Line, Column, FileName);
+  return Line;
+}
+
+unsigned long TokenLocation::getTokenColNumber() const {
+  unsigned long Line, Column;
+  const std::string *FileName;
+  SourceManager::get().getPresumedLoc(Offset, Line, Column, FileName);
+  return Column;
+}
+
+const std::string &TokenLocation::getTokenFileName() const {
+  static const std::string NoFile;
+  unsigned long Line, Column;
+  const std::string *FileName;
+  if (!SourceManager::get().getPresumedLoc(Offset, Line, Column, FileName))
+    return NoFile;
+  return *FileName;
+}
 
+std::string TokenLocation::toString() const {
+  unsigned long Line, Column;
+  const std::string *FileName;
+  bool Valid =
+      SourceManager::get().getPresumedLoc(Offset, Line, Column, FileName);
+  std::string LineStr = std::to_string(Line);
+  std::string ColStr = std::to_string(Column);
+  return (Valid ? *FileName : std::string("")) + ": Line: " + LineStr +
+         ", ColumnNumber: " + ColStr;
+}
+
+//===---------------------------------------------------------------------===//
+// Implements class Token.
 Token::Token()
-    : value(tok::TokenValue::FILE_EOF), loc(0, 0, std::string("")), lexem(""), 
-    intValue(0), realValue(0), strValue("") {}
-
-// identifier and keyword
-Token::Token(TokenValue tv, const TokenLocation &location, const std::string &name)
-    : value(tv), loc(location), lexem(name), intValue(0), realValue(0), 
-      strValue(name) {}
-
-// literal
-// Token::Token(TokenValue tv, const TokenLocation& location, const std::string&
-// strValue, std::string name) : 	value(tok::TokenValue::FILE_EOF),
-// Length(0),
-// TokenLoc(location), intValue(0), realValue(0), strValue(strValue),
-// name(name){}
-// int
-Token::Token(TokenValue tv, const TokenLocation &location, long intvalue,
-             const std::string &name)
-    : value(tv), loc(location), lexem(name), intValue(intvalue), realValue(0),
-      strValue("") {}
-// real
-Token::Token(TokenValue tv, const TokenLocation &location, double realvalue,
-             const std::string &name)
-    : value(tv), loc(location), lexem(name), intValue(0), realValue(realvalue),
-      strValue("") {}
\ No newline at end of file
+    : value(tok::TokenValue::FILE_EOF), flags(0), offset(0), length(0),
+      identID(0) {}
+
+Token::Token(TokenValue tv, const TokenLocation &location,
+             std::uint32_t length, std::uint32_t identID, std::uint16_t flags)
+    : value(tv), flags(flags), offset(location.getOffset()), length(length),
+      identID(identID) {}
+
+std::string_view Token::getLexemView() const {
+  if (length == 0)
+    return std::string_view();
+  // Skip the '$' or the '"' before the lexeme.
+  std::uint32_t Start = offset + ((flags & (HexLiteral | QuotedLiteral)) ? 1 : 0);
+  return std::string_view(SourceManager::get().getCharacterData(Start),
+                          length);
+}
+
+long Token::getIntValue() const {
+  std::string_view Lexem = getLexemView();
+  if (value == TokenValue::CHAR_LITERAL)
+    return Lexem.empty() ? 0 : static_cast<long>(Lexem[0]);
+  long IntValue = 0;
+  std::from_chars(Lexem.data(), Lexem.data() + Lexem.size(), IntValue,
+                  flags & HexLiteral ? 16 : 10);
+  return IntValue;
+}
+
+double Token::getRealValue() const {
+  std::string_view Lexem = getLexemView();
+  double RealValue = 0;
+  std::from_chars(Lexem.data(), Lexem.data() + Lexem.size(), RealValue);
+  return RealValue;
+}
@@ -4,103 +4,273 @@
 //
 //===------------------------------------------------------------------------===//
 #include "Lexer/scanner.h"
+#include "Lexer/ParallelLexer.h"
+#include "Support/StringInterner.h"
+#include "Support/Trace.h"
+#include <charconv>
+#include <cstring>
+#include <memory>
 using namespace parse;
 using namespace lex;
 using namespace tok;
 
-bool Scanner::errorFlag = false;
-
-Scanner::Scanner(const std::string &srcFileName)
-    : FileName(srcFileName), CurLine(1), CurCol(0), CurrentChar(0),
-      state(State::NONE) {
-  input.open(FileName);
-  if (input.fail()) {
+Scanner::Scanner(const std::string &srcFileName, unsigned NumThreads)
+    : FileName(srcFileName), AtEOF(false), Kernels(ScanKernels::get()),
+      CurrentChar(0), errorFlag(false), state(State::NONE), Chunk(nullptr),
+      CurToken(0), MaxToken(0), NextDiagnostic(0) {
+  SourceManager &SM = SourceManager::get();
+  bool Loaded = SM.addFile(FileName, FileID);
+  FileBase = SM.getFileBase(FileID);
+  BufferStart = SM.getBuffer(FileID).getBufferStart();
+  BufferPtr = BufferStart;
+  BufferEnd = SM.getBuffer(FileID).getBufferEnd();
+  CurPtr = BufferPtr;
+  if (!Loaded) {
     errorReport("When trying to open file " + FileName + ", occurred error.");
     errorFlag = true;
   }
+  ParallelLexer(FileID, NumThreads).lex(Tokens, Diagnostics);
+  Tokens.emplace_back();
 }
 
-void Scanner::getNextChar() {
-  CurrentChar = input.get();
-  if (CurrentChar == '\n') {
-    CurLine++;
-    CurCol = 0;
-  } else {
-    CurCol++;
+Scanner::Scanner(const Scanner &File, std::size_t First, std::size_t End)
+    : FileName(File.FileName), FileID(File.FileID), FileBase(File.FileBase),
+      BufferStart(File.BufferStart), BufferPtr(File.BufferEnd),
+      BufferEnd(File.BufferEnd), CurPtr(File.BufferEnd), AtEOF(true),
+      Kernels(File.Kernels), CurrentChar(0), errorFlag(false),
+      state(State::NONE), Chunk(nullptr), CurToken(0), NextDiagnostic(0) {
+  assert(First && First <= End && End < File.Tokens.size() &&
+         "The part is out of the token buffer");
+  // The token before the part is the last one before the first token, the
+  // errors at the start of the part point there.
+  Tokens.assign(File.Tokens.begin() + First - 1, File.Tokens.begin() + End);
+  Tokens.emplace_back(TokenValue::FILE_EOF, File.Tokens[End].getTokenLoc(),
+                      0);
+  Tokens.emplace_back();
+  // Every token counts as consumed, nothing is traced or reported.
+  MaxToken = Tokens.size();
+}
+
+Scanner::Scanner(unsigned FileID, LexedChunk &Chunk)
+    : FileID(FileID), AtEOF(false), Kernels(ScanKernels::get()),
+      CurrentChar(0), errorFlag(false), state(State::NONE), Chunk(&Chunk),
+      CurToken(0), MaxToken(0), NextDiagnostic(0) {
+  SourceManager &SM = SourceManager::get();
+  FileBase = SM.getFileBase(FileID);
+  BufferStart = SM.getBuffer(FileID).getBufferStart();
+  BufferPtr = Chunk.Begin;
+  BufferEnd = Chunk.End;
+  CurPtr = BufferPtr;
+}
+
+void Scanner::lexChunk() {
+  do {
+    lexToken();
+  } while (!AtEOF);
+}
+
+const Token &Scanner::getNextToken() {
+  // The FILE_EOF token of the file is never the current token.
+  std::size_t EOFToken = Tokens.size() - 2;
+  CurToken = std::min(CurToken + 1, EOFToken);
+  if (CurToken == EOFToken)
+    ++CurToken;
+  if (CurToken > MaxToken) {
+    MaxToken = CurToken;
+    reachToken(std::min(CurToken, EOFToken));
+  } else if (CurToken > EOFToken && MaxToken != Tokens.size()) {
+    // Every attempt to read past the end of file is traced, but the end of a
+    // part of the file.
+    MOSES_TRACE(Tokens, Info) << "FILE_EOF\n";
   }
+  return Tokens[CurToken];
 }
 
-char Scanner::peekChar() {
-  char c = input.peek();
-  return c;
+void Scanner::reachToken(std::size_t Index) {
+  // Report the errors at the point the scanner finds them in the source.
+  for (; NextDiagnostic != Diagnostics.size() &&
+         Diagnostics[NextDiagnostic].TokenIndex <= Index;
+       ++NextDiagnostic) {
+    const LexDiagnostic &Diag = Diagnostics[NextDiagnostic];
+    if (Diag.BadToken) {
+      DiagnosticBuffer::flushCaptured();
+      std::cerr << "Bad Token!\n";
+      exit(1);
+    }
+    errorToken(Diag.Loc.toString() + Diag.Message);
+  }
+  const Token &Tok = Tokens[Index];
+  if (Tok.getKind() == TokenValue::FILE_EOF)
+    MOSES_TRACE(Tokens, Info) << "FILE_EOF\n";
+  else
+    MOSES_TRACE(Tokens, Info) << Tok.getLexemView() << "\n";
+}
+
+void Scanner::seekTo(std::size_t Index) {
+  assert(Index && Index < Tokens.size() && "Seek out of the token buffer");
+  CurToken = MaxToken = Index - 1;
+  NextDiagnostic =
+      std::partition_point(Diagnostics.begin(), Diagnostics.end(),
+                           [Index](const LexDiagnostic &Diag) {
+                             return Diag.TokenIndex < Index;
+                           }) -
+      Diagnostics.begin();
 }
 
-void Scanner::addToBuffer(char c) { buffer.push_back(c); }
+TokenEdit Scanner::applyEdit(std::uint32_t Offset, std::uint32_t RemovedLength,
+                             std::string_view Inserted) {
+  SourceManager &SM = SourceManager::get();
+  std::string_view Old = SM.getBuffer(FileID).getBuffer();
+  assert(Offset <= Old.size() && RemovedLength <= Old.size() - Offset &&
+         "The edit is out of the file");
+  std::string Text;
+  Text.reserve(Old.size() - RemovedLength + Inserted.size());
+  Text.append(Old.substr(0, Offset));
+  Text.append(Inserted);
+  Text.append(Old.substr(Offset + RemovedLength));
+  std::int64_t Delta = std::int64_t(Inserted.size()) - RemovedLength;
+  SM.replaceBuffer(FileID, std::move(Text));
+  BufferStart = BufferPtr = CurPtr = SM.getBuffer(FileID).getBufferStart();
+  BufferEnd = SM.getBuffer(FileID).getBufferEnd();
+  std::size_t Size = BufferEnd - BufferStart;
+
+  // The old tokens of the file are [1, EOFToken), their positions are the
+  // ones of the old source.
+  std::size_t EOFToken = Tokens.size() - 2;
+  auto getPos = [this](const Token &Tok) -> std::size_t {
+    return Tok.getTokenLoc().getOffset() - FileBase;
+  };
+  auto getFirstTokenAt = [&](std::size_t From, std::size_t Pos) {
+    return std::partition_point(
+               Tokens.begin() + From, Tokens.begin() + EOFToken,
+               [&](const Token &Tok) { return getPos(Tok) < Pos; }) -
+           Tokens.begin();
+  };
+  // Only a string literal spans lines. Its quotes aren't in the lexeme, and
+  // one that isn't closed is taken to reach a little further.
+  auto mayReach = [&](const Token &Tok, std::size_t Pos) {
+    return Tok.is(TokenValue::STRING_LITERAL) &&
+           getPos(Tok) + Tok.getLength() + 2 > Pos;
+  };
+  auto getNextLineStart = [&](std::size_t Pos) -> std::size_t {
+    const void *NewLine = std::memchr(BufferStart + Pos, '\n', Size - Pos);
+    return NewLine ? static_cast<const char *>(NewLine) - BufferStart + 1
+                   : Size;
+  };
+
+  // Lex again from the start of the line of the edit, or from the quote of
+  // a string literal that runs into it.
+  std::size_t LexBegin = Offset;
+  while (LexBegin && BufferStart[LexBegin - 1] != '\n')
+    --LexBegin;
+  std::size_t First = getFirstTokenAt(1, LexBegin);
+  if (First > 1 && mayReach(Tokens[First - 1], LexBegin))
+    LexBegin = getPos(Tokens[--First]);
+
+  // Up to the first line start after the inserted text that no string
+  // literal of the old or the new source crosses, the old tokens from there
+  // on are the same.
+  std::size_t LexEnd = getNextLineStart(Offset + Inserted.size());
+  std::size_t OldEnd;
+  std::unique_ptr<LexedChunk> Relexed;
+  for (;; LexEnd = getNextLineStart(LexEnd)) {
+    Relexed = std::make_unique<LexedChunk>(BufferStart + LexBegin,
+                                           BufferStart + LexEnd, LexEnd == Size);
+    Relexed->Identifiers = &Support::StringInterner::get();
+    Scanner(FileID, *Relexed).lexChunk();
+    if (Relexed->OpenString.isValid())
+      continue;
+    if (LexEnd == Size) {
+      OldEnd = EOFToken;
+      break;
+    }
+    std::size_t OldPos = LexEnd - Delta;
+    OldEnd = getFirstTokenAt(First, OldPos);
+    if (OldEnd == First || !mayReach(Tokens[OldEnd - 1], OldPos))
+      break;
+  }
 
-void Scanner::reduceBuffer() { buffer.pop_back(); }
+  // Replace the diagnostics of the lines lexed again.
+  std::size_t OldLexEnd = LexEnd - Delta;
+  auto getFirstDiagnosticAt = [&](std::size_t Pos) {
+    return std::partition_point(
+        Diagnostics.begin(), Diagnostics.end(), [&](const LexDiagnostic &D) {
+          return D.Loc.getOffset() - FileBase < Pos;
+        });
+  };
+  std::vector<Token> &NewTokens = Relexed->Tokens;
+  std::size_t NewEnd = First + NewTokens.size();
+  auto DiagEnd = LexEnd == Size ? Diagnostics.end()
+                                : getFirstDiagnosticAt(OldLexEnd);
+  for (auto Iter = DiagEnd; Iter != Diagnostics.end(); ++Iter) {
+    Iter->TokenIndex = Iter->TokenIndex + NewEnd - OldEnd;
+    Iter->Loc = TokenLocation(Iter->Loc.getOffset() + Delta);
+  }
+  for (LexDiagnostic &Diag : Relexed->Diagnostics)
+    Diag.TokenIndex += First;
+  auto DiagBegin = getFirstDiagnosticAt(LexBegin);
+  DiagBegin = Diagnostics.erase(DiagBegin, DiagEnd);
+  Diagnostics.insert(DiagBegin, Relexed->Diagnostics.begin(),
+                     Relexed->Diagnostics.end());
+
+  // The FILE_EOF token moves with the tokens after the edit.
+  for (std::size_t i = OldEnd; i <= EOFToken; ++i)
+    Tokens[i].setTokenLoc(
+        TokenLocation(Tokens[i].getTokenLoc().getOffset() + Delta));
+  Tokens.erase(Tokens.begin() + First, Tokens.begin() + OldEnd);
+  Tokens.insert(Tokens.begin() + First, NewTokens.begin(), NewTokens.end());
+
+  seekTo(First);
+  return {First, OldEnd, NewEnd, Delta};
+}
 
-void Scanner::makeToken(TokenValue tv, const TokenLocation &Loc,
-                        std::string name) {
-  std::cout << name << std::endl;
-  LastTok = Tok;
-  Tok = Token(tv, Loc, name);
-  buffer.clear();
-  state = State::NONE;
+void Scanner::getNextChar() {
+  if (BufferPtr == BufferEnd) {
+    CurrentChar = EOF;
+    CurPtr = BufferEnd;
+    AtEOF = true;
+    return;
+  }
+  CurPtr = BufferPtr;
+  CurrentChar = *BufferPtr++;
 }
 
-void Scanner::makeToken(TokenValue tv, const TokenLocation &loc, long intvalue,
-                        std::string name) {
-  std::cout << name << std::endl;
-  LastTok = Tok;
-  Tok = Token(tv, loc, intvalue, name);
-  buffer.clear();
-  state = State::NONE;
+char Scanner::peekChar() {
+  return BufferPtr == BufferEnd ? static_cast<char>(EOF) : *BufferPtr;
 }
 
-void Scanner::makeToken(TokenValue tv, const TokenLocation &loc,
-                        double realvalue, std::string name) {
-  std::cout << name << '\n';
-  LastTok = Tok;
-  Tok = Token(tv, loc, realvalue, name);
-  buffer.clear();
+void Scanner::makeToken(TokenValue tv, const TokenLocation &Loc,
+                        std::string_view name, std::uint16_t flags) {
+  // The end of a chunk isn't the end of file, the ParallelLexer adds the
+  // FILE_EOF token once the chunks are merged.
+  if (tv != TokenValue::FILE_EOF)
+    Chunk->Tokens.emplace_back(
+        tv, Loc, name.size(),
+        tv == TokenValue::IDENTIFIER ? Chunk->Identifiers->intern(name) : 0,
+        flags);
   state = State::NONE;
 }
 
 void Scanner::preprocess() {
   do {
-    while (std::isspace(CurrentChar)) {
-      getNextChar();
-    }
+    if (std::isspace(CurrentChar))
+      advanceTo(Kernels.SkipWhitespace(CurPtr, BufferEnd));
     handleLineComment();
     // handleBlockComment();
-  } while (std::isspace(CurrentChar));
+  } while (std::isspace(CurrentChar) || CurrentChar == '#');
 }
 
 void Scanner::handleLineComment() {
   CurLoc = getTokenLocation();
 
   if (CurrentChar == '#') {
-    getNextChar();
-
-    while (CurrentChar != '\n' && CurrentChar != '\r' && CurrentChar != EOF) {
-      getNextChar();
-    }
+    advanceTo(Kernels.FindLineEnd(CurPtr + 1, BufferEnd));
 
     if (CurrentChar == '\n') {
-      CurLine++;
-      CurCol = 0;
       getNextChar();
     } else if (CurrentChar == '\r' && peekChar() == '\n') {
       getNextChar();
       getNextChar();
-      CurLine++;
-      CurCol = 0;
-    } else {
-      return;
-    }
-
-    if (!input.eof()) {
-      getNextChar();
     }
   }
 }
@@ -133,7 +303,7 @@ void Scanner::handleLineComment() {
 //	}
 //}
 
-Token Scanner::getNextToken() {
+void Scanner::lexToken() {
   bool matched = false;
   do {
     if (state != State::NONE) {
@@ -146,10 +316,7 @@ Token Scanner::getNextToken() {
       break;
     case State::END_OF_FILE:
       handleEOFState();
-      LastTok = Tok;
-      Tok = Token();
-      return Tok;
-      break;
+      return;
     case State::IDENTIFIER:
       handleIdentifierState();
       break;
@@ -170,7 +337,7 @@ Token Scanner::getNextToken() {
 
     if (state == State::NONE) {
       preprocess();
-      if (input.eof()) {
+      if (AtEOF) {
         state = State::END_OF_FILE;
       } else {
         if (std::isalpha(CurrentChar)) {
@@ -187,13 +354,11 @@ Token Scanner::getNextToken() {
       }
     }
   } while (!matched);
-  return Tok;
 }
 
 void Scanner::handleEOFState() {
   CurLoc = getTokenLocation();
-  makeToken(TokenValue::FILE_EOF, CurLoc, std::string("FILE_EOF"));
-  input.close();
+  makeToken(TokenValue::FILE_EOF, CurLoc, std::string_view("FILE_EOF"));
 }
 
 void Scanner::handleNumberState() {
@@ -205,6 +370,8 @@ void Scanner::handleNumberState() {
     numberBase = 16;
     getNextChar();
   }
+  // The lexeme doesn't include the '$'.
+  const char *NumStart = CurPtr;
   enum class NumberState { INTEGER, FRACTION, EXPONENT, DONE };
 
   NumberState numberState = NumberState::INTEGER;
@@ -243,16 +410,22 @@ void Scanner::handleNumberState() {
     }
   } while (numberState != NumberState::DONE);
 
+  std::string_view Lexeme = getLexemeFrom(NumStart);
   if (!errorFlag) {
     if (isFloat) {
-      makeToken(TokenValue::REAL_LITERAL, CurLoc, std::stod(buffer), buffer);
+      makeToken(TokenValue::REAL_LITERAL, CurLoc, Lexeme);
     } else {
-      makeToken(TokenValue::INTEGER_LITERAL, CurLoc,
-                std::stol(buffer, 0, numberBase), buffer);
+      // The value is converted again when it is asked for, only check it.
+      long IntValue = 0;
+      if (std::from_chars(Lexeme.data(), Lexeme.data() + Lexeme.size(),
+                          IntValue, numberBase)
+              .ec == std::errc::result_out_of_range)
+        errorReport("Integer literal out of range.");
+      makeToken(TokenValue::INTEGER_LITERAL, CurLoc, Lexeme,
+                numberBase == 16 ? Token::HexLiteral : 0);
     }
   } else {
-    // just clear buffer and set the state to State::NONE
-    buffer.clear();
+    // just set the state to State::NONE
     state = State::NONE;
   }
 }
@@ -262,85 +435,89 @@ void Scanner::handleStringState() {
   // eat ' and NOT update currentChar
   // because we don't want ' (single quote).
   getNextChar();
+  const char *StrStart = CurPtr;
 
   while (true) {
     if (CurrentChar == '\"') {
       break;
     }
-    addToBuffer(CurrentChar);
+    if (AtEOF) {
+      if (Chunk && !Chunk->EndsFile) {
+        // The literal goes on in the next chunk, the ParallelLexer lexes it
+        // again from the quote.
+        Chunk->OpenString = CurLoc;
+        state = State::NONE;
+        return;
+      }
+      errorReport("end of file happened in string literal.");
+      break;
+    }
     getNextChar();
   }
+  std::string_view Lexeme = getLexemeFrom(StrStart);
 
   // eat end ' and update currentChar
   getNextChar();
 
   // just one char
-  if (buffer.length() == 1) {
-    makeToken(TokenValue::CHAR_LITERAL, CurLoc, static_cast<long>(buffer.at(0)),
-              buffer);
+  if (Lexeme.length() == 1) {
+    makeToken(TokenValue::CHAR_LITERAL, CurLoc, Lexeme, Token::QuotedLiteral);
   } else {
-    makeToken(TokenValue::STRING_LITERAL, CurLoc, buffer);
+    makeToken(TokenValue::STRING_LITERAL, CurLoc, Lexeme, Token::QuotedLiteral);
   }
 }
 
 void Scanner::handleIdentifierState() {
   CurLoc = getTokenLocation();
-  // add first char
-  addToBuffer(CurrentChar);
-  getNextChar();
-
-  while (std::isalnum(CurrentChar) || CurrentChar == '_') {
-    addToBuffer(CurrentChar);
-    getNextChar();
-  }
+  const char *IdStart = CurPtr;
+  advanceTo(Kernels.SkipIdentifier(CurPtr + 1, BufferEnd));
 
-  TokenValue tokenValue = table.isKeyword(buffer);
+  std::string_view Lexeme = getLexemeFrom(IdStart);
+  TokenValue tokenValue = PreStoreToken::isKeyword(Lexeme);
   if (tokenValue == TokenValue::UNKNOWN) {
     tokenValue = TokenValue::IDENTIFIER;
   }
-  makeToken(tokenValue, CurLoc, buffer);
+  makeToken(tokenValue, CurLoc, Lexeme);
 }
 
 void Scanner::handleOperationState() {
   CurLoc = getTokenLocation();
 
-  addToBuffer(CurrentChar);
-  addToBuffer(peekChar());
-
-  auto tokenKind = table.isOperator(buffer);
+  // Try the two-character operator first.
+  std::string_view Lexeme(CurPtr, BufferEnd - CurPtr >= 2 ? 2 : 1);
+  auto tokenKind = PreStoreToken::isOperator(Lexeme);
   if (tokenKind == TokenValue::UNKNOWN) {
-    reduceBuffer();
-    tokenKind = table.isOperator(buffer);
+    Lexeme.remove_suffix(Lexeme.size() - 1);
+    tokenKind = PreStoreToken::isOperator(Lexeme);
   } else {
     getNextChar();
   }
 
   if (tokenKind == TokenValue::UNKNOWN) {
+    if (Chunk) {
+      // Stop the chunk, the bad token is reported if the chunk is kept.
+      Chunk->Diagnostics.emplace_back(Chunk->Tokens.size(), CurLoc, "", true);
+      BufferPtr = BufferEnd;
+      getNextChar();
+      state = State::NONE;
+      return;
+    }
     std::cerr << "Bad Token!\n";
     exit(1);
   }
 
-  makeToken(tokenKind, CurLoc, buffer);
+  makeToken(tokenKind, CurLoc, Lexeme);
   getNextChar();
 }
 
 void Scanner::handleDigit() {
-  addToBuffer(CurrentChar);
-  getNextChar();
-  while (std::isdigit(CurrentChar)) {
-    addToBuffer(CurrentChar);
-    getNextChar();
-  }
+  advanceTo(Kernels.SkipDigits(CurPtr + 1, BufferEnd));
 }
 
 void Scanner::handleXDigit() {
-  bool readFlag = false;
-
-  while (std::isxdigit(CurrentChar)) {
-    readFlag = true;
-    addToBuffer(CurrentChar);
-    getNextChar();
-  }
+  const char *DigitsEnd = Kernels.SkipHexDigits(CurPtr, BufferEnd);
+  bool readFlag = DigitsEnd != CurPtr;
+  advanceTo(DigitsEnd);
 
   if (!readFlag)
     errorReport("Hexadecimal number format error!");
@@ -350,17 +527,16 @@ void Scanner::handleFraction() {
   if (!std::isdigit(peekChar()))
     errorReport("Fraction number part should be numbers");
 
-  addToBuffer(CurrentChar);
-  getNextChar();
-
-  while (std::isdigit(CurrentChar)) {
-    addToBuffer(CurrentChar);
-    getNextChar();
-  }
+  advanceTo(Kernels.SkipDigits(CurPtr + 1, BufferEnd));
 }
 
-void Scanner::handleExponent() { addToBuffer(CurrentChar); }
+void Scanner::handleExponent() {}
 
 void Scanner::errorReport(const std::string &msg) {
+  if (Chunk) {
+    Chunk->Diagnostics.emplace_back(Chunk->Tokens.size(), getTokenLocation(),
+                                    msg);
+    return;
+  }
   errorToken(getTokenLocation().toString() + msg);
 }
\ No newline at end of file
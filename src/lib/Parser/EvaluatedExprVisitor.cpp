@@ -9,7 +9,7 @@ using namespace ast;
 //===-----------------------------------------------------------------------------------===//
 // EvaluatedExprVisitorBase's Impletation
 bool EvaluatedExprVisitorBase::Evaluate(ExprASTPtr expr, EvalInfo &info) {
-  if (BinaryPtr B = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+  if (BinaryPtr B = dynamic_cast<BinaryExpr *>(expr)) {
     EvalInfo LhsVal(ValueKind::IntKind, EvaluationMode::EM_ConstantFold);
     EvalInfo RhsVal(ValueKind::IntKind, EvaluationMode::EM_ConstantFold);
 
@@ -20,7 +20,7 @@ bool EvaluatedExprVisitorBase::Evaluate(ExprASTPtr expr, EvalInfo &info) {
     return EvalBinaryExpr(B, info, LhsVal, RhsVal);
   }
 
-  if (UnaryPtr U = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+  if (UnaryPtr U = dynamic_cast<UnaryExpr *>(expr)) {
     EvalInfo subVal(ValueKind::IntKind, EvaluationMode::EM_ConstantFold);
 
     if (!Evaluate(U->getSubExpr(), subVal))
@@ -28,25 +28,25 @@ bool EvaluatedExprVisitorBase::Evaluate(ExprASTPtr expr, EvalInfo &info) {
     return EvalUnaryExpr(U, info, subVal);
   }
 
-  if (MemberExprPtr M = std::dynamic_pointer_cast<MemberExpr>(expr)) {
+  if (MemberExprPtr M = dynamic_cast<MemberExpr *>(expr)) {
     return EvalMemberExpr(M, info);
   }
 
-  if (DeclRefExprPtr DRE = std::dynamic_pointer_cast<DeclRefExpr>(expr)) {
+  if (DeclRefExprPtr DRE = dynamic_cast<DeclRefExpr *>(expr)) {
     return EvalDeclRefExpr(DRE, info);
   }
 
-  if (CallExprPtr CE = std::dynamic_pointer_cast<CallExpr>(expr)) {
+  if (CallExprPtr CE = dynamic_cast<CallExpr *>(expr)) {
     return EvalCallExpr(CE, info);
   }
 
-  if (BoolLiteralPtr BL = std::dynamic_pointer_cast<BoolLiteral>(expr)) {
+  if (BoolLiteralPtr BL = dynamic_cast<BoolLiteral *>(expr)) {
     info.evalstatus.kind = ValueKind::BoolKind;
     info.evalstatus.boolVal = BL->getVal();
     return true;
   }
 
-  if (NumberExprPtr Num = std::dynamic_pointer_cast<NumberExpr>(expr)) {
+  if (NumberExprPtr Num = dynamic_cast<NumberExpr *>(expr)) {
     info.evalstatus.kind = ValueKind::IntKind;
     info.evalstatus.intVal = Num->getVal();
     return true;
@@ -116,7 +116,7 @@ bool EvaluatedExprVisitorBase::EvalCallExpr(CallExprPtr CE, EvalInfo &info) {
 bool EvaluatedExprVisitorBase::EvalDeclRefExpr(DeclRefExprPtr DRE,
                                                EvalInfo &info) {
   auto decl = DRE->getDecl();
-  if (VarDeclPtr VD = std::dynamic_pointer_cast<VarDecl>(decl)) {
+  if (VarDeclPtr VD = dynamic_cast<VarDecl *>(decl)) {
     if (!VD->isConst())
       return false;
     EvalInfo declInfo(info.evalstatus.kind, EvaluationMode::EM_ConstantFold);
@@ -125,7 +125,7 @@ bool EvaluatedExprVisitorBase::EvalDeclRefExpr(DeclRefExprPtr DRE,
     }
     info = declInfo;
     return true;
-  } else if (ParmDeclPtr PD = std::dynamic_pointer_cast<ParameterDecl>(decl)) {
+  } else if (ParmDeclPtr PD = dynamic_cast<ParameterDecl *>(decl)) {
     // func add(lhs : int, rhs : int) -> int
     // {
     //		return lhs + rhs;
@@ -0,0 +1,1089 @@
+//===-----------------------------ModuleFile.cpp--------------------------===//
+//
+// This file is used to implement the precompiled module.
+//
+//===---------------------------------------------------------------------===//
+#include "Parser/ModuleFile.h"
+#include "Lexer/SourceBuffer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+
+using namespace ast;
+using namespace Support;
+
+std::uint64_t ModuleFile::hashSource(std::string_view Source) {
+  // 64-bit FNV-1a.
+  std::uint64_t Hash = 0xcbf29ce484222325ULL;
+  for (unsigned char C : Source) {
+    Hash ^= C;
+    Hash *= 0x100000001b3ULL;
+  }
+  return Hash;
+}
+
+std::string ModuleFile::getModulePath(const std::string &SourcePath) {
+  std::string Path(SourcePath);
+  if (Path.size() > 3 && Path.compare(Path.size() - 3, 3, ".mo") == 0)
+    Path.resize(Path.size() - 3);
+  return Path + ".mc";
+}
+
+/// writeNumber - Append Value as an unsigned LEB128.
+static void writeNumber(std::string &Out, std::uint64_t Value) {
+  do {
+    unsigned char Byte = Value & 0x7f;
+    Value >>= 7;
+    if (Value)
+      Byte |= 0x80;
+    Out.push_back(static_cast<char>(Byte));
+  } while (Value);
+}
+
+/// writeDouble - Append Value. A whole number, as the literals are, is saved
+/// as a LEB128 of twice its value, any other value as a one and its bytes.
+static void writeDouble(std::string &Out, double Value) {
+  if (Value >= 0 && !std::signbit(Value) && Value < 0x1p52 &&
+      Value == std::floor(Value)) {
+    writeNumber(Out, std::uint64_t(Value) << 1);
+    return;
+  }
+  writeNumber(Out, 1);
+  char Bytes[sizeof(double)];
+  std::memcpy(Bytes, &Value, sizeof(double));
+  Out.append(Bytes, sizeof(double));
+}
+
+/// writeLoc - Append the distance of Loc from Base, zigzag encoded, and make
+/// Loc the new base. The locations of neighbouring nodes are close.
+static void writeLoc(std::string &Out, std::uint32_t &Base,
+                     SourceLocation Loc) {
+  std::int64_t Delta = std::int64_t(Loc.getOffset()) - Base;
+  writeNumber(Out, Delta < 0 ? (std::uint64_t(-Delta) << 1) - 1
+                             : std::uint64_t(Delta) << 1);
+  Base = Loc.getOffset();
+}
+
+//===---------------------------------------------------------------------===//
+// Implement class ModuleWriter.
+std::uint32_t ModuleWriter::addString(const std::string &Str) {
+  auto Result = StringIDs.try_emplace(Str, Strings.size());
+  if (Result.second)
+    Strings.push_back(&Result.first->first);
+  return Result.first->second;
+}
+
+std::uint32_t ModuleWriter::addType(const std::shared_ptr<ASTType> &Type) {
+  if (!Type)
+    return 0;
+  if (Type == Ctx.Int)
+    return 1;
+  if (Type == Ctx.Bool)
+    return 2;
+  if (Type == Ctx.Void)
+    return 3;
+  auto Iter = TypeIDs.find(Type.get());
+  if (Iter != TypeIDs.end()) {
+    // Zero marks an anonymous type whose subtypes are being added, only a
+    // type that contains itself gets there.
+    if (Iter->second == 0)
+      Failed = true;
+    return Iter->second;
+  }
+
+  auto assignID = [this](const ASTType *T) {
+    std::uint32_t ID = Types.size() + ModuleFile::NumBuiltinTypes + 1;
+    Types.push_back(T);
+    TypeIDs[T] = ID;
+    return ID;
+  };
+  // The reader builds an anonymous type from its subtypes, they come first.
+  // A class type is filled in after all the types are built, it may contain
+  // a type that comes after it.
+  if (auto Anon = std::dynamic_pointer_cast<AnonymousType>(Type)) {
+    TypeIDs[Type.get()] = 0;
+    for (const auto &SubType : Anon->getSubTypes())
+      addType(SubType);
+    return assignID(Type.get());
+  }
+  std::uint32_t ID = assignID(Type.get());
+  if (auto UDT = std::dynamic_pointer_cast<UserDefinedType>(Type))
+    for (const auto &Member : UDT->getMemberTypes())
+      addType(Member.first);
+  return ID;
+}
+
+/// getReferences - Get the nodes Node refers to, in the order they are
+/// written. The function a call refers to isn't one of them, a call may be in
+/// the body of its function.
+static void getReferences(const StatementAST *Node,
+                          std::vector<const StatementAST *> &Refs) {
+  if (auto DRE = dynamic_cast<const DeclRefExpr *>(Node)) {
+    Refs.push_back(DRE->getDecl());
+  } else if (auto BE = dynamic_cast<const BinaryExpr *>(Node)) {
+    Refs.push_back(BE->getLHS());
+    Refs.push_back(BE->getRHS());
+  } else if (auto UE = dynamic_cast<const UnaryExpr *>(Node)) {
+    Refs.push_back(UE->getSubExpr());
+  } else if (auto CE = dynamic_cast<const CallExpr *>(Node)) {
+    Refs.insert(Refs.end(), CE->getArgs().begin(), CE->getArgs().end());
+  } else if (auto ME = dynamic_cast<const MemberExpr *>(Node)) {
+    Refs.push_back(ME->getBase());
+  } else if (auto AIE = dynamic_cast<const AnonymousInitExpr *>(Node)) {
+    Refs.insert(Refs.end(), AIE->getInitExprs().begin(),
+                AIE->getInitExprs().end());
+  } else if (auto CS = dynamic_cast<const CompoundStmt *>(Node)) {
+    for (std::size_t i = 0; i < CS->getSize(); ++i)
+      Refs.push_back(CS->getSubStmt(i));
+  } else if (auto IS = dynamic_cast<const IfStatement *>(Node)) {
+    Refs.push_back(IS->getCondition());
+    Refs.push_back(IS->getThen());
+    Refs.push_back(IS->getElse());
+  } else if (auto WS = dynamic_cast<const WhileStatement *>(Node)) {
+    Refs.push_back(WS->getCondition());
+    Refs.push_back(WS->getLoopBody());
+  } else if (auto RS = dynamic_cast<const ReturnStatement *>(Node)) {
+    Refs.push_back(RS->getSubExpr());
+  } else if (auto ES = dynamic_cast<const ExprStatement *>(Node)) {
+    Refs.push_back(ES->getExpr());
+  } else if (auto VD = dynamic_cast<const VarDecl *>(Node)) {
+    Refs.push_back(VD->getInitExpr());
+  } else if (auto UD = dynamic_cast<const UnpackDecl *>(Node)) {
+    Refs.insert(Refs.end(), UD->getSubDecls().begin(),
+                UD->getSubDecls().end());
+  } else if (auto FD = dynamic_cast<const FunctionDecl *>(Node)) {
+    Refs.insert(Refs.end(), FD->getParms().begin(), FD->getParms().end());
+    Refs.push_back(FD->getCompoundBody());
+  } else if (auto CD = dynamic_cast<const ClassDecl *>(Node)) {
+    Refs.push_back(CD->getBody());
+  }
+}
+
+std::uint32_t ModuleWriter::addNode(const StatementAST *Root) {
+  if (!Root)
+    return 0;
+  // The AST is walked with an explicit stack, it may be deeper than the
+  // native one. A node is numbered once the nodes it refers to are, zero
+  // marks a node whose references are being added.
+  std::vector<std::pair<const StatementAST *, bool>> Stack;
+  std::vector<const StatementAST *> Refs;
+  Stack.push_back({Root, false});
+  while (!Stack.empty()) {
+    auto [Node, Expanded] = Stack.back();
+    if (Expanded) {
+      Stack.pop_back();
+      NodeIDs[Node] = Nodes.size() + 1;
+      Nodes.push_back(Node);
+      continue;
+    }
+    auto Iter = NodeIDs.find(Node);
+    if (Iter != NodeIDs.end()) {
+      // Only a node that refers to itself meets a zero.
+      if (Iter->second == 0)
+        Failed = true;
+      Stack.pop_back();
+      continue;
+    }
+    NodeIDs[Node] = 0;
+    Stack.back().second = true;
+    Refs.clear();
+    getReferences(Node, Refs);
+    for (auto Ref = Refs.rbegin(); Ref != Refs.rend(); ++Ref)
+      if (*Ref)
+        Stack.push_back({*Ref, false});
+  }
+  return NodeIDs[Root];
+}
+
+std::uint32_t ModuleWriter::addScope(const std::shared_ptr<Scope> &S) {
+  if (!S)
+    return 0;
+  auto Iter = ScopeIDs.find(S.get());
+  if (Iter != ScopeIDs.end())
+    return Iter->second;
+  // The parent comes first, adding it may add this scope as well.
+  addScope(S->getParent());
+  Iter = ScopeIDs.find(S.get());
+  if (Iter != ScopeIDs.end())
+    return Iter->second;
+
+  std::uint32_t ID = Scopes.size() + 1;
+  Scopes.push_back(S.get());
+  ScopeIDs[S.get()] = ID;
+  for (std::size_t i = 0; i < S->getNumDefs(); ++i)
+    addSymbol(S->getDef(i));
+  addSymbol(S->getTheSymbolBelongTo());
+  return ID;
+}
+
+std::uint32_t ModuleWriter::addSymbol(const std::shared_ptr<Symbol> &Sym) {
+  if (!Sym)
+    return 0;
+  auto Iter = SymbolIDs.find(Sym.get());
+  if (Iter != SymbolIDs.end())
+    return Iter->second;
+
+  // The parameters of a function come before it, nothing else a symbol
+  // refers to needs to be built first.
+  auto Func = std::dynamic_pointer_cast<FunctionSymbol>(Sym);
+  if (Func)
+    for (std::size_t i = 0; i < Func->getParmNum(); ++i)
+      addSymbol((*Func)[i]);
+  Iter = SymbolIDs.find(Sym.get());
+  if (Iter != SymbolIDs.end())
+    return Iter->second;
+  std::uint32_t ID = Symbols.size() + 1;
+  Symbols.push_back(Sym.get());
+  SymbolIDs[Sym.get()] = ID;
+
+  addScope(Sym->getBelongTo());
+  addType(Sym->getType());
+  if (auto Var = std::dynamic_pointer_cast<VariableSymbol>(Sym)) {
+    addNode(Var->getDecl());
+  } else if (auto Parm = std::dynamic_pointer_cast<ParmDeclSymbol>(Sym)) {
+    addNode(Parm->getDecl());
+  } else if (Func) {
+    addScope(Func->getScope());
+    addNode(Func->getFuncDeclPointer());
+  } else if (auto Class = std::dynamic_pointer_cast<ClassSymbol>(Sym)) {
+    addScope(Class->getScope());
+  } else if (auto ScopeSym = std::dynamic_pointer_cast<ScopeSymbol>(Sym)) {
+    addScope(ScopeSym->getScope());
+  } else {
+    Failed = true;
+  }
+  return ID;
+}
+
+std::uint32_t ModuleWriter::getScopeID(const Scope *S) {
+  if (!S)
+    return 0;
+  auto Iter = ScopeIDs.find(S);
+  if (Iter == ScopeIDs.end()) {
+    Failed = true;
+    return 0;
+  }
+  return Iter->second;
+}
+
+std::uint32_t ModuleWriter::getSymbolID(const Symbol *Sym) {
+  if (!Sym)
+    return 0;
+  auto Iter = SymbolIDs.find(Sym);
+  if (Iter == SymbolIDs.end()) {
+    Failed = true;
+    return 0;
+  }
+  return Iter->second;
+}
+
+void ModuleWriter::writeType(std::string &Out, const ASTType *Type) {
+  using ModuleFile::TypeClass;
+  if (auto UDT = dynamic_cast<const UserDefinedType *>(Type)) {
+    writeNumber(Out, unsigned(TypeClass::UserDefined));
+    writeNumber(Out, unsigned(Type->getKind()));
+    writeNumber(Out, addString(UDT->getTypeName()));
+    auto Members = UDT->getMemberTypes();
+    writeNumber(Out, Members.size());
+    for (const auto &Member : Members) {
+      writeNumber(Out, addType(Member.first));
+      writeNumber(Out, addString(Member.second));
+    }
+  } else if (auto Anon = dynamic_cast<const AnonymousType *>(Type)) {
+    writeNumber(Out, unsigned(TypeClass::Anonymous));
+    writeNumber(Out, unsigned(Type->getKind()));
+    auto SubTypes = Anon->getSubTypes();
+    writeNumber(Out, SubTypes.size());
+    for (const auto &SubType : SubTypes)
+      writeNumber(Out, addType(SubType));
+  } else {
+    writeNumber(Out, unsigned(dynamic_cast<const BuiltinType *>(Type)
+                                  ? TypeClass::Builtin
+                                  : TypeClass::Plain));
+    writeNumber(Out, unsigned(Type->getKind()));
+  }
+}
+
+void ModuleWriter::writeNode(std::string &Out, const StatementAST *Node) {
+  using ModuleFile::NodeKind;
+  // The kind and the value flags of an expression share a byte.
+  auto writeKind = [&](NodeKind Kind) {
+    auto E = dynamic_cast<const Expr *>(Node);
+    unsigned Flags = unsigned(Kind);
+    if (E)
+      Flags |= E->isLValue() << ModuleFile::LValueBit |
+               E->canBeEvaluated() << ModuleFile::CanBeEvaluatedBit;
+    writeNumber(Out, Flags);
+    writeLoc(Out, LastLoc, Node->getLocStart());
+    std::uint32_t Start = LastLoc;
+    writeLoc(Out, Start, Node->getLocEnd());
+    if (E)
+      writeNumber(Out, addType(E->getType()));
+  };
+  // A node refers to the nodes before it by the distance to them, most
+  // are close.
+  auto writeRef = [&](const StatementAST *Ref) {
+    writeNumber(Out, Ref ? NodeIDs[Node] - NodeIDs[Ref] : 0);
+  };
+  auto writeRefs = [&](auto Refs) {
+    writeNumber(Out, Refs.size());
+    for (const StatementAST *Ref : Refs)
+      writeRef(Ref);
+  };
+
+  if (auto NE = dynamic_cast<const NumberExpr *>(Node)) {
+    writeKind(NodeKind::NumberExpr);
+    writeDouble(Out, NE->getVal());
+  } else if (auto CE = dynamic_cast<const CharExpr *>(Node)) {
+    writeKind(NodeKind::CharExpr);
+    writeNumber(Out, addString(CE->getChar()));
+  } else if (auto SL = dynamic_cast<const StringLiteral *>(Node)) {
+    writeKind(NodeKind::StringLiteral);
+    writeNumber(Out, addString(SL->getString()));
+  } else if (auto BL = dynamic_cast<const BoolLiteral *>(Node)) {
+    writeKind(NodeKind::BoolLiteral);
+    writeNumber(Out, BL->getVal());
+  } else if (auto DRE = dynamic_cast<const DeclRefExpr *>(Node)) {
+    writeKind(NodeKind::DeclRefExpr);
+    writeNumber(Out, addString(DRE->getDeclName()));
+    writeRef(DRE->getDecl());
+  } else if (auto BE = dynamic_cast<const BinaryExpr *>(Node)) {
+    writeKind(NodeKind::BinaryExpr);
+    writeNumber(Out, addString(BE->getOpcode()));
+    writeRef(BE->getLHS());
+    writeRef(BE->getRHS());
+  } else if (auto UE = dynamic_cast<const UnaryExpr *>(Node)) {
+    writeKind(NodeKind::UnaryExpr);
+    writeNumber(Out, addString(UE->getOpcode()));
+    writeRef(UE->getSubExpr());
+  } else if (auto Call = dynamic_cast<const CallExpr *>(Node)) {
+    writeKind(NodeKind::CallExpr);
+    writeNumber(Out, addString(Call->getCalleeName()));
+    // The function may come after the call, it is saved by its index.
+    const FunctionDecl *FD = Call->getFuncDecl();
+    writeNumber(Out, FD ? NodeIDs[FD] : 0);
+    writeRefs(Call->getArgs());
+  } else if (auto ME = dynamic_cast<const MemberExpr *>(Node)) {
+    writeKind(NodeKind::MemberExpr);
+    writeRef(ME->getBase());
+    std::uint32_t Start = ME->getLocStart().getOffset();
+    writeLoc(Out, Start, ME->getOperatorLoc());
+    writeNumber(Out, addString(ME->getMemberName()));
+    writeNumber(Out, ME->getIdx());
+  } else if (auto AIE = dynamic_cast<const AnonymousInitExpr *>(Node)) {
+    writeKind(NodeKind::AnonymousInitExpr);
+    writeRefs(AIE->getInitExprs());
+  } else if (auto CS = dynamic_cast<const CompoundStmt *>(Node)) {
+    writeKind(NodeKind::CompoundStmt);
+    writeNumber(Out, CS->getSize());
+    for (std::size_t i = 0; i < CS->getSize(); ++i)
+      writeRef(CS->getSubStmt(i));
+    writeNumber(Out, getScopeID(CS->getScope()));
+  } else if (auto IS = dynamic_cast<const IfStatement *>(Node)) {
+    writeKind(NodeKind::IfStatement);
+    writeRef(IS->getCondition());
+    writeRef(IS->getThen());
+    writeRef(IS->getElse());
+  } else if (auto WS = dynamic_cast<const WhileStatement *>(Node)) {
+    writeKind(NodeKind::WhileStatement);
+    writeRef(WS->getCondition());
+    writeRef(WS->getLoopBody());
+  } else if (dynamic_cast<const BreakStatement *>(Node)) {
+    writeKind(NodeKind::BreakStatement);
+  } else if (dynamic_cast<const ContinueStatement *>(Node)) {
+    writeKind(NodeKind::ContinueStatement);
+  } else if (auto RS = dynamic_cast<const ReturnStatement *>(Node)) {
+    writeKind(NodeKind::ReturnStatement);
+    writeRef(RS->getSubExpr());
+  } else if (auto ES = dynamic_cast<const ExprStatement *>(Node)) {
+    writeKind(NodeKind::ExprStatement);
+    writeRef(ES->getExpr());
+  } else if (auto VD = dynamic_cast<const VarDecl *>(Node)) {
+    // A ParameterDecl is a VarDecl without an initializer of its own.
+    writeKind(dynamic_cast<const ParameterDecl *>(Node)
+                  ? NodeKind::ParameterDecl
+                  : NodeKind::VarDecl);
+    writeNumber(Out, addString(VD->getName()));
+    writeNumber(Out, addType(VD->getDeclType()));
+    writeNumber(Out, VD->isConst());
+    writeRef(VD->getInitExpr());
+  } else if (auto UD = dynamic_cast<const UnpackDecl *>(Node)) {
+    writeKind(NodeKind::UnpackDecl);
+    writeNumber(Out, addType(UD->getDeclType()));
+    writeRefs(UD->getSubDecls());
+  } else if (auto FD = dynamic_cast<const FunctionDecl *>(Node)) {
+    writeKind(NodeKind::FunctionDecl);
+    writeNumber(Out, addString(FD->getFDName()));
+    writeRefs(FD->getParms());
+    writeRef(FD->getCompoundBody());
+    writeNumber(Out, addType(FD->getReturnType()));
+    writeNumber(Out, FD->isBuiltin());
+  } else if (auto CD = dynamic_cast<const ClassDecl *>(Node)) {
+    writeKind(NodeKind::ClassDecl);
+    writeNumber(Out, addString(CD->getClassName()));
+    writeRef(CD->getBody());
+  } else {
+    Failed = true;
+  }
+}
+
+void ModuleWriter::writeSymbol(std::string &Out, const Symbol *Sym) {
+  using ModuleFile::SymbolClass;
+  auto writeCommon = [&](SymbolClass Class) {
+    writeNumber(Out, unsigned(Class));
+    writeNumber(Out, addString(Sym->getLexem()));
+    writeNumber(Out, addScope(Sym->getBelongTo()));
+    writeNumber(Out, addType(Sym->getType()));
+  };
+  auto writeRef = [&](const StatementAST *Ref) {
+    writeNumber(Out, Ref ? NodeIDs[Ref] : 0);
+  };
+
+  if (auto Var = dynamic_cast<const VariableSymbol *>(Sym)) {
+    writeCommon(SymbolClass::Variable);
+    writeNumber(Out, Var->isInitial());
+    writeRef(Var->getDecl());
+  } else if (auto Parm = dynamic_cast<const ParmDeclSymbol *>(Sym)) {
+    writeCommon(SymbolClass::ParmDecl);
+    writeRef(Parm->getDecl());
+  } else if (auto Func = dynamic_cast<const FunctionSymbol *>(Sym)) {
+    writeCommon(SymbolClass::Function);
+    writeNumber(Out, addScope(Func->getScope()));
+    writeNumber(Out, Func->getParmNum());
+    for (std::size_t i = 0; i < Func->getParmNum(); ++i)
+      writeNumber(Out, addSymbol((*Func)[i]));
+    writeRef(Func->getFuncDeclPointer());
+  } else if (auto Class = dynamic_cast<const ClassSymbol *>(Sym)) {
+    writeCommon(SymbolClass::Class);
+    writeNumber(Out, addScope(Class->getScope()));
+  } else if (auto ScopeSym = dynamic_cast<const ScopeSymbol *>(Sym)) {
+    writeCommon(SymbolClass::Scope);
+    writeNumber(Out, addScope(ScopeSym->getScope()));
+  } else {
+    Failed = true;
+  }
+}
+
+bool ModuleWriter::write(const std::string &ModulePath,
+                         std::string_view Source, std::uint32_t FileBase,
+                         const ASTPtr &AST,
+                         const std::shared_ptr<Scope> &TopScope) {
+  // Number everything first. Writing the tables adds no node, scope or
+  // symbol, only the strings and types they name.
+  for (const StatementAST *Stmt : AST)
+    addNode(Stmt);
+  std::uint32_t TopScopeID = addScope(TopScope);
+  // The functions that are only reached by a call, e.g. a builtin one.
+  for (std::size_t i = 0; i < Nodes.size(); ++i)
+    if (auto CE = dynamic_cast<const CallExpr *>(Nodes[i]))
+      addNode(CE->getFuncDecl());
+  for (const auto &UDT : Ctx.UDTypes)
+    addType(UDT);
+  for (const auto &Anon : Ctx.AnonTypes)
+    addType(Anon);
+
+  std::string NodeTable;
+  writeNumber(NodeTable, Nodes.size());
+  for (const StatementAST *Node : Nodes)
+    writeNode(NodeTable, Node);
+
+  std::string SymbolTable;
+  writeNumber(SymbolTable, Symbols.size());
+  for (const Symbol *Sym : Symbols)
+    writeSymbol(SymbolTable, Sym);
+
+  std::string ScopeTable;
+  std::string Bindings;
+  writeNumber(ScopeTable, Scopes.size());
+  for (const Scope *S : Scopes) {
+    writeNumber(ScopeTable, addString(S->getScopeName()));
+    writeNumber(ScopeTable, addScope(S->getParent()));
+    writeNumber(ScopeTable, unsigned(S->getFlags()));
+    writeNumber(ScopeTable, S->getDepth());
+    writeNumber(Bindings, addSymbol(S->getTheSymbolBelongTo()));
+    writeNumber(Bindings, S->getNumDefs());
+    for (std::size_t i = 0; i < S->getNumDefs(); ++i)
+      writeNumber(Bindings, addSymbol(S->getDef(i)));
+  }
+  for (const StatementAST *Node : Nodes) {
+    if (auto VD = dynamic_cast<const VarDecl *>(Node))
+      writeNumber(Bindings, getSymbolID(VD->getSymbol()));
+    else if (auto FD = dynamic_cast<const FunctionDecl *>(Node))
+      writeNumber(Bindings, getSymbolID(FD->getSymbol()));
+    else if (auto CE = dynamic_cast<const CallExpr *>(Node))
+      writeNumber(Bindings, getSymbolID(CE->getCalleeSymbol()));
+  }
+
+  std::string Program;
+  writeNumber(Program, TopScopeID);
+  writeNumber(Program, AST.size());
+  for (const StatementAST *Stmt : AST)
+    writeNumber(Program, NodeIDs[Stmt]);
+  const auto &UDTypes = Ctx.UDTypes.getBuckets();
+  writeNumber(Program, UDTypes.size());
+  for (const auto &UDT : UDTypes)
+    writeNumber(Program, addType(UDT));
+  const auto &AnonTypes = Ctx.AnonTypes.getBuckets();
+  writeNumber(Program, AnonTypes.size());
+  for (const auto &Anon : AnonTypes)
+    writeNumber(Program, addType(Anon));
+
+  // The types name strings, so the string table is written last.
+  std::string TypeTable;
+  writeNumber(TypeTable, Types.size());
+  for (const ASTType *Type : Types)
+    writeType(TypeTable, Type);
+
+  std::string Payload;
+  writeNumber(Payload, Strings.size());
+  for (const std::string *Str : Strings) {
+    writeNumber(Payload, Str->size());
+    Payload += *Str;
+  }
+  Payload += TypeTable;
+  Payload += ScopeTable;
+  Payload += NodeTable;
+  Payload += SymbolTable;
+  Payload += Bindings;
+  Payload += Program;
+  if (Failed)
+    return false;
+
+  ModuleFile::Header Header;
+  std::memcpy(Header.Magic, ModuleFile::Magic, sizeof(Header.Magic));
+  Header.Version = ModuleFile::Version;
+  Header.FileBase = FileBase;
+  Header.SourceSize = Source.size();
+  Header.SourceHash = ModuleFile::hashSource(Source);
+  Header.PayloadHash = ModuleFile::hashSource(Payload);
+
+  // The module is written aside and renamed over the old one, so a run
+  // that reads it meanwhile sees either of them whole.
+  std::string TempPath =
+      ModulePath + ".tmp" + std::to_string(std::random_device()());
+  {
+    std::ofstream Out(TempPath, std::ios::binary);
+    Out.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+    Out.write(Payload.data(), Payload.size());
+    if (!Out.flush()) {
+      Out.close();
+      std::remove(TempPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(TempPath.c_str(), ModulePath.c_str()) != 0) {
+    std::remove(TempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+//===---------------------------------------------------------------------===//
+// Implement class ModuleReader.
+namespace {
+/// ModuleLoader - The state of one read of a module. Every read checks the
+/// bounds, a damaged module only makes it fail.
+class ModuleLoader {
+  ASTContext &Ctx;
+  const unsigned char *Ptr;
+  const unsigned char *End;
+  bool Failed;
+  // The start of the last node read, see writeLoc.
+  std::uint32_t LastLoc;
+
+  std::vector<std::string_view> Strings;
+  // Index 0 of every table is nullptr.
+  std::vector<std::shared_ptr<ASTType>> Types;
+  std::vector<std::shared_ptr<Scope>> Scopes;
+  std::vector<StatementAST *> Nodes;
+  std::vector<std::shared_ptr<Symbol>> Symbols;
+  // The calls and the index of their function, which may come after them.
+  std::vector<std::pair<CallExpr *, std::size_t>> Callees;
+
+  std::uint64_t readNumber() {
+    std::uint64_t Value = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      if (Ptr == End)
+        break;
+      unsigned char Byte = *Ptr++;
+      Value |= std::uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return Value;
+    }
+    Failed = true;
+    return 0;
+  }
+  /// \brief Read a number that must be less than Limit.
+  std::size_t readIndex(std::size_t Limit) {
+    std::uint64_t Value = readNumber();
+    if (Value >= Limit) {
+      Failed = true;
+      return 0;
+    }
+    return Value;
+  }
+  double readDouble() {
+    std::uint64_t Number = readNumber();
+    if (!(Number & 1))
+      return double(Number >> 1);
+    double Value = 0;
+    if (std::size_t(End - Ptr) < sizeof(double)) {
+      Failed = true;
+      return Value;
+    }
+    std::memcpy(&Value, Ptr, sizeof(double));
+    Ptr += sizeof(double);
+    return Value;
+  }
+  bool readBool() { return readIndex(2); }
+  std::string readString() {
+    std::size_t Index = readIndex(Strings.size());
+    return Failed ? std::string() : std::string(Strings[Index]);
+  }
+  SourceLocation readLoc(std::uint32_t &Base) {
+    std::uint64_t Number = readNumber();
+    std::int64_t Delta = Number & 1 ? -std::int64_t((Number + 1) >> 1)
+                                    : std::int64_t(Number >> 1);
+    std::int64_t Offset = std::int64_t(Base) + Delta;
+    if (Offset < 0 || Offset > std::numeric_limits<std::uint32_t>::max()) {
+      Failed = true;
+      Offset = 0;
+    }
+    Base = Offset;
+    return SourceLocation(TokenLocation(Base));
+  }
+  std::shared_ptr<ASTType> readType() { return Types[readIndex(Types.size())]; }
+  std::shared_ptr<Scope> readScope() {
+    return Scopes[readIndex(Scopes.size())];
+  }
+  /// \brief Read a reference to a node of the class T, or nullptr.
+  template <typename T> T *readNode() {
+    StatementAST *Node = Nodes[readIndex(Nodes.size())];
+    T *Result = dynamic_cast<T *>(Node);
+    if (Node && !Result)
+      Failed = true;
+    return Result;
+  }
+  /// \brief Read a reference of the node being read to a node of the class
+  /// T before it, or nullptr.
+  template <typename T> T *readChild() {
+    std::size_t Distance = readIndex(Nodes.size());
+    StatementAST *Node = Distance ? Nodes[Nodes.size() - Distance] : nullptr;
+    T *Result = dynamic_cast<T *>(Node);
+    if (Node && !Result)
+      Failed = true;
+    return Result;
+  }
+  template <typename T> std::span<T *const> readChildren() {
+    std::vector<T *> Result(readCount());
+    for (auto &Node : Result)
+      Node = readChild<T>();
+    return Ctx.copyArray(Result);
+  }
+  template <typename T> std::shared_ptr<T> readSymbol() {
+    const auto &Sym = Symbols[readIndex(Symbols.size())];
+    auto Result = std::dynamic_pointer_cast<T>(Sym);
+    if (Sym && !Result)
+      Failed = true;
+    return Result;
+  }
+  /// \brief Read the number of entries of a table, each takes a byte at
+  /// least.
+  std::size_t readCount() { return readIndex(End - Ptr + 1); }
+
+  bool readStringTable();
+  bool readTypeTable();
+  bool readScopeTable();
+  bool readNodeTable();
+  StatementAST *readNodeEntry();
+  bool readSymbolTable();
+  bool readBindings();
+
+public:
+  ModuleLoader(ASTContext &Ctx, std::string_view Payload)
+      : Ctx(Ctx), Ptr(reinterpret_cast<const unsigned char *>(Payload.data())),
+        End(Ptr + Payload.size()), Failed(false), LastLoc(0) {}
+
+  bool load(ASTPtr &AST, std::shared_ptr<Scope> &TopScope);
+};
+} // namespace
+
+bool ModuleLoader::readStringTable() {
+  Strings.resize(readCount());
+  for (auto &Str : Strings) {
+    std::size_t Size = readIndex(End - Ptr + 1);
+    Str = std::string_view(reinterpret_cast<const char *>(Ptr), Size);
+    Ptr += Size;
+  }
+  return !Failed;
+}
+
+bool ModuleLoader::readTypeTable() {
+  using ModuleFile::TypeClass;
+  struct TypeEntry {
+    TypeClass Class;
+    TypeKind Kind;
+    std::size_t Name;
+    std::vector<std::pair<std::size_t, std::size_t>> SubTypes;
+  };
+  std::vector<TypeEntry> Entries(readCount());
+  std::size_t NumTypes = Entries.size() + ModuleFile::NumBuiltinTypes + 1;
+  for (auto &Entry : Entries) {
+    Entry.Class = TypeClass(readIndex(unsigned(TypeClass::Anonymous) + 1));
+    Entry.Kind = TypeKind(readIndex(unsigned(TypeKind::ANONYMOUS) + 1));
+    if (Entry.Class == TypeClass::UserDefined) {
+      Entry.Name = readIndex(Strings.size());
+      Entry.SubTypes.resize(readCount());
+      for (auto &SubType : Entry.SubTypes) {
+        SubType.first = readIndex(NumTypes);
+        SubType.second = readIndex(Strings.size());
+      }
+    } else if (Entry.Class == TypeClass::Anonymous) {
+      Entry.SubTypes.resize(readCount());
+      for (auto &SubType : Entry.SubTypes)
+        SubType.first = readIndex(NumTypes);
+    }
+    if (Failed)
+      return false;
+  }
+
+  // The class types are built first and filled in last, an anonymous type
+  // needs its subtypes built.
+  Types = {nullptr, Ctx.Int, Ctx.Bool, Ctx.Void};
+  for (const auto &Entry : Entries) {
+    switch (Entry.Class) {
+    case TypeClass::Plain:
+      Types.push_back(std::make_shared<ASTType>(Entry.Kind));
+      break;
+    case TypeClass::Builtin:
+      Types.push_back(std::make_shared<BuiltinType>(Entry.Kind));
+      break;
+    case TypeClass::UserDefined:
+      Types.push_back(std::make_shared<UserDefinedType>(
+          Entry.Kind, std::string(Strings[Entry.Name])));
+      break;
+    case TypeClass::Anonymous:
+      Types.push_back(nullptr);
+      break;
+    }
+  }
+  for (std::size_t i = 0; i < Entries.size(); ++i) {
+    const TypeEntry &Entry = Entries[i];
+    if (Entry.Class != TypeClass::Anonymous)
+      continue;
+    std::vector<std::shared_ptr<ASTType>> SubTypes;
+    for (const auto &SubType : Entry.SubTypes) {
+      if (SubType.first && !Types[SubType.first])
+        return false;
+      SubTypes.push_back(Types[SubType.first]);
+    }
+    Types[i + ModuleFile::NumBuiltinTypes + 1] =
+        std::make_shared<AnonymousType>(SubTypes);
+  }
+  for (std::size_t i = 0; i < Entries.size(); ++i) {
+    if (Entries[i].Class != TypeClass::UserDefined)
+      continue;
+    auto UDT = std::static_pointer_cast<UserDefinedType>(
+        Types[i + ModuleFile::NumBuiltinTypes + 1]);
+    for (const auto &SubType : Entries[i].SubTypes)
+      UDT->addSubType(Types[SubType.first],
+                      std::string(Strings[SubType.second]));
+  }
+  return true;
+}
+
+bool ModuleLoader::readScopeTable() {
+  std::size_t NumScopes = readCount();
+  Scopes.reserve(NumScopes + 1);
+  Scopes.push_back(nullptr);
+  for (std::size_t i = 0; i < NumScopes && !Failed; ++i) {
+    std::string Name = readString();
+    // The parent comes first.
+    std::shared_ptr<Scope> Parent = readScope();
+    auto Kind = Scope::ScopeKind(
+        readIndex(unsigned(Scope::ScopeKind::SK_TopLevel) + 1));
+    unsigned Depth =
+        readIndex(std::numeric_limits<unsigned short>::max() + 1);
+    Scopes.push_back(std::make_shared<Scope>(Name, Depth, Parent, Kind));
+  }
+  return !Failed;
+}
+
+StatementAST *ModuleLoader::readNodeEntry() {
+  using ModuleFile::NodeKind;
+  unsigned Flags = readIndex(1u << (ModuleFile::CanBeEvaluatedBit + 1));
+  auto Kind = NodeKind(Flags & ((1u << ModuleFile::LValueBit) - 1));
+  if (Kind > NodeKind::ClassDecl) {
+    Failed = true;
+    return nullptr;
+  }
+  SourceLocation Start = readLoc(LastLoc);
+  std::uint32_t StartOffset = LastLoc;
+  SourceLocation End = readLoc(StartOffset);
+  std::shared_ptr<ASTType> Type;
+  auto VK = Flags >> ModuleFile::LValueBit & 1
+                ? Expr::ExprValueKind::VK_LValue
+                : Expr::ExprValueKind::VK_RValue;
+  bool CanBeEvaluated = Flags >> ModuleFile::CanBeEvaluatedBit & 1;
+  if (Kind <= NodeKind::AnonymousInitExpr)
+    Type = readType();
+
+  Expr *E = nullptr;
+  switch (Kind) {
+  case NodeKind::NumberExpr:
+    E = Ctx.create<NumberExpr>(Start, End, readDouble());
+    break;
+  case NodeKind::CharExpr:
+    E = Ctx.create<CharExpr>(Start, End, readString());
+    break;
+  case NodeKind::StringLiteral:
+    E = Ctx.create<StringLiteral>(Start, End, Type, readString());
+    break;
+  case NodeKind::BoolLiteral:
+    E = Ctx.create<BoolLiteral>(Start, End, readBool());
+    break;
+  case NodeKind::DeclRefExpr: {
+    std::string Name = readString();
+    E = Ctx.create<DeclRefExpr>(Start, End, Type, Name, readChild<VarDecl>());
+    break;
+  }
+  case NodeKind::BinaryExpr: {
+    std::string Op = readString();
+    Expr *LHS = readChild<Expr>();
+    E = Ctx.create<BinaryExpr>(Start, End, Type, Op, LHS, readChild<Expr>());
+    break;
+  }
+  case NodeKind::UnaryExpr: {
+    std::string Op = readString();
+    E = Ctx.create<UnaryExpr>(Start, End, Type, Op, readChild<Expr>(), VK);
+    break;
+  }
+  case NodeKind::CallExpr: {
+    std::string Callee = readString();
+    std::size_t FD = readNumber();
+    auto Call = Ctx.create<CallExpr>(Start, End, Type, Callee,
+                                     readChildren<Expr>(), VK, nullptr,
+                                     CanBeEvaluated);
+    Callees.push_back({Call, FD});
+    E = Call;
+    break;
+  }
+  case NodeKind::MemberExpr: {
+    Expr *Base = readChild<Expr>();
+    StartOffset = Start.getOffset();
+    SourceLocation OperatorLoc = readLoc(StartOffset);
+    std::string Name = readString();
+    E = Ctx.create<MemberExpr>(Start, End, Type, Base, OperatorLoc, Name,
+                               CanBeEvaluated, readNumber());
+    break;
+  }
+  case NodeKind::AnonymousInitExpr:
+    E = Ctx.create<AnonymousInitExpr>(Start, End, readChildren<Expr>(), Type);
+    break;
+  case NodeKind::CompoundStmt: {
+    auto SubStmts = readChildren<StatementAST>();
+    return Ctx.create<CompoundStmt>(Start, End, SubStmts, readScope().get());
+  }
+  case NodeKind::IfStatement: {
+    Expr *Condition = readChild<Expr>();
+    StatementAST *Then = readChild<StatementAST>();
+    return Ctx.create<IfStatement>(Start, End, Condition, Then,
+                                   readChild<StatementAST>());
+  }
+  case NodeKind::WhileStatement: {
+    Expr *Condition = readChild<Expr>();
+    return Ctx.create<WhileStatement>(Start, End, Condition,
+                                      readChild<StatementAST>());
+  }
+  case NodeKind::BreakStatement:
+    return Ctx.create<BreakStatement>(Start, End);
+  case NodeKind::ContinueStatement:
+    return Ctx.create<ContinueStatement>(Start, End);
+  case NodeKind::ReturnStatement:
+    return Ctx.create<ReturnStatement>(Start, End, readChild<Expr>());
+  case NodeKind::ExprStatement:
+    return Ctx.create<ExprStatement>(Start, End, readChild<Expr>());
+  case NodeKind::VarDecl:
+  case NodeKind::ParameterDecl: {
+    std::string Name = readString();
+    std::shared_ptr<ASTType> DeclType = readType();
+    bool IsConst = readBool();
+    Expr *Init = readChild<Expr>();
+    if (Kind == NodeKind::VarDecl)
+      return Ctx.create<VarDecl>(Start, End, Name, DeclType, IsConst, Init);
+    auto PD = Ctx.create<ParameterDecl>(Start, End, Name, IsConst, DeclType);
+    PD->setInitExpr(Init);
+    return PD;
+  }
+  case NodeKind::UnpackDecl: {
+    std::shared_ptr<ASTType> DeclType = readType();
+    auto UD = Ctx.create<UnpackDecl>(Start, End, readChildren<DeclStatement>());
+    UD->setCorrespondingType(DeclType);
+    return UD;
+  }
+  case NodeKind::FunctionDecl: {
+    std::string Name = readString();
+    auto Parms = readChildren<ParameterDecl>();
+    StatementAST *Body = readChild<StatementAST>();
+    std::shared_ptr<ASTType> ReturnType = readType();
+    return Ctx.create<FunctionDecl>(Start, End, Name, Parms, Body, ReturnType,
+                                    readBool());
+  }
+  case NodeKind::ClassDecl: {
+    std::string Name = readString();
+    return Ctx.create<ClassDecl>(Start, End, Name, readChild<StatementAST>());
+  }
+  }
+
+  // The parser and Sema give some expressions their type and value kind
+  // after they are built.
+  E->setType(Type);
+  E->setExprValueKind(VK);
+  if (CanBeEvaluated)
+    E->setCanBeEvaluated();
+  return E;
+}
+
+bool ModuleLoader::readNodeTable() {
+  std::size_t NumNodes = readCount();
+  Nodes.reserve(NumNodes + 1);
+  Nodes.push_back(nullptr);
+  for (std::size_t i = 0; i < NumNodes && !Failed; ++i)
+    Nodes.push_back(readNodeEntry());
+  for (auto [Call, FD] : Callees) {
+    if (Failed || FD >= Nodes.size())
+      return false;
+    Call->setFuncDecl(dynamic_cast<FunctionDecl *>(Nodes[FD]));
+    if (Nodes[FD] && !Call->getFuncDecl())
+      return false;
+  }
+  return !Failed;
+}
+
+bool ModuleLoader::readSymbolTable() {
+  using ModuleFile::SymbolClass;
+  std::size_t NumSymbols = readCount();
+  Symbols.reserve(NumSymbols + 1);
+  Symbols.push_back(nullptr);
+  for (std::size_t i = 0; i < NumSymbols && !Failed; ++i) {
+    auto Class = SymbolClass(readIndex(unsigned(SymbolClass::Scope) + 1));
+    std::string Lexem = readString();
+    std::shared_ptr<Scope> BelongTo = readScope();
+    std::shared_ptr<ASTType> Type = readType();
+    switch (Class) {
+    case SymbolClass::Variable: {
+      bool IsInitial = readBool();
+      Symbols.push_back(std::make_shared<VariableSymbol>(
+          Lexem, BelongTo, Type, IsInitial, readNode<VarDecl>()));
+      break;
+    }
+    case SymbolClass::ParmDecl:
+      Symbols.push_back(std::make_shared<ParmDeclSymbol>(
+          Lexem, BelongTo, Type, false, readNode<ParameterDecl>()));
+      break;
+    case SymbolClass::Function: {
+      auto Func =
+          std::make_shared<FunctionSymbol>(Lexem, Type, BelongTo, readScope());
+      std::size_t NumParms = readCount();
+      for (std::size_t Parm = 0; Parm < NumParms && !Failed; ++Parm)
+        Func->addParmVariableSymbol(readSymbol<ParmDeclSymbol>());
+      Func->setFunctionDeclPointer(readNode<FunctionDecl>());
+      Symbols.push_back(Func);
+      break;
+    }
+    case SymbolClass::Class: {
+      auto UDT = std::dynamic_pointer_cast<UserDefinedType>(Type);
+      if (!UDT)
+        return false;
+      Symbols.push_back(
+          std::make_shared<ClassSymbol>(Lexem, BelongTo, readScope(), UDT));
+      break;
+    }
+    case SymbolClass::Scope:
+      Symbols.push_back(std::make_shared<ScopeSymbol>(readScope(), BelongTo));
+      break;
+    }
+  }
+  return !Failed;
+}
+
+bool ModuleLoader::readBindings() {
+  for (std::size_t i = 1; i < Scopes.size() && !Failed; ++i) {
+    Scopes[i]->setBelongToSymbolForClassScope(readSymbol<ClassSymbol>());
+    std::size_t NumDefs = readCount();
+    for (std::size_t Def = 0; Def < NumDefs && !Failed; ++Def)
+      Scopes[i]->addDef(Symbols[readIndex(Symbols.size())]);
+  }
+  // The symbols are owned by the scopes and the functions, the AST only
+  // points to them.
+  for (StatementAST *Node : Nodes) {
+    if (auto VD = dynamic_cast<VarDecl *>(Node)) {
+      // A ParameterDecl is bound to a ParmDeclSymbol, a VarDecl to a
+      // VariableSymbol.
+      std::shared_ptr<Symbol> Sym;
+      if (dynamic_cast<ParameterDecl *>(VD))
+        Sym = readSymbol<ParmDeclSymbol>();
+      else
+        Sym = readSymbol<VariableSymbol>();
+      VD->setSymbol(Sym.get());
+    } else if (auto FD = dynamic_cast<FunctionDecl *>(Node)) {
+      FD->setSymbol(readSymbol<FunctionSymbol>().get());
+    } else if (auto CE = dynamic_cast<CallExpr *>(Node)) {
+      CE->setCalleeSymbol(readSymbol<FunctionSymbol>().get());
+    }
+    if (Failed)
+      break;
+  }
+  return !Failed;
+}
+
+bool ModuleLoader::load(ASTPtr &AST, std::shared_ptr<Scope> &TopScope) {
+  if (!readStringTable() || !readTypeTable() || !readScopeTable() ||
+      !readNodeTable() || !readSymbolTable() || !readBindings())
+    return false;
+
+  std::shared_ptr<Scope> Top = readScope();
+  ASTPtr Stmts(readCount());
+  for (auto &Stmt : Stmts)
+    Stmt = readNode<StatementAST>();
+  std::vector<std::shared_ptr<UserDefinedType>> UDTypes(readCount());
+  for (auto &UDT : UDTypes)
+    UDT = std::dynamic_pointer_cast<UserDefinedType>(readType());
+  std::vector<std::shared_ptr<AnonymousType>> AnonTypes(readCount());
+  for (auto &Anon : AnonTypes)
+    Anon = std::dynamic_pointer_cast<AnonymousType>(readType());
+  if (Failed || Ptr != End || !Top)
+    return false;
+
+  for (const auto &UDT : UDTypes)
+    Ctx.UDTypes.insert(UDT);
+  for (const auto &Anon : AnonTypes)
+    Ctx.AnonTypes.insert(Anon);
+  AST = std::move(Stmts);
+  TopScope = Top;
+  return true;
+}
+
+bool ModuleReader::read(const std::string &ModulePath,
+                        std::string_view Source, std::uint32_t FileBase,
+                        ASTPtr &AST, std::shared_ptr<Scope> &TopScope) {
+  lex::SourceBuffer Module;
+  if (!Module.load(ModulePath))
+    return false;
+  std::string_view Contents = Module.getBuffer();
+  ModuleFile::Header Header;
+  if (Contents.size() < sizeof(Header))
+    return false;
+  std::memcpy(&Header, Contents.data(), sizeof(Header));
+  std::string_view Payload = Contents.substr(sizeof(Header));
+  if (std::memcmp(Header.Magic, ModuleFile::Magic, sizeof(Header.Magic)) ||
+      Header.Version != ModuleFile::Version || Header.FileBase != FileBase ||
+      Header.SourceSize != Source.size() ||
+      Header.SourceHash != ModuleFile::hashSource(Source) ||
+      Header.PayloadHash != ModuleFile::hashSource(Payload))
+    return false;
+  return ModuleLoader(Ctx, Payload).load(AST, TopScope);
+}
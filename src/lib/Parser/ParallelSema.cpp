@@ -0,0 +1,58 @@
+//===----------------------------ParallelSema.cpp-------------------------===//
+//
+// This file is used to check the deferred function bodies on worker threads.
+//
+//===---------------------------------------------------------------------===//
+#include "Parser/parser.h"
+#include "Support/Parallel.h"
+#include "Support/StringInterner.h"
+#include <memory>
+
+using namespace parse;
+using namespace lex;
+
+void Parser::checkDeferredBodies() {
+  if (DeferredBodies.empty())
+    return;
+  FileCapture.reset();
+
+  // A body is checked against the symbols of the file, which the workers
+  // share read only. Every name a body makes a symbol for was interned by
+  // the lexer or by Sema already, and the locations of the errors are looked
+  // up in the line table of the file.
+  lex::SourceManager::get().buildLineTables();
+
+  std::size_t NumBodies = DeferredBodies.size();
+  std::vector<std::unique_ptr<ASTContext>> Contexts(NumBodies);
+  std::vector<DiagnosticBuffer> Diagnostics(NumBodies);
+  // The scanner of a body fails on its own, the failure is merged here.
+  std::vector<char> ScanFailed(NumBodies, false);
+  Support::runOnWorkers(NumBodies, SemaThreads, [&](std::size_t i) {
+    const DeferredBody &Body = DeferredBodies[i];
+    Support::StringInterner::ReadOnlyScope ReadOnly;
+    DiagnosticBuffer::Capture Capture(Diagnostics[i]);
+    Contexts[i] = std::make_unique<ASTContext>(Ctx);
+    Scanner BodyScan(scan, Body.FirstToken, Body.EndToken);
+    Sema BodyActions(*Contexts[i]);
+    Parser BodyParser(BodyScan, BodyActions, *Contexts[i]);
+    BodyActions.ActOnFunctionBodyStart(Body.Func, Body.BodyScope,
+                                       Body.NumTopLevelDefs);
+    BodyParser.CurrentContext = ContextKind::Function;
+    Body.FD->setCompoundBody(BodyParser.ParseCompoundStatement());
+    ScanFailed[i] = BodyScan.getErrorFlag();
+  });
+
+  // The errors of a body go where the parser skipped it, the later bodies
+  // are put in first so that the positions of the earlier ones still hold.
+  for (std::size_t i = NumBodies; i-- != 0;)
+    FileDiagnostics.splice(DeferredBodies[i].DiagnosticPos, Diagnostics[i]);
+  for (std::size_t i = 0; i != NumBodies; ++i) {
+    if (!Contexts[i]->isParseOrSemaSuccess)
+      Items[DeferredBodies[i].Item].HadErrors = true;
+    if (ScanFailed[i])
+      scan.setErrorFlag(true);
+    Ctx.takeFrom(*Contexts[i]);
+  }
+  DeferredBodies.clear();
+  FileDiagnostics.flush();
+}
@@ -9,11 +9,6 @@ using namespace ast;
 
 //===----------------------CompoundStmt-------------------------===//
 //
-void CompoundStmt::addSubStmt(StmtASTPtr stmt) {
-  if (!stmt)
-    SubStmts.push_back(std::move(stmt));
-}
-
 StmtASTPtr CompoundStmt::getSubStmt(std::size_t index) const {
   return SubStmts[index];
 }
@@ -31,8 +26,7 @@ bool UnpackDecl::TypeCheckingAndTypeSetting(AnonTyPtr type) {
   }
 
   for (unsigned index = 0; index < size; index++) {
-    if (UnpackDeclPtr unpackd =
-            std::dynamic_pointer_cast<UnpackDecl>(decls[index])) {
+    if (UnpackDeclPtr unpackd = dynamic_cast<UnpackDecl *>(decls[index])) {
       if (AnonTyPtr anonyt = std::dynamic_pointer_cast<AnonymousType>(
               type->getSubType(index))) {
         return unpackd->TypeCheckingAndTypeSetting(anonyt);
@@ -51,12 +45,11 @@ bool UnpackDecl::TypeCheckingAndTypeSetting(AnonTyPtr type) {
 
 std::vector<VarDeclPtr> UnpackDecl::operator[](std::size_t index) const {
   std::vector<VarDeclPtr> SubDecls;
-  if (UnpackDeclPtr unpackd =
-          std::dynamic_pointer_cast<UnpackDecl>(decls[index])) {
+  if (UnpackDeclPtr unpackd = dynamic_cast<UnpackDecl *>(decls[index])) {
     unpackd->getDecls(SubDecls);
   }
 
-  if (VarDeclPtr var = std::dynamic_pointer_cast<VarDecl>(decls[index])) {
+  if (VarDeclPtr var = dynamic_cast<VarDecl *>(decls[index])) {
     SubDecls.push_back(var);
   }
   return SubDecls;
@@ -65,12 +58,11 @@ std::vector<VarDeclPtr> UnpackDecl::operator[](std::size_t index) const {
 void UnpackDecl::getDecls(std::vector<VarDeclPtr> &SubDecls) const {
   std::size_t size = decls.size();
   for (unsigned index = 0; index < size; index++) {
-    if (UnpackDeclPtr unpackd =
-            std::dynamic_pointer_cast<UnpackDecl>(decls[index])) {
+    if (UnpackDeclPtr unpackd = dynamic_cast<UnpackDecl *>(decls[index])) {
       unpackd->getDecls(SubDecls);
     }
 
-    if (VarDeclPtr var = std::dynamic_pointer_cast<VarDecl>(decls[index])) {
+    if (VarDeclPtr var = dynamic_cast<VarDecl *>(decls[index])) {
       SubDecls.push_back(var);
     }
   }
@@ -87,12 +79,11 @@ ReturnStmtPtr FunctionDecl::isEvalCandiateAndGetReturnStmt() const {
       returnType->getKind() != TypeKind::BOOL) {
     return nullptr;
   }
-  if (CompoundStmtPtr body =
-          std::dynamic_pointer_cast<CompoundStmt>(funcBody)) {
+  if (CompoundStmtPtr body = dynamic_cast<CompoundStmt *>(funcBody)) {
     if (body->getSize() != 1)
       return nullptr;
     if (ReturnStmtPtr returnStmt =
-            std::dynamic_pointer_cast<ReturnStatement>(body->getSubStmt(0))) {
+            dynamic_cast<ReturnStatement *>(body->getSubStmt(0))) {
       return returnStmt;
     }
     return nullptr;
@@ -101,11 +92,9 @@ ReturnStmtPtr FunctionDecl::isEvalCandiateAndGetReturnStmt() const {
 }
 
 bool FunctionDecl::endsWithReturn() const {
-  if (CompoundStmtPtr body =
-          std::dynamic_pointer_cast<CompoundStmt>(funcBody)) {
+  if (CompoundStmtPtr body = dynamic_cast<CompoundStmt *>(funcBody)) {
     // ends with return stmt.
-    if (ReturnStmtPtr ret = std::dynamic_pointer_cast<ReturnStatement>(
-            (*body)[body->getSize() - 1])) {
+    if (dynamic_cast<ReturnStatement *>((*body)[body->getSize() - 1])) {
       return true;
     }
   }
@@ -46,8 +46,7 @@ bool ConstantEvaluator::EvaluateAsBooleanCondition(ExprASTPtr Exp,
 
 bool ConstantEvaluator::FastEvaluateAsRValue(ExprASTPtr Exp, EvalInfo &Result) {
   if (Result.evalstatus.kind == EvalStatus::ValueKind::IntKind) {
-    if (std::shared_ptr<NumberExpr> Num =
-            std::dynamic_pointer_cast<NumberExpr>(Exp)) {
+    if (NumberExpr *Num = dynamic_cast<NumberExpr *>(Exp)) {
       Result.evalstatus.intVal = Num->getVal();
       Result.evalstatus.result = EvalStatus::Result::Constant;
       return true;
@@ -55,8 +54,7 @@ bool ConstantEvaluator::FastEvaluateAsRValue(ExprASTPtr Exp, EvalInfo &Result) {
   }
 
   if (Result.evalstatus.kind == EvalStatus::ValueKind::BoolKind) {
-    if (std::shared_ptr<BoolLiteral> BL =
-            std::dynamic_pointer_cast<BoolLiteral>(Exp)) {
+    if (BoolLiteral *BL = dynamic_cast<BoolLiteral *>(Exp)) {
       Result.evalstatus.boolVal = BL->getVal();
       Result.evalstatus.result = EvalStatus::Result::Constant;
       return true;
@@ -4,53 +4,91 @@
 //
 //===---------------------------------------------------------------------===//
 #include "Parser/parser.h"
+#include "Support/Trace.h"
+#include <array>
+#include <iterator>
 using namespace parse;
 using namespace parse::OperatorPrec;
 using namespace lex;
 using namespace tok;
 
-/// \brief
-static Level getBinOpPrecedence(TokenValue Kind) {
-  switch (Kind) {
-  case TokenValue::PUNCTUATOR_Comma:
-    return Level::Comma;
-  case TokenValue::BO_Mul:
-  case TokenValue::BO_Div:
-    return Level::Multiplicative;
-  case TokenValue::BO_Add:
-  case TokenValue::BO_Sub:
-    return Level::Additive;
-  case TokenValue::BO_LT:
-  case TokenValue::BO_GT:
-  case TokenValue::BO_LE:
-  case TokenValue::BO_GE:
-    return Level::Relational;
-  case TokenValue::BO_EQ:
-  case TokenValue::BO_NE:
-    return Level::Equality;
-  case TokenValue::BO_Assign:
-  case TokenValue::BO_MulAssign:
-  case TokenValue::BO_DivAssign:
-  case TokenValue::BO_RemAssign:
-  case TokenValue::BO_AddAssign:
-  case TokenValue::BO_SubAssign:
-    return Level::Assignment;
-  case TokenValue::BO_And:
-    return Level::LogicalAnd;
-  case TokenValue::BO_Or:
-    return Level::LogicalOr;
-  case TokenValue::PUNCTUATOR_Member_Access:
-    return Level::PointerToMember;
-  default:
-    return Level::Unknown;
-  }
-  return Level::Unknown;
+namespace {
+/// ExprRule - How a token is parsed in an expression. The expression parser
+/// looks the rule of a token up by its kind instead of switching on it.
+struct ExprRule {
+  /// Parse the operand that starts with the token, if one does.
+  ExprASTPtr (*Operand)(Parser &);
+  /// The semantic action of the token as a prefix operator, if it is one.
+  ExprASTPtr (Sema::*Prefix)(ExprASTPtr);
+  Expr::ExprValueKind PrefixValueKind;
+  /// The binding power of the token as a binary operator, Unknown ends the
+  /// expression.
+  Level Infix;
+};
+} // namespace
+
+static constexpr std::array<ExprRule, NumTokenValues> ExprRules = [] {
+  std::array<ExprRule, NumTokenValues> Rules{};
+  auto rule = [&Rules](TokenValue Kind) -> ExprRule & {
+    return Rules[static_cast<unsigned>(Kind)];
+  };
+  // now moses0.1 only have int and bool, a char, real or string literal
+  // doesn't start an operand.
+  rule(TokenValue::IDENTIFIER).Operand = [](Parser &P) {
+    return P.ParseIdentifierExpr();
+  };
+  rule(TokenValue::INTEGER_LITERAL).Operand = [](Parser &P) {
+    return P.ParseNumberExpr();
+  };
+  rule(TokenValue::BOOL_TRUE).Operand = [](Parser &P) {
+    return P.ParseBoolLiteral(true);
+  };
+  rule(TokenValue::BOOL_FALSE).Operand = [](Parser &P) {
+    return P.ParseBoolLiteral(false);
+  };
+  rule(TokenValue::PUNCTUATOR_Left_Paren).Operand = [](Parser &P) {
+    return P.ParseParenExpr();
+  };
+
+  for (TokenValue Kind : {TokenValue::BO_Sub, TokenValue::UO_Exclamatory}) {
+    rule(Kind).Prefix = &Sema::ActOnUnarySubExpr;
+    rule(Kind).PrefixValueKind = Expr::ExprValueKind::VK_RValue;
+  }
+  for (TokenValue Kind : {TokenValue::UO_Inc, TokenValue::UO_Dec}) {
+    rule(Kind).Prefix = &Sema::ActOnDecOrIncExpr;
+    rule(Kind).PrefixValueKind = Expr::ExprValueKind::VK_LValue;
+  }
+
+  rule(TokenValue::PUNCTUATOR_Comma).Infix = Level::Comma;
+  for (TokenValue Kind :
+       {TokenValue::BO_Assign, TokenValue::BO_MulAssign,
+        TokenValue::BO_DivAssign, TokenValue::BO_RemAssign,
+        TokenValue::BO_AddAssign, TokenValue::BO_SubAssign})
+    rule(Kind).Infix = Level::Assignment;
+  rule(TokenValue::BO_Or).Infix = Level::LogicalOr;
+  rule(TokenValue::BO_And).Infix = Level::LogicalAnd;
+  rule(TokenValue::BO_EQ).Infix = Level::Equality;
+  rule(TokenValue::BO_NE).Infix = Level::Equality;
+  for (TokenValue Kind : {TokenValue::BO_LT, TokenValue::BO_GT,
+                          TokenValue::BO_LE, TokenValue::BO_GE})
+    rule(Kind).Infix = Level::Relational;
+  rule(TokenValue::BO_Add).Infix = Level::Additive;
+  rule(TokenValue::BO_Sub).Infix = Level::Additive;
+  rule(TokenValue::BO_Mul).Infix = Level::Multiplicative;
+  rule(TokenValue::BO_Div).Infix = Level::Multiplicative;
+  rule(TokenValue::PUNCTUATOR_Member_Access).Infix = Level::PointerToMember;
+  return Rules;
+}();
+
+static const ExprRule &getExprRule(TokenValue Kind) {
+  return ExprRules[static_cast<unsigned>(Kind)];
 }
 
 /// \brief Parser constructor.
 /// Get the first token and start parse	tokens.
-Parser::Parser(Scanner &scan, Sema &sema, ASTContext &Ctx)
-    : scan(scan), Ctx(Ctx), Actions(sema) {
+Parser::Parser(Scanner &scan, Sema &sema, ASTContext &Ctx,
+               unsigned SemaThreads)
+    : scan(scan), Ctx(Ctx), Actions(sema), SemaThreads(SemaThreads) {
   scan.getNextToken();
   Actions.getScannerPointer(&(this->scan));
 }
@@ -64,61 +102,185 @@ ASTPtr &Parser::parse() {
   Actions.ActOnTranslationUnitStart();
 
   // Parser
-  for (;;) {
-    switch (scan.getToken().getKind()) {
-      // Predict for { statement -> compound-statement }
-      // Left Brace {, This represents the compound statement.
-      // In Top-Level this is allowed.
-    case TokenValue::PUNCTUATOR_Left_Brace:
-      AST.push_back(ParseCompoundStatement());
-      break;
-    case TokenValue::KEYWORD_if:
-      AST.push_back(ParseIfStatement());
-      break;
-    case TokenValue::KEYWORD_while:
-      AST.push_back(ParseWhileStatement());
+  Items.clear();
+  while (scan.getToken().getKind() != TokenValue::FILE_EOF)
+    Items.push_back(ParseTopLevelItem());
+  checkDeferredBodies();
+  MOSES_TRACE(Tokens, Info)
+      << "Parser done! \n"
+      << "-----------------------------------------------------------"
+         "---------------------\n";
+  rebuildAST();
+  return AST;
+}
+
+/// \brief ParseTopLevelItem - Parse a statement or a declaration of the
+/// translation unit, and record the tokens and the top-level symbols of it.
+Parser::TopLevelItem Parser::ParseTopLevelItem() {
+  auto TopScope = Actions.getTopLevelScope();
+  TopLevelItem Item;
+  Item.FirstToken = scan.getTokenIndex();
+  Item.FirstDef = TopScope->getNumDefs();
+  Item.HasNode = true;
+  // The errors are recorded per item, applyEdit keeps the ones of the items
+  // it doesn't parse again.
+  Ctx.isParseOrSemaSuccess = true;
+  NestingLimitReached = false;
+  switch (scan.getToken().getKind()) {
+    // Predict for { statement -> compound-statement }
+    // Left Brace {, This represents the compound statement.
+    // In Top-Level this is allowed.
+  case TokenValue::PUNCTUATOR_Left_Brace:
+    Item.Node = ParseCompoundStatement();
+    break;
+  case TokenValue::KEYWORD_if:
+    Item.Node = ParseIfStatement();
+    break;
+  case TokenValue::KEYWORD_while:
+    Item.Node = ParseWhileStatement();
+    break;
+    // Predict for { statement -> expression-statement }
+    // ;, -, !, identifier, (, INT-LITERAL, BOOL-LITERAL
+  case TokenValue::PUNCTUATOR_Semicolon:
+    scan.getNextToken();
+    Item.HasNode = false;
+    break;
+  case TokenValue::BO_Sub:
+  case TokenValue::IDENTIFIER:
+  case TokenValue::UO_Exclamatory:
+  case TokenValue::UO_Dec:
+  case TokenValue::UO_Inc:
+  case TokenValue::PUNCTUATOR_Left_Paren:
+  case TokenValue::INTEGER_LITERAL:
+  case TokenValue::BOOL_TRUE:
+  case TokenValue::BOOL_FALSE:
+    Item.Node = ParseExpressionStatement();
+    break;
+  case TokenValue::KEYWORD_var:
+  case TokenValue::KEYWORD_const:
+  case TokenValue::KEYWORD_class:
+    Item.Node = ParseDeclStmt();
+    break;
+  case TokenValue::KEYWORD_func:
+    Item.Node = ParseFunctionDefinition();
+    break;
+  default:
+    // Handle syntax error.
+    // For example,break unlikely appear in Top-Level.
+    errorReport("Illegal token '" + scan.getToken().getLexem() + "'.");
+    syntaxErrorRecovery(ParseContext::context::Statement);
+    Item.HasNode = false;
+    break;
+  }
+  Item.EndToken = scan.getTokenIndex();
+  Item.EndDef = TopScope->getNumDefs();
+  Item.HadErrors = !Ctx.isParseOrSemaSuccess;
+  for (std::size_t i = Item.FirstToken; i < Item.EndToken; ++i)
+    if (scan.getTokenAt(i).isIdentifier())
+      Item.Identifiers.push_back(scan.getTokenAt(i).getIdentifierID());
+  std::sort(Item.Identifiers.begin(), Item.Identifiers.end());
+  Item.Identifiers.erase(
+      std::unique(Item.Identifiers.begin(), Item.Identifiers.end()),
+      Item.Identifiers.end());
+  return Item;
+}
+
+ASTPtr &Parser::applyEdit(std::uint32_t Offset, std::uint32_t RemovedLength,
+                          std::string_view Inserted) {
+  TokenEdit Edit = scan.applyEdit(Offset, RemovedLength, Inserted);
+  if (Items.empty()) {
+    // The file had no token, nothing was parsed yet.
+    scan.getNextToken();
+    return parse();
+  }
+
+  // The items before the one of the token before the edit are kept, the
+  // edit may extend that one.
+  auto Begin = std::partition_point(
+      Items.begin(), Items.end(),
+      [&Edit](const TopLevelItem &Item) { return Item.EndToken < Edit.First; });
+  std::vector<TopLevelItem> OldItems(std::make_move_iterator(Begin),
+                                     std::make_move_iterator(Items.end()));
+  Items.erase(Begin, Items.end());
+  auto TopScope = Actions.getTopLevelScope();
+  std::size_t OldFirstDef = OldItems.front().FirstDef;
+  auto OldDefs = TopScope->takeDefsFrom(OldFirstDef);
+  auto getNewIndex = [&Edit](std::size_t Index) {
+    return Index < Edit.OldEnd ? Index : Index - Edit.OldEnd + Edit.NewEnd;
+  };
+
+  // The names defined by the items parsed again. The AST of the items after
+  // them refers to the old declarations, so an item that mentions one of the
+  // names is parsed again as well.
+  std::vector<std::uint32_t> ChangedNames;
+  auto addChangedName = [&ChangedNames](const std::shared_ptr<Symbol> &Def) {
+    const std::string &Name = Def->getLexem();
+    if (!Name.empty())
+      ChangedNames.push_back(Support::StringInterner::get().intern(Name));
+  };
+  auto mentionsChangedName = [&ChangedNames](const TopLevelItem &Item) {
+    return std::any_of(
+        ChangedNames.begin(), ChangedNames.end(), [&Item](std::uint32_t ID) {
+          return std::binary_search(Item.Identifiers.begin(),
+                                    Item.Identifiers.end(), ID);
+        });
+  };
+
+  scan.seekTo(OldItems.front().FirstToken);
+  scan.getNextToken();
+  for (std::size_t Next = 0;;) {
+    std::size_t Pos = scan.getTokenIndex();
+    // The old items that overlap the edit or the items parsed again are gone.
+    for (; Next != OldItems.size() &&
+           (OldItems[Next].FirstToken < Edit.OldEnd ||
+            getNewIndex(OldItems[Next].FirstToken) < Pos);
+         ++Next)
+      for (std::size_t i = OldItems[Next].FirstDef;
+           i != OldItems[Next].EndDef; ++i)
+        addChangedName(OldDefs[i - OldFirstDef]);
+    if (scan.getToken().getKind() == TokenValue::FILE_EOF)
       break;
-      // Predict for { statement -> expression-statement }
-      // ;, -, !, identifier, (, INT-LITERAL, BOOL-LITERAL
-    case TokenValue::PUNCTUATOR_Semicolon:
+
+    if (Next != OldItems.size() &&
+        getNewIndex(OldItems[Next].FirstToken) == Pos &&
+        !mentionsChangedName(OldItems[Next])) {
+      // The item is the same, define its symbols again and skip it.
+      TopLevelItem &Item = OldItems[Next++];
+      std::size_t FirstDef = TopScope->getNumDefs();
+      for (std::size_t i = Item.FirstDef; i != Item.EndDef; ++i)
+        TopScope->addDef(OldDefs[i - OldFirstDef]);
+      Item.FirstToken = Pos;
+      Item.EndToken = getNewIndex(Item.EndToken);
+      Item.EndDef = FirstDef + (Item.EndDef - Item.FirstDef);
+      Item.FirstDef = FirstDef;
+      scan.seekTo(Item.EndToken);
       scan.getNextToken();
-      break;
-    case TokenValue::BO_Sub:
-    case TokenValue::IDENTIFIER:
-    case TokenValue::UO_Exclamatory:
-    case TokenValue::UO_Dec:
-    case TokenValue::UO_Inc:
-    case TokenValue::PUNCTUATOR_Left_Paren:
-    case TokenValue::INTEGER_LITERAL:
-    case TokenValue::BOOL_TRUE:
-    case TokenValue::BOOL_FALSE:
-      AST.push_back(ParseExpressionStatement());
-      break;
-    case TokenValue::KEYWORD_var:
-    case TokenValue::KEYWORD_const:
-    case TokenValue::KEYWORD_class:
-      AST.push_back(ParseDeclStmt());
-      break;
-    case TokenValue::KEYWORD_func:
-      AST.push_back(ParseFunctionDefinition());
-      break;
-    case TokenValue::FILE_EOF:
-      std::cout << "Parser done! \n";
-      std::cout << "-----------------------------------------------------------"
-                   "---------------------\n";
-      goto DONE;
-    default:
-      // Handle syntax error.
-      // For example,break unlikely appear in Top-Level.
-      errorReport("Illegal token '" + scan.getToken().getLexem() + "'.");
-      syntaxErrorRecovery(ParseContext::context::Statement);
-      break;
+      Items.push_back(std::move(Item));
+      continue;
     }
+
+    Actions.PopToTopLevelScope();
+    CurrentContext = ContextKind::TopLevel;
+    Items.push_back(ParseTopLevelItem());
+    for (std::size_t i = Items.back().FirstDef; i != Items.back().EndDef; ++i)
+      addChangedName(TopScope->getDef(i));
   }
-DONE:
+  checkDeferredBodies();
+  rebuildAST();
   return AST;
 }
 
+void Parser::rebuildAST() {
+  AST.clear();
+  Ctx.isParseOrSemaSuccess = true;
+  for (const TopLevelItem &Item : Items) {
+    if (Item.HasNode)
+      AST.push_back(Item.Node);
+    if (Item.HadErrors)
+      Ctx.isParseOrSemaSuccess = false;
+  }
+}
+
 /// \brief ParseIfStatement - This function mainly used to parse if statement.
 /// sample code:
 ///		if flag-expression
@@ -180,13 +342,13 @@ StmtASTPtr Parser::ParseIfStatement() {
   }
   auto locEnd = scan.getToken().getTokenLoc();
 
-  return std::make_shared<IfStatement>(locStart, locEnd, condition, thenPart,
-                                       elsePart);
+  return Ctx.create<IfStatement>(locStart, locEnd, condition, thenPart,
+                                 elsePart);
 }
 
 /// \brief ParseNumberExpr - number literal.
 ExprASTPtr Parser::ParseNumberExpr() {
-  auto curTok = scan.getToken();
+  const Token &curTok = scan.getToken();
   if (!expectToken(TokenValue::INTEGER_LITERAL, "integer literal", true)) {
     syntaxErrorRecovery(ParseContext::context::PrimaryExpression);
   }
@@ -194,21 +356,21 @@ ExprASTPtr Parser::ParseNumberExpr() {
   // Get the number value.
   double numVal = strtod(curTok.getLexem().c_str(), nullptr);
   auto locEnd = scan.getToken().getTokenLoc();
-  auto NumE = std::make_shared<NumberExpr>(locStart, locEnd, numVal);
+  auto NumE = Ctx.create<NumberExpr>(locStart, locEnd, numVal);
   NumE->setIntType(Ctx.Int);
   return NumE;
 }
 
 /// \brief ParseCharLiteral - char literal.
 ExprASTPtr Parser::ParseCharLiteral() {
-  auto curTok = scan.getToken();
+  const Token &curTok = scan.getToken();
   if (!expectToken(TokenValue::CHAR_LITERAL, "char literal", true)) {
     syntaxErrorRecovery(ParseContext::context::PrimaryExpression);
   }
   auto locStart = curTok.getTokenLoc();
   // Get the number value.
   auto locEnd = scan.getToken().getTokenLoc();
-  auto CharE = std::make_shared<CharExpr>(locStart, locEnd, curTok.getLexem());
+  auto CharE = Ctx.create<CharExpr>(locStart, locEnd, curTok.getLexem());
   CharE->setCharType(Ctx.Int);
   return CharE;
 }
@@ -251,22 +413,20 @@ ExprASTPtr Parser::ParseParenExpr() {
 ///		-> identifier
 ///		-> identifier arg-list "
 ExprASTPtr Parser::ParseIdentifierExpr() {
-  auto curTok = scan.getToken();
-  auto locStart = curTok.getTokenLoc();
-  std::string IdName = curTok.getLexem();
+  if (scan.peekToken(1).getKind() == TokenValue::PUNCTUATOR_Left_Paren)
+    return ParseCallExpr();
+
+  auto locStart = scan.getToken().getTokenLoc();
+  std::string IdName = scan.getToken().getLexem();
 
   // eat identifier
   scan.getNextToken();
 
-  if (validateToken(TokenValue::PUNCTUATOR_Left_Paren)) {
-    return ParseCallExpr(curTok);
-  } else {
-    // Semantic analysis.
-    VarDeclPtr var = Actions.ActOnDeclRefExpr(IdName);
-    auto locEnd = scan.getToken().getTokenLoc();
-    return std::make_shared<DeclRefExpr>(
-        locStart, locEnd, var ? var->getDeclType() : nullptr, IdName, var);
-  }
+  // Semantic analysis.
+  VarDeclPtr var = Actions.ActOnDeclRefExpr(IdName);
+  auto locEnd = scan.getToken().getTokenLoc();
+  return Ctx.create<DeclRefExpr>(
+      locStart, locEnd, var ? var->getDeclType() : nullptr, IdName, var);
 }
 
 /// \brief ParseDeclStmt - DeclStmt.
@@ -305,7 +465,6 @@ StmtASTPtr Parser::ParseCompoundStatementBody() {
   expectToken(TokenValue::PUNCTUATOR_Left_Brace, "{", true);
   std::vector<StmtASTPtr> bodyStmts;
   for (;;) {
-    StmtASTPtr currentASTPtr = nullptr;
     if (validateToken(TokenValue::PUNCTUATOR_Right_Brace, false)) {
       break;
     }
@@ -366,8 +525,9 @@ StmtASTPtr Parser::ParseCompoundStatementBody() {
   if (!expectToken(TokenValue::PUNCTUATOR_Right_Brace, "}", true)) {
     syntaxErrorRecovery(ParseContext::context::CompoundStatement);
   }
-  return std::make_shared<CompoundStmt>(locStart, scan.getToken().getTokenLoc(),
-                                        bodyStmts);
+  return Ctx.create<CompoundStmt>(locStart, scan.getToken().getTokenLoc(),
+                                  Ctx.copyArray(bodyStmts),
+                                  Actions.getCurScope().get());
 }
 
 /// \brief ParseWhileStatement - while.
@@ -403,8 +563,8 @@ StmtASTPtr Parser::ParseWhileStatement() {
   CurrentContext = oldContext;
 
   auto locEnd = scan.getToken().getTokenLoc();
-  return std::make_shared<WhileStatement>(locStart, locEnd, condition,
-                                          compoundStmt);
+  return Ctx.create<WhileStatement>(locStart, locEnd, condition,
+                                    compoundStmt);
 }
 
 /// \brief ParseBreakStatement - break statement.
@@ -416,7 +576,7 @@ StmtASTPtr Parser::ParseBreakStatement() {
     syntaxErrorRecovery(ParseContext::context::Statement);
   }
   auto locEnd = scan.getToken().getTokenLoc();
-  return std::make_shared<BreakStatement>(locStart, locEnd);
+  return Ctx.create<BreakStatement>(locStart, locEnd);
 }
 
 /// \brief ParseContinueStatement - continue statement.
@@ -430,7 +590,7 @@ StmtASTPtr Parser::ParseContinueStatement() {
     syntaxErrorRecovery(ParseContext::context::Statement);
   }
   auto locEnd = scan.getToken().getTokenLoc();
-  return std::make_shared<ContinueStatement>(locStart, locEnd);
+  return Ctx.create<ContinueStatement>(locStart, locEnd);
 }
 
 /// \brief ParsereturnStatement() - return statement.
@@ -447,7 +607,7 @@ StmtASTPtr Parser::ParseReturnStatement() {
   }
 
   if (validateToken(TokenValue::PUNCTUATOR_Semicolon)) {
-    return std::make_shared<ReturnStatement>(
+    return Ctx.create<ReturnStatement>(
         locStart, scan.getToken().getTokenLoc(), nullptr);
   }
 
@@ -467,7 +627,7 @@ StmtASTPtr Parser::ParseReturnStatement() {
   if (!expectToken(TokenValue::PUNCTUATOR_Semicolon, ";", true)) {
     syntaxErrorRecovery(ParseContext::context::Statement);
   }
-  return std::make_shared<ReturnStatement>(
+  return Ctx.create<ReturnStatement>(
       locStart, scan.getToken().getTokenLoc(), returnExpr);
 }
 
@@ -477,9 +637,9 @@ ExprASTPtr Parser::ParseStringLiteral() {
   if (!expectToken(TokenValue::STRING_LITERAL, "string", true)) {
     syntaxErrorRecovery(ParseContext::context::PrimaryExpression);
   }
-  return std::make_shared<StringLiteral>(locStart,
-                                         scan.getToken().getTokenLoc(), nullptr,
-                                         scan.getToken().getLexem());
+  return Ctx.create<StringLiteral>(locStart,
+                                   scan.getToken().getTokenLoc(), nullptr,
+                                   scan.getToken().getLexem());
 }
 
 /// \brief ParseBoolLiteral - parse bool literal.
@@ -487,7 +647,7 @@ ExprASTPtr Parser::ParseBoolLiteral(bool isTrue) {
   auto locStart = scan.getToken().getTokenLoc();
   // consume bool literal token
   scan.getNextToken();
-  auto BoolL = std::make_shared<BoolLiteral>(
+  auto BoolL = Ctx.create<BoolLiteral>(
       locStart, scan.getToken().getTokenLoc(), isTrue);
   BoolL->setBoolType(Ctx.Bool);
   return BoolL;
@@ -508,12 +668,24 @@ ExprASTPtr Parser::ParseBoolLiteral(bool isTrue) {
 /// --------------------------nonsense for coding-------------------------------
 
 ExprASTPtr Parser::ParseExpression() {
+  if (ExprNesting == MaxExprNesting) {
+    // Give up on the file rather than recurse any deeper.
+    errorReport("Expression is nested too deeply, the limit is " +
+                std::to_string(MaxExprNesting) + ".");
+    NestingLimitReached = true;
+    while (scan.getToken().getKind() != TokenValue::FILE_EOF)
+      scan.getNextToken();
+    return nullptr;
+  }
+  ++ExprNesting;
   auto LHS = ParseWrappedUnaryExpression();
   if (!LHS) {
     syntaxErrorRecovery(ParseContext::context::Expression);
   }
 
-  return ParseBinOpRHS(OperatorPrec::Level::Assignment, LHS);
+  auto Result = ParseBinOpRHS(OperatorPrec::Level::Assignment, LHS);
+  --ExprNesting;
+  return Result;
 }
 
 /// \brief ParseWrappedUnaryExpression - parse UnaryExpression
@@ -524,43 +696,28 @@ ExprASTPtr Parser::ParseExpression() {
 /// fxxk expression!!!
 /// Token is the key to understand Parser, not the character!!!
 ExprASTPtr Parser::ParseWrappedUnaryExpression() {
-  auto tok = scan.getToken();
-  TokenValue tokKind = tok.getKind();
-  auto locStart = scan.getToken().getTokenLoc();
-  ExprASTPtr RHS = nullptr;
-
-  if (tokKind == TokenValue::BO_Sub) {
-    scan.getNextToken();
-    RHS = ParseWrappedUnaryExpression();
-    if (!RHS || !(RHS->getType())) {
-      errorReport("Error occured in left hand expression.");
-    }
-    RHS = Actions.ActOnUnarySubExpr(RHS);
-    RHS = std::make_shared<UnaryExpr>(locStart, scan.getToken().getTokenLoc(),
-                                      RHS->getType(), tok.getLexem(), RHS,
-                                      Expr::ExprValueKind::VK_RValue);
-  } else if (tokKind == TokenValue::UO_Exclamatory) {
-    scan.getNextToken();
-    RHS = ParseWrappedUnaryExpression();
-    if (!RHS || !(RHS->getType())) {
-      errorReport("Error occured in left hand expression.");
-    }
-    RHS = Actions.ActOnUnarySubExpr(RHS);
-    RHS = std::make_shared<UnaryExpr>(locStart, scan.getToken().getTokenLoc(),
-                                      RHS->getType(), tok.getLexem(), RHS,
-                                      Expr::ExprValueKind::VK_RValue);
-  } else if (tokKind == TokenValue::UO_Dec || tokKind == TokenValue::UO_Inc) {
+  // The prefix operators are pushed until the operand, which is wrapped from
+  // the innermost operator out, "- - ! num" doesn't recurse.
+  std::size_t FirstPrefixOp = PendingPrefixOps.size();
+  while (getExprRule(scan.getToken().getKind()).Prefix) {
+    PendingPrefixOps.push_back(&scan.getToken());
     scan.getNextToken();
-    RHS = ParseWrappedUnaryExpression();
+  }
+  ExprASTPtr RHS = ParsePostfixExpression();
+
+  while (PendingPrefixOps.size() != FirstPrefixOp) {
+    const Token &tok = *PendingPrefixOps.back();
+    PendingPrefixOps.pop_back();
     if (!RHS || !(RHS->getType())) {
       errorReport("Error occured in left hand expression.");
+      PendingPrefixOps.resize(FirstPrefixOp);
+      return nullptr;
     }
-    RHS = Actions.ActOnDecOrIncExpr(RHS);
-    RHS = std::make_shared<UnaryExpr>(locStart, scan.getToken().getTokenLoc(),
-                                      RHS->getType(), tok.getLexem(), RHS,
-                                      Expr::ExprValueKind::VK_LValue);
-  } else {
-    RHS = ParsePostfixExpression();
+    const ExprRule &Rule = getExprRule(tok.getKind());
+    RHS = (Actions.*Rule.Prefix)(RHS);
+    RHS = Ctx.create<UnaryExpr>(tok.getTokenLoc(), scan.getToken().getTokenLoc(),
+                                RHS->getType(), tok.getLexem(), RHS,
+                                Rule.PrefixValueKind);
   }
   return RHS;
 }
@@ -629,7 +786,7 @@ ExprASTPtr Parser::ParsePostfixExpressionSuffix(ExprASTPtr LHS) {
       LHS = Actions.ActOnDecOrIncExpr(LHS);
       // Consume the '++' or '--'
       scan.getNextToken();
-      return std::make_shared<UnaryExpr>(
+      return Ctx.create<UnaryExpr>(
           locStart, scan.getToken().getTokenLoc(), LHS->getType(), OpName, LHS,
           Expr::ExprValueKind::VK_RValue);
     default: // Not a postfix-expression suffix.
@@ -652,77 +809,66 @@ StmtASTPtr Parser::ParseExpressionStatement() {
 
 /// \brief ParseBinOpRHS - Parse the expression-tail.
 /// Note: Anonymous type need specially handled.
+/// ---------------------------------------------------------------------------
+/// The binding power of an operator is looked up in ExprRules. An operator
+/// waits on PendingBinOps until the one after its right operand binds no
+/// more tightly than it does, so "num0 + num1 * num2 - num3" folds
+/// "num1 * num2" first, then "num0 + ...", then "... - num3", in one loop.
+/// Assignments are right-associative, "num0 = num1 = num2" folds
+/// "num1 = num2" first.
+/// ---------------------------------------------------------------------------
 ExprASTPtr Parser::ParseBinOpRHS(OperatorPrec::Level MinPrec, ExprASTPtr lhs) {
-  auto locStart = scan.getToken().getTokenLoc();
-  OperatorPrec::Level NextTokPrec =
-      getBinOpPrecedence(scan.getToken().getKind());
+  std::size_t FirstBinOp = PendingBinOps.size();
+  // Combine the operand on the top of the stack with the one before it.
+  auto foldBinOp = [this, &lhs]() {
+    PendingBinOp BinOp = PendingBinOps.back();
+    PendingBinOps.pop_back();
+    // Perform semantic and combine the LHS and RHS into LHS (e.g. build AST)
+    lhs = Actions.ActOnBinaryOperator(BinOp.LHS, *BinOp.Op, lhs);
+  };
   while (1) {
-    // --------------------annotation from clang-------------------------------
-    // If this token has a lower precedence than we are allowed to parse (e.g.
-    // because we are called recursively, or because the token is not a binop),
-    // then we are done!
-    // --------------------annotation from clang-------------------------------
+    OperatorPrec::Level NextTokPrec =
+        getExprRule(scan.getToken().getKind()).Infix;
+    // The pending operators that bind the operand at least as tightly as the
+    // next token get it, unless both are right-associative assignments.
+    while (PendingBinOps.size() != FirstBinOp &&
+           (PendingBinOps.back().Prec > NextTokPrec ||
+            (PendingBinOps.back().Prec == NextTokPrec &&
+             NextTokPrec != OperatorPrec::Level::Assignment)))
+      foldBinOp();
     // For example, we are parsing "num = num * 10 - max + num ;"
     // The ";" is the end character for parsing expression. And we set ";" the
     // lowest precedence.
     // The initial precedence is "="
     if (NextTokPrec < MinPrec)
       return lhs;
-    Token OpToken = scan.getToken();
+    const Token &OpToken = scan.getToken();
 
     if (!OpToken.isBinaryOp()) {
       errorReport("Must be binary operator!");
     }
 
+    // consume the operator
+    scan.getNextToken();
+
     // Handled anonymous initexpr specially.
     // num = {expr1, expr2};
-    if (OpToken.getLexem() == "=") {
-      scan.getNextToken();
-      // Anonymous initexpr.
-      if (validateToken(TokenValue::PUNCTUATOR_Left_Brace, false)) {
-        ExprASTPtr RHS = ParseAnonymousInitExpr();
-        return Actions.ActOnAnonymousTypeVariableAssignment(lhs, RHS);
-      }
+    if (OpToken.getKind() == TokenValue::BO_Assign &&
+        validateToken(TokenValue::PUNCTUATOR_Left_Brace, false)) {
+      ExprASTPtr RHS = ParseAnonymousInitExpr();
+      lhs = Actions.ActOnAnonymousTypeVariableAssignment(lhs, RHS);
+      // The assignment ends the expression, or it is the right operand of
+      // the assignment before it, "num = var = {expr1, expr2}".
+      if (PendingBinOps.size() == FirstBinOp)
+        return lhs;
+      foldBinOp();
+      continue;
     }
 
-    // consume the operator
-    if (OpToken.getLexem() != "=")
-      scan.getNextToken();
-
     // Parse another leaf here for the RHS of the operator.
     // For example, "num1 * ++num2", '++num2' is a operand
-    ExprASTPtr RHS = ParseWrappedUnaryExpression();
-
-    // Update the information after consume the operand
-    // "num1* ++num2;"
-    // At first NextTokPrec -> '*', after consume '++num2',
-    // ThisPrec = NextTokPrex -> '*', and NextTokPrex -> ';'
-    // -------------------annotation from clang-------------------------
-    // Remember the precedence of this operator and get the precedence of
-    // the operator immediatiely to the right of the RHS.
-    // -------------------annotation from clang--------------------------
-    OperatorPrec::Level ThisPrec = NextTokPrec;
-    NextTokPrec = getBinOpPrecedence(scan.getToken().getKind());
-
-    // Assignment exression are right-associative.
-    bool isRightAssoc = ThisPrec == OperatorPrec::Level::Assignment;
-
-    // -----------------------annotation from clang------------------------
-    // Get the precedence of the operator to the right of the RHS. If it
-    // binds more tightly with RHS than we do, evaluate it completely first.
-    // -----------------------annotation from clang------------------------
-    // For example, "num0 + num1 * num2", ThisPrec -> '+', NextTokPrec -> '*'
-    // we will promote the precedence to '*',  and Call
-    // ParserHSOfBinaryExpression() And if now the expression is "num0 = num1 =
-    // num2", right association, so "num0 = (num1 = num2)", num1 is binds more
-    // tightly with num2.
-    if (ThisPrec < NextTokPrec || (ThisPrec == NextTokPrec && isRightAssoc)) {
-      RHS = ParseBinOpRHS(
-          static_cast<OperatorPrec::Level>(ThisPrec + !isRightAssoc), RHS);
-      NextTokPrec = getBinOpPrecedence(scan.getToken().getKind());
-    }
-    // Perform semantic and combine the LHS and RHS into LHS (e.g. build AST)
-    lhs = Actions.ActOnBinaryOperator(lhs, OpToken, RHS);
+    PendingBinOps.push_back({lhs, &OpToken, NextTokPrec});
+    lhs = ParseWrappedUnaryExpression();
   }
   return lhs;
 }
@@ -731,30 +877,10 @@ ExprASTPtr Parser::ParseBinOpRHS(OperatorPrec::Level MinPrec, ExprASTPtr lhs) {
 /// primary-expression -> identifier | identifier arg-list | ( expression )
 ///			| INT-LITERAL | BOOL-LITERAL
 ExprASTPtr Parser::ParsePrimaryExpr() {
-  TokenValue curTokVal = scan.getToken().getValue();
-  switch (curTokVal) {
-  case TokenValue::IDENTIFIER:
-    return ParseIdentifierExpr();
-  case TokenValue::INTEGER_LITERAL:
-    return ParseNumberExpr();
-    // now moses0.1 only have int and bool
-    // case TokenValue::REAL_LITERAL:
-    //	return ParseNumberExpr();
-    // case TokenValue::CHAR_LITERAL:
-    //	return ParseCharLiteral();
-    // case TokenValue::STRING_LITERAL:
-    //	return ParseStringLitreal();
-  case TokenValue::BOOL_TRUE:
-    return ParseBoolLiteral(true);
-  case TokenValue::BOOL_FALSE:
-    return ParseBoolLiteral(false);
-  case TokenValue::PUNCTUATOR_Left_Paren:
-    return ParseParenExpr();
-  default:
-    errorReport("Error occured when parsing primary expression! Illegal token");
-    syntaxErrorRecovery(ParseContext::context::PrimaryExpression);
-    break;
-  }
+  if (auto Operand = getExprRule(scan.getToken().getKind()).Operand)
+    return Operand(*this);
+  errorReport("Error occured when parsing primary expression! Illegal token");
+  syntaxErrorRecovery(ParseContext::context::PrimaryExpression);
   return nullptr;
 }
 
@@ -763,9 +889,13 @@ ExprASTPtr Parser::ParsePrimaryExpr() {
 /// proper-arg-list->arg proper-arg - list - tail
 /// proper-arg-list-tail ->, arg proper-arg-list-tail | EPSILON
 /// arg->expression | anonymous - initial
-ExprASTPtr Parser::ParseCallExpr(Token tok) {
+ExprASTPtr Parser::ParseCallExpr() {
+  const Token &tok = scan.getToken();
   auto startLoc = tok.getTokenLoc();
   std::string funcName = tok.getLexem();
+  // eat identifier and '('
+  scan.getNextToken();
+  scan.getNextToken();
   std::vector<ExprASTPtr> Args;
   std::vector<std::shared_ptr<ASTType>> ParmTyps;
   bool first = true;
@@ -803,15 +933,18 @@ ExprASTPtr Parser::ParseCallExpr(Token tok) {
   // Perform simple semantic analysis
   // (Check whether the function is defined or parameter types match).
   FunctionDeclPtr fd = nullptr;
-  auto returnType = Actions.ActOnCallExpr(funcName, ParmTyps, fd);
+  Support::FunctionSymbol *Callee = nullptr;
+  auto returnType = Actions.ActOnCallExpr(funcName, ParmTyps, fd, Callee);
 
   auto endLoc = scan.getToken().getTokenLoc();
 
   if (returnType) {
-    return std::make_shared<CallExpr>(
-        startLoc, endLoc, returnType, tok.getLexem(), Args,
+    auto CE = Ctx.create<CallExpr>(
+        startLoc, endLoc, returnType, tok.getLexem(), Ctx.copyArray(Args),
         Expr::ExprValueKind::VK_RValue, fd,
         returnType->getKind() != TypeKind::USERDEFIED);
+    CE->setCalleeSymbol(Callee);
+    return CE;
   }
   return nullptr;
 }
@@ -857,7 +990,7 @@ DeclASTPtr Parser::ParseVarDecl() {
     syntaxErrorRecovery(ParseContext::context::Statement);
   }
 
-  Token curTok = scan.getToken();
+  const Token &curTok = scan.getToken();
   scan.getNextToken();
   std::shared_ptr<ASTType> DeclType = nullptr;
 
@@ -901,8 +1034,8 @@ DeclASTPtr Parser::ParseVarDecl() {
   }
 
   auto decl =
-      std::make_shared<VarDecl>(locStart, scan.getToken().getTokenLoc(),
-                                curTok.getLexem(), DeclType, isConst, InitExpr);
+      Ctx.create<VarDecl>(locStart, scan.getToken().getTokenLoc(),
+                          curTok.getLexem(), DeclType, isConst, InitExpr);
   Actions.ActOnVarDecl(curTok.getLexem(), decl);
 
   return decl;
@@ -924,7 +1057,7 @@ UnpackDeclPtr Parser::ParseUnpackDecl(bool isConst) {
     } else if (validateToken(TokenValue::IDENTIFIER, false)) {
       Actions.ActOnUnpackDeclElement(scan.getToken().getLexem());
 
-      decls.push_back(std::make_shared<VarDecl>(
+      decls.push_back(Ctx.create<VarDecl>(
           startloc, scan.getToken().getTokenLoc(), scan.getToken().getLexem(),
           nullptr, isConst, nullptr));
       scan.getNextToken();
@@ -937,8 +1070,8 @@ UnpackDeclPtr Parser::ParseUnpackDecl(bool isConst) {
     }
     expectToken(TokenValue::PUNCTUATOR_Comma, ",", true);
   }
-  return std::make_shared<UnpackDecl>(startloc, scan.getToken().getTokenLoc(),
-                                      decls);
+  return Ctx.create<UnpackDecl>(startloc, scan.getToken().getTokenLoc(),
+                                Ctx.copyArray(decls));
 }
 
 ExprASTPtr Parser::ParseAnonymousInitExpr() {
@@ -980,8 +1113,8 @@ ExprASTPtr Parser::ParseAnonymousInitExpr() {
     initTypes.push_back(initExprs[i]->getType());
   }
   // std::make_shared<AnonymousType>(initTypes);
-  return std::make_shared<AnonymousInitExpr>(
-      startloc, scan.getToken().getTokenLoc(), initExprs,
+  return Ctx.create<AnonymousInitExpr>(
+      startloc, scan.getToken().getTokenLoc(), Ctx.copyArray(initExprs),
       std::make_shared<AnonymousType>(initTypes));
 }
 
@@ -1050,14 +1183,39 @@ StmtASTPtr Parser::ParseFunctionDefinition() {
   // Record return type and create new scope.
   Actions.ActOnFunctionDecl(name, returnType);
 
-  auto body = ParseFunctionStatementBody();
+  // The calls in the body refer to the FunctionDecl, it is made first.
+  auto FuncDecl = Ctx.create<FunctionDecl>(
+      locStart, locStart, name, Ctx.copyArray(parm), nullptr, returnType);
+  Actions.getFunctionStackTop()->setFunctionDeclPointer(FuncDecl);
+  FuncDecl->setSymbol(Actions.getFunctionStackTop().get());
+
+  std::size_t BodyEnd;
+  if (canDeferBody(BodyEnd)) {
+    // The errors are held back from the first body on, the errors of the
+    // bodies are put in among them.
+    if (!FileCapture)
+      FileCapture.emplace(FileDiagnostics);
+    DeferredBody Body;
+    Body.FirstToken = scan.getTokenIndex();
+    Body.EndToken = BodyEnd;
+    Body.FD = FuncDecl;
+    Body.Func = Actions.getFunctionStackTop();
+    Body.BodyScope = Actions.getCurScope();
+    Body.NumTopLevelDefs = Actions.getTopLevelScope()->getNumDefs();
+    Body.Item = Items.size();
+    Body.DiagnosticPos = FileDiagnostics.size();
+    DeferredBodies.push_back(std::move(Body));
+    // The body ends the file if it is the last token.
+    while (scan.getTokenIndex() < BodyEnd)
+      scan.getNextToken();
+    // Pop function body'
+    Actions.PopScope();
+  } else {
+    FuncDecl->setCompoundBody(ParseFunctionStatementBody());
+  }
 
   CurrentContext = ContextKind::TopLevel;
-
-  auto FuncDecl = std::make_shared<FunctionDecl>(
-      locStart, scan.getToken().getTokenLoc(), name, parm, body, returnType);
-
-  Actions.getFunctionStackTop()->setFunctionDeclPointer(FuncDecl);
+  FuncDecl->setLocEnd(scan.getToken().getTokenLoc());
 
   // Pop function stack
   Actions.PopFunctionStack();
@@ -1068,6 +1226,39 @@ StmtASTPtr Parser::ParseFunctionDefinition() {
   return FuncDecl;
 }
 
+bool Parser::canDeferBody(std::size_t &EndToken) const {
+  if (SemaThreads < 2 ||
+      scan.getToken().getKind() != TokenValue::PUNCTUATOR_Left_Brace)
+    return false;
+  auto TopScope = Actions.getTopLevelScope();
+  std::size_t Depth = 0;
+  for (std::size_t i = scan.getTokenIndex();; ++i) {
+    const Token &Tok = scan.getTokenAt(i);
+    switch (Tok.getKind()) {
+    case TokenValue::FILE_EOF:
+      // A body that isn't closed is reported in place.
+      return false;
+    case TokenValue::PUNCTUATOR_Left_Brace:
+      ++Depth;
+      break;
+    case TokenValue::PUNCTUATOR_Right_Brace:
+      if (--Depth == 0) {
+        EndToken = i + 1;
+        return true;
+      }
+      break;
+    case TokenValue::IDENTIFIER:
+      if (auto Var = std::dynamic_pointer_cast<VariableSymbol>(
+              TopScope->Resolve(Tok.getIdentifierID())))
+        if (Var->getDecl()->isConst() && !Var->isInitial())
+          return false;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
 /// \brief ParseFunctionStatementBody - Parse function body.
 StmtASTPtr Parser::ParseFunctionStatementBody() {
   // Temporarily call 'ParseCompoundStatement()'
@@ -1151,7 +1342,7 @@ ParmDeclPtr Parser::ParseParmDecl() {
     errorReport("variable declaration error.");
   }
 
-  auto parm = std::make_shared<ParameterDecl>(
+  auto parm = Ctx.create<ParameterDecl>(
       locStart, scan.getToken().getTokenLoc(), name, isConst, DeclType);
   // simple semantic analysis.
   Actions.ActOnParmDecl(name, parm);
@@ -1224,18 +1415,18 @@ DeclASTPtr Parser::ParseClassDecl() {
   // Pop class scope.
   Actions.PopScope();
   CurrentContext = ContextKind::TopLevel;
-  auto ClassD = std::make_shared<ClassDecl>(
+  auto ClassD = Ctx.create<ClassDecl>(
       locStart, scan.getToken().getTokenLoc(), className,
-      std::make_shared<CompoundStmt>(classBodyStart,
-                                     scan.getToken().getTokenLoc(), classBody));
-  Ctx.UDTypes.insert(
+      Ctx.create<CompoundStmt>(classBodyStart, scan.getToken().getTokenLoc(),
+                               Ctx.copyArray(classBody),
+                               ClassSym->getScope().get()));
+  Ctx.addUserDefinedType(
       std::dynamic_pointer_cast<UserDefinedType>(ClassSym->getType()));
   return ClassD;
 }
 
 std::shared_ptr<AnonymousType> Parser::ParseAnony() {
   std::vector<std::shared_ptr<ASTType>> types;
-  auto startloc = scan.getToken().getTokenLoc();
   scan.getNextToken();
   while (1) {
     switch (scan.getToken().getKind()) {
@@ -1260,9 +1451,7 @@ std::shared_ptr<AnonymousType> Parser::ParseAnony() {
       errorReport("Expected ','.");
     }
   }
-  auto anony = std::make_shared<AnonymousType>(types);
-  Ctx.AnonTypes.insert(anony);
-  return anony;
+  return Ctx.getAnonymousType(types);
 }
 
 // Helper Functions.
@@ -1301,48 +1490,51 @@ bool Parser::validateToken(TokenValue value, bool advanceToNextToken) const {
 
 void Parser::errorReport(const std::string &msg) const {
   Ctx.isParseOrSemaSuccess = false;
+  if (NestingLimitReached)
+    return;
   errorParser(scan.getLastToken().getTokenLoc().toString() + " --- " + msg);
 }
 
 /// \brief syntaxErrorRecovery - achieve syntax error recovery.
 void Parser::syntaxErrorRecovery(ParseContext::context context) {
-  std::vector<TokenValue> curSafeSymbols;
+  static constexpr TokenSet NoSafeSymbols;
+  const TokenSet *curSafeSymbols = &NoSafeSymbols;
   switch (context) {
   case ParseContext::context::CompoundStatement:
-    curSafeSymbols = ParseContext::StmtSafeSymbols;
+    curSafeSymbols = &ParseContext::StmtSafeSymbols;
     break;
   case ParseContext::context::Statement:
     // statement, if-statement, while-statement, break-statement,
     // continue-statement return-statement, expression-statement,
     // declaration-statement, variable-statement, class-declaration,
-    curSafeSymbols = ParseContext::StmtSafeSymbols;
+    curSafeSymbols = &ParseContext::StmtSafeSymbols;
     break;
   case ParseContext::context::Expression:
     // expression, assignmen-expression, condition-or-expression
-    curSafeSymbols = ParseContext::ExprSafeSymbols;
+    curSafeSymbols = &ParseContext::ExprSafeSymbols;
     break;
   case ParseContext::context::UnaryExpression:
   case ParseContext::context::PostExpression:
-    curSafeSymbols = ParseContext::UnaryAndPostExprSafeSymbols;
+    curSafeSymbols = &ParseContext::UnaryAndPostExprSafeSymbols;
     break;
   case ParseContext::context::ArgListExpression:
   case ParseContext::context::PrimaryExpression:
-    curSafeSymbols = ParseContext::PrimaryAndArgListExprSafeSymbols;
+    curSafeSymbols = &ParseContext::PrimaryAndArgListExprSafeSymbols;
     break;
   case ParseContext::context::ParmList:
-    curSafeSymbols = ParseContext::ParaListSafeSymbols;
+    curSafeSymbols = &ParseContext::ParaListSafeSymbols;
     break;
   case ParseContext::context::ParmDecl:
-    curSafeSymbols = ParseContext::ParaDeclSafeSymbols;
+    curSafeSymbols = &ParseContext::ParaDeclSafeSymbols;
     break;
   case ParseContext::context::ArgExpression:
-    curSafeSymbols = ParseContext::ArgSafeSymbols;
+    curSafeSymbols = &ParseContext::ArgSafeSymbols;
     break;
   case ParseContext::context::FunctionDefinition:
-    curSafeSymbols = ParseContext::FuncDefSafeSymbols;
+    curSafeSymbols = &ParseContext::FuncDefSafeSymbols;
     break;
   case ParseContext::context::ClassBody:
-    curSafeSymbols = ParseContext::ClassBodySafeSymbols;
+    curSafeSymbols = &ParseContext::ClassBodySafeSymbols;
     break;
   default:
     break;
@@ -1354,8 +1546,7 @@ void Parser::syntaxErrorRecovery(ParseContext::context context) {
 
 iterate:
   auto curKind = initial;
-  while (find(curSafeSymbols.begin(), curSafeSymbols.end(), curKind) ==
-         curSafeSymbols.end()) {
+  while (!curSafeSymbols->contains(curKind)) {
     scan.getNextToken();
     curKind = scan.getToken().getKind();
   }
@@ -16,17 +16,78 @@ using FuncSymPtr = std::shared_ptr<FunctionSymbol>;
 using UDTyPtr = std::shared_ptr<UserDefinedType>;
 using AnonTyPtr = std::shared_ptr<AnonymousType>;
 
+/// getSlot - Get the first slot to probe for NameID in an index of Size
+/// slots, Size is a power of two.
+static std::size_t getSlot(std::uint32_t NameID, std::size_t Size) {
+  // Fibonacci hashing, the interned IDs are dense and small.
+  return (NameID * 0x9E3779B9u) & (Size - 1);
+}
+
+void Scope::addDef(std::shared_ptr<Symbol> sym) {
+  SymbolTable.push_back(std::move(sym));
+  if (SymbolTable.back()->getNameID())
+    indexDef(SymbolTable.size() - 1);
+}
+
+void Scope::indexDef(std::uint32_t Def) {
+  if ((NumIndexed + 1) * 2 > Index.size()) {
+    std::vector<IndexSlot> Old(std::max<std::size_t>(Index.size() * 2, 8));
+    Old.swap(Index);
+    NumIndexed = 0;
+    for (const IndexSlot &Slot : Old)
+      if (Slot.NameID)
+        indexDef(Slot.Def);
+  }
+  std::uint32_t NameID = SymbolTable[Def]->getNameID();
+  for (std::size_t i = getSlot(NameID, Index.size());;
+       i = (i + 1) & (Index.size() - 1)) {
+    if (Index[i].NameID == NameID)
+      return;
+    if (!Index[i].NameID) {
+      Index[i] = {NameID, Def};
+      ++NumIndexed;
+      return;
+    }
+  }
+}
+
+void Scope::rebuildIndex() {
+  Index.clear();
+  NumIndexed = 0;
+  for (std::uint32_t Def = 0; Def < SymbolTable.size(); ++Def)
+    if (SymbolTable[Def]->getNameID())
+      indexDef(Def);
+}
+
+const std::shared_ptr<Symbol> *Scope::lookupDef(std::uint32_t NameID) const {
+  if (Index.empty())
+    return nullptr;
+  for (std::size_t i = getSlot(NameID, Index.size());;
+       i = (i + 1) & (Index.size() - 1)) {
+    if (Index[i].NameID == NameID)
+      return &SymbolTable[Index[i].Def];
+    if (!Index[i].NameID)
+      return nullptr;
+  }
+}
+
 // Lookup the symbol with specified 'name' in the scope chain. If not found,
 // return nullptr.
 std::shared_ptr<Symbol> Scope::Resolve(const std::string &name) const {
-  // Look up the name in current scope.
-  for (auto item : SymbolTable)
-    if (item->getLexem() == name)
-      return item;
-
-  if (Parent)
-    return Parent->Resolve(name);
-
+  // A name that was never interned isn't defined anywhere.
+  std::uint32_t NameID = StringInterner::get().lookup(name);
+  return NameID ? Resolve(NameID) : nullptr;
+}
+
+std::shared_ptr<Symbol> Scope::Resolve(std::uint32_t NameID,
+                                       std::size_t NumTopLevelDefs) const {
+  for (const Scope *S = this; S; S = S->Parent.get())
+    if (const std::shared_ptr<Symbol> *Sym = S->lookupDef(NameID)) {
+      if (!S->Parent &&
+          std::size_t(Sym - S->SymbolTable.data()) >= NumTopLevelDefs)
+        return nullptr;
+      return *Sym;
+    }
   return nullptr;
 }
 
@@ -34,6 +95,21 @@ void Sema::ActOnTranslationUnitStart() {
   CurScope = std::make_shared<Scope>("##TranslationUnit", 0, nullptr,
                                      Scope::ScopeKind::SK_TopLevel);
   ScopeStack.push_back(CurScope);
+  // The symbols of print are made for every call, their names are interned
+  // up front for the function bodies checked on read-only threads.
+  Support::StringInterner::get().intern("print");
+  Support::StringInterner::get().intern("parm");
+}
+
+void Sema::ActOnFunctionBodyStart(std::shared_ptr<FunctionSymbol> Func,
+                                  std::shared_ptr<Scope> BodyScope,
+                                  std::size_t NumTopLevelDefs) {
+  std::shared_ptr<Scope> FuncScope = BodyScope->getParent();
+  ScopeStack = {FuncScope->getParent(), FuncScope, BodyScope};
+  CurScope = BodyScope;
+  FunctionStack = {Func};
+  ClassStack.clear();
+  NumVisibleTopLevelDefs = NumTopLevelDefs;
 }
 
 /// \brief ActOnFunctionDecl - Mainly for checking function name and recording
@@ -41,7 +117,7 @@ void Sema::ActOnTranslationUnitStart() {
 void Sema::ActOnFunctionDeclStart(const std::string &name) {
   // Check function name.
   // Note: moses doesn't support function overload now.
-  if (CurScope->Resolve(name)) {
+  if (resolve(name)) {
     errorReport("Function redefinition.");
   }
 
@@ -82,12 +158,12 @@ void Sema::ActOnFunctionDecl([[maybe_unused]] const std::string &name,
 StmtASTPtr Sema::ActOnIfStmt(SourceLocation start, SourceLocation end,
                              ExprASTPtr condition, StmtASTPtr ThenPart,
                              StmtASTPtr ElsePart) {
-  Expr *cond = condition.get();
+  Expr *cond = condition;
   if (!cond) {
     // To Do:
   }
-  return std::make_shared<IfStatement>(start, end, condition, ThenPart,
-                                       ElsePart);
+  return Ctx.create<IfStatement>(start, end, condition, ThenPart,
+                                 ElsePart);
 }
 
 /// \brief Action routines about CompoundStatement.
@@ -125,8 +201,8 @@ bool Sema::ActOnBreakAndContinueStmt(bool whileContext) {
 
 /// \brief Mainly current whether identifier is user defined type.
 std::shared_ptr<ASTType> Sema::ActOnReturnType(const std::string &name) const {
-  if (ClassSymPtr sym = std::dynamic_pointer_cast<ClassSymbol>(
-          ScopeStack[0]->CheckWhetherInCurScope(name))) {
+  if (ClassSymPtr sym =
+          std::dynamic_pointer_cast<ClassSymbol>(resolveTopLevel(name))) {
     return sym->getType();
   } else {
     errorReport("Current identifier isn't user defined type.");
@@ -142,6 +218,7 @@ void Sema::ActOnParmDecl(const std::string &name, ParmDeclPtr parm) {
   
   auto vsym = std::make_shared<ParmDeclSymbol>(name, CurScope,
                                                parm->getDeclType(), true, parm);
+  parm->setSymbol(vsym.get());
 
   CurScope->addDef(vsym);
   getFunctionStackTop()->addParmVariableSymbol(vsym);
@@ -176,8 +253,10 @@ void Sema::ActOnVarDecl(
     VarDeclPtr VD /*, std::shared_ptr<Type> declType, ExprASTPtr InitExpr*/) {
   ExprASTPtr Init = VD->getInitExpr();
   auto declType = VD->getDeclType();
-  CurScope->addDef(std::make_shared<VariableSymbol>(
-      name, CurScope, declType, VD->getInitExpr() ? true : false, VD));
+  auto VarSym = std::make_shared<VariableSymbol>(
+      name, CurScope, declType, VD->getInitExpr() ? true : false, VD);
+  VD->setSymbol(VarSym.get());
+  CurScope->addDef(VarSym);
 
   if (ClassStack.size() != 0) {
     if (Init)
@@ -224,11 +303,10 @@ bool Sema::ActOnReturnStmt(std::shared_ptr<ASTType> type) const {
 /// \brief Act on declaration reference.
 /// Perferm name lookup and type checking.
 VarDeclPtr Sema::ActOnDeclRefExpr(const std::string &name) {
-  if (VarSymPtr vsym =
-          std::dynamic_pointer_cast<VariableSymbol>(CurScope->Resolve(name))) {
+  std::shared_ptr<Symbol> sym = resolve(name);
+  if (VarSymPtr vsym = std::dynamic_pointer_cast<VariableSymbol>(sym)) {
     return vsym->getDecl();
-  } else if (ParmSymPtr psym = std::dynamic_pointer_cast<ParmDeclSymbol>(
-                 CurScope->Resolve(name))) {
+  } else if (ParmSymPtr psym = std::dynamic_pointer_cast<ParmDeclSymbol>(sym)) {
     return psym->getDecl();
   } else {
     errorReport("Undefined variable.");
@@ -240,7 +318,7 @@ VarDeclPtr Sema::ActOnDeclRefExpr(const std::string &name) {
 /// Perform name lookup and parm type checking.
 std::shared_ptr<ASTType>
 Sema::ActOnCallExpr(const std::string &name, std::vector<std::shared_ptr<ASTType>> args,
-                    FunctionDeclPtr &FD) {
+                    FunctionDeclPtr &FD, FunctionSymbol *&Callee) {
   std::shared_ptr<ASTType> ReturnType = nullptr;
 
   // First check whether the call is `print()`.
@@ -260,20 +338,23 @@ Sema::ActOnCallExpr(const std::string &name, std::vector<std::shared_ptr<ASTType
     std::shared_ptr<FunctionSymbol> PrintSym = std::make_shared<FunctionSymbol>(
         name, std::make_shared<ASTType>(TypeKind::VOID), ScopeStack[0], nullptr);
 
-    ParmDeclPtr ParmDecl = std::make_shared<ParameterDecl>(
+    ParmDeclPtr ParmDecl = Ctx.create<ParameterDecl>(
         SourceLocation(), SourceLocation(), "parm", false, args[0]);
 
-    PrintSym->addParmVariableSymbol(std::make_shared<ParmDeclSymbol>(
-        "parm", nullptr, args[0], false, ParmDecl));
+    auto ParmSym = std::make_shared<ParmDeclSymbol>("parm", nullptr, args[0],
+                                                    false, ParmDecl);
+    ParmDecl->setSymbol(ParmSym.get());
+    PrintSym->addParmVariableSymbol(ParmSym);
 
     // FIXME: There need better approach to generate the Functiondecl about
     // `print`.
     std::vector<ParmDeclPtr> Parms;
     Parms.push_back(ParmDecl);
 
-    FD = std::make_shared<FunctionDecl>(SourceLocation(), SourceLocation(),
-                                        name, Parms, nullptr,
-                                        PrintSym->getReturnType(), true);
+    FD = Ctx.create<FunctionDecl>(SourceLocation(), SourceLocation(), name,
+                                  Ctx.copyArray(Parms), nullptr,
+                                  PrintSym->getReturnType(), true);
+    FD->setSymbol(PrintSym.get());
 
     if (args[0] != Ctx.Int && args[0] != Ctx.Bool)
       errorReport("Builtin function 'print()' can only accept one parameter "
@@ -281,11 +362,12 @@ Sema::ActOnCallExpr(const std::string &name, std::vector<std::shared_ptr<ASTType
 
     PrintSym->setReturnType(Ctx.Void);
     CurScope->addDef(PrintSym);
+    Callee = PrintSym.get();
     return PrintSym->getReturnType();
   }
 
-  if (FuncSymPtr FuncSym = std::dynamic_pointer_cast<FunctionSymbol>(
-          ScopeStack[0]->CheckWhetherInCurScope(name))) {
+  if (FuncSymPtr FuncSym =
+          std::dynamic_pointer_cast<FunctionSymbol>(resolveTopLevel(name))) {
     ReturnType = FuncSym->getReturnType();
     // check args number and type.
     if (args.size() != FuncSym->getParmNum()) {
@@ -312,6 +394,7 @@ Sema::ActOnCallExpr(const std::string &name, std::vector<std::shared_ptr<ASTType
       }
     }
     FD = FuncSym->getFuncDeclPointer();
+    Callee = FuncSym.get();
   } else {
     errorReport("Function undefined.");
   }
@@ -320,7 +403,7 @@ Sema::ActOnCallExpr(const std::string &name, std::vector<std::shared_ptr<ASTType
 
 /// \brief Act on Binary Operator(Type checking and create new binary expr
 /// through lhs and rhs). To Do: Shit code!
-ExprASTPtr Sema::ActOnBinaryOperator(ExprASTPtr lhs, Token tok,
+ExprASTPtr Sema::ActOnBinaryOperator(ExprASTPtr lhs, const Token &tok,
                                      ExprASTPtr rhs) {
   if (!lhs || !rhs)
     return nullptr;
@@ -343,10 +426,10 @@ ExprASTPtr Sema::ActOnBinaryOperator(ExprASTPtr lhs, Token tok,
         TypeKeyInfo::TypeKeyInfo::getHashValue(rhs->getType()))
       errorReport("Type on the left and type on the right must be same.");
     type = lhs->getType();
-    if (DeclRefExprPtr DRE = std::dynamic_pointer_cast<DeclRefExpr>(lhs)) {
+    if (DeclRefExprPtr DRE = dynamic_cast<DeclRefExpr *>(lhs)) {
       if (DRE->getDecl()->isConst()) {
         if (VarSymPtr sym = std::dynamic_pointer_cast<VariableSymbol>(
-                CurScope->Resolve(DRE->getDeclName()))) {
+                resolve(DRE->getDeclName()))) {
           if (sym->isInitial()) {
             errorReport("Can not assign to const type.");
           } else {
@@ -405,8 +488,8 @@ ExprASTPtr Sema::ActOnBinaryOperator(ExprASTPtr lhs, Token tok,
     type = lhs->getType();
   }
 
-  auto BE = std::make_shared<BinaryExpr>(lhs->getLocStart(), rhs->getLocEnd(),
-                                         type, tok.getLexem(), lhs, rhs);
+  auto BE = Ctx.create<BinaryExpr>(lhs->getLocStart(), rhs->getLocEnd(),
+                                   type, tok.getLexem(), lhs, rhs);
 
   return BE;
 }
@@ -419,7 +502,7 @@ ExprASTPtr Sema::ActOnBinaryOperator(ExprASTPtr lhs, Token tok,
 ///		}
 ///		var base : A;
 ///		base.num = 10;
-ExprASTPtr Sema::ActOnMemberAccessExpr(ExprASTPtr lhs, Token tok) {
+ExprASTPtr Sema::ActOnMemberAccessExpr(ExprASTPtr lhs, const Token &tok) {
   /// (1) Check LHS
   if (!lhs->getType() || lhs->getType()->getKind() != TypeKind::USERDEFIED) {
     errorReport("Type error. Expect user defined type.");
@@ -441,7 +524,7 @@ ExprASTPtr Sema::ActOnMemberAccessExpr(ExprASTPtr lhs, Token tok) {
 
   if (!memberType)
     return nullptr;
-  return std::make_shared<MemberExpr>(
+  return Ctx.create<MemberExpr>(
       lhs->getLocStart(), lhs->getLocEnd(), memberType, lhs, tok.getTokenLoc(),
       tok.getLexem(), memberType->getKind() != TypeKind::USERDEFIED, idx);
 }
@@ -459,11 +542,11 @@ ExprASTPtr Sema::ActOnDecOrIncExpr(ExprASTPtr rhs) {
     errorReport("Operator '++' '--' need operand is lvalue");
   }
 
-  if (DeclRefExprPtr DeclRef = std::dynamic_pointer_cast<DeclRefExpr>(rhs)) {
+  if (DeclRefExprPtr DeclRef = dynamic_cast<DeclRefExpr *>(rhs)) {
     auto decl = DeclRef->getDecl();
     if (!decl)
       errorReport("Declaration reference error!");
-    auto symbol = CurScope->Resolve(decl->getName());
+    auto symbol = resolve(decl->getName());
     if (VarSymPtr sym = std::dynamic_pointer_cast<VariableSymbol>(symbol)) {
       if (decl->isConst() && sym->isInitial()) {
         errorReport("Const variable can't be assigned.");
@@ -496,8 +579,7 @@ ExprASTPtr Sema::ActOnUnarySubExpr(ExprASTPtr rhs) {
 /// Shit code!
 UnpackDeclPtr Sema::ActOnUnpackDecl(UnpackDeclPtr unpackDecl,
                                     std::shared_ptr<ASTType> type) {
-  if (UnpackDeclPtr unpackd =
-          std::dynamic_pointer_cast<UnpackDecl>(unpackDecl)) {
+  if (unpackDecl) {
     if (!type) {
       errorReport("Unapck declaration's initial expression type error.");
     }
@@ -517,7 +599,7 @@ UnpackDeclPtr Sema::ActOnUnpackDecl(UnpackDeclPtr unpackDecl,
 /// \brief
 BinaryPtr Sema::ActOnAnonymousTypeVariableAssignment(ExprASTPtr lhs,
                                                      ExprASTPtr rhs) const {
-  if (DeclRefExprPtr DRE = std::dynamic_pointer_cast<DeclRefExpr>(lhs)) {
+  if (DeclRefExprPtr DRE = dynamic_cast<DeclRefExpr *>(lhs)) {
     // Type Checking.
     if (TypeKeyInfo::TypeKeyInfo::getHashValue(DRE->getType()) !=
         TypeKeyInfo::TypeKeyInfo::getHashValue(rhs->getType())) {
@@ -526,8 +608,8 @@ BinaryPtr Sema::ActOnAnonymousTypeVariableAssignment(ExprASTPtr lhs,
   } else {
     errorReport("Error occured in anonymous type variable assigning.");
   }
-  return std::make_shared<BinaryExpr>(lhs->getLocStart(), rhs->getLocEnd(),
-                                      lhs->getType(), "=", lhs, rhs);
+  return Ctx.create<BinaryExpr>(lhs->getLocStart(), rhs->getLocEnd(),
+                                lhs->getType(), "=", lhs, rhs);
 }
 
 /// \brief Mainly check the conditon expression type.
@@ -540,9 +622,9 @@ bool Sema::ActOnConditionExpr(std::shared_ptr<ASTType> type) const {
 }
 
 /// \brief Mainly check parameter declaration type.
-std::shared_ptr<ASTType> Sema::ActOnParmDeclUserDefinedType(Token tok) const {
+std::shared_ptr<ASTType> Sema::ActOnParmDeclUserDefinedType(const Token &tok) const {
   if (ClassSymPtr csym = std::dynamic_pointer_cast<ClassSymbol>(
-          ScopeStack[0]->CheckWhetherInCurScope(tok.getLexem()))) {
+          resolveTopLevel(tok.getLexem()))) {
     return csym->getType();
   } else {
     errorReport("Undefined type.");
@@ -551,7 +633,7 @@ std::shared_ptr<ASTType> Sema::ActOnParmDeclUserDefinedType(Token tok) const {
 }
 
 /// \brief Mainly check variable declararion type.
-std::shared_ptr<ASTType> Sema::ActOnVarDeclUserDefinedType(Token tok) const {
+std::shared_ptr<ASTType> Sema::ActOnVarDeclUserDefinedType(const Token &tok) const {
   return ActOnParmDeclUserDefinedType(tok);
 }
 
@@ -582,21 +664,38 @@ void Sema::PopScope() {
   CurScope = getScopeStackTop();
 }
 
-/// \brief Look up name for current scope.
-std::shared_ptr<Symbol> Scope::CheckWhetherInCurScope(const std::string &name) {
+void Sema::PopToTopLevelScope() {
+  ScopeStack.resize(1);
+  CurScope = ScopeStack[0];
+  FunctionStack.clear();
+  ClassStack.clear();
+}
 
-  for (auto item : SymbolTable) {
-    if (item->getLexem() == name) {
-      return item;
-    }
-  }
-  return nullptr;
+/// \brief Look up name for current scope.
+std::shared_ptr<Symbol> Scope::CheckWhetherInCurScope(const std::string &name,
+                                                      std::size_t NumDefs) {
+  std::uint32_t NameID = StringInterner::get().lookup(name);
+  if (!NameID)
+    return nullptr;
+  const std::shared_ptr<Symbol> *Sym = lookupDef(NameID);
+  if (!Sym || std::size_t(Sym - SymbolTable.data()) >= NumDefs)
+    return nullptr;
+  return *Sym;
 }
 
 std::shared_ptr<Scope> Sema::getScopeStackBottom() const {
   return ScopeStack[0];
 }
 
+std::shared_ptr<Symbol> Sema::resolve(const std::string &name) const {
+  std::uint32_t NameID = StringInterner::get().lookup(name);
+  return NameID ? CurScope->Resolve(NameID, NumVisibleTopLevelDefs) : nullptr;
+}
+
+std::shared_ptr<Symbol> Sema::resolveTopLevel(const std::string &name) const {
+  return ScopeStack[0]->CheckWhetherInCurScope(name, NumVisibleTopLevelDefs);
+}
+
 std::shared_ptr<Scope> Sema::getScopeStackTop() const {
   if (ScopeStack.size() == 0) {
     errorReport("Now in top-level scope and we can't get current scope.");
@@ -630,9 +729,11 @@ Sema::unpackDeclTypeChecking(UnpackDeclPtr decl,
     // 3: symbol
       std::size_t size = unpackDecls.size();
     for (unsigned index = 0; index < size; index++) {
-      CurScope->addDef(std::make_shared<VariableSymbol>(
+      auto VarSym = std::make_shared<VariableSymbol>(
           unpackDecls[index]->getName(), CurScope, types[index], true,
-          unpackDecls[index]));
+          unpackDecls[index]);
+      unpackDecls[index]->setSymbol(VarSym.get());
+      CurScope->addDef(VarSym);
     }
   } else {
     errorReport("Unpack declaration type error.");
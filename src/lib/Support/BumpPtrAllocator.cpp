@@ -0,0 +1,39 @@
+//===--------------------------BumpPtrAllocator.cpp-----------------------===//
+//
+// This file is used to implement class BumpPtrAllocator.
+//
+//===---------------------------------------------------------------------===//
+#include "Support/BumpPtrAllocator.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace Support;
+
+BumpPtrAllocator::~BumpPtrAllocator() {
+  for (auto Iter = Destructors.rbegin(); Iter != Destructors.rend(); ++Iter)
+    Iter->Destroy(Iter->Object);
+}
+
+void BumpPtrAllocator::takeFrom(BumpPtrAllocator &Other) {
+  // The free space of the last slab of Other is lost.
+  Slabs.insert(Slabs.end(), std::make_move_iterator(Other.Slabs.begin()),
+               std::make_move_iterator(Other.Slabs.end()));
+  Destructors.insert(Destructors.end(), Other.Destructors.begin(),
+                     Other.Destructors.end());
+  BytesAllocated += Other.BytesAllocated;
+  Other.Slabs.clear();
+  Other.Destructors.clear();
+  Other.Cur = Other.End = nullptr;
+  Other.BytesAllocated = 0;
+}
+
+char *BumpPtrAllocator::grow(std::size_t Size, std::size_t Align) {
+  std::size_t NewSize = SlabSize << std::min<std::size_t>(Slabs.size(), 10);
+  // An allocation bigger than a slab gets a slab of its own.
+  NewSize = std::max(NewSize, Size + Align - 1);
+  Slabs.emplace_back(new char[NewSize]);
+  char *Slab = Slabs.back().get();
+  End = Slab + NewSize;
+  std::size_t Adjust = -reinterpret_cast<std::uintptr_t>(Slab) & (Align - 1);
+  return Slab + Adjust;
+}
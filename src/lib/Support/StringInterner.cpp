@@ -0,0 +1,41 @@
+//===--------------------------StringInterner.cpp-------------------------===//
+//
+// Implements the class StringInterner.
+//
+//===---------------------------------------------------------------------===//
+#include "Support/StringInterner.h"
+#include <cassert>
+
+using namespace Support;
+
+// Set while a ReadOnlyScope of this thread is alive.
+static thread_local bool ReadOnly = false;
+
+StringInterner::ReadOnlyScope::ReadOnlyScope() : Prev(ReadOnly) {
+  ReadOnly = true;
+}
+
+StringInterner::ReadOnlyScope::~ReadOnlyScope() { ReadOnly = Prev; }
+
+StringInterner &StringInterner::get() {
+  static StringInterner TheInterner;
+  return TheInterner;
+}
+
+std::uint32_t StringInterner::intern(std::string_view Str) {
+  auto Iter = IDs.find(Str);
+  if (Iter != IDs.end())
+    return Iter->second;
+  assert(!ReadOnly && "A new string is interned on a read-only thread.");
+
+  std::string_view Stored = Storage.emplace_back(Str);
+  std::uint32_t ID = Strings.size();
+  Strings.push_back(Stored);
+  IDs.emplace(Stored, ID);
+  return ID;
+}
+
+std::uint32_t StringInterner::lookup(std::string_view Str) const {
+  auto Iter = IDs.find(Str);
+  return Iter != IDs.end() ? Iter->second : 0;
+}
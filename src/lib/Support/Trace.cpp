@@ -0,0 +1,132 @@
+//===-------------------------------Trace.cpp-----------------------------===//
+//
+// Implements the trace subsystem.
+//
+//===---------------------------------------------------------------------===//
+#include "Support/Trace.h"
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using namespace Trace;
+
+Level Trace::ChannelLevels[static_cast<unsigned>(Channel::NumChannels)] = {
+    Level::Off, Level::Off, Level::Off, Level::Off};
+
+static std::unique_ptr<Sink> &getSinkStorage() {
+  static std::unique_ptr<Sink> TheSink = std::make_unique<StreamSink>(std::cout);
+  return TheSink;
+}
+
+const char *Trace::getChannelName(Channel C) {
+  switch (C) {
+  case Channel::Tokens:
+    return "tokens";
+  case Channel::IR:
+    return "ir";
+  case Channel::DomTree:
+    return "domtree";
+  case Channel::Exec:
+    return "exec";
+  default:
+    assert(0 && "Unknown trace channel.");
+    return "";
+  }
+}
+
+void Trace::setLevel(Channel C, Level L) {
+  ChannelLevels[static_cast<unsigned>(C)] = L;
+}
+
+void Trace::setSink(std::unique_ptr<Sink> S) {
+  getSinkStorage()->flush();
+  getSinkStorage() = std::move(S);
+}
+
+Sink &Trace::getSink() { return *getSinkStorage(); }
+
+bool Trace::parseChannels(const std::string &Spec) {
+  std::size_t Begin = 0;
+  while (Begin <= Spec.size()) {
+    std::size_t End = Spec.find(',', Begin);
+    if (End == std::string::npos)
+      End = Spec.size();
+    std::string Item = Spec.substr(Begin, End - Begin);
+    Begin = End + 1;
+
+    std::string Name = Item;
+    Level L = Level::Debug;
+    std::size_t Eq = Item.find('=');
+    if (Eq != std::string::npos) {
+      Name = Item.substr(0, Eq);
+      std::string LevelName = Item.substr(Eq + 1);
+      if (LevelName == "off")
+        L = Level::Off;
+      else if (LevelName == "info")
+        L = Level::Info;
+      else if (LevelName == "debug")
+        L = Level::Debug;
+      else
+        return false;
+    }
+
+    bool Found = false;
+    for (unsigned i = 0; i < static_cast<unsigned>(Channel::NumChannels); i++) {
+      Channel C = static_cast<Channel>(i);
+      if (Name == "all" || Name == getChannelName(C)) {
+        setLevel(C, L);
+        Found = true;
+      }
+    }
+    if (!Found)
+      return false;
+  }
+  return true;
+}
+
+bool Trace::parseSink(const std::string &Spec) {
+  if (Spec == "stdout") {
+    setSink(std::make_unique<StreamSink>(std::cout));
+  } else if (Spec == "stderr") {
+    setSink(std::make_unique<StreamSink>(std::cerr));
+  } else if (Spec == "null") {
+    setSink(std::make_unique<NullSink>());
+  } else if (Spec.compare(0, 5, "file:") == 0) {
+    auto File = std::make_unique<FileSink>(Spec.substr(5));
+    if (!File->isOpen())
+      return false;
+    setSink(std::move(File));
+  } else if (Spec.compare(0, 5, "ring:") == 0) {
+    char *End = nullptr;
+    unsigned long long Capacity = std::strtoull(Spec.c_str() + 5, &End, 10);
+    if (Capacity == 0 || *End != '\0')
+      return false;
+    setSink(std::make_unique<RingSink>(std::cerr, Capacity));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+//===---------------------------------------------------------------------===//
+// Implements the class RingSink.
+void RingSink::write(Channel C, Level, const std::string &Msg) {
+  if (Records.size() == Capacity) {
+    Records.pop_front();
+    ++Dropped;
+  }
+  Records.push_back({C, Msg});
+}
+
+void RingSink::flush() {
+  if (Dropped)
+    Out << "[trace] " << Dropped << " earlier messages dropped\n";
+  for (auto &R : Records) {
+    Out << "[" << getChannelName(R.C) << "] " << R.Msg;
+    if (!R.Msg.empty() && R.Msg.back() != '\n')
+      Out << "\n";
+  }
+  Records.clear();
+  Dropped = 0;
+  Out.flush();
+}
@@ -5,19 +5,55 @@
 //===-----------------------------------------------------------------------------------===//
 #include "Support/error.h"
 #include <iostream>
+#include <iterator>
+
+// The buffer the errors of this thread go to, nullptr prints them.
+static thread_local DiagnosticBuffer *CurBuffer = nullptr;
+
+static void report(std::string Line) {
+  if (CurBuffer)
+    CurBuffer->add(std::move(Line));
+  else
+    std::cerr << Line << std::endl;
+}
 
 void errorOption(const std::string &msg) {
-  std::cerr << "Option Error: " << " ----- " << msg << std::endl;
+  report("Option Error:  ----- " + msg);
+}
+
+void errorToken(const std::string &msg) { report("Token Error: " + msg); }
+
+void errorParser(const std::string &msg) { report("parser error: " + msg); }
+
+void errorSema(const std::string &msg) { report("sema error: " + msg); }
+
+void errorExecution(const std::string &msg) {
+  report("runtime error: " + msg);
+}
+
+DiagnosticBuffer::Capture::Capture(DiagnosticBuffer &Buffer)
+    : Prev(CurBuffer) {
+  CurBuffer = &Buffer;
 }
 
-void errorToken(const std::string &msg) {
-  std::cerr << "Token Error: " << msg << std::endl;
+DiagnosticBuffer::Capture::~Capture() { CurBuffer = Prev; }
+
+void DiagnosticBuffer::splice(std::size_t Pos, DiagnosticBuffer &Other) {
+  Lines.insert(Lines.begin() + Pos, std::make_move_iterator(Other.Lines.begin()),
+               std::make_move_iterator(Other.Lines.end()));
+  Other.Lines.clear();
 }
 
-void errorParser(const std::string &msg) {
-  std::cerr << "parser error: " << msg << std::endl;
+void DiagnosticBuffer::flush() {
+  std::vector<std::string> Flushed;
+  Flushed.swap(Lines);
+  for (std::string &Line : Flushed)
+    report(std::move(Line));
 }
 
-void errorSema(const std::string &msg) {
-  std::cerr << "sema error: " << msg << std::endl;
-}
\ No newline at end of file
+void DiagnosticBuffer::flushCaptured() {
+  DiagnosticBuffer *Buffer = CurBuffer;
+  CurBuffer = nullptr;
+  if (Buffer)
+    Buffer->flush();
+}
@@ -10,9 +10,18 @@
 #include "IRBuild/IRBuilder.h"
 #include "Lexer/scanner.h"
 #include "Parser/ASTContext.h"
+#include "Parser/ModuleFile.h"
 #include "Parser/parser.h"
+#include "Support/Trace.h"
+#include "Support/error.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 
 using namespace parse;
@@ -20,41 +29,278 @@ using namespace sema;
 using namespace IR;
 using namespace IRBuild;
 using namespace Execution;
+
+static void printUsage() {
+  std::cerr << "usage: moses [options] <file.mo>\n"
+               "  --engine=<ir|bytecode|jit|tiered>\n"
+               "                          the tier that executes the program\n"
+               "  --max-call-depth=<n>    stop the program when its call stack\n"
+               "                          outgrows <n> frames, the top-level\n"
+               "                          code included, 100000 by default\n"
+               "  --tier-threshold=<n>    the calls or loop iterations before\n"
+               "                          the tiered mode compiles the code\n"
+               "  --tier-stats            print the promotions of the tiered\n"
+               "                          mode\n"
+               "  --no-superinstructions  don't fuse the bytecode sequences\n"
+               "  --pair-stats=<file>     add the counts of the executed\n"
+               "                          instruction pairs to <file>\n"
+               "  --profile=<file>        write the execution profile to <file>\n"
+               "                          and the folded stacks to <file>.folded\n"
+               "  --trace=<channel>[=<level>],...\n"
+               "                          trace the channels tokens, ir, domtree,\n"
+               "                          exec or all at the level info or debug\n"
+               "  --trace-sink=<stdout|stderr|null|file:<path>|ring:<n>>\n"
+               "                          where the trace is written\n"
+               "  --lex-only              only scan the file, and print the\n"
+               "                          lexing throughput\n"
+               "  --lex-threads=<n>       lex the file in chunks on <n> threads,\n"
+               "                          0 for one per core\n"
+               "  --sema-threads=<n>      check the function bodies on <n> threads\n"
+               "                          once the rest of the file is parsed,\n"
+               "                          0 for one per core\n"
+               "  --edit=<offset>,<length>,<text>\n"
+               "                          replace <length> bytes at <offset> by\n"
+               "                          <text> once the file is parsed, and\n"
+               "                          parse the edit incrementally\n"
+               "  --no-module             don't load or write the precompiled\n"
+               "                          module <file>.mc\n";
+}
+
+/// SourceEdit - An edit of the source given by --edit.
+struct SourceEdit {
+  std::uint32_t Offset;
+  std::uint32_t RemovedLength;
+  std::string Inserted;
+};
+
+/// parseEdit - Parse "<offset>,<length>,<text>", the text may hold commas.
+static bool parseEdit(const std::string &Spec, SourceEdit &Edit) {
+  std::size_t FirstComma = Spec.find(',');
+  std::size_t SecondComma = Spec.find(',', FirstComma + 1);
+  if (SecondComma == std::string::npos)
+    return false;
+  char *End;
+  Edit.Offset = std::strtoul(Spec.c_str(), &End, 10);
+  if (End != Spec.c_str() + FirstComma)
+    return false;
+  Edit.RemovedLength = std::strtoul(Spec.c_str() + FirstComma + 1, &End, 10);
+  if (End != Spec.c_str() + SecondComma)
+    return false;
+  Edit.Inserted = Spec.substr(SecondComma + 1);
+  return true;
+}
+
+/// lexOnly - Scan the whole file and report the number of tokens and the
+/// throughput, used to measure the scanner.
+static int lexOnly(const std::string &SourcePath, unsigned LexThreads) {
+  auto Start = std::chrono::steady_clock::now();
+  Scanner scanner(SourcePath, LexThreads);
+  if (scanner.getErrorFlag())
+    return 1;
+  std::size_t NumTokens = 0;
+  while (scanner.getNextToken().getKind() != TokenValue::FILE_EOF)
+    ++NumTokens;
+  double Seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - Start)
+                       .count();
+  double MBytes = scanner.getSource().getBufferSize() / (1024.0 * 1024.0);
+  std::cerr << NumTokens << " tokens, " << MBytes << " MB in "
+            << Seconds * 1000 << " ms, " << MBytes / Seconds << " MB/s ("
+            << ScanKernels::getLevelName(ScanKernels::get().KernelLevel)
+            << " kernels)\n";
+  return 0;
+}
+
+/// loadModule - Load the precompiled module of the file, if it was written for
+/// the current contents of the file.
+static bool loadModule(const std::string &SourcePath,
+                       const std::string &ModulePath, ASTContext &Ctx,
+                       ASTPtr &AST, std::shared_ptr<Scope> &TopScope) {
+  SourceBuffer Source;
+  if (!Source.load(SourcePath))
+    return false;
+  SourceManager &SM = SourceManager::get();
+  if (!ModuleReader(Ctx).read(ModulePath, Source.getBuffer(),
+                              SM.getNextFileBase(), AST, TopScope))
+    return false;
+  // The source locations of the AST point into the file.
+  unsigned FileID;
+  SM.addFile(SourcePath, FileID);
+  return true;
+}
+
+/// parseSource - Parse and check the file, and apply the edits. The result is
+/// saved to ModulePath unless it is empty. Return false if the file has
+/// errors.
+static bool parseSource(const std::string &SourcePath, unsigned LexThreads,
+                        unsigned SemaThreads,
+                        const std::vector<SourceEdit> &Edits,
+                        const std::string &ModulePath, ASTContext &Ctx,
+                        ASTPtr &AST, std::shared_ptr<Scope> &TopScope) {
+  Scanner scanner(SourcePath, LexThreads);
+  Sema sema(Ctx);
+  Parser parse(scanner, sema, Ctx, SemaThreads);
+  parse.parse();
+  for (const SourceEdit &Edit : Edits) {
+    if (Edit.Offset + std::uint64_t(Edit.RemovedLength) >
+        scanner.getSource().getBufferSize()) {
+      errorOption("The edit is out of the file.");
+      exit(1);
+    }
+    parse.applyEdit(Edit.Offset, Edit.RemovedLength, Edit.Inserted);
+  }
+  if (!Ctx.isParseOrSemaSuccess)
+    return false;
+
+  AST = parse.getAST();
+  TopScope = sema.getScopeStackBottom();
+  // A file the scanner reports anything for is parsed every time, so that
+  // the report is never lost.
+  if (!ModulePath.empty() && !scanner.getErrorFlag() &&
+      !scanner.hasDiagnostics())
+    ModuleWriter(Ctx).write(ModulePath, scanner.getSource().getBuffer(),
+                            scanner.getFileBase(), AST, TopScope);
+  return true;
+}
+
 int main(int argc, char *argv[]) {
   // FIXME: We should use more mature approach to handle user options.
-  if (argc != 2) {
+  std::string SourcePath;
+  std::string PairStatsPath;
+  std::string ProfilePath;
+  bool TierStats = false;
+  bool LexOnly = false;
+  bool UseModule = true;
+  unsigned LexThreads = 1;
+  unsigned SemaThreads = 1;
+  std::vector<SourceEdit> Edits;
+  InterpreterOptions Options;
+  for (int i = 1; i < argc; i++) {
+    std::string Arg(argv[i]);
+    if (Arg.compare(0, 9, "--engine=") == 0) {
+      std::string Mode = Arg.substr(9);
+      if (Mode == "ir")
+        Options.Mode = ExecutionMode::IR;
+      else if (Mode == "bytecode")
+        Options.Mode = ExecutionMode::Bytecode;
+      else if (Mode == "jit")
+        Options.Mode = ExecutionMode::JIT;
+      else if (Mode == "tiered")
+        Options.Mode = ExecutionMode::Tiered;
+      else {
+        errorOption("Unknown engine '" + Mode + "'.");
+        printUsage();
+        exit(1);
+      }
+    } else if (Arg.compare(0, 17, "--max-call-depth=") == 0) {
+      Options.MaxCallDepth = std::strtoull(Arg.c_str() + 17, nullptr, 10);
+      if (Options.MaxCallDepth == 0) {
+        errorOption("The call depth limit must be a positive number.");
+        exit(1);
+      }
+    } else if (Arg.compare(0, 17, "--tier-threshold=") == 0) {
+      Options.TierUpThreshold = std::strtoull(Arg.c_str() + 17, nullptr, 10);
+      if (Options.TierUpThreshold == 0) {
+        errorOption("The tier-up threshold must be a positive number.");
+        exit(1);
+      }
+    } else if (Arg == "--lex-only") {
+      LexOnly = true;
+    } else if (Arg.compare(0, 14, "--lex-threads=") == 0) {
+      LexThreads = std::strtoul(Arg.c_str() + 14, nullptr, 10);
+      if (LexThreads == 0)
+        LexThreads = std::thread::hardware_concurrency();
+    } else if (Arg.compare(0, 15, "--sema-threads=") == 0) {
+      SemaThreads = std::strtoul(Arg.c_str() + 15, nullptr, 10);
+      if (SemaThreads == 0)
+        SemaThreads = std::thread::hardware_concurrency();
+    } else if (Arg.compare(0, 7, "--edit=") == 0) {
+      Edits.emplace_back();
+      if (!parseEdit(Arg.substr(7), Edits.back())) {
+        errorOption("Malformed edit '" + Arg.substr(7) + "'.");
+        printUsage();
+        exit(1);
+      }
+    } else if (Arg == "--no-module") {
+      UseModule = false;
+    } else if (Arg == "--tier-stats") {
+      TierStats = true;
+    } else if (Arg == "--no-superinstructions") {
+      Options.Superinstructions = false;
+    } else if (Arg.compare(0, 13, "--pair-stats=") == 0) {
+      PairStatsPath = Arg.substr(13);
+    } else if (Arg.compare(0, 8, "--trace=") == 0) {
+      if (!Trace::parseChannels(Arg.substr(8))) {
+        errorOption("Malformed trace channels '" + Arg.substr(8) + "'.");
+        printUsage();
+        exit(1);
+      }
+    } else if (Arg.compare(0, 13, "--trace-sink=") == 0) {
+      if (!Trace::parseSink(Arg.substr(13))) {
+        errorOption("Invalid trace sink '" + Arg.substr(13) + "'.");
+        printUsage();
+        exit(1);
+      }
+    } else if (Arg.compare(0, 10, "--profile=") == 0) {
+      ProfilePath = Arg.substr(10);
+      Options.Profile = true;
+    } else if (Arg.size() > 1 && Arg[0] == '-') {
+      errorOption("Unknown option '" + Arg + "'.");
+      printUsage();
+      exit(1);
+    } else if (SourcePath.empty()) {
+      SourcePath = Arg;
+    } else {
+      errorOption("Please provide only one source code path.");
+      exit(1);
+    }
+  }
+  if (SourcePath.empty()) {
     errorOption("Please provide one option to indicate the source code path.");
+    printUsage();
+    exit(1);
   }
+  if (LexOnly)
+    return lexOnly(SourcePath, LexThreads);
 
-  Scanner scanner(argv[1]);
   ASTContext Ctx;
-  Sema sema(Ctx);
-  Parser parse(scanner, sema, Ctx);
-  // (1) parse and semantic analysis.
-  parse.parse();
+  ASTPtr AST;
+  std::shared_ptr<Scope> TopScope;
+  // (1) parse and semantic analysis, or load them from the precompiled module
+  // of the file. An edited file isn't saved, and the token trace needs the
+  // file scanned.
+  std::string ModulePath;
+  if (UseModule && Edits.empty())
+    ModulePath = ModuleFile::getModulePath(SourcePath);
+  bool Loaded =
+      !ModulePath.empty() &&
+      !Trace::isEnabled(Trace::Channel::Tokens, Trace::Level::Info) &&
+      loadModule(SourcePath, ModulePath, Ctx, AST, TopScope);
 
   // (2) check error.
-  if (!Ctx.isParseOrSemaSuccess)
+  if (!Loaded &&
+      !parseSource(SourcePath, LexThreads, SemaThreads, Edits, ModulePath, Ctx,
+                   AST, TopScope))
     exit(1);
 
   // ConstantEvaluator evaluator;
-  auto AST = parse.getAST();
   MosesIRContext IRContext;
-  ModuleBuilder moduleBuilder(sema.getScopeStackBottom(), IRContext);
+  ModuleBuilder moduleBuilder(TopScope, IRContext);
   // (3) IR Build.
-  moduleBuilder.VisitChildren(parse.getAST());
+  moduleBuilder.VisitChildren(AST);
 
   // (4) IR write;
   std::ostringstream out;
   IRPrinter::Print(IRContext, out);
   IRPrinter::Print(moduleBuilder.getIRs(), out);
-  cout << out.str();
-  cout << "--------------------------------------------------------------------"
-          "------------\n";
+  MOSES_TRACE(IR, Info)
+      << out.str()
+      << "--------------------------------------------------------------------"
+         "------------\n";
 
   // Set the output path.
   // FIXME: Maybe we should allow user to provide a output path.
-  std::string OutputPath(argv[1]);
+  std::string OutputPath(SourcePath);
   OutputPath = OutputPath.substr(0, OutputPath.size() - 2);
   OutputPath += "mi";
 
@@ -73,7 +319,33 @@ int main(int argc, char *argv[]) {
   DomTree.ComputeDomFrontierOnCFG(CFG);
 
   // (5) Interpreter
-  auto interpreter = Interpreter::create(moduleBuilder.getIRs(), IRContext);
+  // The pair counts of the previous runs are merged, so that one file collects
+  // the counts of a whole workload.
+  PairProfile Pairs;
+  if (!PairStatsPath.empty()) {
+    std::ifstream PrevStats(PairStatsPath);
+    if (PrevStats && !Pairs.merge(PrevStats)) {
+      errorOption("Malformed pair stats file '" + PairStatsPath + "'.");
+      exit(1);
+    }
+    Options.Pairs = &Pairs;
+  }
+
+  auto interpreter =
+      Interpreter::create(moduleBuilder.getIRs(), IRContext, Options);
   interpreter->run();
-  return 0;
+
+  if (!PairStatsPath.empty()) {
+    std::ofstream Stats(PairStatsPath);
+    Pairs.write(Stats);
+  }
+  if (TierStats)
+    interpreter->dumpTierStats(std::cerr);
+  if (const Profiler *Prof = interpreter->getProfiler()) {
+    std::ofstream Report(ProfilePath);
+    Prof->writeReport(Report);
+    std::ofstream Folded(ProfilePath + ".folded");
+    Prof->writeFoldedStacks(Folded);
+  }
+  return interpreter->hadRuntimeError() ? 1 : 0;
 }
\ No newline at end of file